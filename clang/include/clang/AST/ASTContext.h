@@ -72,6 +72,7 @@ namespace clang {
   class VTableContextBase;
 
   namespace Builtin { class Context; }
+  namespace interp { class Context; }
   enum BuiltinTemplateKind : int;
 
   namespace comments {
@@ -1965,6 +1966,10 @@ public:
 
   VTableContextBase *getVTableContext();
 
+  /// \brief Returns the context of the bytecode constant interpreter, which
+  /// holds the constexpr functions it has compiled.
+  interp::Context &getInterpContext();
+
   MangleContext *createMangleContext();
   
   void DeepCollectObjCIvars(const ObjCInterfaceDecl *OI, bool leafClass,
@@ -2598,6 +2603,8 @@ private:
 
   std::unique_ptr<VTableContextBase> VTContext;
 
+  std::unique_ptr<interp::Context> InterpContext;
+
 public:
   enum PragmaSectionFlag : unsigned {
     PSF_None = 0,
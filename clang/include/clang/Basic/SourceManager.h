@@ -604,6 +604,12 @@ class SourceManager : public RefCountedBase<SourceManager> {
   /// expansion.
   SmallVector<SrcMgr::SLocEntry, 0> LocalSLocEntryTable;
 
+  /// \brief The offsets of the entries in LocalSLocEntryTable.
+  ///
+  /// Kept densely packed so that the binary search in getFileIDLocal touches
+  /// far fewer cache lines than searching the SLocEntries themselves.
+  SmallVector<unsigned, 0> LocalSLocEntryOffsets;
+
   /// \brief The table of SLocEntries that are loaded from other modules.
   ///
   /// Negative FileIDs are indexes into this table. To get from ID to an index,
@@ -640,6 +646,13 @@ class SourceManager : public RefCountedBase<SourceManager> {
   /// is very common to look up many tokens from the same file.
   mutable FileID LastFileIDLookup;
 
+  /// \brief A small most-recently-used cache for getFileIDSlow.
+  ///
+  /// Unlike LastFileIDLookup this also holds macro expansions, so that
+  /// repeated queries about the same few expansions don't each need a
+  /// search. The most recently used FileID comes first.
+  mutable FileID RecentFileIDLookups[4];
+
   /// \brief Holds information for \#line directives.
   ///
   /// This is referenced by indices from SLocEntryTable.
@@ -659,7 +672,7 @@ class SourceManager : public RefCountedBase<SourceManager> {
   FileID PreambleFileID;
 
   // Statistics for -print-stats.
-  mutable unsigned NumLinearScans, NumBinaryProbes;
+  mutable unsigned NumLinearScans, NumBinaryProbes, NumRecentLookupHits;
 
   /// \brief Associates a FileID with its "included/expanded in" decomposed
   /// location.
@@ -177,6 +177,12 @@ public:
   /// Whether the driver is generating diagnostics for debugging purposes.
   unsigned CCGenDiagnostics : 1;
 
+  /// Entry point used to run -cc1 jobs inside the driver process instead of
+  /// spawning a new one. Argv holds the full command line, starting with the
+  /// executable and "-cc1". When null, every job is spawned as a process.
+  typedef int (*CC1ToolFunc)(ArrayRef<const char *> Argv);
+  CC1ToolFunc CC1Main;
+
 private:
   /// Default target triple.
   std::string DefaultTargetTriple;
@@ -96,6 +96,10 @@ public:
   virtual int Execute(const StringRef **Redirects, std::string *ErrMsg,
                       bool *ExecutionFailed) const;
 
+  /// Whether the command may run inside the driver process instead of
+  /// spawning Executable.
+  virtual bool isInProcess() const { return false; }
+
   /// getSource - Return the Action which caused the creation of this job.
   const Action &getSource() const { return Source; }
 
@@ -119,6 +123,21 @@ public:
   static void printArg(llvm::raw_ostream &OS, const char *Arg, bool Quote);
 };
 
+/// Like Command, but runs the -cc1 tool inside the driver process when the
+/// driver provides an in-process entry point (see Driver::CC1Main). This
+/// avoids paying process startup and target initialization once per job.
+class CC1Command : public Command {
+public:
+  CC1Command(const Action &Source_, const Tool &Creator_,
+             const char *Executable_, const ArgStringList &Arguments_,
+             ArrayRef<InputInfo> Inputs);
+
+  int Execute(const StringRef **Redirects, std::string *ErrMsg,
+              bool *ExecutionFailed) const override;
+
+  bool isInProcess() const override { return true; }
+};
+
 /// Like Command, but with a fallback which is executed in case
 /// the primary command crashes.
 class FallbackCommand : public Command {
@@ -179,6 +179,9 @@ private:
   /// some number of calls.
   unsigned PreambleRebuildCounter;
 
+  /// \brief The number of times a precompiled preamble was built.
+  unsigned NumPreambleBuilds;
+
 public:
   class PreambleData {
     const FileEntry *File;
@@ -221,6 +224,10 @@ public:
     return Preamble;
   }
 
+  /// \brief Returns the number of times a precompiled preamble was built for
+  /// this translation unit, for testing the reuse of the preamble.
+  unsigned getNumPreambleBuildsForTests() const { return NumPreambleBuilds; }
+
   /// Data used to determine if a file used in the preamble has been changed.
   struct PreambleFileHash {
     /// All files have size set.
@@ -230,12 +237,15 @@ public:
     /// buffers it is zero.
     time_t ModTime;
 
-    /// Memory buffers have MD5 instead of modification time.  We don't
-    /// compute MD5 for on-disk files because we hope that modification time is
-    /// enough to tell if the file was changed.
+    /// Memory buffers have MD5 instead of modification time.  On-disk files
+    /// compare equal based on size and modification time; their MD5 is only
+    /// consulted when the modification time changed, to tell whether the
+    /// file was actually modified or merely touched.
     llvm::MD5::MD5Result MD5;
 
     static PreambleFileHash createForFile(off_t Size, time_t ModTime);
+    static PreambleFileHash createForFile(off_t Size, time_t ModTime,
+                                          const llvm::MemoryBuffer *Buffer);
     static PreambleFileHash
     createForMemoryBuffer(const llvm::MemoryBuffer *Buffer);
 
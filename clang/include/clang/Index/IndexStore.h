@@ -0,0 +1,122 @@
+//===--- IndexStore.h - Index data recorded during compilation --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// The index store is a directory which the compiler fills with the symbol
+// occurrences of the translation units it compiles, when passed
+// -index-store-path. It has two kinds of files:
+//
+//   <store>/v1/records/<file name>-<hash>
+//     The symbols and occurrences found in one source file. The hash is
+//     computed from the contents of the record, so a header which is indexed
+//     the same way by many translation units is only stored once.
+//
+//   <store>/v1/units/<output file name>-<hash>
+//     One per translation unit, named after its output file. Lists the files
+//     the translation unit depends on, and the record of each of them.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_INDEX_INDEXSTORE_H
+#define LLVM_CLANG_INDEX_INDEXSTORE_H
+
+#include "clang/Basic/LLVM.h"
+#include "clang/Index/IndexSymbol.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace index {
+
+/// \brief A symbol referenced by the occurrences of a record.
+struct StoreSymbol {
+  SymbolKind Kind;
+  SymbolSubKindSet SubKinds;
+  SymbolLanguage Lang;
+  std::string Name;
+  std::string USR;
+};
+
+/// \brief A relation of an occurrence to another symbol of the same record.
+struct StoreRelation {
+  SymbolRoleSet Roles;
+  unsigned Symbol;
+};
+
+struct StoreOccurrence {
+  /// The index of the symbol in the symbols of the record.
+  unsigned Symbol;
+  SymbolRoleSet Roles;
+  unsigned Line;
+  unsigned Column;
+  std::vector<StoreRelation> Relations;
+};
+
+/// \brief The symbol occurrences found in one source file, sorted by
+/// location.
+struct IndexRecord {
+  std::vector<StoreSymbol> Symbols;
+  std::vector<StoreOccurrence> Occurrences;
+};
+
+struct IndexUnitDependency {
+  std::string FilePath;
+  /// The name of the record of the file, or empty if nothing was indexed in
+  /// it.
+  std::string RecordName;
+  bool IsSystem;
+  /// The size and modification time of the file when it was compiled, so
+  /// that clients can tell whether the unit is out of date.
+  uint64_t Size;
+  int64_t ModTime;
+};
+
+/// \brief The files a translation unit depends on, starting with its main
+/// file.
+struct IndexUnit {
+  std::string MainFilePath;
+  std::string OutputFilePath;
+  std::vector<IndexUnitDependency> Dependencies;
+};
+
+/// \brief Serialize \p Record in the compact binary form used by the store.
+void writeIndexRecord(const IndexRecord &Record, raw_ostream &OS);
+void writeIndexUnit(const IndexUnit &Unit, raw_ostream &OS);
+
+/// \brief Deserialize a record from \p Data.
+/// \returns true on error, with a description of the problem in \p Error.
+bool readIndexRecord(StringRef Data, IndexRecord &Record, std::string &Error);
+bool readIndexUnit(StringRef Data, IndexUnit &Unit, std::string &Error);
+
+/// \brief Return the name of the record of \p FilePath with the serialized
+/// contents \p RecordData.
+std::string getIndexRecordName(StringRef FilePath, StringRef RecordData);
+
+/// \brief Return the name of the unit of the translation unit which writes
+/// \p OutputFilePath.
+std::string getIndexUnitName(StringRef OutputFilePath);
+
+/// \brief Return the directories of the records and units in \p StorePath.
+std::string getIndexRecordsDirectory(StringRef StorePath);
+std::string getIndexUnitsDirectory(StringRef StorePath);
+
+/// \brief Write \p Data to the file \p Name in \p Directory, creating the
+/// directory if needed. The file is replaced atomically, so that compilers
+/// running in parallel never see a partial file.
+///
+/// \param Overwrite if false and the file already exists, leave it alone.
+/// Used for records, whose name already identifies their contents.
+///
+/// \returns true on error, with a description of the problem in \p Error.
+bool writeIndexStoreFile(StringRef Directory, StringRef Name, StringRef Data,
+                         bool Overwrite, std::string &Error);
+
+} // namespace index
+} // namespace clang
+
+#endif
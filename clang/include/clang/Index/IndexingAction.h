@@ -16,6 +16,7 @@
 namespace clang {
   class ASTUnit;
   class FrontendAction;
+  class FrontendOptions;
 
 namespace index {
   class IndexDataConsumer;
@@ -38,6 +39,13 @@ createIndexingAction(std::shared_ptr<IndexDataConsumer> DataConsumer,
                      IndexingOptions Opts,
                      std::unique_ptr<FrontendAction> WrappedAction);
 
+/// \brief Create an action which runs \p WrappedAction and records the
+/// symbol occurrences of the translation unit in the index store at
+/// \c FEOpts.IndexStorePath, without parsing the translation unit again.
+std::unique_ptr<FrontendAction>
+createIndexDataRecordingAction(const FrontendOptions &FEOpts,
+                               std::unique_ptr<FrontendAction> WrappedAction);
+
 void indexASTUnit(ASTUnit &Unit,
                   std::shared_ptr<IndexDataConsumer> DataConsumer,
                   IndexingOptions Opts);
@@ -259,6 +259,12 @@ private:
   /// \sa getMaxNodesPerTopLevelFunction
   Optional<unsigned> MaxNodesPerTopLevelFunction;
 
+  /// \sa getShardCount
+  Optional<unsigned> ShardCount;
+
+  /// \sa getShardIndex
+  Optional<unsigned> ShardIndex;
+
   /// \sa shouldInlineLambdas
   Optional<bool> InlineLambdas;
 
@@ -525,6 +531,22 @@ public:
   /// This is controlled by the 'max-nodes' config option.
   unsigned getMaxNodesPerTopLevelFunction();
 
+  /// Returns the number of shards the functions of the translation unit are
+  /// split into. Each invocation of the analyzer analyzes the functions of a
+  /// single shard, so that several processes can analyze a large translation
+  /// unit in parallel. The default is 1, i.e. all functions are analyzed.
+  ///
+  /// This is controlled by the 'shard-count' config option.
+  unsigned getShardCount();
+
+  /// Returns the index, starting at 0, of the shard analyzed by this
+  /// invocation. Every shard analyzes the same functions no matter which
+  /// other shards are run, so the reports of all shards together do not
+  /// depend on the scheduling of the processes.
+  ///
+  /// This is controlled by the 'shard-index' config option.
+  unsigned getShardIndex();
+
   /// Returns true if lambdas should be inlined. Otherwise a sink node will be
   /// generated each time a LambdaExpr is visited.
   bool shouldInlineLambdas();
@@ -323,6 +323,23 @@ class ClangTool {
   /// \param Action Tool action.
   int run(ToolAction *Action);
 
+  /// \brief Runs an action over all files specified in the command line,
+  /// processing several compile commands at the same time.
+  ///
+  /// Every compile command gets its own FileManager and working directory,
+  /// so the process-wide working directory is never changed. \p Action is
+  /// invoked from several threads at once and must be thread-safe.
+  ///
+  /// A diagnostic consumer set with setDiagnosticConsumer() is shared by all
+  /// threads, but is only ever called by one thread at a time. Without one,
+  /// the diagnostics of each compile command are buffered and printed in the
+  /// order of the source paths, independent of the thread scheduling.
+  ///
+  /// \param Action Tool action.
+  /// \param ThreadCount Number of worker threads, or 0 to use the number of
+  /// hardware threads.
+  int runConcurrently(ToolAction *Action, unsigned ThreadCount = 0);
+
   /// \brief Create an AST for each file specified in the command line and
   /// append them to ASTs.
   int buildASTs(std::vector<std::unique_ptr<ASTUnit>> &ASTs);
@@ -13,6 +13,7 @@
 
 #include "clang/AST/ASTContext.h"
 #include "CXXABI.h"
+#include "Interp/Context.h"
 #include "clang/AST/ASTMutationListener.h"
 #include "clang/AST/Attr.h"
 #include "clang/AST/CharUnits.h"
@@ -8757,6 +8758,12 @@ VTableContextBase *ASTContext::getVTableContext() {
   return VTContext.get();
 }
 
+interp::Context &ASTContext::getInterpContext() {
+  if (!InterpContext)
+    InterpContext.reset(new interp::Context(*this));
+  return *InterpContext;
+}
+
 MangleContext *ASTContext::createMangleContext() {
   switch (Target->getCXXABI().getKind()) {
   case TargetCXXABI::GenericAArch64:
@@ -0,0 +1,149 @@
+//===--- ByteCode.h - Bytecode for the constant interpreter -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the bytecode executed by the constant interpreter: the
+// opcodes, the primitive types they operate on and the compiled form of a
+// constexpr function.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LIB_AST_INTERP_BYTECODE_H
+#define LLVM_CLANG_LIB_AST_INTERP_BYTECODE_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace clang {
+class FunctionDecl;
+
+namespace interp {
+
+/// \brief The type of a primitive value: an integer of the given bit width.
+///
+/// Values live in 64-bit slots and are kept normalized: signed values are
+/// sign-extended and unsigned values zero-extended to 64 bits.
+struct PrimType {
+  uint8_t Width;
+  bool Signed;
+
+  PrimType() : Width(0), Signed(false) {}
+  PrimType(unsigned Width, bool Signed) : Width(Width), Signed(Signed) {}
+
+  /// \brief Bring the bit pattern \p V into the normalized form of this type,
+  /// wrapping it modulo 2^Width.
+  int64_t normalize(uint64_t V) const {
+    if (Width == 64)
+      return static_cast<int64_t>(V);
+    if (Signed)
+      return static_cast<int64_t>(V << (64 - Width)) >> (64 - Width);
+    return static_cast<int64_t>(V & ((uint64_t(1) << Width) - 1));
+  }
+
+  /// \brief Whether the mathematical value \p V is representable in this
+  /// type. Only meaningful for signed types.
+  bool fits(int64_t V) const { return normalize(V) == V; }
+
+  uint8_t encode() const { return Width | (Signed ? 0x80 : 0); }
+  static PrimType decode(uint8_t Byte) {
+    return PrimType(Byte & 0x7f, Byte & 0x80);
+  }
+};
+
+/// \brief The instructions of the stack machine.
+///
+/// Operands follow the opcode in the instruction stream. <type> is an
+/// encoded PrimType, <signed> a single byte.
+enum class Opcode : uint8_t {
+  Step,        ///< Consume one evaluation step.
+  Const,       ///< <int64> Push a constant.
+  GetLocal,    ///< <uint32> Push the value of a local.
+  SetLocal,    ///< <uint32> Pop a value into a local.
+  Pop,         ///< Discard the top of the stack.
+  Dup,         ///< Duplicate the top of the stack.
+  Cast,        ///< <type> Convert the top of the stack to a type.
+  ToBool,      ///< Convert the top of the stack to bool.
+  LNot,        ///< Logical negation of a bool.
+  Neg,         ///< <type> Arithmetic negation.
+  Comp,        ///< <type> Bitwise complement.
+  Add,         ///< <type> Addition.
+  Sub,         ///< <type> Subtraction.
+  Mul,         ///< <type> Multiplication.
+  Div,         ///< <type> Division.
+  Rem,         ///< <type> Remainder.
+  Shl,         ///< <type> <signed> Left shift; the operand gives whether the
+               ///< shift count is signed.
+  Shr,         ///< <type> <signed> Right shift.
+  And,         ///< <type> Bitwise and.
+  Or,          ///< <type> Bitwise or.
+  Xor,         ///< <type> Bitwise xor.
+  LT,          ///< <signed> Less than.
+  LE,          ///< <signed> Less than or equal.
+  GT,          ///< <signed> Greater than.
+  GE,          ///< <signed> Greater than or equal.
+  EQ,          ///< Equality.
+  NE,          ///< Inequality.
+  Jmp,         ///< <int32> Jump, relative to the end of the instruction.
+  JmpIfFalse,  ///< <int32> Pop a bool and jump if it is false.
+  JmpIfTrue,   ///< <int32> Pop a bool and jump if it is true.
+  Call,        ///< <uint32> Call the function with the given callee index.
+  Ret,         ///< Return the top of the stack.
+  Trap         ///< Evaluation cannot continue.
+};
+
+/// \brief A constexpr function compiled to bytecode.
+class Function {
+public:
+  Function(const FunctionDecl *Decl) : Decl(Decl) {}
+
+  const FunctionDecl *getDecl() const { return Decl; }
+
+  /// \brief Whether the function was compiled successfully.
+  bool isValid() const { return Valid; }
+  void setValid(bool V) { Valid = V; }
+
+  llvm::ArrayRef<uint8_t> getCode() const { return Code; }
+
+  unsigned getNumParams() const { return ParamTypes.size(); }
+  llvm::ArrayRef<PrimType> getParamTypes() const { return ParamTypes; }
+  PrimType getReturnType() const { return ReturnType; }
+
+  /// \brief The number of local slots, including the parameters.
+  unsigned getNumLocals() const { return NumLocals; }
+
+  const FunctionDecl *getCallee(unsigned Index) const {
+    return Callees[Index];
+  }
+
+  /// \brief Read an operand of type \p T from \p PC and advance it.
+  template <typename T> static T read(const uint8_t *&PC) {
+    T Value;
+    std::memcpy(&Value, PC, sizeof(T));
+    PC += sizeof(T);
+    return Value;
+  }
+
+private:
+  friend class ByteCodeEmitter;
+
+  const FunctionDecl *Decl;
+  std::vector<uint8_t> Code;
+  std::vector<const FunctionDecl *> Callees;
+  std::vector<PrimType> ParamTypes;
+  PrimType ReturnType;
+  unsigned NumLocals = 0;
+  bool Valid = false;
+};
+
+} // end namespace interp
+} // end namespace clang
+
+#endif
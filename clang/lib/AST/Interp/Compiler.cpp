@@ -0,0 +1,782 @@
+//===--- Compiler.cpp - Bytecode compiler for the constant interpreter ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file compiles the bodies of constexpr functions to the bytecode run by
+// the constant interpreter.
+//
+// Only integer parameters, locals and return values are supported, together
+// with the statements and expressions operating on them. Anything else makes
+// the compilation fail, and calls to the function are then left to the
+// AST-walking evaluator.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Context.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/StmtCXX.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+
+using namespace clang;
+using namespace clang::interp;
+
+namespace clang {
+namespace interp {
+
+/// \brief Emits the bytecode of a single function.
+class ByteCodeEmitter {
+public:
+  ByteCodeEmitter(Context &Ctx, Function &F)
+      : Ctx(Ctx), ASTCtx(Ctx.getASTContext()), F(F) {}
+
+  bool compileFunction();
+
+private:
+  /// \brief The pending jumps out of the innermost loop.
+  struct LoopLabels {
+    SmallVector<size_t, 4> Breaks;
+    SmallVector<size_t, 4> Continues;
+  };
+
+  Context &Ctx;
+  ASTContext &ASTCtx;
+  Function &F;
+
+  /// \brief The slots of the parameters and local variables.
+  llvm::DenseMap<const VarDecl *, unsigned> Locals;
+  llvm::DenseMap<const FunctionDecl *, unsigned> CalleeIndices;
+  LoopLabels *CurLoop = nullptr;
+
+  void emit(Opcode Op) { F.Code.push_back(static_cast<uint8_t>(Op)); }
+
+  template <typename T> void emitOperand(T Value) {
+    size_t Pos = F.Code.size();
+    F.Code.resize(Pos + sizeof(T));
+    std::memcpy(&F.Code[Pos], &Value, sizeof(T));
+  }
+
+  void emitConst(int64_t Value) {
+    emit(Opcode::Const);
+    emitOperand(Value);
+  }
+
+  void emitTyped(Opcode Op, PrimType T) {
+    emit(Op);
+    emitOperand(T.encode());
+  }
+
+  void emitLocal(Opcode Op, unsigned Slot) {
+    emit(Op);
+    emitOperand<uint32_t>(Slot);
+  }
+
+  /// \brief Emit a jump whose target is set later by patchJump.
+  /// \returns the position of the jump offset.
+  size_t emitJump(Opcode Op) {
+    emit(Op);
+    size_t Pos = F.Code.size();
+    emitOperand<int32_t>(0);
+    return Pos;
+  }
+
+  void setJumpTarget(size_t Pos, size_t Target) {
+    int32_t Offset = static_cast<int32_t>(Target) -
+                     static_cast<int32_t>(Pos + sizeof(int32_t));
+    std::memcpy(&F.Code[Pos], &Offset, sizeof(Offset));
+  }
+
+  /// \brief Make the jump at \p Pos jump to the next instruction emitted.
+  void patchJump(size_t Pos) { setJumpTarget(Pos, F.Code.size()); }
+
+  /// \brief Emit a jump to the already emitted instruction at \p Target.
+  void emitJumpTo(Opcode Op, size_t Target) {
+    setJumpTarget(emitJump(Op), Target);
+  }
+
+  bool classify(QualType T, PrimType &PT) const {
+    return !T.isVolatileQualified() && Ctx.classify(T, PT);
+  }
+
+  // Statements.
+  bool visitStmt(const Stmt *S);
+  bool visitDeclStmt(const DeclStmt *DS);
+  bool visitIfStmt(const IfStmt *IS);
+  bool visitWhileStmt(const WhileStmt *WS);
+  bool visitDoStmt(const DoStmt *DS);
+  bool visitForStmt(const ForStmt *FS);
+  bool visitLoopBody(const Stmt *Body, LoopLabels &Labels);
+
+  // Expressions.
+  bool visitRValue(const Expr *E);
+  bool visitLValue(const Expr *E, unsigned &Slot);
+  bool visitLoad(const Expr *E);
+  bool visitDiscarded(const Expr *E);
+  bool visitCast(const CastExpr *CE, PrimType T);
+  bool visitUnaryOperator(const UnaryOperator *UO, PrimType T);
+  bool visitBinaryOperator(const BinaryOperator *BO, PrimType T);
+  bool visitAssignment(const BinaryOperator *BO, unsigned &Slot);
+  bool visitIncDec(const UnaryOperator *UO, unsigned &Slot, bool KeepOld);
+  bool visitCall(const CallExpr *CE);
+  bool visitGlobalConstant(const VarDecl *VD, PrimType T);
+  bool emitArith(BinaryOperatorKind Op, PrimType T, PrimType RHS);
+};
+
+} // end namespace interp
+} // end namespace clang
+
+bool ByteCodeEmitter::compileFunction() {
+  const FunctionDecl *FD = F.getDecl();
+  if (!FD->isConstexpr() || FD->isInvalidDecl() || FD->isVariadic())
+    return false;
+  if (const auto *MD = dyn_cast<CXXMethodDecl>(FD))
+    if (!MD->isStatic())
+      return false;
+
+  if (!classify(FD->getReturnType(), F.ReturnType))
+    return false;
+  for (const ParmVarDecl *P : FD->parameters()) {
+    PrimType T;
+    if (!classify(P->getType(), T))
+      return false;
+    unsigned Slot = Locals.size();
+    Locals[P] = Slot;
+    F.ParamTypes.push_back(T);
+  }
+
+  if (!visitStmt(FD->getBody()))
+    return false;
+
+  // Flowing off the end of the function is not a constant expression.
+  emit(Opcode::Trap);
+  F.NumLocals = Locals.size();
+  return true;
+}
+
+bool ByteCodeEmitter::visitStmt(const Stmt *S) {
+  // Charge one step per statement, as the AST-walking evaluator does.
+  emit(Opcode::Step);
+
+  switch (S->getStmtClass()) {
+  case Stmt::NullStmtClass:
+    return true;
+
+  case Stmt::CompoundStmtClass:
+    for (const Stmt *Child : cast<CompoundStmt>(S)->body())
+      if (!visitStmt(Child))
+        return false;
+    return true;
+
+  case Stmt::DeclStmtClass:
+    return visitDeclStmt(cast<DeclStmt>(S));
+  case Stmt::IfStmtClass:
+    return visitIfStmt(cast<IfStmt>(S));
+  case Stmt::WhileStmtClass:
+    return visitWhileStmt(cast<WhileStmt>(S));
+  case Stmt::DoStmtClass:
+    return visitDoStmt(cast<DoStmt>(S));
+  case Stmt::ForStmtClass:
+    return visitForStmt(cast<ForStmt>(S));
+
+  case Stmt::ReturnStmtClass: {
+    const Expr *RetValue = cast<ReturnStmt>(S)->getRetValue();
+    if (!RetValue || !visitRValue(RetValue))
+      return false;
+    emit(Opcode::Ret);
+    return true;
+  }
+
+  case Stmt::BreakStmtClass:
+    if (!CurLoop)
+      return false;
+    CurLoop->Breaks.push_back(emitJump(Opcode::Jmp));
+    return true;
+
+  case Stmt::ContinueStmtClass:
+    if (!CurLoop)
+      return false;
+    CurLoop->Continues.push_back(emitJump(Opcode::Jmp));
+    return true;
+
+  default:
+    if (const auto *E = dyn_cast<Expr>(S))
+      return visitDiscarded(E);
+    return false;
+  }
+}
+
+bool ByteCodeEmitter::visitDeclStmt(const DeclStmt *DS) {
+  for (const Decl *D : DS->decls()) {
+    if (isa<TypedefNameDecl>(D) || isa<StaticAssertDecl>(D))
+      continue;
+
+    // Variables without an initializer would need to track whether they
+    // were assigned before being read.
+    const auto *VD = dyn_cast<VarDecl>(D);
+    PrimType T;
+    if (!VD || !VD->hasLocalStorage() || !VD->getInit() ||
+        !classify(VD->getType(), T) || !visitRValue(VD->getInit()))
+      return false;
+
+    unsigned Slot = Locals.size();
+    Locals[VD] = Slot;
+    emitLocal(Opcode::SetLocal, Slot);
+  }
+  return true;
+}
+
+bool ByteCodeEmitter::visitIfStmt(const IfStmt *IS) {
+  if (IS->getInit() || IS->getConditionVariable())
+    return false;
+
+  if (!visitRValue(IS->getCond()))
+    return false;
+  size_t ToElse = emitJump(Opcode::JmpIfFalse);
+  if (!visitStmt(IS->getThen()))
+    return false;
+
+  if (const Stmt *Else = IS->getElse()) {
+    size_t ToEnd = emitJump(Opcode::Jmp);
+    patchJump(ToElse);
+    if (!visitStmt(Else))
+      return false;
+    patchJump(ToEnd);
+  } else {
+    patchJump(ToElse);
+  }
+  return true;
+}
+
+bool ByteCodeEmitter::visitLoopBody(const Stmt *Body, LoopLabels &Labels) {
+  LoopLabels *OuterLoop = CurLoop;
+  CurLoop = &Labels;
+  bool Success = visitStmt(Body);
+  CurLoop = OuterLoop;
+  return Success;
+}
+
+bool ByteCodeEmitter::visitWhileStmt(const WhileStmt *WS) {
+  if (WS->getConditionVariable())
+    return false;
+
+  LoopLabels Labels;
+  size_t CondPos = F.Code.size();
+  if (!visitRValue(WS->getCond()))
+    return false;
+  size_t ToEnd = emitJump(Opcode::JmpIfFalse);
+  if (!visitLoopBody(WS->getBody(), Labels))
+    return false;
+  emitJumpTo(Opcode::Jmp, CondPos);
+
+  patchJump(ToEnd);
+  for (size_t Pos : Labels.Breaks)
+    patchJump(Pos);
+  for (size_t Pos : Labels.Continues)
+    setJumpTarget(Pos, CondPos);
+  return true;
+}
+
+bool ByteCodeEmitter::visitDoStmt(const DoStmt *DS) {
+  LoopLabels Labels;
+  size_t BodyPos = F.Code.size();
+  if (!visitLoopBody(DS->getBody(), Labels))
+    return false;
+
+  size_t CondPos = F.Code.size();
+  if (!visitRValue(DS->getCond()))
+    return false;
+  emitJumpTo(Opcode::JmpIfTrue, BodyPos);
+
+  for (size_t Pos : Labels.Breaks)
+    patchJump(Pos);
+  for (size_t Pos : Labels.Continues)
+    setJumpTarget(Pos, CondPos);
+  return true;
+}
+
+bool ByteCodeEmitter::visitForStmt(const ForStmt *FS) {
+  if (FS->getConditionVariable())
+    return false;
+  if (FS->getInit() && !visitStmt(FS->getInit()))
+    return false;
+
+  LoopLabels Labels;
+  size_t CondPos = F.Code.size();
+  size_t ToEnd = 0;
+  bool HasCond = FS->getCond();
+  if (HasCond) {
+    if (!visitRValue(FS->getCond()))
+      return false;
+    ToEnd = emitJump(Opcode::JmpIfFalse);
+  }
+  if (!visitLoopBody(FS->getBody(), Labels))
+    return false;
+
+  size_t IncPos = F.Code.size();
+  if (FS->getInc() && !visitDiscarded(FS->getInc()))
+    return false;
+  emitJumpTo(Opcode::Jmp, CondPos);
+
+  if (HasCond)
+    patchJump(ToEnd);
+  for (size_t Pos : Labels.Breaks)
+    patchJump(Pos);
+  for (size_t Pos : Labels.Continues)
+    setJumpTarget(Pos, IncPos);
+  return true;
+}
+
+bool ByteCodeEmitter::visitRValue(const Expr *E) {
+  PrimType T;
+  if (!E->isRValue() || !classify(E->getType(), T))
+    return false;
+
+  if (const auto *CE = dyn_cast<CastExpr>(E))
+    return visitCast(CE, T);
+
+  switch (E->getStmtClass()) {
+  case Stmt::IntegerLiteralClass:
+    emitConst(T.normalize(cast<IntegerLiteral>(E)->getValue().getZExtValue()));
+    return true;
+  case Stmt::CharacterLiteralClass:
+    emitConst(T.normalize(cast<CharacterLiteral>(E)->getValue()));
+    return true;
+  case Stmt::CXXBoolLiteralExprClass:
+    emitConst(cast<CXXBoolLiteralExpr>(E)->getValue());
+    return true;
+  case Stmt::CXXScalarValueInitExprClass:
+    emitConst(0);
+    return true;
+
+  case Stmt::ParenExprClass:
+    return visitRValue(cast<ParenExpr>(E)->getSubExpr());
+  case Stmt::ExprWithCleanupsClass:
+    return visitRValue(cast<ExprWithCleanups>(E)->getSubExpr());
+  case Stmt::CXXDefaultArgExprClass:
+    return visitRValue(cast<CXXDefaultArgExpr>(E)->getExpr());
+  case Stmt::SubstNonTypeTemplateParmExprClass:
+    return visitRValue(
+        cast<SubstNonTypeTemplateParmExpr>(E)->getReplacement());
+
+  case Stmt::InitListExprClass: {
+    const auto *ILE = cast<InitListExpr>(E);
+    if (ILE->getNumInits() == 0) {
+      emitConst(0);
+      return true;
+    }
+    return ILE->getNumInits() == 1 && visitRValue(ILE->getInit(0));
+  }
+
+  case Stmt::DeclRefExprClass:
+    if (const auto *ECD =
+            dyn_cast<EnumConstantDecl>(cast<DeclRefExpr>(E)->getDecl())) {
+      const llvm::APSInt &Value = ECD->getInitVal();
+      emitConst(T.normalize(Value.isSigned() ? Value.getSExtValue()
+                                             : Value.getZExtValue()));
+      return true;
+    }
+    return false;
+
+  // These do not depend on the values of locals, so fold them right away.
+  case Stmt::UnaryExprOrTypeTraitExprClass:
+  case Stmt::TypeTraitExprClass:
+  case Stmt::ArrayTypeTraitExprClass:
+  case Stmt::ExpressionTraitExprClass:
+  case Stmt::CXXNoexceptExprClass:
+  case Stmt::OffsetOfExprClass: {
+    llvm::APSInt Value;
+    if (!E->EvaluateAsInt(Value, ASTCtx))
+      return false;
+    emitConst(T.normalize(Value.isSigned() ? Value.getSExtValue()
+                                           : Value.getZExtValue()));
+    return true;
+  }
+
+  case Stmt::UnaryOperatorClass:
+    return visitUnaryOperator(cast<UnaryOperator>(E), T);
+  case Stmt::BinaryOperatorClass:
+  case Stmt::CompoundAssignOperatorClass:
+    return visitBinaryOperator(cast<BinaryOperator>(E), T);
+
+  case Stmt::ConditionalOperatorClass: {
+    const auto *CO = cast<ConditionalOperator>(E);
+    if (!visitRValue(CO->getCond()))
+      return false;
+    size_t ToFalse = emitJump(Opcode::JmpIfFalse);
+    if (!visitRValue(CO->getTrueExpr()))
+      return false;
+    size_t ToEnd = emitJump(Opcode::Jmp);
+    patchJump(ToFalse);
+    if (!visitRValue(CO->getFalseExpr()))
+      return false;
+    patchJump(ToEnd);
+    return true;
+  }
+
+  case Stmt::CallExprClass:
+    return visitCall(cast<CallExpr>(E));
+
+  default:
+    return false;
+  }
+}
+
+bool ByteCodeEmitter::visitCast(const CastExpr *CE, PrimType T) {
+  const Expr *SubExpr = CE->getSubExpr();
+  switch (CE->getCastKind()) {
+  case CK_LValueToRValue:
+    return visitLoad(SubExpr);
+  case CK_NoOp:
+    return visitRValue(SubExpr);
+  case CK_IntegralCast:
+    if (!visitRValue(SubExpr))
+      return false;
+    emitTyped(Opcode::Cast, T);
+    return true;
+  case CK_IntegralToBoolean:
+    if (!visitRValue(SubExpr))
+      return false;
+    emit(Opcode::ToBool);
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool ByteCodeEmitter::visitLoad(const Expr *E) {
+  PrimType T;
+  if (!E->isGLValue() || !classify(E->getType(), T))
+    return false;
+
+  if (const auto *DRE = dyn_cast<DeclRefExpr>(E->IgnoreParens()))
+    if (const auto *VD = dyn_cast<VarDecl>(DRE->getDecl()))
+      if (!Locals.count(VD))
+        return visitGlobalConstant(VD, T);
+
+  unsigned Slot;
+  if (!visitLValue(E, Slot))
+    return false;
+  emitLocal(Opcode::GetLocal, Slot);
+  return true;
+}
+
+bool ByteCodeEmitter::visitGlobalConstant(const VarDecl *VD, PrimType T) {
+  if (VD->hasLocalStorage() || VD->isWeak() ||
+      !VD->isUsableInConstantExpressions(ASTCtx))
+    return false;
+
+  const VarDecl *Definition = nullptr;
+  if (!VD->getAnyInitializer(Definition))
+    return false;
+  // Values of const variables that are not constant initialized would be
+  // diagnosed by the AST-walking evaluator.
+  if (!Definition->isConstexpr() && !Definition->checkInitIsICE())
+    return false;
+
+  const APValue *Value = Definition->evaluateValue();
+  if (!Value || !Value->isInt())
+    return false;
+  const llvm::APSInt &Int = Value->getInt();
+  emitConst(T.normalize(Int.isSigned() ? Int.getSExtValue()
+                                       : Int.getZExtValue()));
+  return true;
+}
+
+bool ByteCodeEmitter::visitLValue(const Expr *E, unsigned &Slot) {
+  E = E->IgnoreParens();
+  PrimType T;
+  if (!E->isGLValue() || !classify(E->getType(), T))
+    return false;
+
+  if (const auto *DRE = dyn_cast<DeclRefExpr>(E)) {
+    const auto *VD = dyn_cast<VarDecl>(DRE->getDecl());
+    auto It = VD ? Locals.find(VD) : Locals.end();
+    if (It == Locals.end())
+      return false;
+    Slot = It->second;
+    return true;
+  }
+
+  if (const auto *BO = dyn_cast<BinaryOperator>(E)) {
+    if (BO->isAssignmentOp())
+      return visitAssignment(BO, Slot);
+    if (BO->getOpcode() == BO_Comma)
+      return visitDiscarded(BO->getLHS()) && visitLValue(BO->getRHS(), Slot);
+    return false;
+  }
+
+  if (const auto *UO = dyn_cast<UnaryOperator>(E))
+    if (UO->isPrefix() && UO->isIncrementDecrementOp())
+      return visitIncDec(UO, Slot, /*KeepOld=*/false);
+
+  return false;
+}
+
+bool ByteCodeEmitter::visitDiscarded(const Expr *E) {
+  E = E->IgnoreParens();
+  unsigned Slot;
+
+  if (const auto *EWC = dyn_cast<ExprWithCleanups>(E))
+    return visitDiscarded(EWC->getSubExpr());
+
+  if (const auto *BO = dyn_cast<BinaryOperator>(E)) {
+    if (BO->isAssignmentOp())
+      return visitAssignment(BO, Slot);
+    if (BO->getOpcode() == BO_Comma)
+      return visitDiscarded(BO->getLHS()) && visitDiscarded(BO->getRHS());
+  }
+
+  if (const auto *UO = dyn_cast<UnaryOperator>(E))
+    if (UO->isIncrementDecrementOp())
+      return visitIncDec(UO, Slot, /*KeepOld=*/false);
+
+  if (const auto *CE = dyn_cast<CastExpr>(E))
+    if (CE->getCastKind() == CK_ToVoid)
+      return visitDiscarded(CE->getSubExpr());
+
+  // A discarded glvalue is not read.
+  if (E->isGLValue())
+    return visitLValue(E, Slot);
+
+  if (!visitRValue(E))
+    return false;
+  emit(Opcode::Pop);
+  return true;
+}
+
+bool ByteCodeEmitter::visitUnaryOperator(const UnaryOperator *UO,
+                                         PrimType T) {
+  const Expr *SubExpr = UO->getSubExpr();
+  switch (UO->getOpcode()) {
+  case UO_Plus:
+  case UO_Extension:
+    return visitRValue(SubExpr);
+  case UO_Minus:
+    if (!visitRValue(SubExpr))
+      return false;
+    emitTyped(Opcode::Neg, T);
+    return true;
+  case UO_Not:
+    if (!visitRValue(SubExpr))
+      return false;
+    emitTyped(Opcode::Comp, T);
+    return true;
+  case UO_LNot:
+    if (!visitRValue(SubExpr))
+      return false;
+    emit(Opcode::LNot);
+    return true;
+  case UO_PostInc:
+  case UO_PostDec: {
+    unsigned Slot;
+    return visitIncDec(UO, Slot, /*KeepOld=*/true);
+  }
+  default:
+    return false;
+  }
+}
+
+bool ByteCodeEmitter::visitIncDec(const UnaryOperator *UO, unsigned &Slot,
+                                  bool KeepOld) {
+  PrimType T;
+  if (!classify(UO->getSubExpr()->getType(), T) || T.Width == 1 ||
+      !visitLValue(UO->getSubExpr(), Slot))
+    return false;
+
+  emitLocal(Opcode::GetLocal, Slot);
+  if (KeepOld)
+    emit(Opcode::Dup);
+
+  // Types narrower than int are incremented as int and converted back, so
+  // they wrap around instead of overflowing.
+  unsigned IntWidth = ASTCtx.getIntWidth(ASTCtx.IntTy);
+  PrimType OpType = T.Width < IntWidth ? PrimType(IntWidth, true) : T;
+  emitConst(1);
+  emitTyped(UO->isIncrementOp() ? Opcode::Add : Opcode::Sub, OpType);
+  emitTyped(Opcode::Cast, T);
+  emitLocal(Opcode::SetLocal, Slot);
+  return true;
+}
+
+bool ByteCodeEmitter::visitAssignment(const BinaryOperator *BO,
+                                      unsigned &Slot) {
+  PrimType T;
+  if (!classify(BO->getLHS()->getType(), T))
+    return false;
+
+  if (BO->getOpcode() == BO_Assign) {
+    if (!visitRValue(BO->getRHS()) || !visitLValue(BO->getLHS(), Slot))
+      return false;
+    emitLocal(Opcode::SetLocal, Slot);
+    return true;
+  }
+
+  // For compound assignments, convert the value of the LHS to the type the
+  // operation is performed in, and convert the result back.
+  const auto *CAO = cast<CompoundAssignOperator>(BO);
+  PrimType LHSType, ResultType, RHSType;
+  if (!classify(CAO->getComputationLHSType(), LHSType) ||
+      !classify(CAO->getComputationResultType(), ResultType) ||
+      !classify(CAO->getRHS()->getType(), RHSType) ||
+      !visitLValue(BO->getLHS(), Slot))
+    return false;
+
+  emitLocal(Opcode::GetLocal, Slot);
+  emitTyped(Opcode::Cast, LHSType);
+  if (!visitRValue(BO->getRHS()) ||
+      !emitArith(BinaryOperator::getOpForCompoundAssignment(BO->getOpcode()),
+                 ResultType, RHSType))
+    return false;
+  emitTyped(Opcode::Cast, T);
+  emitLocal(Opcode::SetLocal, Slot);
+  return true;
+}
+
+bool ByteCodeEmitter::visitBinaryOperator(const BinaryOperator *BO,
+                                          PrimType T) {
+  const Expr *LHS = BO->getLHS();
+  const Expr *RHS = BO->getRHS();
+  BinaryOperatorKind Op = BO->getOpcode();
+
+  // Assignments are only prvalues in C.
+  if (BO->isAssignmentOp()) {
+    unsigned Slot;
+    if (!visitAssignment(BO, Slot))
+      return false;
+    emitLocal(Opcode::GetLocal, Slot);
+    return true;
+  }
+
+  switch (Op) {
+  case BO_Comma:
+    return visitDiscarded(LHS) && visitRValue(RHS);
+
+  case BO_LAnd:
+  case BO_LOr: {
+    if (!visitRValue(LHS))
+      return false;
+    size_t ToShortCircuit =
+        emitJump(Op == BO_LAnd ? Opcode::JmpIfFalse : Opcode::JmpIfTrue);
+    if (!visitRValue(RHS))
+      return false;
+    size_t ToEnd = emitJump(Opcode::Jmp);
+    patchJump(ToShortCircuit);
+    emitConst(Op == BO_LOr);
+    patchJump(ToEnd);
+    return true;
+  }
+
+  case BO_LT:
+  case BO_GT:
+  case BO_LE:
+  case BO_GE:
+  case BO_EQ:
+  case BO_NE: {
+    PrimType OperandType;
+    if (!classify(LHS->getType(), OperandType) || !visitRValue(LHS) ||
+        !visitRValue(RHS))
+      return false;
+    switch (Op) {
+    case BO_EQ:
+      emit(Opcode::EQ);
+      return true;
+    case BO_NE:
+      emit(Opcode::NE);
+      return true;
+    case BO_LT:
+      emit(Opcode::LT);
+      break;
+    case BO_GT:
+      emit(Opcode::GT);
+      break;
+    case BO_LE:
+      emit(Opcode::LE);
+      break;
+    default:
+      emit(Opcode::GE);
+      break;
+    }
+    emitOperand<uint8_t>(OperandType.Signed);
+    return true;
+  }
+
+  default: {
+    PrimType RHSType;
+    return classify(RHS->getType(), RHSType) && visitRValue(LHS) &&
+           visitRValue(RHS) && emitArith(Op, T, RHSType);
+  }
+  }
+}
+
+bool ByteCodeEmitter::emitArith(BinaryOperatorKind Op, PrimType T,
+                                PrimType RHS) {
+  switch (Op) {
+  case BO_Mul:
+    emitTyped(Opcode::Mul, T);
+    return true;
+  case BO_Div:
+    emitTyped(Opcode::Div, T);
+    return true;
+  case BO_Rem:
+    emitTyped(Opcode::Rem, T);
+    return true;
+  case BO_Add:
+    emitTyped(Opcode::Add, T);
+    return true;
+  case BO_Sub:
+    emitTyped(Opcode::Sub, T);
+    return true;
+  case BO_Shl:
+  case BO_Shr:
+    emitTyped(Op == BO_Shl ? Opcode::Shl : Opcode::Shr, T);
+    emitOperand<uint8_t>(RHS.Signed);
+    return true;
+  case BO_And:
+    emitTyped(Opcode::And, T);
+    return true;
+  case BO_Xor:
+    emitTyped(Opcode::Xor, T);
+    return true;
+  case BO_Or:
+    emitTyped(Opcode::Or, T);
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool ByteCodeEmitter::visitCall(const CallExpr *CE) {
+  const FunctionDecl *Callee = CE->getDirectCallee();
+  if (!Callee || Callee->getBuiltinID() ||
+      CE->getNumArgs() != Callee->getNumParams())
+    return false;
+  if (const auto *MD = dyn_cast<CXXMethodDecl>(Callee))
+    if (!MD->isStatic())
+      return false;
+
+  for (const Expr *Arg : CE->arguments())
+    if (!visitRValue(Arg))
+      return false;
+
+  // The callee is compiled when it is first called, as its definition may
+  // not have been parsed yet.
+  auto It = CalleeIndices.find(Callee);
+  if (It == CalleeIndices.end()) {
+    It = CalleeIndices.insert(std::make_pair(Callee, F.Callees.size())).first;
+    F.Callees.push_back(Callee);
+  }
+  emit(Opcode::Call);
+  emitOperand<uint32_t>(It->second);
+  return true;
+}
+
+bool interp::compile(Context &Ctx, Function &F) {
+  return ByteCodeEmitter(Ctx, F).compileFunction();
+}
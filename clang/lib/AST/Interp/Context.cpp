@@ -0,0 +1,100 @@
+//===--- Context.cpp - Context for the constant interpreter -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the interface between the AST-walking constant
+// evaluator and the bytecode constant interpreter.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Context.h"
+#include "clang/AST/APValue.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "llvm/ADT/SmallVector.h"
+
+using namespace clang;
+using namespace clang::interp;
+
+Context::Context(ASTContext &Ctx) : Ctx(Ctx) {}
+
+Context::~Context() {}
+
+bool Context::classify(QualType T, PrimType &PT) const {
+  if (!T->isIntegralOrEnumerationType())
+    return false;
+
+  unsigned Width = Ctx.getIntWidth(T);
+  if (Width == 1 ? !T->isBooleanType()
+                 : Width != 8 && Width != 16 && Width != 32 && Width != 64)
+    return false;
+
+  PT = PrimType(Width, T->isSignedIntegerOrEnumerationType());
+  return true;
+}
+
+const Function *Context::getFunction(const FunctionDecl *FD) {
+  // Don't cache anything for functions without a body yet: the definition
+  // may still follow.
+  const FunctionDecl *Definition = nullptr;
+  if (!FD->getBody(Definition))
+    return nullptr;
+
+  auto It = Functions.find(Definition);
+  if (It != Functions.end())
+    return It->second->isValid() ? It->second.get() : nullptr;
+
+  // Compiling can evaluate the initializers of constants, which can get here
+  // again, so don't hold on to the map entry. The function stays invalid
+  // until it is compiled, which keeps recursive uses on the AST-walking
+  // evaluator.
+  Function *F = new Function(Definition);
+  Functions[Definition].reset(F);
+  F->setValid(compile(*this, *F));
+  return F->isValid() ? F : nullptr;
+}
+
+bool Context::evaluateCall(const FunctionDecl *FD, ArrayRef<APValue> Args,
+                           unsigned Depth, unsigned &StepsLeft,
+                           APValue &Result) {
+  const Function *F = getFunction(FD);
+  if (!F || Args.size() != F->getNumParams() ||
+      FailedFunctions.count(F->getDecl()))
+    return false;
+
+  SmallVector<int64_t, 8> ArgValues;
+  for (unsigned I = 0, N = Args.size(); I != N; ++I) {
+    if (!Args[I].isInt())
+      return false;
+    const llvm::APSInt &Arg = Args[I].getInt();
+    PrimType PT = F->getParamTypes()[I];
+    if (Arg.getBitWidth() != PT.Width)
+      return false;
+    ArgValues.push_back(PT.Signed ? Arg.getSExtValue()
+                                  : static_cast<int64_t>(Arg.getZExtValue()));
+  }
+
+  unsigned Steps = StepsLeft;
+  int64_t Value;
+  if (!run(*this, *F, ArgValues, Depth, Ctx.getLangOpts().ConstexprCallDepth,
+           Steps, Value)) {
+    FailedFunctions.insert(F->getDecl());
+    // Charge the steps taken, unless they ran out: the AST-walking evaluator
+    // then needs them to find where the limit is exceeded.
+    if (Steps)
+      StepsLeft = Steps;
+    return false;
+  }
+  StepsLeft = Steps;
+
+  PrimType RT = F->getReturnType();
+  Result = APValue(llvm::APSInt(
+      llvm::APInt(RT.Width, static_cast<uint64_t>(Value), RT.Signed),
+      !RT.Signed));
+  return true;
+}
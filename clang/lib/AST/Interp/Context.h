@@ -0,0 +1,94 @@
+//===--- Context.h - Context for the constant interpreter -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the interface between the AST-walking constant evaluator
+// and the bytecode constant interpreter.
+//
+// The interpreter compiles constexpr functions whose parameters, locals and
+// return value are integers to bytecode once, and runs calls to them on a
+// stack machine. It gives up on any construct it does not support and on any
+// operation which is not a constant expression, leaving the call to the
+// AST-walking evaluator, which also produces the diagnostics.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LIB_AST_INTERP_CONTEXT_H
+#define LLVM_CLANG_LIB_AST_INTERP_CONTEXT_H
+
+#include "ByteCode.h"
+#include "clang/AST/Type.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include <memory>
+
+namespace clang {
+class APValue;
+class ASTContext;
+
+namespace interp {
+
+/// \brief Holds the compiled functions of a translation unit.
+class Context {
+public:
+  Context(ASTContext &Ctx);
+  ~Context();
+
+  ASTContext &getASTContext() const { return Ctx; }
+
+  /// \brief Try to evaluate a call to \p FD with the arguments \p Args.
+  ///
+  /// \param Depth The depth of the call in the constexpr call stack.
+  /// \param StepsLeft The number of evaluation steps left; charged for the
+  /// steps taken whether or not the evaluation succeeds, unless the steps ran
+  /// out.
+  ///
+  /// \returns true and sets \p Result if the call was evaluated, false if it
+  /// has to be evaluated by the AST-walking evaluator. Once a call to \p FD
+  /// failed, later calls to it are left to the AST-walking evaluator without
+  /// trying again.
+  bool evaluateCall(const FunctionDecl *FD, llvm::ArrayRef<APValue> Args,
+                    unsigned Depth, unsigned &StepsLeft, APValue &Result);
+
+  /// \brief Get the compiled form of \p FD, compiling it if needed.
+  ///
+  /// \returns null if \p FD is not a constexpr function with a body, or uses
+  /// constructs the interpreter does not support.
+  const Function *getFunction(const FunctionDecl *FD);
+
+  /// \brief Get the primitive type representing \p T, if there is one.
+  bool classify(QualType T, PrimType &PT) const;
+
+private:
+  ASTContext &Ctx;
+  llvm::DenseMap<const FunctionDecl *, std::unique_ptr<Function>> Functions;
+
+  /// \brief Functions a call to which failed to evaluate. The AST-walking
+  /// evaluator evaluates the calls made by the failed call again, so retrying
+  /// them here would redo the failing evaluation from every enclosing frame.
+  llvm::DenseSet<const FunctionDecl *> FailedFunctions;
+};
+
+/// \brief Run \p F on the stack machine.
+///
+/// \returns false if evaluation had to stop, e.g. because of an overflow, a
+/// call to a function that cannot be compiled or exhausting the step or
+/// depth limit.
+bool run(Context &Ctx, const Function &F, llvm::ArrayRef<int64_t> Args,
+         unsigned Depth, unsigned MaxDepth, unsigned &StepsLeft,
+         int64_t &Result);
+
+/// \brief Compile the body of \p F.
+///
+/// \returns false if the body uses constructs that are not supported.
+bool compile(Context &Ctx, Function &F);
+
+} // end namespace interp
+} // end namespace clang
+
+#endif
@@ -0,0 +1,333 @@
+//===--- Interp.cpp - Stack machine for the constant interpreter ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the stack machine which runs the bytecode of the
+// constant interpreter.
+//
+// Every operation whose result is undefined, and thus not a constant
+// expression, stops the evaluation; the AST-walking evaluator then evaluates
+// the call again and explains the problem.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Context.h"
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+
+using namespace clang;
+using namespace clang::interp;
+
+namespace {
+
+// Signed arithmetic on normalized values, failing on overflow. The only
+// width above 32 bits is 64.
+bool signedAdd(PrimType T, int64_t L, int64_t R, int64_t &Result) {
+  if (T.Width < 64) {
+    Result = L + R;
+    return T.fits(Result);
+  }
+  bool Overflow;
+  Result = llvm::APInt(64, L, true).sadd_ov(llvm::APInt(64, R, true), Overflow)
+               .getSExtValue();
+  return !Overflow;
+}
+
+bool signedSub(PrimType T, int64_t L, int64_t R, int64_t &Result) {
+  if (T.Width < 64) {
+    Result = L - R;
+    return T.fits(Result);
+  }
+  bool Overflow;
+  Result = llvm::APInt(64, L, true).ssub_ov(llvm::APInt(64, R, true), Overflow)
+               .getSExtValue();
+  return !Overflow;
+}
+
+bool signedMul(PrimType T, int64_t L, int64_t R, int64_t &Result) {
+  // Products of values up to 32 bits wide fit in 64 bits.
+  if (T.Width <= 32) {
+    Result = L * R;
+    return T.fits(Result);
+  }
+  bool Overflow;
+  Result = llvm::APInt(64, L, true).smul_ov(llvm::APInt(64, R, true), Overflow)
+               .getSExtValue();
+  return !Overflow;
+}
+
+class Interpreter {
+  Context &Ctx;
+  unsigned MaxDepth;
+  unsigned &StepsLeft;
+
+  SmallVector<int64_t, 64> Stack;
+  SmallVector<int64_t, 64> Locals;
+
+  int64_t pop() { return Stack.pop_back_val(); }
+  void push(int64_t Value) { Stack.push_back(Value); }
+
+  bool arith(Opcode Op, PrimType T, bool RHSSigned);
+
+public:
+  Interpreter(Context &Ctx, unsigned MaxDepth, unsigned &StepsLeft)
+      : Ctx(Ctx), MaxDepth(MaxDepth), StepsLeft(StepsLeft) {}
+
+  /// \brief Call \p F with the arguments on top of the stack.
+  bool call(const Function &F, unsigned Depth, int64_t &Result);
+
+  void pushArgs(ArrayRef<int64_t> Args) {
+    Stack.append(Args.begin(), Args.end());
+  }
+};
+
+} // end anonymous namespace
+
+/// \brief Pop the operands of a binary operation and push its result.
+bool Interpreter::arith(Opcode Op, PrimType T, bool RHSSigned) {
+  int64_t R = pop();
+  int64_t L = pop();
+  uint64_t UL = static_cast<uint64_t>(L), UR = static_cast<uint64_t>(R);
+  int64_t Result;
+
+  switch (Op) {
+  case Opcode::Add:
+    if (!T.Signed)
+      Result = T.normalize(UL + UR);
+    else if (!signedAdd(T, L, R, Result))
+      return false;
+    break;
+
+  case Opcode::Sub:
+    if (!T.Signed)
+      Result = T.normalize(UL - UR);
+    else if (!signedSub(T, L, R, Result))
+      return false;
+    break;
+
+  case Opcode::Mul:
+    if (!T.Signed)
+      Result = T.normalize(UL * UR);
+    else if (!signedMul(T, L, R, Result))
+      return false;
+    break;
+
+  case Opcode::Div:
+  case Opcode::Rem:
+    if (R == 0)
+      return false;
+    if (T.Signed) {
+      // The quotient of the minimum value and -1 is not representable.
+      if (R == -1 && L == T.normalize(uint64_t(1) << (T.Width - 1)))
+        return false;
+      Result = Op == Opcode::Div ? L / R : L % R;
+    } else {
+      Result = T.normalize(Op == Opcode::Div ? UL / UR : UL % UR);
+    }
+    break;
+
+  case Opcode::Shl:
+  case Opcode::Shr: {
+    // Negative shift counts and counts of at least the width are undefined.
+    if ((RHSSigned && R < 0) || UR >= T.Width)
+      return false;
+    if (Op == Opcode::Shr) {
+      Result = T.Signed ? L >> UR : static_cast<int64_t>(UL >> UR);
+      break;
+    }
+    // Shifting a negative value, or shifting set bits out of the value, is
+    // undefined for signed types.
+    if (T.Signed &&
+        (L < 0 || T.Width - (64 - llvm::countLeadingZeros(UL)) < UR))
+      return false;
+    Result = T.normalize(UL << UR);
+    break;
+  }
+
+  case Opcode::And:
+    Result = L & R;
+    break;
+  case Opcode::Or:
+    Result = L | R;
+    break;
+  case Opcode::Xor:
+    Result = L ^ R;
+    break;
+
+  default:
+    llvm_unreachable("not an arithmetic opcode");
+  }
+
+  push(Result);
+  return true;
+}
+
+bool Interpreter::call(const Function &F, unsigned Depth, int64_t &Result) {
+  // Move the arguments into the first locals of the new frame.
+  size_t FrameBase = Locals.size();
+  unsigned NumParams = F.getNumParams();
+  Locals.resize(FrameBase + F.getNumLocals());
+  std::copy(Stack.end() - NumParams, Stack.end(), Locals.begin() + FrameBase);
+  Stack.resize(Stack.size() - NumParams);
+
+  const uint8_t *PC = F.getCode().data();
+  while (true) {
+    Opcode Op = static_cast<Opcode>(*PC++);
+    switch (Op) {
+    case Opcode::Step:
+      if (!StepsLeft)
+        return false;
+      --StepsLeft;
+      break;
+
+    case Opcode::Const:
+      push(Function::read<int64_t>(PC));
+      break;
+    case Opcode::GetLocal:
+      push(Locals[FrameBase + Function::read<uint32_t>(PC)]);
+      break;
+    case Opcode::SetLocal:
+      Locals[FrameBase + Function::read<uint32_t>(PC)] = pop();
+      break;
+    case Opcode::Pop:
+      pop();
+      break;
+    case Opcode::Dup:
+      push(Stack.back());
+      break;
+
+    case Opcode::Cast: {
+      PrimType T = PrimType::decode(Function::read<uint8_t>(PC));
+      Stack.back() = T.normalize(Stack.back());
+      break;
+    }
+    case Opcode::ToBool:
+      Stack.back() = Stack.back() != 0;
+      break;
+    case Opcode::LNot:
+      Stack.back() = Stack.back() == 0;
+      break;
+
+    case Opcode::Neg: {
+      PrimType T = PrimType::decode(Function::read<uint8_t>(PC));
+      int64_t V = Stack.back();
+      // The negation of the minimum value is not representable.
+      if (T.Signed && V == T.normalize(uint64_t(1) << (T.Width - 1)))
+        return false;
+      Stack.back() = T.normalize(-static_cast<uint64_t>(V));
+      break;
+    }
+    case Opcode::Comp: {
+      PrimType T = PrimType::decode(Function::read<uint8_t>(PC));
+      Stack.back() = T.normalize(~static_cast<uint64_t>(Stack.back()));
+      break;
+    }
+
+    case Opcode::Add:
+    case Opcode::Sub:
+    case Opcode::Mul:
+    case Opcode::Div:
+    case Opcode::Rem:
+    case Opcode::And:
+    case Opcode::Or:
+    case Opcode::Xor: {
+      PrimType T = PrimType::decode(Function::read<uint8_t>(PC));
+      if (!arith(Op, T, /*RHSSigned=*/false))
+        return false;
+      break;
+    }
+    case Opcode::Shl:
+    case Opcode::Shr: {
+      PrimType T = PrimType::decode(Function::read<uint8_t>(PC));
+      bool RHSSigned = Function::read<uint8_t>(PC);
+      if (!arith(Op, T, RHSSigned))
+        return false;
+      break;
+    }
+
+    case Opcode::LT:
+    case Opcode::LE:
+    case Opcode::GT:
+    case Opcode::GE: {
+      bool Signed = Function::read<uint8_t>(PC);
+      int64_t R = pop();
+      int64_t L = pop();
+      bool Less = Signed ? L < R : uint64_t(L) < uint64_t(R);
+      bool Greater = Signed ? L > R : uint64_t(L) > uint64_t(R);
+      switch (Op) {
+      case Opcode::LT:
+        push(Less);
+        break;
+      case Opcode::LE:
+        push(!Greater);
+        break;
+      case Opcode::GT:
+        push(Greater);
+        break;
+      default:
+        push(!Less);
+        break;
+      }
+      break;
+    }
+    case Opcode::EQ:
+    case Opcode::NE: {
+      int64_t R = pop();
+      int64_t L = pop();
+      push((L == R) == (Op == Opcode::EQ));
+      break;
+    }
+
+    case Opcode::Jmp: {
+      int32_t Offset = Function::read<int32_t>(PC);
+      PC += Offset;
+      break;
+    }
+    case Opcode::JmpIfFalse:
+    case Opcode::JmpIfTrue: {
+      int32_t Offset = Function::read<int32_t>(PC);
+      if ((pop() != 0) == (Op == Opcode::JmpIfTrue))
+        PC += Offset;
+      break;
+    }
+
+    case Opcode::Call: {
+      const FunctionDecl *CalleeDecl =
+          F.getCallee(Function::read<uint32_t>(PC));
+      // As for the AST-walking evaluator, a call is allowed if the depth of
+      // the caller is within the limit.
+      if (Depth > MaxDepth)
+        return false;
+      const Function *Callee = Ctx.getFunction(CalleeDecl);
+      int64_t Value;
+      if (!Callee || !call(*Callee, Depth + 1, Value))
+        return false;
+      push(Value);
+      break;
+    }
+
+    case Opcode::Ret:
+      Result = pop();
+      Locals.resize(FrameBase);
+      return true;
+
+    case Opcode::Trap:
+      return false;
+    }
+  }
+}
+
+bool interp::run(Context &Ctx, const Function &F, ArrayRef<int64_t> Args,
+                 unsigned Depth, unsigned MaxDepth, unsigned &StepsLeft,
+                 int64_t &Result) {
+  Interpreter I(Ctx, MaxDepth, StepsLeft);
+  I.pushArgs(Args);
+  return I.call(F, Depth, Result);
+}
@@ -362,7 +362,7 @@ SourceManager::SourceManager(DiagnosticsEngine &Diag, FileManager &FileMgr,
   : Diag(Diag), FileMgr(FileMgr), OverridenFilesKeepOriginalName(true),
     UserFilesAreVolatile(UserFilesAreVolatile), FilesAreTransient(false),
     ExternalSLocEntries(nullptr), LineTable(nullptr), NumLinearScans(0),
-    NumBinaryProbes(0) {
+    NumBinaryProbes(0), NumRecentLookupHits(0) {
   clearIDTables();
   Diag.setSourceManager(this);
 }
@@ -393,11 +393,14 @@ SourceManager::~SourceManager() {
 void SourceManager::clearIDTables() {
   MainFileID = FileID();
   LocalSLocEntryTable.clear();
+  LocalSLocEntryOffsets.clear();
   LoadedSLocEntryTable.clear();
   SLocEntryLoaded.clear();
   LastLineNoFileIDQuery = FileID();
   LastLineNoContentCache = nullptr;
   LastFileIDLookup = FileID();
+  std::fill(std::begin(RecentFileIDLookups), std::end(RecentFileIDLookups),
+            FileID());
 
   if (LineTable)
     LineTable->clear();
@@ -572,6 +575,7 @@ FileID SourceManager::createFileID(const ContentCache *File,
   LocalSLocEntryTable.push_back(SLocEntry::get(NextLocalOffset,
                                                FileInfo::get(IncludePos, File,
                                                              FileCharacter)));
+  LocalSLocEntryOffsets.push_back(NextLocalOffset);
   unsigned FileSize = File->getSize();
   assert(NextLocalOffset + FileSize + 1 > NextLocalOffset &&
          NextLocalOffset + FileSize + 1 <= CurrentLoadedOffset &&
@@ -622,6 +626,7 @@ SourceManager::createExpansionLocImpl(const ExpansionInfo &Info,
     return SourceLocation::getMacroLoc(LoadedOffset);
   }
   LocalSLocEntryTable.push_back(SLocEntry::get(NextLocalOffset, Info));
+  LocalSLocEntryOffsets.push_back(NextLocalOffset);
   assert(NextLocalOffset + TokLength + 1 > NextLocalOffset &&
          NextLocalOffset + TokLength + 1 <= CurrentLoadedOffset &&
          "Ran out of source locations!");
@@ -711,11 +716,30 @@ FileID SourceManager::getFileIDSlow(unsigned SLocOffset) const {
   if (!SLocOffset)
     return FileID::get(0);
 
+  // Check the entries we found most recently, moving a hit to the front.
+  const unsigned NumRecent = llvm::array_lengthof(RecentFileIDLookups);
+  for (unsigned I = 0; I != NumRecent && RecentFileIDLookups[I].isValid();
+       ++I) {
+    FileID FID = RecentFileIDLookups[I];
+    if (isOffsetInFileID(FID, SLocOffset)) {
+      std::copy_backward(RecentFileIDLookups, RecentFileIDLookups + I,
+                         RecentFileIDLookups + I + 1);
+      RecentFileIDLookups[0] = FID;
+      ++NumRecentLookupHits;
+      return FID;
+    }
+  }
+
   // Now it is time to search for the correct file. See where the SLocOffset
   // sits in the global view and consult local or loaded buffers for it.
-  if (SLocOffset < NextLocalOffset)
-    return getFileIDLocal(SLocOffset);
-  return getFileIDLoaded(SLocOffset);
+  FileID Res = SLocOffset < NextLocalOffset ? getFileIDLocal(SLocOffset)
+                                            : getFileIDLoaded(SLocOffset);
+  if (Res.isValid()) {
+    std::copy_backward(RecentFileIDLookups, RecentFileIDLookups + NumRecent - 1,
+                       RecentFileIDLookups + NumRecent);
+    RecentFileIDLookups[0] = Res;
+  }
+  return Res;
 }
 
 /// \brief Return the FileID for a SourceLocation with a low offset.
@@ -774,39 +798,27 @@ FileID SourceManager::getFileIDLocal(unsigned SLocOffset) const {
   // SLocOffset.
   unsigned LessIndex = 0;
   NumProbes = 0;
-  while (1) {
-    bool Invalid = false;
-    unsigned MiddleIndex = (GreaterIndex-LessIndex)/2+LessIndex;
-    unsigned MidOffset = getLocalSLocEntry(MiddleIndex, &Invalid).getOffset();
-    if (Invalid)
-      return FileID::get(0);
-    
-    ++NumProbes;
 
-    // If the offset of the midpoint is too large, chop the high side of the
-    // range to the midpoint.
-    if (MidOffset > SLocOffset) {
+  // Local entries are contiguous, so the entry containing SLocOffset is the
+  // last one that starts at or before it. Search the dense offset table for
+  // it rather than the SLocEntries themselves.
+  while (GreaterIndex - LessIndex > 1) {
+    ++NumProbes;
+    unsigned MiddleIndex = (GreaterIndex-LessIndex)/2+LessIndex;
+    if (LocalSLocEntryOffsets[MiddleIndex] > SLocOffset)
       GreaterIndex = MiddleIndex;
-      continue;
-    }
-
-    // If the middle index contains the value, succeed and return.
-    // FIXME: This could be made faster by using a function that's aware of
-    // being in the local area.
-    if (isOffsetInFileID(FileID::get(MiddleIndex), SLocOffset)) {
-      FileID Res = FileID::get(MiddleIndex);
+    else
+      LessIndex = MiddleIndex;
+  }
 
-      // If this isn't a macro expansion, remember it.  We have good locality
-      // across FileID lookups.
-      if (!LocalSLocEntryTable[MiddleIndex].isExpansion())
-        LastFileIDLookup = Res;
-      NumBinaryProbes += NumProbes;
-      return Res;
-    }
+  FileID Res = FileID::get(LessIndex);
 
-    // Otherwise, move the low-side up to the middle index.
-    LessIndex = MiddleIndex;
-  }
+  // If this isn't a macro expansion, remember it.  We have good locality
+  // across FileID lookups.
+  if (!LocalSLocEntryTable[LessIndex].isExpansion())
+    LastFileIDLookup = Res;
+  NumBinaryProbes += NumProbes;
+  return Res;
 }
 
 /// \brief Return the FileID for a SourceLocation with a high offset.
@@ -2152,7 +2164,8 @@ void SourceManager::PrintStats() const {
                << NumLineNumsComputed << " files with line #'s computed, "
                << NumMacroArgsComputed << " files with macro args computed.\n";
   llvm::errs() << "FileID scans: " << NumLinearScans << " linear, "
-               << NumBinaryProbes << " binary.\n";
+               << NumBinaryProbes << " binary, " << NumRecentLookupHits
+               << " recent lookup hits.\n";
 }
 
 LLVM_DUMP_METHOD void SourceManager::dump() const {
@@ -2237,6 +2250,7 @@ SourceManager::MemoryBufferSizes SourceManager::getMemoryBufferSizes() const {
 size_t SourceManager::getDataStructureSizes() const {
   size_t size = llvm::capacity_in_bytes(MemBufferInfos)
     + llvm::capacity_in_bytes(LocalSLocEntryTable)
+    + llvm::capacity_in_bytes(LocalSLocEntryOffsets)
     + llvm::capacity_in_bytes(LoadedSLocEntryTable)
     + llvm::capacity_in_bytes(SLocEntryLoaded)
     + llvm::capacity_in_bytes(FileInfos);
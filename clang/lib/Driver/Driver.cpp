@@ -57,7 +57,8 @@ Driver::Driver(StringRef ClangExecutable, StringRef DefaultTargetTriple,
       DriverTitle("clang LLVM compiler"), CCPrintOptionsFilename(nullptr),
       CCPrintHeadersFilename(nullptr), CCLogDiagnosticsFilename(nullptr),
       CCCPrintBindings(false), CCPrintHeaders(false), CCLogDiagnostics(false),
-      CCGenDiagnostics(false), DefaultTargetTriple(DefaultTargetTriple),
+      CCGenDiagnostics(false), CC1Main(nullptr),
+      DefaultTargetTriple(DefaultTargetTriple),
       CCCGenericGCCName(""), CheckInputsExist(true), CCCUsePCH(true),
       SuppressMissingInputWarning(false) {
 
@@ -791,7 +792,13 @@ int Driver::ExecuteCompilation(
     SmallVectorImpl<std::pair<int, const Command *>> &FailingCommands) {
   // Just print if -### was present.
   if (C.getArgs().hasArg(options::OPT__HASH_HASH_HASH)) {
-    C.getJobs().Print(llvm::errs(), "\n", true);
+    // Mark the jobs which would not spawn a process on a line of their own,
+    // so that the command lines can still be copied and run.
+    for (const Command &Job : C.getJobs()) {
+      if (Job.isInProcess())
+        llvm::errs() << " (in-process)\n";
+      Job.Print(llvm::errs(), "\n", true);
+    }
     return 0;
   }
 
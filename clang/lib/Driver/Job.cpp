@@ -19,6 +19,8 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/raw_ostream.h"
@@ -270,6 +272,44 @@ int Command::Execute(const StringRef **Redirects, std::string *ErrMsg,
                                    /*memoryLimit*/ 0, ErrMsg, ExecutionFailed);
 }
 
+CC1Command::CC1Command(const Action &Source_, const Tool &Creator_,
+                       const char *Executable_,
+                       const ArgStringList &Arguments_,
+                       ArrayRef<InputInfo> Inputs)
+    : Command(Source_, Creator_, Executable_, Arguments_, Inputs) {}
+
+int CC1Command::Execute(const StringRef **Redirects, std::string *ErrMsg,
+                        bool *ExecutionFailed) const {
+  const Driver &D = getCreator().getToolChain().getDriver();
+
+  // Redirected output and crash reproduction rely on running a separate
+  // process, so spawn one in those cases. Response files are not needed when
+  // the arguments never leave this process.
+  if (!D.CC1Main || Redirects || D.CCGenDiagnostics)
+    return Command::Execute(Redirects, ErrMsg, ExecutionFailed);
+
+  if (ExecutionFailed)
+    *ExecutionFailed = false;
+
+  SmallVector<const char *, 128> Argv;
+  Argv.push_back(getExecutable());
+  Argv.append(getArguments().begin(), getArguments().end());
+
+  // Options given through -mllvm are parsed once per -cc1 invocation; forget
+  // the occurrences recorded by the previous job run in this process.
+  llvm::cl::ResetAllOptionOccurrences();
+
+  // Turn a crash in the job into a failing status, reported the same way as
+  // an abnormally terminated process so that the driver still generates crash
+  // diagnostics for it.
+  llvm::CrashRecoveryContext::Enable();
+  int R = 0;
+  llvm::CrashRecoveryContext CRC;
+  if (!CRC.RunSafely([&]() { R = D.CC1Main(Argv); }))
+    return -1;
+  return R;
+}
+
 FallbackCommand::FallbackCommand(const Action &Source_, const Tool &Creator_,
                                  const char *Executable_,
                                  const ArgStringList &Arguments_,
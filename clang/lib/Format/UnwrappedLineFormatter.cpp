@@ -9,6 +9,7 @@
 
 #include "UnwrappedLineFormatter.h"
 #include "WhitespaceManager.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/Debug.h"
 #include <queue>
 
@@ -631,6 +632,16 @@ public:
   /// below the column limit.
   unsigned formatLine(const AnnotatedLine &Line, unsigned FirstIndent,
                       bool DryRun) override {
+    // A child line that could be merged into its parent is formatted in dry
+    // run mode once for every state of the parent that reaches its closing
+    // brace. The result only depends on the line and the indent.
+    std::pair<const AnnotatedLine *, unsigned> CacheKey(&Line, FirstIndent);
+    if (DryRun) {
+      auto CacheIt = DryRunPenalties.find(CacheKey);
+      if (CacheIt != DryRunPenalties.end())
+        return CacheIt->second;
+    }
+
     LineState State = Indenter->getInitialState(FirstIndent, &Line, DryRun);
 
     // If the ObjC method declaration does not fit on a line, we should format
@@ -639,7 +650,10 @@ public:
       State.Stack.back().BreakBeforeParameter = true;
 
     // Find best solution in solution space.
-    return analyzeSolutionSpace(State, DryRun);
+    unsigned Penalty = analyzeSolutionSpace(State, DryRun);
+    if (DryRun)
+      DryRunPenalties[CacheKey] = Penalty;
+    return Penalty;
   }
 
 private:
@@ -697,6 +711,7 @@ private:
     ++Count;
 
     unsigned Penalty = 0;
+    StateNode *Best = nullptr;
 
     // While not empty, take first element and follow edges.
     while (!Queue.empty()) {
@@ -704,6 +719,7 @@ private:
       StateNode *Node = Queue.top().second;
       if (!Node->State.NextToken) {
         DEBUG(llvm::dbgs() << "\n---\nPenalty for line: " << Penalty << "\n");
+        Best = Node;
         break;
       }
       Queue.pop();
@@ -717,6 +733,15 @@ private:
         // State already examined with lower penalty.
         continue;
 
+      // If even that does not keep the solution space small enough, give up
+      // on the best solution and complete the cheapest partial one greedily,
+      // so that the time spent on a single line stays bounded.
+      if (Count > MaxAnalyzedStates) {
+        DEBUG(llvm::dbgs() << "Too many states, completing greedily.\n");
+        Best = completeGreedily(Node, Penalty);
+        break;
+      }
+
       FormatDecision LastFormat = Node->State.NextToken->Decision;
       if (LastFormat == FD_Unformatted || LastFormat == FD_Continue)
         addNextStateToQueue(Penalty, Node, /*NewLine=*/false, &Count, &Queue);
@@ -724,7 +749,7 @@ private:
         addNextStateToQueue(Penalty, Node, /*NewLine=*/true, &Count, &Queue);
     }
 
-    if (Queue.empty()) {
+    if (!Best) {
       // We were unable to find a solution, do nothing.
       // FIXME: Add diagnostic?
       DEBUG(llvm::dbgs() << "Could not find a solution.\n");
@@ -733,7 +758,7 @@ private:
 
     // Reconstruct the solution.
     if (!DryRun)
-      reconstructPath(InitialState, Queue.top().second);
+      reconstructPath(InitialState, Best);
 
     DEBUG(llvm::dbgs() << "Total number of analyzed states: " << Count << "\n");
     DEBUG(llvm::dbgs() << "---\n");
@@ -747,20 +772,60 @@ private:
   /// penalty of \p Penalty. Insert a line break if \p NewLine is \c true.
   void addNextStateToQueue(unsigned Penalty, StateNode *PreviousNode,
                            bool NewLine, unsigned *Count, QueueType *Queue) {
-    if (NewLine && !Indenter->canBreak(PreviousNode->State))
+    StateNode *Node = createNextState(Penalty, PreviousNode, NewLine);
+    if (!Node)
       return;
+
+    Queue->push(QueueItem(OrderedPenalty(Penalty, *Count), Node));
+    ++(*Count);
+  }
+
+  /// \brief Create the state following \p PreviousNode, inserting a line
+  /// break if \p NewLine is \c true, and add its cost to \p Penalty.
+  ///
+  /// Returns \c nullptr if the token cannot be placed this way.
+  StateNode *createNextState(unsigned &Penalty, StateNode *PreviousNode,
+                             bool NewLine) {
+    if (NewLine && !Indenter->canBreak(PreviousNode->State))
+      return nullptr;
     if (!NewLine && Indenter->mustBreak(PreviousNode->State))
-      return;
+      return nullptr;
 
     StateNode *Node = new (Allocator.Allocate())
         StateNode(PreviousNode->State, NewLine, PreviousNode);
     if (!formatChildren(Node->State, NewLine, /*DryRun=*/true, Penalty))
-      return;
+      return nullptr;
 
     Penalty += Indenter->addTokenToState(Node->State, NewLine, true);
+    return Node;
+  }
 
-    Queue->push(QueueItem(OrderedPenalty(Penalty, *Count), Node));
-    ++(*Count);
+  /// \brief Place the remaining tokens after \p Node one at a time, each in
+  /// the cheaper of the two possible ways, and add their cost to \p Penalty.
+  ///
+  /// Returns the final state, or \c nullptr if a token cannot be placed.
+  StateNode *completeGreedily(StateNode *Node, unsigned &Penalty) {
+    while (Node->State.NextToken) {
+      FormatDecision LastFormat = Node->State.NextToken->Decision;
+      StateNode *Next = nullptr;
+      unsigned NextPenalty = 0;
+      // Prefer not to break when both ways cost the same.
+      for (bool NewLine : {false, true}) {
+        if (LastFormat == (NewLine ? FD_Continue : FD_Break))
+          continue;
+        unsigned CandidatePenalty = Penalty;
+        StateNode *Candidate = createNextState(CandidatePenalty, Node, NewLine);
+        if (Candidate && (!Next || CandidatePenalty < NextPenalty)) {
+          Next = Candidate;
+          NextPenalty = CandidatePenalty;
+        }
+      }
+      if (!Next)
+        return nullptr;
+      Node = Next;
+      Penalty = NextPenalty;
+    }
+    return Node;
   }
 
   /// \brief Applies the best formatting by reconstructing the path in the
@@ -789,7 +854,16 @@ private:
     }
   }
 
+  /// \brief The number of states after which \c analyzeSolutionSpace stops
+  /// searching for the best solution.
+  static const unsigned MaxAnalyzedStates = 200000;
+
   llvm::SpecificBumpPtrAllocator<StateNode> Allocator;
+
+  /// \brief The penalties of the lines formatted in dry run mode, by line and
+  /// first indent.
+  llvm::DenseMap<std::pair<const AnnotatedLine *, unsigned>, unsigned>
+      DryRunPenalties;
 };
 
 } // anonymous namespace
@@ -218,7 +218,7 @@ ASTUnit::ASTUnit(bool _MainFileIsAST)
     TUKind(TU_Complete), WantTiming(getenv("LIBCLANG_TIMING")),
     OwnsRemappedFileBuffers(true),
     NumStoredDiagnosticsFromDriver(0),
-    PreambleRebuildCounter(0),
+    PreambleRebuildCounter(0), NumPreambleBuilds(0),
     NumWarningsInPreamble(0),
     ShouldCacheCodeCompletionResults(false),
     IncludeBriefCommentsInCodeCompletion(false), UserFilesAreVolatile(false),
@@ -1250,6 +1250,18 @@ ASTUnit::PreambleFileHash::createForFile(off_t Size, time_t ModTime) {
   return Result;
 }
 
+ASTUnit::PreambleFileHash
+ASTUnit::PreambleFileHash::createForFile(off_t Size, time_t ModTime,
+                                         const llvm::MemoryBuffer *Buffer) {
+  PreambleFileHash Result = createForFile(Size, ModTime);
+  if (Buffer) {
+    llvm::MD5 MD5Ctx;
+    MD5Ctx.update(Buffer->getBuffer());
+    MD5Ctx.final(Result.MD5);
+  }
+  return Result;
+}
+
 ASTUnit::PreambleFileHash ASTUnit::PreambleFileHash::createForMemoryBuffer(
     const llvm::MemoryBuffer *Buffer) {
   PreambleFileHash Result;
@@ -1266,8 +1278,10 @@ ASTUnit::PreambleFileHash ASTUnit::PreambleFileHash::createForMemoryBuffer(
 namespace clang {
 bool operator==(const ASTUnit::PreambleFileHash &LHS,
                 const ASTUnit::PreambleFileHash &RHS) {
-  return LHS.Size == RHS.Size && LHS.ModTime == RHS.ModTime &&
-         memcmp(LHS.MD5, RHS.MD5, sizeof(LHS.MD5)) == 0;
+  if (LHS.Size != RHS.Size || LHS.ModTime != RHS.ModTime)
+    return false;
+  // On-disk files are identified by their modification time.
+  return LHS.ModTime != 0 || memcmp(LHS.MD5, RHS.MD5, sizeof(LHS.MD5)) == 0;
 }
 } // namespace clang
 
@@ -1432,10 +1446,30 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
         }
         
         // The file was not remapped; check whether it has changed on disk.
-        if (Status.getSize() != uint64_t(F->second.Size) ||
-            Status.getLastModificationTime().toEpochTime() !=
-                uint64_t(F->second.ModTime))
+        if (Status.getSize() != uint64_t(F->second.Size)) {
+          AnyFileChanged = true;
+          continue;
+        }
+        time_t ModTime = Status.getLastModificationTime().toEpochTime();
+        if (ModTime == F->second.ModTime)
+          continue;
+
+        // The file was touched, but may still have the same contents, e.g.
+        // after a branch switch or when a build step rewrote it unchanged.
+        // Only rebuild the preamble if the contents differ.
+        auto Buffer = FileMgr->getBufferForFile(F->first());
+        if (!Buffer) {
+          AnyFileChanged = true;
+          continue;
+        }
+        PreambleFileHash Current =
+            PreambleFileHash::createForFile(F->second.Size, ModTime,
+                                            Buffer->get());
+        if (memcmp(Current.MD5, F->second.MD5, sizeof(Current.MD5)) != 0) {
           AnyFileChanged = true;
+          continue;
+        }
+        F->second.ModTime = ModTime;
       }
           
       if (!AnyFileChanged) {
@@ -1611,6 +1645,7 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
   
   // Keep track of the preamble we precompiled.
   setPreambleFile(this, FrontendOpts.OutputFile);
+  ++NumPreambleBuilds;
   NumWarningsInPreamble = getDiagnostics().getNumWarnings();
   
   // Keep track of all of the files that the source manager knows about,
@@ -1621,11 +1656,11 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
     const FileEntry *File = Clang->getFileManager().getFile(Filename);
     if (!File || File == SourceMgr.getFileEntryForID(SourceMgr.getMainFileID()))
       continue;
+    llvm::MemoryBuffer *Buffer = SourceMgr.getMemoryBufferForFile(File);
     if (time_t ModTime = File->getModificationTime()) {
       FilesInPreamble[File->getName()] = PreambleFileHash::createForFile(
-          File->getSize(), ModTime);
+          File->getSize(), ModTime, Buffer);
     } else {
-      llvm::MemoryBuffer *Buffer = SourceMgr.getMemoryBufferForFile(File);
       FilesInPreamble[File->getName()] =
           PreambleFileHash::createForMemoryBuffer(Buffer);
     }
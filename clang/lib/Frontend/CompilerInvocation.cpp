@@ -153,6 +153,15 @@ static void getAllNoBuiltinFuncValues(ArgList &Args,
   Funcs.insert(Funcs.end(), Values.begin(), Values.end());
 }
 
+static int getAnalyzerConfigInteger(const AnalyzerOptions &Opts,
+                                    StringRef Name, int DefaultVal) {
+  auto I = Opts.Config.find(Name);
+  int Res;
+  if (I == Opts.Config.end() || StringRef(I->getValue()).getAsInteger(10, Res))
+    return DefaultVal;
+  return Res;
+}
+
 static bool ParseAnalyzerArgs(AnalyzerOptions &Opts, ArgList &Args,
                               DiagnosticsEngine &Diags) {
   using namespace options;
@@ -302,6 +311,19 @@ static bool ParseAnalyzerArgs(AnalyzerOptions &Opts, ArgList &Args,
     }
   }
 
+  // The AnalyzerOptions accessors live in the analyzer library, which the
+  // frontend does not link against, so read the shard options directly.
+  if (Success) {
+    int ShardCount = getAnalyzerConfigInteger(Opts, "shard-count", 1);
+    int ShardIndex = getAnalyzerConfigInteger(Opts, "shard-index", 0);
+    ShardCount = std::max(ShardCount, 1);
+    if (ShardIndex < 0 || ShardIndex >= ShardCount) {
+      Diags.Report(diag::err_analyzer_config_invalid_shard)
+          << ShardIndex << ShardCount;
+      Success = false;
+    }
+  }
+
   return Success;
 }
 
@@ -1185,8 +1207,10 @@ static InputKind ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
   Opts.ShowHelp = Args.hasArg(OPT_help);
   Opts.ShowStats = Args.hasArg(OPT_print_stats);
   Opts.ShowTimers = Args.hasArg(OPT_ftime_report);
+  Opts.TimeTrace = Args.hasArg(OPT_ftime_trace);
   Opts.ShowVersion = Args.hasArg(OPT_version);
   Opts.ASTMergeFiles = Args.getAllArgValues(OPT_ast_merge);
+  Opts.IndexStorePath = Args.getLastArgValue(OPT_index_store_path);
   Opts.LLVMArgs = Args.getAllArgValues(OPT_mllvm);
   Opts.FixWhatYouCan = Args.hasArg(OPT_fix_what_you_can);
   Opts.FixOnlyWarnings = Args.hasArg(OPT_fix_only_warnings);
@@ -1907,6 +1931,8 @@ static void ParseLangArgs(LangOptions &Opts, ArgList &Args, InputKind IK,
       getLastArgIntValue(Args, OPT_fconstexpr_depth, 512, Diags);
   Opts.ConstexprStepLimit =
       getLastArgIntValue(Args, OPT_fconstexpr_steps, 1048576, Diags);
+  Opts.EnableNewConstInterp =
+      Args.hasArg(OPT_fexperimental_new_constant_interpreter);
   Opts.BracketDepth = getLastArgIntValue(Args, OPT_fbracket_depth, 256, Diags);
   Opts.DelayedTemplateParsing = Args.hasArg(OPT_fdelayed_template_parsing);
   Opts.NumLargeByValueCopy =
@@ -0,0 +1,342 @@
+//===--- IndexStore.cpp - Index data recorded during compilation ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Records and units start with a four byte signature and a version number,
+// followed by their fields in order. Integers are ULEB128-encoded and strings
+// are a length followed by their bytes, so that the many small line and
+// column numbers take a single byte.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Index/IndexStore.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+using namespace clang::index;
+
+static const char RecordSignature[] = {'I', 'D', 'X', 'R'};
+static const char UnitSignature[] = {'I', 'D', 'X', 'U'};
+static const unsigned StoreVersion = 1;
+
+//===----------------------------------------------------------------------===//
+// Writing
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+class StoreWriter {
+  raw_ostream &OS;
+
+public:
+  explicit StoreWriter(raw_ostream &OS) : OS(OS) {}
+
+  void writeHeader(const char (&Signature)[4]) {
+    OS.write(Signature, 4);
+    writeInt(StoreVersion);
+  }
+
+  void writeInt(uint64_t Value) { llvm::encodeULEB128(Value, OS); }
+
+  void writeString(StringRef Str) {
+    writeInt(Str.size());
+    OS << Str;
+  }
+};
+
+class StoreReader {
+  const char *Ptr;
+  const char *End;
+  std::string &Error;
+
+public:
+  StoreReader(StringRef Data, std::string &Error)
+      : Ptr(Data.begin()), End(Data.end()), Error(Error) {}
+
+  /// \returns true on error.
+  bool fail(const Twine &Message) {
+    Error = Message.str();
+    return true;
+  }
+
+  bool readHeader(const char (&Signature)[4]) {
+    if (End - Ptr < 4 || StringRef(Ptr, 4) != StringRef(Signature, 4))
+      return fail("invalid signature");
+    Ptr += 4;
+    uint64_t Version;
+    if (readInt(Version))
+      return true;
+    if (Version != StoreVersion)
+      return fail("unsupported version " + Twine(Version));
+    return false;
+  }
+
+  bool readInt(uint64_t &Value) {
+    Value = 0;
+    unsigned Shift = 0;
+    while (true) {
+      if (Ptr == End || Shift >= 64)
+        return fail("malformed integer");
+      uint8_t Byte = *Ptr++;
+      Value |= uint64_t(Byte & 0x7f) << Shift;
+      Shift += 7;
+      if (!(Byte & 0x80))
+        return false;
+    }
+  }
+
+  template <typename T> bool readInt(T &Value) {
+    uint64_t V;
+    if (readInt(V))
+      return true;
+    Value = static_cast<T>(V);
+    if (static_cast<uint64_t>(Value) != V)
+      return fail("integer out of range");
+    return false;
+  }
+
+  /// Read the number of elements of a list, each taking at least one byte.
+  bool readCount(size_t &Count) {
+    if (readInt(Count))
+      return true;
+    if (Count > size_t(End - Ptr))
+      return fail("invalid element count");
+    return false;
+  }
+
+  bool readString(std::string &Str) {
+    size_t Size;
+    if (readInt(Size))
+      return true;
+    if (Size > size_t(End - Ptr))
+      return fail("truncated string");
+    Str.assign(Ptr, Size);
+    Ptr += Size;
+    return false;
+  }
+
+  bool finish() {
+    if (Ptr != End)
+      return fail("unexpected data at end of file");
+    return false;
+  }
+};
+
+} // end anonymous namespace
+
+void index::writeIndexRecord(const IndexRecord &Record, raw_ostream &OS) {
+  StoreWriter W(OS);
+  W.writeHeader(RecordSignature);
+
+  W.writeInt(Record.Symbols.size());
+  for (const StoreSymbol &Sym : Record.Symbols) {
+    W.writeInt(static_cast<unsigned>(Sym.Kind));
+    W.writeInt(Sym.SubKinds);
+    W.writeInt(static_cast<unsigned>(Sym.Lang));
+    W.writeString(Sym.Name);
+    W.writeString(Sym.USR);
+  }
+
+  // Lines are stored as the difference to the previous occurrence, which is
+  // small since the occurrences are sorted.
+  unsigned PrevLine = 0;
+  W.writeInt(Record.Occurrences.size());
+  for (const StoreOccurrence &Occur : Record.Occurrences) {
+    assert(Occur.Line >= PrevLine && "occurrences are not sorted");
+    W.writeInt(Occur.Symbol);
+    W.writeInt(Occur.Roles);
+    W.writeInt(Occur.Line - PrevLine);
+    W.writeInt(Occur.Column);
+    W.writeInt(Occur.Relations.size());
+    for (const StoreRelation &Rel : Occur.Relations) {
+      W.writeInt(Rel.Roles);
+      W.writeInt(Rel.Symbol);
+    }
+    PrevLine = Occur.Line;
+  }
+}
+
+void index::writeIndexUnit(const IndexUnit &Unit, raw_ostream &OS) {
+  StoreWriter W(OS);
+  W.writeHeader(UnitSignature);
+  W.writeString(Unit.MainFilePath);
+  W.writeString(Unit.OutputFilePath);
+
+  W.writeInt(Unit.Dependencies.size());
+  for (const IndexUnitDependency &Dep : Unit.Dependencies) {
+    W.writeString(Dep.FilePath);
+    W.writeString(Dep.RecordName);
+    W.writeInt(Dep.IsSystem);
+    W.writeInt(Dep.Size);
+    W.writeInt(static_cast<uint64_t>(Dep.ModTime));
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Reading
+//===----------------------------------------------------------------------===//
+
+bool index::readIndexRecord(StringRef Data, IndexRecord &Record,
+                            std::string &Error) {
+  StoreReader R(Data, Error);
+  if (R.readHeader(RecordSignature))
+    return true;
+
+  size_t NumSymbols;
+  if (R.readCount(NumSymbols))
+    return true;
+  Record.Symbols.resize(NumSymbols);
+  for (StoreSymbol &Sym : Record.Symbols) {
+    unsigned Kind, Lang;
+    if (R.readInt(Kind) || R.readInt(Sym.SubKinds) || R.readInt(Lang) ||
+        R.readString(Sym.Name) || R.readString(Sym.USR))
+      return true;
+    if (Kind > static_cast<unsigned>(SymbolKind::ConversionFunction) ||
+        Lang > static_cast<unsigned>(SymbolLanguage::CXX))
+      return R.fail("invalid symbol kind");
+    Sym.Kind = static_cast<SymbolKind>(Kind);
+    Sym.Lang = static_cast<SymbolLanguage>(Lang);
+  }
+
+  size_t NumOccurrences;
+  if (R.readCount(NumOccurrences))
+    return true;
+  Record.Occurrences.resize(NumOccurrences);
+  unsigned Line = 0;
+  for (StoreOccurrence &Occur : Record.Occurrences) {
+    unsigned LineDelta;
+    size_t NumRelations;
+    if (R.readInt(Occur.Symbol) || R.readInt(Occur.Roles) ||
+        R.readInt(LineDelta) || R.readInt(Occur.Column) ||
+        R.readCount(NumRelations))
+      return true;
+    if (Occur.Symbol >= NumSymbols)
+      return R.fail("invalid symbol reference");
+    Line += LineDelta;
+    Occur.Line = Line;
+
+    Occur.Relations.resize(NumRelations);
+    for (StoreRelation &Rel : Occur.Relations) {
+      if (R.readInt(Rel.Roles) || R.readInt(Rel.Symbol))
+        return true;
+      if (Rel.Symbol >= NumSymbols)
+        return R.fail("invalid symbol reference");
+    }
+  }
+
+  return R.finish();
+}
+
+bool index::readIndexUnit(StringRef Data, IndexUnit &Unit,
+                          std::string &Error) {
+  StoreReader R(Data, Error);
+  if (R.readHeader(UnitSignature) || R.readString(Unit.MainFilePath) ||
+      R.readString(Unit.OutputFilePath))
+    return true;
+
+  size_t NumDependencies;
+  if (R.readCount(NumDependencies))
+    return true;
+  Unit.Dependencies.resize(NumDependencies);
+  for (IndexUnitDependency &Dep : Unit.Dependencies) {
+    uint64_t ModTime;
+    if (R.readString(Dep.FilePath) || R.readString(Dep.RecordName) ||
+        R.readInt(Dep.IsSystem) || R.readInt(Dep.Size) || R.readInt(ModTime))
+      return true;
+    Dep.ModTime = static_cast<int64_t>(ModTime);
+  }
+
+  return R.finish();
+}
+
+//===----------------------------------------------------------------------===//
+// Store layout
+//===----------------------------------------------------------------------===//
+
+static std::string getHashedName(StringRef FilePath, StringRef HashedData) {
+  llvm::MD5 Hash;
+  Hash.update(HashedData);
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Digest;
+  llvm::MD5::stringifyResult(Result, Digest);
+  return (llvm::sys::path::filename(FilePath) + "-" + Digest).str();
+}
+
+std::string index::getIndexRecordName(StringRef FilePath,
+                                      StringRef RecordData) {
+  return getHashedName(FilePath, RecordData);
+}
+
+std::string index::getIndexUnitName(StringRef OutputFilePath) {
+  return getHashedName(OutputFilePath, OutputFilePath);
+}
+
+static std::string getStoreDirectory(StringRef StorePath, StringRef Kind) {
+  SmallString<128> Path(StorePath);
+  llvm::sys::path::append(Path, "v1", Kind);
+  return Path.str();
+}
+
+std::string index::getIndexRecordsDirectory(StringRef StorePath) {
+  return getStoreDirectory(StorePath, "records");
+}
+
+std::string index::getIndexUnitsDirectory(StringRef StorePath) {
+  return getStoreDirectory(StorePath, "units");
+}
+
+bool index::writeIndexStoreFile(StringRef Directory, StringRef Name,
+                                StringRef Data, bool Overwrite,
+                                std::string &Error) {
+  SmallString<128> Path(Directory);
+  llvm::sys::path::append(Path, Name);
+  if (!Overwrite && llvm::sys::fs::exists(Path))
+    return false;
+
+  if (std::error_code EC = llvm::sys::fs::create_directories(Directory)) {
+    Error = "cannot create directory '" + Directory.str() + "': " +
+            EC.message();
+    return true;
+  }
+
+  // Write to a temporary file next to the destination and rename it, which
+  // is atomic.
+  int FD;
+  SmallString<128> TempPath;
+  if (std::error_code EC =
+          llvm::sys::fs::createUniqueFile(Twine(Path) + "-%%%%%%%%", FD, TempPath)) {
+    Error = "cannot create file in '" + Directory.str() + "': " +
+            EC.message();
+    return true;
+  }
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Data;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(TempPath);
+      Error = "cannot write '" + TempPath.str().str() + "'";
+      return true;
+    }
+  }
+
+  if (std::error_code EC = llvm::sys::fs::rename(TempPath, Path)) {
+    llvm::sys::fs::remove(TempPath);
+    Error = "cannot rename '" + TempPath.str().str() + "' to '" +
+            Path.str().str() + "': " + EC.message();
+    return true;
+  }
+  return false;
+}
@@ -9,10 +9,21 @@
 
 #include "clang/Index/IndexingAction.h"
 #include "clang/Index/IndexDataConsumer.h"
+#include "clang/Index/IndexStore.h"
+#include "clang/Index/USRGeneration.h"
 #include "IndexingContext.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/Basic/SourceManager.h"
 #include "clang/Frontend/FrontendAction.h"
+#include "clang/Frontend/FrontendDiagnostic.h"
+#include "clang/Frontend/FrontendOptions.h"
 #include "clang/Frontend/MultiplexConsumer.h"
 #include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/FileSystem.h"
+#include <algorithm>
+#include <tuple>
 
 using namespace clang;
 using namespace clang::index;
@@ -174,3 +185,213 @@ void index::indexASTUnit(ASTUnit &Unit,
   DataConsumer->initialize(Unit.getASTContext());
   indexTranslationUnit(Unit, IndexCtx);
 }
+
+//===----------------------------------------------------------------------===//
+// Index data recording
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// \brief Collects the occurrences of a translation unit and writes them to
+/// an index store when the translation unit is done.
+class IndexRecordingConsumer : public IndexDataConsumer {
+  std::string StorePath;
+  std::string OutputFile;
+  ASTContext *Ctx = nullptr;
+
+  /// The symbols of the translation unit, indexed by the occurrences below.
+  std::vector<StoreSymbol> Symbols;
+  /// The index of the symbol of each declaration, or ~0U if it has no USR.
+  llvm::DenseMap<const Decl *, unsigned> SymbolIndices;
+  /// The occurrences in each file, referring to the symbols above.
+  llvm::DenseMap<const FileEntry *, std::vector<StoreOccurrence>> Occurrences;
+
+  unsigned getSymbolIndex(const Decl *D);
+  IndexRecord createRecord(std::vector<StoreOccurrence> &FileOccurrences);
+  void reportError(StringRef Message);
+
+public:
+  IndexRecordingConsumer(StringRef StorePath, StringRef OutputFile)
+      : StorePath(StorePath), OutputFile(OutputFile) {}
+
+  void initialize(ASTContext &Context) override { Ctx = &Context; }
+
+  bool handleDeclOccurence(const Decl *D, SymbolRoleSet Roles,
+                           ArrayRef<SymbolRelation> Relations,
+                           FileID FID, unsigned Offset,
+                           ASTNodeInfo ASTNode) override;
+
+  void finish() override;
+};
+
+} // anonymous namespace
+
+unsigned IndexRecordingConsumer::getSymbolIndex(const Decl *D) {
+  auto Inserted = SymbolIndices.insert(std::make_pair(D, ~0U));
+  if (!Inserted.second)
+    return Inserted.first->second;
+
+  SmallString<256> USR;
+  if (generateUSRForDecl(D, USR))
+    return ~0U;
+
+  StoreSymbol Sym;
+  SymbolInfo Info = getSymbolInfo(D);
+  Sym.Kind = Info.Kind;
+  Sym.SubKinds = Info.SubKinds;
+  Sym.Lang = Info.Lang;
+  llvm::raw_string_ostream NameOS(Sym.Name);
+  printSymbolName(D, Ctx->getLangOpts(), NameOS);
+  NameOS.flush();
+  Sym.USR = USR.str();
+  Symbols.push_back(std::move(Sym));
+  return Inserted.first->second = Symbols.size() - 1;
+}
+
+bool IndexRecordingConsumer::handleDeclOccurence(
+    const Decl *D, SymbolRoleSet Roles, ArrayRef<SymbolRelation> Relations,
+    FileID FID, unsigned Offset, ASTNodeInfo ASTNode) {
+  SourceManager &SM = Ctx->getSourceManager();
+  const FileEntry *FE = SM.getFileEntryForID(FID);
+  if (!FE)
+    return true;
+
+  StoreOccurrence Occur;
+  Occur.Symbol = getSymbolIndex(D);
+  if (Occur.Symbol == ~0U)
+    return true;
+  Occur.Roles = Roles;
+  Occur.Line = SM.getLineNumber(FID, Offset);
+  Occur.Column = SM.getColumnNumber(FID, Offset);
+  for (const SymbolRelation &Rel : Relations) {
+    unsigned RelSymbol = getSymbolIndex(Rel.RelatedSymbol);
+    if (RelSymbol != ~0U)
+      Occur.Relations.push_back({Rel.Roles, RelSymbol});
+  }
+  Occurrences[FE].push_back(std::move(Occur));
+  return true;
+}
+
+/// \brief Sort the occurrences of a file and give them their own symbol
+/// table, so that the record only depends on the contents of the file.
+IndexRecord IndexRecordingConsumer::createRecord(
+    std::vector<StoreOccurrence> &FileOccurrences) {
+  auto Less = [](const StoreOccurrence &LHS, const StoreOccurrence &RHS) {
+    return std::tie(LHS.Line, LHS.Column, LHS.Symbol, LHS.Roles) <
+           std::tie(RHS.Line, RHS.Column, RHS.Symbol, RHS.Roles);
+  };
+  auto Equal = [](const StoreOccurrence &LHS, const StoreOccurrence &RHS) {
+    return LHS.Line == RHS.Line && LHS.Column == RHS.Column &&
+           LHS.Symbol == RHS.Symbol && LHS.Roles == RHS.Roles;
+  };
+  // A header without include guards is indexed once per inclusion.
+  std::stable_sort(FileOccurrences.begin(), FileOccurrences.end(), Less);
+  FileOccurrences.erase(
+      std::unique(FileOccurrences.begin(), FileOccurrences.end(), Equal),
+      FileOccurrences.end());
+
+  IndexRecord Record;
+  llvm::DenseMap<unsigned, unsigned> LocalIndices;
+  auto getLocalIndex = [&](unsigned Symbol) {
+    auto Inserted = LocalIndices.insert(
+        std::make_pair(Symbol, unsigned(Record.Symbols.size())));
+    if (Inserted.second)
+      Record.Symbols.push_back(Symbols[Symbol]);
+    return Inserted.first->second;
+  };
+  for (StoreOccurrence &Occur : FileOccurrences) {
+    Occur.Symbol = getLocalIndex(Occur.Symbol);
+    for (StoreRelation &Rel : Occur.Relations)
+      Rel.Symbol = getLocalIndex(Rel.Symbol);
+  }
+  Record.Occurrences = std::move(FileOccurrences);
+  return Record;
+}
+
+void IndexRecordingConsumer::reportError(StringRef Message) {
+  Ctx->getDiagnostics().Report(diag::err_fe_index_store_write)
+      << StorePath << Message;
+}
+
+static std::string getAbsolutePath(StringRef Path) {
+  SmallString<256> AbsPath(Path);
+  llvm::sys::fs::make_absolute(AbsPath);
+  return AbsPath.str();
+}
+
+void IndexRecordingConsumer::finish() {
+  if (!Ctx)
+    return;
+  SourceManager &SM = Ctx->getSourceManager();
+  std::string RecordsDir = getIndexRecordsDirectory(StorePath);
+  std::string Error;
+
+  IndexUnit Unit;
+  if (const FileEntry *MainFile = SM.getFileEntryForID(SM.getMainFileID()))
+    Unit.MainFilePath = getAbsolutePath(MainFile->getName());
+  Unit.OutputFilePath = getAbsolutePath(OutputFile);
+
+  // Every file entered during the compilation is a dependency of the unit,
+  // even if nothing in it was indexed.
+  llvm::SmallPtrSet<const FileEntry *, 16> SeenFiles;
+  for (unsigned I = 0, E = SM.local_sloc_entry_size(); I != E; ++I) {
+    const SrcMgr::SLocEntry &Entry = SM.getLocalSLocEntry(I);
+    if (!Entry.isFile())
+      continue;
+    const SrcMgr::FileInfo &File = Entry.getFile();
+    const FileEntry *FE = File.getContentCache()->OrigEntry;
+    if (!FE || !SeenFiles.insert(FE).second)
+      continue;
+
+    IndexUnitDependency Dep;
+    Dep.FilePath = getAbsolutePath(FE->getName());
+    Dep.IsSystem = File.getFileCharacteristic() != SrcMgr::C_User;
+    Dep.Size = FE->getSize();
+    Dep.ModTime = FE->getModificationTime();
+
+    auto It = Occurrences.find(FE);
+    if (It != Occurrences.end()) {
+      IndexRecord Record = createRecord(It->second);
+      std::string Data;
+      llvm::raw_string_ostream OS(Data);
+      writeIndexRecord(Record, OS);
+      OS.flush();
+
+      // Records are named after their contents, so an existing record with
+      // the same name is the same record, written by another compilation.
+      Dep.RecordName = getIndexRecordName(Dep.FilePath, Data);
+      if (writeIndexStoreFile(RecordsDir, Dep.RecordName, Data,
+                              /*Overwrite=*/false, Error)) {
+        reportError(Error);
+        return;
+      }
+    }
+    Unit.Dependencies.push_back(std::move(Dep));
+  }
+
+  std::string Data;
+  llvm::raw_string_ostream OS(Data);
+  writeIndexUnit(Unit, OS);
+  OS.flush();
+  if (writeIndexStoreFile(getIndexUnitsDirectory(StorePath),
+                          getIndexUnitName(Unit.OutputFilePath), Data,
+                          /*Overwrite=*/true, Error))
+    reportError(Error);
+}
+
+std::unique_ptr<FrontendAction>
+index::createIndexDataRecordingAction(const FrontendOptions &FEOpts,
+                                      std::unique_ptr<FrontendAction>
+                                          WrappedAction) {
+  // Without an output file, name the unit after the input.
+  StringRef OutputFile = FEOpts.OutputFile;
+  if ((OutputFile.empty() || OutputFile == "-") && !FEOpts.Inputs.empty() &&
+      FEOpts.Inputs[0].isFile())
+    OutputFile = FEOpts.Inputs[0].getFile();
+
+  auto DataConsumer = std::make_shared<IndexRecordingConsumer>(
+      FEOpts.IndexStorePath, OutputFile);
+  IndexingOptions Opts;
+  return createIndexingAction(std::move(DataConsumer), Opts,
+                              std::move(WrappedAction));
+}
@@ -306,12 +306,17 @@ namespace {
 class PTHFileData {
   const uint32_t TokenOff;
   const uint32_t PPCondOff;
+  const uint64_t Size;
+  const time_t ModTime;
 public:
-  PTHFileData(uint32_t tokenOff, uint32_t ppCondOff)
-    : TokenOff(tokenOff), PPCondOff(ppCondOff) {}
+  PTHFileData(uint32_t tokenOff, uint32_t ppCondOff, uint64_t size,
+              time_t modTime)
+    : TokenOff(tokenOff), PPCondOff(ppCondOff), Size(size), ModTime(modTime) {}
 
   uint32_t getTokenOffset() const { return TokenOff; }
   uint32_t getPPCondOffset() const { return PPCondOff; }
+  uint64_t getSize() const { return Size; }
+  time_t getModTime() const { return ModTime; }
 };
 
 
@@ -361,7 +366,10 @@ public:
     using namespace llvm::support;
     uint32_t x = endian::readNext<uint32_t, little, unaligned>(d);
     uint32_t y = endian::readNext<uint32_t, little, unaligned>(d);
-    return PTHFileData(x, y);
+    d += 8 * 2; // Skip the unique ID.
+    time_t ModTime = endian::readNext<uint64_t, little, unaligned>(d);
+    uint64_t Size = endian::readNext<uint64_t, little, unaligned>(d);
+    return PTHFileData(x, y, Size, ModTime);
   }
 };
 
@@ -608,6 +616,11 @@ PTHLexer *PTHManager::CreateLexer(FileID FID) {
 
   const PTHFileData& FileData = *I;
 
+  // The file changed since the tokens were cached; lex it from source.
+  if (FE->getSize() != FileData.getSize() ||
+      FE->getModificationTime() != FileData.getModTime())
+    return nullptr;
+
   const unsigned char *BufStart = (const unsigned char *)Buf->getBufferStart();
   // Compute the offset of the token data within the buffer.
   const unsigned char* data = BufStart + FileData.getTokenOffset();
@@ -709,6 +722,11 @@ public:
     if (!D.HasData)
       return CacheMissing;
 
+    // Always stat files that have cached tokens, so that CreateLexer can tell
+    // whether they changed since the PTH file was written.
+    if (!D.IsDirectory)
+      return statChained(Path, Data, isFile, F, FS);
+
     Data.Name = Path;
     Data.Size = D.Size;
     Data.ModTime = D.ModTime;
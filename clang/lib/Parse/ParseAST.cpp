@@ -17,11 +17,13 @@
 #include "clang/AST/ExternalASTSource.h"
 #include "clang/AST/Stmt.h"
 #include "clang/Parse/ParseDiagnostic.h"
+#include "clang/Lex/PPCallbacks.h"
 #include "clang/Parse/Parser.h"
 #include "clang/Sema/CodeCompleteConsumer.h"
 #include "clang/Sema/Sema.h"
 #include "clang/Sema/SemaConsumer.h"
 #include "llvm/Support/CrashRecoveryContext.h"
+#include "llvm/Support/TimeProfiler.h"
 #include <cstdio>
 #include <memory>
 
@@ -85,6 +87,60 @@ void PrettyStackTraceParserEntry::print(raw_ostream &OS) const {
   }
 }
 
+/// Records a "Source" time trace section for each file the preprocessor enters
+/// while parsing, other than the main file.
+class TimeTraceSourceCallbacks : public PPCallbacks {
+  const SourceManager &SM;
+  unsigned Depth;
+  bool SeenMainFile;
+
+public:
+  TimeTraceSourceCallbacks(const SourceManager &SM)
+      : SM(SM), Depth(0), SeenMainFile(false) {}
+
+  void FileChanged(SourceLocation Loc, FileChangeReason Reason,
+                   SrcMgr::CharacteristicKind FileType,
+                   FileID PrevFID) override {
+    if (Reason == EnterFile) {
+      if (!SeenMainFile) {
+        SeenMainFile = true;
+        return;
+      }
+      ++Depth;
+      llvm::timeTraceProfilerBegin("Source", StringRef(SM.getBufferName(Loc)));
+    } else if (Reason == ExitFile && Depth) {
+      --Depth;
+      llvm::timeTraceProfilerEnd();
+    }
+  }
+
+  /// End the sections of the files that are still being parsed, e.g. because
+  /// parsing stopped early.
+  void endOpenSections() {
+    for (; Depth; --Depth)
+      llvm::timeTraceProfilerEnd();
+  }
+};
+
+/// Installs TimeTraceSourceCallbacks for the duration of the parse when the
+/// time trace profiler is enabled.
+class TimeTraceSourceScope {
+  TimeTraceSourceCallbacks *Callbacks = nullptr;
+
+public:
+  TimeTraceSourceScope(Preprocessor &PP) {
+    if (!llvm::timeTraceProfilerEnabled())
+      return;
+    auto C = llvm::make_unique<TimeTraceSourceCallbacks>(PP.getSourceManager());
+    Callbacks = C.get();
+    PP.addPPCallbacks(std::move(C));
+  }
+  ~TimeTraceSourceScope() {
+    if (Callbacks)
+      Callbacks->endOpenSections();
+  }
+};
+
 }  // namespace
 
 //===----------------------------------------------------------------------===//
@@ -135,35 +191,40 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
   llvm::CrashRecoveryContextCleanupRegistrar<Parser>
     CleanupParser(ParseOP.get());
 
-  S.getPreprocessor().EnterMainSourceFile();
-  P.Initialize();
-
-  // C11 6.9p1 says translation units must have at least one top-level
-  // declaration. C++ doesn't have this restriction. We also don't want to
-  // complain if we have a precompiled header, although technically if the PCH
-  // is empty we should still emit the (pedantic) diagnostic.
-  Parser::DeclGroupPtrTy ADecl;
-  ExternalASTSource *External = S.getASTContext().getExternalSource();
-  if (External)
-    External->StartTranslationUnit(Consumer);
-
-  if (P.ParseTopLevelDecl(ADecl)) {
-    if (!External && !S.getLangOpts().CPlusPlus)
-      P.Diag(diag::ext_empty_translation_unit);
-  } else {
-    do {
-      // If we got a null return and something *was* parsed, ignore it.  This
-      // is due to a top-level semicolon, an action override, or a parse error
-      // skipping something.
-      if (ADecl && !Consumer->HandleTopLevelDecl(ADecl.get()))
-        return;
-    } while (!P.ParseTopLevelDecl(ADecl));
+  {
+    llvm::TimeTraceScope TimeScope("Frontend", StringRef(""));
+    TimeTraceSourceScope SourceScope(S.getPreprocessor());
+
+    S.getPreprocessor().EnterMainSourceFile();
+    P.Initialize();
+
+    // C11 6.9p1 says translation units must have at least one top-level
+    // declaration. C++ doesn't have this restriction. We also don't want to
+    // complain if we have a precompiled header, although technically if the
+    // PCH is empty we should still emit the (pedantic) diagnostic.
+    Parser::DeclGroupPtrTy ADecl;
+    ExternalASTSource *External = S.getASTContext().getExternalSource();
+    if (External)
+      External->StartTranslationUnit(Consumer);
+
+    if (P.ParseTopLevelDecl(ADecl)) {
+      if (!External && !S.getLangOpts().CPlusPlus)
+        P.Diag(diag::ext_empty_translation_unit);
+    } else {
+      do {
+        // If we got a null return and something *was* parsed, ignore it.
+        // This is due to a top-level semicolon, an action override, or a
+        // parse error skipping something.
+        if (ADecl && !Consumer->HandleTopLevelDecl(ADecl.get()))
+          return;
+      } while (!P.ParseTopLevelDecl(ADecl));
+    }
+
+    // Process any TopLevelDecls generated by #pragma weak.
+    for (Decl *D : S.WeakTopLevelDecls())
+      Consumer->HandleTopLevelDecl(DeclGroupRef(D));
   }
 
-  // Process any TopLevelDecls generated by #pragma weak.
-  for (Decl *D : S.WeakTopLevelDecls())
-    Consumer->HandleTopLevelDecl(DeclGroupRef(D));
-  
   Consumer->HandleTranslationUnit(S.getASTContext());
 
   std::swap(OldCollectStats, S.CollectStats);
@@ -18,6 +18,7 @@
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 
 using namespace clang;
 using namespace ento;
@@ -321,6 +322,18 @@ unsigned AnalyzerOptions::getMaxNodesPerTopLevelFunction() {
   return MaxNodesPerTopLevelFunction.getValue();
 }
 
+unsigned AnalyzerOptions::getShardCount() {
+  if (!ShardCount.hasValue())
+    ShardCount = std::max(getOptionAsInteger("shard-count", 1), 1);
+  return ShardCount.getValue();
+}
+
+unsigned AnalyzerOptions::getShardIndex() {
+  if (!ShardIndex.hasValue())
+    ShardIndex = getOptionAsInteger("shard-index", 0);
+  return ShardIndex.getValue();
+}
+
 bool AnalyzerOptions::shouldSynthesizeBodies() {
   return getBooleanOption("faux-bodies", true);
 }
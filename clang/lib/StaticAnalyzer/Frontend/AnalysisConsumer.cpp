@@ -149,6 +149,11 @@ class AnalysisConsumer : public AnalysisASTConsumer,
   /// Bug Reporter to use while recursively visiting Decls.
   BugReporter *RecVisitorBR;
 
+  /// The position of the next function in the order in which the functions
+  /// are considered for path-sensitive analysis. Used to assign functions to
+  /// shards.
+  unsigned NextShardSlot;
+
 public:
   ASTContext *Ctx;
   const Preprocessor &PP;
@@ -183,7 +188,8 @@ public:
   AnalysisConsumer(const Preprocessor &pp, const std::string &outdir,
                    AnalyzerOptionsRef opts, ArrayRef<std::string> plugins,
                    CodeInjector *injector)
-      : RecVisitorMode(0), RecVisitorBR(nullptr), Ctx(nullptr), PP(pp),
+      : RecVisitorMode(0), RecVisitorBR(nullptr), NextShardSlot(0),
+        Ctx(nullptr), PP(pp),
         OutDir(outdir), Opts(std::move(opts)), Plugins(plugins),
         Injector(injector) {
     DigestAnalyzerOptions();
@@ -308,6 +314,13 @@ public:
   /// use it to define the order in which the functions should be visited.
   void HandleDeclsCallGraph(const unsigned LocalTUDeclsSize);
 
+  /// \brief Assign the next function considered for path-sensitive analysis
+  /// to a shard and return true if it is the shard analyzed by this
+  /// invocation.
+  bool takeNextShardSlot() {
+    return NextShardSlot++ % Opts->getShardCount() == Opts->getShardIndex();
+  }
+
   /// \brief Run analyzes(syntax or path sensitive) on the given function.
   /// \param Mode - determines if we are requesting syntax only or path
   /// sensitive only analysis.
@@ -483,6 +496,13 @@ void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
     if (!D)
       continue;
 
+    // Skip the functions analyzed by the other shards. Every function is
+    // assigned to a shard before the skipping below, which depends on the
+    // functions this shard has analyzed, so that all shards agree on the
+    // assignment.
+    if (!takeNextShardSlot())
+      continue;
+
     // Skip the functions which have been processed already or previously
     // inlined.
     if (shouldSkipFunction(D, Visited, VisitedAsTopLevel))
@@ -521,12 +541,17 @@ void AnalysisConsumer::HandleTranslationUnit(ASTContext &C) {
     // Introduce a scope to destroy BR before Mgr.
     BugReporter BR(*Mgr);
     TranslationUnitDecl *TU = C.getTranslationUnitDecl();
-    checkerMgr->runCheckersOnASTDecl(TU, *Mgr, BR);
+
+    // The AST-only checks are cheap; when the translation unit is split into
+    // shards, the first shard runs all of them.
+    bool RunSyntaxChecks = Opts->getShardIndex() == 0;
+    if (RunSyntaxChecks)
+      checkerMgr->runCheckersOnASTDecl(TU, *Mgr, BR);
 
     // Run the AST-only checks using the order in which functions are defined.
     // If inlining is not turned on, use the simplest function order for path
     // sensitive analyzes as well.
-    RecVisitorMode = AM_Syntax;
+    RecVisitorMode = RunSyntaxChecks ? AM_Syntax : AM_None;
     if (!Mgr->shouldInlineCall())
       RecVisitorMode |= AM_Path;
     RecVisitorBR = &BR;
@@ -538,15 +563,18 @@ void AnalysisConsumer::HandleTranslationUnit(ASTContext &C) {
     // random access.  By doing so, we automatically compensate for iterators
     // possibly being invalidated, although this is a bit slower.
     const unsigned LocalTUDeclsSize = LocalTUDecls.size();
-    for (unsigned i = 0 ; i < LocalTUDeclsSize ; ++i) {
-      TraverseDecl(LocalTUDecls[i]);
+    if (RecVisitorMode != AM_None) {
+      for (unsigned i = 0 ; i < LocalTUDeclsSize ; ++i) {
+        TraverseDecl(LocalTUDecls[i]);
+      }
     }
 
     if (Mgr->shouldInlineCall())
       HandleDeclsCallGraph(LocalTUDeclsSize);
 
     // After all decls handled, run checkers on the entire TranslationUnit.
-    checkerMgr->runCheckersOnEndOfTranslationUnit(TU, *Mgr, BR);
+    if (RunSyntaxChecks)
+      checkerMgr->runCheckersOnEndOfTranslationUnit(TU, *Mgr, BR);
 
     RecVisitorBR = nullptr;
   }
@@ -611,6 +639,11 @@ void AnalysisConsumer::HandleCode(Decl *D, AnalysisMode Mode,
   if (!D->hasBody())
     return;
   Mode = getModeForDecl(D, Mode);
+
+  // Without inlining, the functions are analyzed in the order in which they
+  // are defined; leave the ones of other shards to those shards.
+  if ((Mode & AM_Path) && !Mgr->shouldInlineCall() && !takeNextShardSlot())
+    Mode &= ~AM_Path;
   if (Mode == AM_None)
     return;
 
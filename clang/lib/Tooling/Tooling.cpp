@@ -31,7 +31,9 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <mutex>
 #include <utility>
 
 #define DEBUG_TYPE "clang-tooling"
@@ -461,6 +463,249 @@ int ClangTool::run(ToolAction *Action) {
 
 namespace {
 
+/// \brief A file with the name it was opened under, which may differ from the
+/// name known to the underlying file system.
+class NamedFile : public vfs::File {
+  std::unique_ptr<vfs::File> F;
+  std::string Name;
+
+public:
+  NamedFile(std::unique_ptr<vfs::File> F, StringRef Name)
+      : F(std::move(F)), Name(Name) {}
+
+  llvm::ErrorOr<vfs::Status> status() override {
+    llvm::ErrorOr<vfs::Status> S = F->status();
+    if (!S)
+      return S;
+    return vfs::Status::copyWithNewName(*S, Name);
+  }
+  llvm::ErrorOr<std::string> getName() override { return Name; }
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+  getBuffer(const Twine &Name, int64_t FileSize, bool RequiresNullTerminator,
+            bool IsVolatile) override {
+    return F->getBuffer(Name, FileSize, RequiresNullTerminator, IsVolatile);
+  }
+  std::error_code close() override { return F->close(); }
+};
+
+/// \brief Resolves relative paths against its own working directory instead
+/// of the one of the process.
+///
+/// Changing the working directory of the real file system affects every
+/// thread, so tool invocations that run at the same time use one of these on
+/// top of it instead.
+class WorkingDirectoryFileSystem : public vfs::FileSystem {
+  IntrusiveRefCntPtr<vfs::FileSystem> FS;
+  std::string WorkingDirectory;
+
+  void resolve(const Twine &Path, SmallVectorImpl<char> &Result) const {
+    Path.toVector(Result);
+    if (llvm::sys::path::is_absolute(Result))
+      return;
+    SmallString<256> Absolute(WorkingDirectory);
+    llvm::sys::path::append(Absolute, Result);
+    Result.clear();
+    Result.append(Absolute.begin(), Absolute.end());
+  }
+
+public:
+  WorkingDirectoryFileSystem(IntrusiveRefCntPtr<vfs::FileSystem> FS,
+                             StringRef WorkingDirectory)
+      : FS(std::move(FS)), WorkingDirectory(WorkingDirectory) {}
+
+  llvm::ErrorOr<vfs::Status> status(const Twine &Path) override {
+    SmallString<256> Resolved;
+    resolve(Path, Resolved);
+    llvm::ErrorOr<vfs::Status> S = FS->status(Resolved);
+    if (!S)
+      return S;
+    return vfs::Status::copyWithNewName(*S, Path.str());
+  }
+
+  llvm::ErrorOr<std::unique_ptr<vfs::File>>
+  openFileForRead(const Twine &Path) override {
+    SmallString<256> Resolved;
+    resolve(Path, Resolved);
+    llvm::ErrorOr<std::unique_ptr<vfs::File>> F = FS->openFileForRead(Resolved);
+    if (!F)
+      return F;
+    return std::unique_ptr<vfs::File>(
+        llvm::make_unique<NamedFile>(std::move(*F), Path.str()));
+  }
+
+  vfs::directory_iterator dir_begin(const Twine &Dir,
+                                    std::error_code &EC) override {
+    SmallString<256> Resolved;
+    resolve(Dir, Resolved);
+    return FS->dir_begin(Resolved, EC);
+  }
+
+  std::error_code setCurrentWorkingDirectory(const Twine &Path) override {
+    SmallString<256> Resolved;
+    resolve(Path, Resolved);
+    llvm::ErrorOr<vfs::Status> S = FS->status(Resolved);
+    if (!S)
+      return S.getError();
+    if (!S->isDirectory())
+      return std::make_error_code(std::errc::not_a_directory);
+    WorkingDirectory = Resolved.str();
+    return std::error_code();
+  }
+
+  llvm::ErrorOr<std::string> getCurrentWorkingDirectory() const override {
+    return WorkingDirectory;
+  }
+};
+
+/// \brief Forwards diagnostics to a consumer shared between threads, one
+/// diagnostic at a time.
+class LockedDiagnosticConsumer : public DiagnosticConsumer {
+  DiagnosticConsumer &Target;
+  std::mutex &Lock;
+
+public:
+  LockedDiagnosticConsumer(DiagnosticConsumer &Target, std::mutex &Lock)
+      : Target(Target), Lock(Lock) {}
+
+  void BeginSourceFile(const LangOptions &LangOpts,
+                       const Preprocessor *PP) override {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Target.BeginSourceFile(LangOpts, PP);
+  }
+
+  void EndSourceFile() override {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Target.EndSourceFile();
+  }
+
+  bool IncludeInDiagnosticCounts() const override {
+    return Target.IncludeInDiagnosticCounts();
+  }
+
+  void HandleDiagnostic(DiagnosticsEngine::Level DiagLevel,
+                        const Diagnostic &Info) override {
+    DiagnosticConsumer::HandleDiagnostic(DiagLevel, Info);
+    std::lock_guard<std::mutex> Guard(Lock);
+    Target.HandleDiagnostic(DiagLevel, Info);
+  }
+};
+
+/// \brief A compile command to run, with its fully adjusted command line.
+struct ToolJob {
+  std::string File;
+  std::string Directory;
+  std::vector<std::string> CommandLine;
+};
+
+} // end anonymous namespace
+
+int ClangTool::runConcurrently(ToolAction *Action, unsigned ThreadCount) {
+  // Exists solely for the purpose of lookup of the resource path.
+  // This just needs to be some symbol in the binary.
+  static int StaticSymbol;
+
+  llvm::SmallString<128> InitialDirectory;
+  if (std::error_code EC = llvm::sys::fs::current_path(InitialDirectory))
+    llvm::report_fatal_error("Cannot detect current path: " +
+                             Twine(EC.message()));
+
+  // Query the compilation database and run the arguments adjusters up front:
+  // neither of them is required to be thread-safe, and the database may
+  // change the state of the file system (see ClangTool::run).
+  std::vector<ToolJob> Jobs;
+  for (const auto &SourcePath : SourcePaths) {
+    std::string File(getAbsolutePath(SourcePath));
+    std::vector<CompileCommand> CompileCommandsForFile =
+        Compilations.getCompileCommands(File);
+    if (CompileCommandsForFile.empty()) {
+      llvm::errs() << "Skipping " << File << ". Compile command not found.\n";
+      continue;
+    }
+    for (CompileCommand &CompileCommand : CompileCommandsForFile) {
+      std::vector<std::string> CommandLine = CompileCommand.CommandLine;
+      if (ArgsAdjuster)
+        CommandLine = ArgsAdjuster(CommandLine, CompileCommand.Filename);
+      assert(!CommandLine.empty());
+      injectResourceDir(CommandLine, "clang_tool", &StaticSymbol);
+      Jobs.push_back({File, CompileCommand.Directory, std::move(CommandLine)});
+    }
+  }
+
+  std::vector<std::string> Outputs(Jobs.size());
+  std::vector<char> Failed(Jobs.size(), false);
+  std::mutex DiagLock;
+
+  auto RunJob = [&](size_t I) {
+    ToolJob &Job = Jobs[I];
+    llvm::raw_string_ostream OS(Outputs[I]);
+
+    // Give each job its own view of the file system, so that jobs can run in
+    // different working directories.
+    IntrusiveRefCntPtr<vfs::OverlayFileSystem> JobFileSystem(
+        new vfs::OverlayFileSystem(new WorkingDirectoryFileSystem(
+            vfs::getRealFileSystem(), InitialDirectory)));
+    IntrusiveRefCntPtr<vfs::InMemoryFileSystem> JobInMemoryFileSystem(
+        new vfs::InMemoryFileSystem);
+    JobFileSystem->pushOverlay(JobInMemoryFileSystem);
+    for (const auto &MappedFile : MappedFileContents)
+      if (llvm::sys::path::is_absolute(MappedFile.first))
+        JobInMemoryFileSystem->addFile(
+            MappedFile.first, 0,
+            llvm::MemoryBuffer::getMemBuffer(MappedFile.second));
+    if (JobFileSystem->setCurrentWorkingDirectory(Job.Directory))
+      llvm::report_fatal_error("Cannot chdir into \"" + Twine(Job.Directory) +
+                               "\n!");
+    for (const auto &MappedFile : MappedFileContents)
+      if (!llvm::sys::path::is_absolute(MappedFile.first))
+        JobInMemoryFileSystem->addFile(
+            MappedFile.first, 0,
+            llvm::MemoryBuffer::getMemBuffer(MappedFile.second));
+    IntrusiveRefCntPtr<FileManager> JobFiles(
+        new FileManager(FileSystemOptions(), JobFileSystem));
+
+    IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
+    std::unique_ptr<DiagnosticConsumer> JobDiagConsumer;
+    if (DiagConsumer)
+      JobDiagConsumer =
+          llvm::make_unique<LockedDiagnosticConsumer>(*DiagConsumer, DiagLock);
+    else
+      JobDiagConsumer =
+          llvm::make_unique<TextDiagnosticPrinter>(OS, &*DiagOpts);
+
+    DEBUG({
+      std::lock_guard<std::mutex> Guard(DiagLock);
+      llvm::dbgs() << "Processing: " << Job.File << ".\n";
+    });
+    ToolInvocation Invocation(std::move(Job.CommandLine), Action,
+                              JobFiles.get(), PCHContainerOps);
+    Invocation.setDiagnosticConsumer(JobDiagConsumer.get());
+
+    if (!Invocation.run()) {
+      OS << "Error while processing " << Job.File << ".\n";
+      Failed[I] = true;
+    }
+    OS.flush();
+  };
+
+  {
+    std::unique_ptr<llvm::ThreadPool> Pool =
+        ThreadCount ? llvm::make_unique<llvm::ThreadPool>(ThreadCount)
+                    : llvm::make_unique<llvm::ThreadPool>();
+    for (size_t I = 0, E = Jobs.size(); I != E; ++I)
+      Pool->async(RunJob, I);
+    Pool->wait();
+  }
+
+  bool ProcessingFailed = false;
+  for (size_t I = 0, E = Jobs.size(); I != E; ++I) {
+    llvm::errs() << Outputs[I];
+    ProcessingFailed |= Failed[I];
+  }
+  return ProcessingFailed ? 1 : 0;
+}
+
+namespace {
+
 class ASTBuilderAction : public ToolAction {
   std::vector<std::unique_ptr<ASTUnit>> &ASTs;
 
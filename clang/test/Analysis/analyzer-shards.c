@@ -0,0 +1,34 @@
+// RUN: %clang_cc1 -analyze -analyzer-checker=core,deadcode -verify -DSYNTAX -DSECOND -DFIRST %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core,deadcode -analyzer-config shard-count=2,shard-index=0 -verify -DSYNTAX -DSECOND %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core,deadcode -analyzer-config shard-count=2,shard-index=1 -verify -DFIRST %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core,deadcode -analyzer-config ipa=none,shard-count=2,shard-index=0 -verify -DSYNTAX -DFIRST %s
+// RUN: %clang_cc1 -analyze -analyzer-checker=core,deadcode -analyzer-config ipa=none,shard-count=2,shard-index=1 -verify -DSECOND %s
+// RUN: not %clang_cc1 -analyze -analyzer-checker=core -analyzer-config shard-count=2,shard-index=2 %s 2>&1 | FileCheck %s
+
+// CHECK: error: analyzer-config option 'shard-index' (2) must be less than 'shard-count' (2)
+
+// With inlining, the functions are assigned to shards in the order of the
+// call graph, which visits 'second' before 'first'. Without inlining, they
+// are assigned in the order in which they are defined. The AST-based checks
+// only run in the first shard.
+
+int first(int *p) {
+  int x;
+#ifdef SYNTAX
+  // expected-warning@+2 {{Value stored to 'x' is never read}}
+#endif
+  x = 1;
+  p = 0;
+#ifdef FIRST
+  // expected-warning@+2 {{Dereference of null pointer}}
+#endif
+  return *p;
+}
+
+int second(int *p) {
+  p = 0;
+#ifdef SECOND
+  // expected-warning@+2 {{Dereference of null pointer}}
+#endif
+  return *p;
+}
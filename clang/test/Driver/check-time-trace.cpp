@@ -0,0 +1,19 @@
+// RUN: %clangxx -### -ftime-trace -c %s 2>&1 | FileCheck %s --check-prefix=DRIVER
+// DRIVER: "-cc1"{{.*}} "-ftime-trace"
+
+// RUN: %clangxx -S -ftime-trace -mllvm -time-trace-granularity=0 -o %t.s %s
+// RUN: FileCheck %s < %t.json
+// CHECK: "traceEvents": [
+// CHECK-DAG: "name": "Frontend"
+// CHECK-DAG: "name": "InstantiateFunction", "args": { "detail": "foo<int>" }
+// CHECK-DAG: "name": "InstantiateClass", "args": { "detail": "S<int>" }
+// CHECK-DAG: "name": "CodeGen Function", "args": { "detail": "bar" }
+// CHECK-DAG: "name": "Backend"
+// CHECK-DAG: "name": "Total InstantiateFunction", "args": { "count": 1,
+// CHECK: ] }
+
+template <typename T> struct S { T X; };
+
+template <typename T> T foo(T X) { return S<T>{X}.X; }
+
+int bar() { return foo(1); }
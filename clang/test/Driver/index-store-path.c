@@ -0,0 +1,3 @@
+// RUN: %clang -### -index-store-path %t/idx -c %s 2>&1 | FileCheck %s
+// CHECK: "-cc1"
+// CHECK: "-index-store-path" "{{.*}}idx"
@@ -0,0 +1,20 @@
+// RUN: %clang -fintegrated-cc1 -### -c %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=IN-PROCESS
+// IN-PROCESS: {{^}} (in-process)
+// IN-PROCESS-NEXT: "-cc1"
+// IN-PROCESS-NOT: (in-process)
+
+// RUN: %clang -fintegrated-cc1 -fno-integrated-cc1 -### -c %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=SPAWN
+// RUN: %clang -### -c %s 2>&1 | FileCheck %s --check-prefix=SPAWN
+// SPAWN: "-cc1"
+// SPAWN-NOT: (in-process)
+
+// RUN: env CC_PRINT_OPTIONS=1 CC_PRINT_OPTIONS_FILE=%t.log \
+// RUN:   %clang -fintegrated-cc1 -c %s -o %t.o
+// RUN: test -f %t.o
+// RUN: FileCheck %s --check-prefix=LOG < %t.log
+// LOG: "-cc1"
+// LOG-NOT: (in-process)
+
+int f(void) { return 0; }
@@ -0,0 +1 @@
+int header_func(int x);
@@ -0,0 +1,31 @@
+// RUN: rm -rf %t
+// RUN: %clang_cc1 -fsyntax-only -index-store-path %t/idx %s -o %t/first.o
+// RUN: c-index-test core -print-record %t/idx/v1/records/record-and-unit.c-* | FileCheck %s
+// RUN: c-index-test core -print-record %t/idx/v1/records/header.h-* | FileCheck %s -check-prefix=HEADER
+// RUN: c-index-test core -print-unit %t/idx/v1/units/first.o-* | FileCheck %s -check-prefix=UNIT
+// RUN: %clang_cc1 -fsyntax-only -index-store-path %t/idx %s -o %t/second.o -DSECOND
+// RUN: ls %t/idx/v1/records | FileCheck %s -check-prefix=RECORDS
+
+// The header is indexed the same way by both compilations, so it has a
+// single record; the main file has one record per compilation.
+// RECORDS: header.h-
+// RECORDS-NEXT: record-and-unit.c-
+// RECORDS-NEXT: record-and-unit.c-
+// RECORDS-NOT: {{.}}
+
+// UNIT: main-path: {{.*}}record-and-unit.c
+// UNIT-NEXT: out-file: {{.*}}first.o
+// UNIT-NEXT: user | {{.*}}record-and-unit.c | record-and-unit.c-{{[0-9a-f]+}}
+// UNIT-NEXT: user | {{.*}}Inputs{{/|\\}}header.h | header.h-{{[0-9a-f]+}}
+
+#include "Inputs/header.h"
+// HEADER: 1:5 | function/C | header_func | c:@F@header_func | Decl | rel: 0
+
+#ifndef SECOND
+int first_func(void) { return header_func(1); }
+// CHECK: [[@LINE-1]]:5 | function/C | first_func | c:@F@first_func | Def | rel: 0
+// CHECK-NEXT: [[@LINE-2]]:31 | function/C | header_func | c:@F@header_func | Ref,Call,RelCall | rel: 1
+// CHECK-NEXT: RelCall | first_func | c:@F@first_func
+#else
+int second_func(void) { return header_func(2); }
+#endif
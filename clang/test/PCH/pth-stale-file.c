@@ -0,0 +1,17 @@
+// Check that files which changed since a PTH file was written are lexed from
+// source instead of using the cached tokens.
+
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: echo 'int from_cache;' > %t/header.h
+// RUN: %clang_cc1 -emit-pth %t/header.h -o %t/header.pth
+// RUN: %clang_cc1 -token-cache %t/header.pth -I %t -E %s \
+// RUN:   | FileCheck %s --check-prefix=CACHED
+// RUN: echo 'int from_source_file;' > %t/header.h
+// RUN: %clang_cc1 -token-cache %t/header.pth -I %t -E %s \
+// RUN:   | FileCheck %s --check-prefix=CHANGED
+
+#include "header.h"
+
+// CACHED: int from_cache;
+// CHANGED-NOT: from_cache
+// CHANGED: int from_source_file;
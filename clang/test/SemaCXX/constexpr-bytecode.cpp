@@ -0,0 +1,100 @@
+// RUN: %clang_cc1 -std=c++14 -fsyntax-only -verify %s
+// RUN: %clang_cc1 -std=c++14 -fsyntax-only -verify %s -fexperimental-new-constant-interpreter
+
+// The results and diagnostics must not depend on which evaluator is used.
+
+constexpr int fib(int n) { return n < 2 ? n : fib(n - 1) + fib(n - 2); }
+static_assert(fib(20) == 6765, "");
+
+constexpr unsigned long long sumTo(unsigned n) {
+  unsigned long long s = 0;
+  for (unsigned i = 1; i <= n; ++i)
+    s += i;
+  return s;
+}
+static_assert(sumTo(100000) == 5000050000ull, "");
+
+constexpr int collatz(int n) {
+  int steps = 0;
+  while (n != 1) {
+    if (n % 2)
+      n = 3 * n + 1;
+    else
+      n /= 2;
+    ++steps;
+  }
+  return steps;
+}
+static_assert(collatz(27) == 111, "");
+
+constexpr int loops(int n) {
+  int r = 0;
+  do {
+    if (n % 3 == 0) {
+      --n;
+      continue;
+    }
+    if (n == 1)
+      break;
+    r += n--;
+  } while (n > 0);
+  return r;
+}
+static_assert(loops(10) == 36, "");
+
+constexpr unsigned wrap(unsigned x) { return x * 2u + 1u; }
+static_assert(wrap(0x80000000u) == 1u, "");
+
+constexpr int shifts(int x, int s) { return (x << s) >> 1; }
+static_assert(shifts(5, 3) == 20, "");
+static_assert(shifts(1, 31) == -1073741824, "");
+
+constexpr char incChar(char c) { return ++c; }
+static_assert(incChar('a') == 'b', "");
+constexpr unsigned char incUChar(unsigned char c) {
+  c++;
+  return c;
+}
+static_assert(incUChar(255) == 0, "");
+
+constexpr bool safeDiv(int a, int b) { return b != 0 && a / b > 1; }
+static_assert(!safeDiv(1, 0) && safeDiv(4, 2), "");
+
+constexpr int Scale = 3;
+enum E { A = 4 };
+constexpr int scaled(int x, int y = 5) { return x * Scale + A + y; }
+static_assert(scaled(2) == 15, "");
+
+template <typename T> constexpr T twice(T x) { return x + x; }
+static_assert(twice<long>(21) == 42, "");
+
+constexpr bool isOdd(unsigned n);
+constexpr bool isEven(unsigned n) { return n == 0 ? true : isOdd(n - 1); }
+constexpr bool isOdd(unsigned n) { return n == 0 ? false : isEven(n - 1); }
+static_assert(isEven(100) && isOdd(7), "");
+
+// Unsupported constructs are left to the AST-walking evaluator.
+constexpr int element(int i) {
+  int a[3] = {1, 2, 3};
+  return a[i];
+}
+static_assert(element(2) == 3, "");
+
+// So are calls which are not constant expressions.
+constexpr int later(); // expected-note {{declared here}}
+constexpr int early() { return later(); } // expected-note {{undefined function 'later' cannot be used in a constant expression}}
+static_assert(early() == 1, ""); // expected-error {{static_assert expression is not an integral constant expression}} expected-note {{in call to 'early()'}}
+constexpr int later() { return 1; }
+static_assert(early() == 1, "");
+
+constexpr int twiceInt(int x) { return x * 2; } // expected-note {{value 2147483648 is outside the range of representable values of type 'int'}}
+static_assert(twiceInt(1 << 30), ""); // expected-error {{static_assert expression is not an integral constant expression}} expected-note {{in call to 'twiceInt(1073741824)'}}
+
+constexpr int divide(int a, int b) { return a / b; } // expected-note {{division by zero}}
+static_assert(divide(1, 0), ""); // expected-error {{static_assert expression is not an integral constant expression}} expected-note {{in call to 'divide(1, 0)'}}
+
+// A call which fails deep in a recursion is left to the AST-walking evaluator,
+// and so are the later calls to the same function.
+constexpr int divideDeep(int n, int d) { return n == 0 ? 100 / d : divideDeep(n - 1, d); } // expected-note {{division by zero}} expected-note {{in call to 'divideDeep(0, 0)'}} expected-note {{in call to 'divideDeep(1, 0)'}}
+static_assert(divideDeep(2, 0), ""); // expected-error {{static_assert expression is not an integral constant expression}} expected-note {{in call to 'divideDeep(2, 0)'}}
+static_assert(divideDeep(50, 5) == 20, "");
@@ -13,9 +13,11 @@
 #include "clang/Frontend/FrontendAction.h"
 #include "clang/Index/IndexingAction.h"
 #include "clang/Index/IndexDataConsumer.h"
+#include "clang/Index/IndexStore.h"
 #include "clang/Index/USRGeneration.h"
 #include "clang/Index/CodegenNameGenerator.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/PrettyStackTrace.h"
@@ -31,6 +33,8 @@ namespace {
 enum class ActionType {
   None,
   PrintSourceSymbols,
+  PrintRecord,
+  PrintUnit,
 };
 
 namespace options {
@@ -42,9 +46,17 @@ Action(cl::desc("Action:"), cl::init(ActionType::None),
        cl::values(
           clEnumValN(ActionType::PrintSourceSymbols,
                      "print-source-symbols", "Print symbols from source"),
+          clEnumValN(ActionType::PrintRecord,
+                     "print-record", "Print an index store record file"),
+          clEnumValN(ActionType::PrintUnit,
+                     "print-unit", "Print an index store unit file"),
           clEnumValEnd),
        cl::cat(IndexTestCoreCategory));
 
+static cl::opt<std::string>
+InputFile(cl::Positional, cl::desc("<record or unit file>"),
+          cl::cat(IndexTestCoreCategory));
+
 static cl::extrahelp MoreHelp(
   "\nAdd \"-- <compiler arguments>\" at the end to setup the compiler "
   "invocation\n"
@@ -162,6 +174,77 @@ static bool printSourceSymbols(ArrayRef<const char *> Args) {
   return false;
 }
 
+//===----------------------------------------------------------------------===//
+// Print Record and Unit
+//===----------------------------------------------------------------------===//
+
+static bool readStoreFile(StringRef Path, std::unique_ptr<MemoryBuffer> &Buf) {
+  auto BufOrErr = MemoryBuffer::getFile(Path);
+  if (!BufOrErr) {
+    errs() << "error: cannot read '" << Path << "': "
+           << BufOrErr.getError().message() << '\n';
+    return true;
+  }
+  Buf = std::move(*BufOrErr);
+  return false;
+}
+
+static bool printRecord(StringRef Path) {
+  std::unique_ptr<MemoryBuffer> Buf;
+  if (readStoreFile(Path, Buf))
+    return true;
+  IndexRecord Record;
+  std::string Error;
+  if (readIndexRecord(Buf->getBuffer(), Record, Error)) {
+    errs() << "error: invalid record '" << Path << "': " << Error << '\n';
+    return true;
+  }
+
+  auto printSymbol = [&](const StoreSymbol &Sym) {
+    outs() << (Sym.Name.empty() ? "<no-name>" : Sym.Name) << " | " << Sym.USR;
+  };
+  for (const StoreOccurrence &Occur : Record.Occurrences) {
+    const StoreSymbol &Sym = Record.Symbols[Occur.Symbol];
+    outs() << Occur.Line << ':' << Occur.Column << " | ";
+    printSymbolInfo({Sym.Kind, Sym.SubKinds, Sym.Lang}, outs());
+    outs() << " | ";
+    printSymbol(Sym);
+    outs() << " | ";
+    printSymbolRoles(Occur.Roles, outs());
+    outs() << " | rel: " << Occur.Relations.size() << '\n';
+    for (const StoreRelation &Rel : Occur.Relations) {
+      outs() << '\t';
+      printSymbolRoles(Rel.Roles, outs());
+      outs() << " | ";
+      printSymbol(Record.Symbols[Rel.Symbol]);
+      outs() << '\n';
+    }
+  }
+  return false;
+}
+
+static bool printUnit(StringRef Path) {
+  std::unique_ptr<MemoryBuffer> Buf;
+  if (readStoreFile(Path, Buf))
+    return true;
+  IndexUnit Unit;
+  std::string Error;
+  if (readIndexUnit(Buf->getBuffer(), Unit, Error)) {
+    errs() << "error: invalid unit '" << Path << "': " << Error << '\n';
+    return true;
+  }
+
+  outs() << "main-path: " << Unit.MainFilePath << '\n';
+  outs() << "out-file: " << Unit.OutputFilePath << '\n';
+  for (const IndexUnitDependency &Dep : Unit.Dependencies) {
+    outs() << (Dep.IsSystem ? "system" : "user") << " | " << Dep.FilePath
+           << " | ";
+    outs() << (Dep.RecordName.empty() ? "<no-record>" : Dep.RecordName)
+           << '\n';
+  }
+  return false;
+}
+
 //===----------------------------------------------------------------------===//
 // Helper Utils
 //===----------------------------------------------------------------------===//
@@ -226,5 +309,16 @@ int indextest_core_main(int argc, const char **argv) {
     return printSourceSymbols(CompArgs);
   }
 
+  if (options::Action == ActionType::PrintRecord ||
+      options::Action == ActionType::PrintUnit) {
+    if (options::InputFile.empty()) {
+      errs() << "error: missing record or unit file\n";
+      return 1;
+    }
+    if (options::Action == ActionType::PrintRecord)
+      return printRecord(options::InputFile);
+    return printUnit(options::InputFile);
+  }
+
   return 0;
 }
@@ -30,8 +30,10 @@
 #include "llvm/Option/OptTable.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstdio>
@@ -58,6 +60,30 @@ static void LLVMErrorHandler(void *UserData, const std::string &Message,
   exit(GenCrashDiag ? 70 : 1);
 }
 
+/// Write the time trace profile next to the output file, or next to the main
+/// input file when there is no output file.
+static void WriteTimeTrace(CompilerInstance &Clang) {
+  const FrontendOptions &FEOpts = Clang.getFrontendOpts();
+  SmallString<128> Path;
+  if (!FEOpts.OutputFile.empty() && FEOpts.OutputFile != "-")
+    Path = FEOpts.OutputFile;
+  else if (!FEOpts.Inputs.empty() && FEOpts.Inputs[0].isFile())
+    Path = llvm::sys::path::filename(FEOpts.Inputs[0].getFile());
+  else
+    Path = "-";
+  if (Path != "-")
+    llvm::sys::path::replace_extension(Path, "json");
+
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::F_Text);
+  if (EC) {
+    Clang.getDiagnostics().Report(diag::err_fe_unable_to_open_output)
+        << Path << EC.message();
+    return;
+  }
+  llvm::timeTraceProfilerWrite(OS);
+}
+
 #ifdef LINK_POLLY_INTO_TOOLS
 namespace polly {
 void initializePollyPasses(llvm::PassRegistry &Registry);
@@ -112,8 +138,19 @@ int cc1_main(ArrayRef<const char *> Argv, const char *Argv0, void *MainAddr) {
   if (!Success)
     return 1;
 
+  if (Clang->getFrontendOpts().TimeTrace)
+    llvm::timeTraceProfilerInitialize();
+
   // Execute the frontend actions.
-  Success = ExecuteCompilerInvocation(Clang.get());
+  {
+    llvm::TimeTraceScope TimeScope("ExecuteCompiler", StringRef(""));
+    Success = ExecuteCompilerInvocation(Clang.get());
+  }
+
+  if (llvm::timeTraceProfilerEnabled()) {
+    WriteTimeTrace(*Clang);
+    llvm::timeTraceProfilerCleanup();
+  }
 
   // If any timers were active but haven't been destroyed yet, print their
   // results now.  This happens in -disable-free mode.
@@ -305,6 +305,10 @@ static int ExecuteCC1Tool(ArrayRef<const char *> argv, StringRef Tool) {
   return 1;
 }
 
+static int ExecuteCC1InProcess(ArrayRef<const char *> argv) {
+  return ExecuteCC1Tool(argv, argv[1] + 4);
+}
+
 int main(int argc_, const char **argv_) {
   llvm::sys::PrintStackTraceOnErrorSignal(argv_[0]);
   llvm::PrettyStackTraceProgram X(argc_, argv_);
@@ -453,6 +457,9 @@ int main(int argc_, const char **argv_) {
 
   SetBackdoorDriverOutputsFromEnvVars(TheDriver);
 
+  // Let -fintegrated-cc1 jobs run inside this process.
+  TheDriver.CC1Main = &ExecuteCC1InProcess;
+
   std::unique_ptr<Compilation> C(TheDriver.BuildCompilation(argv));
   int Res = 0;
   SmallVector<std::pair<int, const Command *>, 4> FailingCommands;
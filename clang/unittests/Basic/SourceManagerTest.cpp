@@ -171,6 +171,48 @@ TEST_F(SourceManagerTest, getColumnNumber) {
   EXPECT_EQ(1U, SourceMgr.getColumnNumber(MainFileID, 0, nullptr));
 }
 
+TEST_F(SourceManagerTest, getFileIDForManyExpansions) {
+  const char *Source = "int x;\n";
+  std::unique_ptr<llvm::MemoryBuffer> Buf =
+      llvm::MemoryBuffer::getMemBuffer(Source);
+  FileID MainFileID = SourceMgr.createFileID(std::move(Buf));
+  SourceMgr.setMainFileID(MainFileID);
+  SourceLocation FileLoc = SourceMgr.getLocForStartOfFile(MainFileID);
+
+  // Enough expansions that lookups need the binary search, with tokens of
+  // varying length.
+  const unsigned NumExpansions = 500;
+  std::vector<SourceLocation> ExpansionLocs;
+  for (unsigned I = 0; I != NumExpansions; ++I)
+    ExpansionLocs.push_back(SourceMgr.createExpansionLoc(
+        FileLoc, FileLoc, FileLoc, /*TokLength=*/1 + I % 7));
+
+  // Visit the expansions in orders that defeat the linear scans and the
+  // recent lookup cache, querying the first and last offset of each.
+  for (unsigned Step : {1u, 37u, 211u}) {
+    for (unsigned I = 0, J = 0; I != NumExpansions;
+         ++I, J = (J + Step) % NumExpansions) {
+      std::pair<FileID, unsigned> Start =
+          SourceMgr.getDecomposedLoc(ExpansionLocs[J]);
+      std::pair<FileID, unsigned> End =
+          SourceMgr.getDecomposedLoc(ExpansionLocs[J].getLocWithOffset(J % 7));
+      EXPECT_EQ(0U, Start.second);
+      EXPECT_EQ(Start.first, End.first);
+      EXPECT_EQ(J % 7, End.second);
+    }
+  }
+
+  // Alternate between a few expansions, which the recent lookup cache serves.
+  for (unsigned I = 0; I != 4; ++I) {
+    for (unsigned J = 0; J != 4; ++J) {
+      SourceLocation Loc = ExpansionLocs[J * 100].getLocWithOffset(1);
+      EXPECT_EQ(1U, SourceMgr.getDecomposedLoc(Loc).second);
+    }
+  }
+
+  EXPECT_EQ(MainFileID, SourceMgr.getFileID(FileLoc.getLocWithOffset(3)));
+}
+
 #if defined(LLVM_ON_UNIX)
 
 TEST_F(SourceManagerTest, getMacroArgExpandedLocation) {
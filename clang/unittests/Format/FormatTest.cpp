@@ -3777,6 +3777,20 @@ TEST_F(FormatTest, MemoizationTests) {
   verifyFormat(input, OnePerLine);
 }
 
+TEST_F(FormatTest, BoundsSearchForLineBreaks) {
+  // Searching the solution space of this line for the best solution takes
+  // too long; the search stops early and the line still fits the limit.
+  std::string Code = "f(";
+  for (unsigned i = 0; i != 100; ++i)
+    Code += "g(a, b(c, d + e * f), h(i, j)) + ";
+  Code += "k);";
+  std::string Result = format(Code);
+  SmallVector<StringRef, 64> Lines;
+  StringRef(Result).split(Lines, '\n');
+  for (StringRef Line : Lines)
+    EXPECT_LE(Line.size(), 80u) << Line;
+}
+
 TEST_F(FormatTest, BreaksAsHighAsPossible) {
   verifyFormat(
       "void f() {\n"
@@ -0,0 +1,102 @@
+//===- unittests/Frontend/PCHPreambleTest.cpp - Preamble reuse tests ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/FrontendOptions.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace clang;
+
+namespace {
+
+class PCHPreambleTest : public ::testing::Test {
+protected:
+  SmallString<128> Dir;
+  std::vector<std::string> Files;
+  std::shared_ptr<PCHContainerOperations> PCHContainerOpts;
+
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("preamble-test", Dir));
+  }
+
+  void TearDown() override {
+    for (const std::string &File : Files)
+      sys::fs::remove(File);
+    sys::fs::remove(Dir);
+  }
+
+  std::string writeFile(StringRef Name, StringRef Contents,
+                        sys::TimeValue ModTime) {
+    SmallString<128> Path(Dir);
+    sys::path::append(Path, Name);
+    int FD;
+    EXPECT_FALSE(sys::fs::openFileForWrite(Path, FD, sys::fs::F_None));
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Contents;
+    OS.flush();
+    EXPECT_FALSE(sys::fs::setLastModificationAndAccessTime(FD, ModTime));
+    if (std::find(Files.begin(), Files.end(), Path.str()) == Files.end())
+      Files.push_back(Path.str());
+    return Path.str();
+  }
+
+  std::unique_ptr<ASTUnit> parseAST(StringRef MainFile) {
+    PCHContainerOpts = std::make_shared<PCHContainerOperations>();
+    CompilerInvocation *CI = new CompilerInvocation;
+    CI->getFrontendOpts().Inputs.push_back(
+        FrontendInputFile(MainFile, IK_C));
+    CI->getTargetOpts().Triple = "i386-unknown-linux-gnu";
+    IntrusiveRefCntPtr<DiagnosticsEngine> Diags(
+        CompilerInstance::createDiagnostics(new DiagnosticOptions,
+                                            new DiagnosticConsumer));
+    FileManager *FileMgr = new FileManager(FileSystemOptions());
+    return ASTUnit::LoadFromCompilerInvocation(
+        CI, PCHContainerOpts, Diags, FileMgr, /*OnlyLocalDecls=*/false,
+        /*CaptureDiagnostics=*/false,
+        /*PrecompilePreambleAfterNParses=*/1);
+  }
+};
+
+TEST_F(PCHPreambleTest, TouchedHeaderKeepsPreamble) {
+  sys::TimeValue ModTime(1000000000, 0);
+  std::string Header =
+      writeFile("header.h", "#define VALUE 1\nint f(void);\n", ModTime);
+  std::string Main = writeFile(
+      "main.c", "#include \"header.h\"\nint g(void) { return f(); }\n",
+      ModTime);
+
+  std::unique_ptr<ASTUnit> AST = parseAST(Main);
+  ASSERT_TRUE(AST.get());
+  ASSERT_FALSE(AST->Reparse(PCHContainerOpts));
+  unsigned Builds = AST->getNumPreambleBuildsForTests();
+  ASSERT_EQ(1u, Builds);
+
+  // Touching the header without changing its contents keeps the preamble.
+  writeFile("header.h", "#define VALUE 1\nint f(void);\n",
+            ModTime + sys::TimeValue(10, 0));
+  ASSERT_FALSE(AST->Reparse(PCHContainerOpts));
+  EXPECT_EQ(Builds, AST->getNumPreambleBuildsForTests());
+
+  // Changing the contents, even without changing the size, rebuilds it.
+  writeFile("header.h", "#define VALUE 2\nint f(void);\n",
+            ModTime + sys::TimeValue(20, 0));
+  ASSERT_FALSE(AST->Reparse(PCHContainerOpts));
+  EXPECT_EQ(Builds + 1, AST->getNumPreambleBuildsForTests());
+}
+
+} // anonymous namespace
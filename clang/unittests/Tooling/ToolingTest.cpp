@@ -482,6 +482,32 @@ TEST(ClangToolTest, InjectDiagnosticConsumer) {
   EXPECT_EQ(1u, Consumer.NumDiagnosticsSeen);
 }
 
+TEST(ClangToolTest, RunConcurrently) {
+  FixedCompilationDatabase Compilations("/", std::vector<std::string>());
+  std::vector<std::string> Sources = {"/a.cc", "/b.cc", "/c.cc"};
+  ClangTool Tool(Compilations, Sources);
+  Tool.mapVirtualFile("/a.cc", "void a() {}");
+  Tool.mapVirtualFile("/b.cc", "void b() {}");
+  Tool.mapVirtualFile("/c.cc", "void c() {}");
+  std::unique_ptr<FrontendActionFactory> Action(
+      newFrontendActionFactory<SyntaxOnlyAction>());
+  EXPECT_EQ(0, Tool.runConcurrently(Action.get(), 2));
+}
+
+TEST(ClangToolTest, InjectDiagnosticConsumerInRunConcurrently) {
+  FixedCompilationDatabase Compilations("/", std::vector<std::string>());
+  std::vector<std::string> Sources = {"/a.cc", "/b.cc"};
+  ClangTool Tool(Compilations, Sources);
+  Tool.mapVirtualFile("/a.cc", "int x = undeclared;");
+  Tool.mapVirtualFile("/b.cc", "int y = undeclared;");
+  TestDiagnosticConsumer Consumer;
+  Tool.setDiagnosticConsumer(&Consumer);
+  std::unique_ptr<FrontendActionFactory> Action(
+      newFrontendActionFactory<SyntaxOnlyAction>());
+  EXPECT_EQ(1, Tool.runConcurrently(Action.get(), 2));
+  EXPECT_EQ(2u, Consumer.NumDiagnosticsSeen);
+}
+
 TEST(ClangToolTest, InjectDiagnosticConsumerInBuildASTs) {
   FixedCompilationDatabase Compilations("/", std::vector<std::string>());
   ClangTool Tool(Compilations, std::vector<std::string>(1, "/a.cc"));
@@ -26,6 +26,10 @@
 
 namespace llvm {
 
+/// \brief Count the instructions of the functions in \p C, for the pass
+/// instrumentation.
+unsigned getIRUnitInstructionCount(const LazyCallGraph::SCC &C);
+
 extern template class PassManager<LazyCallGraph::SCC>;
 /// \brief The CGSCC pass manager.
 ///
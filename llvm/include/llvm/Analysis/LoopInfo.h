@@ -153,7 +153,7 @@ public:
   void invalidate() { IsInvalid = true; }
 
   /// Return true if this loop is no longer valid.
-  bool isInvalid() { return IsInvalid; }
+  bool isInvalid() const { return IsInvalid; }
 
   /// True if terminator in the block can branch to another block that is
   /// outside of the current loop.
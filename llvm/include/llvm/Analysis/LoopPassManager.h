@@ -21,6 +21,10 @@
 
 namespace llvm {
 
+/// \brief Count the instructions of the blocks of \p L, for the pass
+/// instrumentation. A loop which has been removed counts as empty.
+unsigned getIRUnitInstructionCount(const Loop &L);
+
 extern template class PassManager<Loop>;
 /// \brief The loop pass manager.
 ///
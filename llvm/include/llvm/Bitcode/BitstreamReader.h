@@ -43,6 +43,11 @@ public:
 private:
   std::unique_ptr<MemoryObject> BitcodeBytes;
 
+  /// The bytes of the bitcode, if they are all in memory, which lets cursors
+  /// read them directly instead of through BitcodeBytes.
+  const uint8_t *MappedBytes = nullptr;
+  size_t MappedSize = 0;
+
   std::vector<BlockInfo> BlockInfoRecords;
 
   /// This is set to true if we don't care about the block/record name
@@ -69,6 +74,8 @@ public:
 
   BitstreamReader &operator=(BitstreamReader &&Other) {
     BitcodeBytes = std::move(Other.BitcodeBytes);
+    MappedBytes = Other.MappedBytes;
+    MappedSize = Other.MappedSize;
     // Explicitly swap block info, so that nothing gets destroyed twice.
     std::swap(BlockInfoRecords, Other.BlockInfoRecords);
     IgnoreBlockInfoNames = Other.IgnoreBlockInfoNames;
@@ -78,10 +85,17 @@ public:
   void init(const unsigned char *Start, const unsigned char *End) {
     assert(((End-Start) & 3) == 0 &&"Bitcode stream not a multiple of 4 bytes");
     BitcodeBytes.reset(getNonStreamedMemoryObject(Start, End));
+    MappedBytes = Start;
+    MappedSize = End - Start;
   }
 
   MemoryObject &getBitcodeBytes() { return *BitcodeBytes; }
 
+  /// Return the bytes of the bitcode if they are all in memory, or null if
+  /// they are streamed.
+  const uint8_t *getMappedBytes() const { return MappedBytes; }
+  size_t getMappedSize() const { return MappedSize; }
+
   /// This is called by clients that want block/record name information.
   void CollectBlockInfoNames() { IgnoreBlockInfoNames = false; }
   bool isIgnoringBlockInfoNames() { return IgnoreBlockInfoNames; }
@@ -163,6 +177,8 @@ public:
   explicit SimpleBitstreamCursor(BitstreamReader *R) : R(R) {}
 
   bool canSkipToPos(size_t pos) const {
+    if (R->getMappedBytes())
+      return pos <= R->getMappedSize();
     // pos can be skipped to if it is a valid address or one byte past the end.
     return pos == 0 ||
            R->getBitcodeBytes().isValidAddress(static_cast<uint64_t>(pos - 1));
@@ -223,6 +239,8 @@ public:
 
   /// Get a pointer into the bitstream at the specified byte offset.
   const uint8_t *getPointerToByte(uint64_t ByteNo, uint64_t NumBytes) {
+    if (const uint8_t *Bytes = R->getMappedBytes())
+      return Bytes + ByteNo;
     return R->getBitcodeBytes().getPointer(ByteNo, NumBytes);
   }
 
@@ -238,6 +256,18 @@ public:
     if (Size != 0 && NextChar >= Size)
       report_fatal_error("Unexpected end of file");
 
+    // If the bitcode is in memory, load whole words directly from it; only
+    // the last, partial, word goes through the memory object.
+    const uint8_t *Bytes = R->getMappedBytes();
+    if (Bytes && R->getMappedSize() >= NextChar + sizeof(word_t)) {
+      CurWord =
+          support::endian::read<word_t, support::little, support::unaligned>(
+              Bytes + NextChar);
+      NextChar += sizeof(word_t);
+      BitsInCurWord = sizeof(word_t) * 8;
+      return;
+    }
+
     // Read the next word from the stream.
     uint8_t Array[sizeof(word_t)] = {0};
 
@@ -351,7 +381,10 @@ public:
   }
 
   /// Skip to the end of the file.
-  void skipToEnd() { NextChar = R->getBitcodeBytes().getExtent(); }
+  void skipToEnd() {
+    NextChar = R->getMappedBytes() ? R->getMappedSize()
+                                   : R->getBitcodeBytes().getExtent();
+  }
 
   /// Prevent the cursor from reading past a byte boundary.
   ///
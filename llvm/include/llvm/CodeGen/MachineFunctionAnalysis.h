@@ -20,13 +20,17 @@ namespace llvm {
 
 class MachineFunction;
 class MachineFunctionInitializer;
+class MachineModuleInfo;
 class TargetMachine;
 
 /// MachineFunctionAnalysis - This class is a Pass that manages a
-/// MachineFunction object.
+/// MachineFunction object. When the MachineModuleInfo retains the machine
+/// functions, they are handed over to it instead of being destroyed, and picked
+/// up by the next MachineFunctionAnalysis of the pipeline.
 struct MachineFunctionAnalysis : public FunctionPass {
 private:
   const TargetMachine &TM;
+  MachineModuleInfo *MMI;
   MachineFunction *MF;
   unsigned NextFnNum;
   MachineFunctionInitializer *MFInitializer;
@@ -202,6 +202,42 @@ public:
   typedef SmallVector<VariableDbgInfo, 4> VariableDbgInfoMapTy;
   VariableDbgInfoMapTy VariableDbgInfos;
 
+private:
+  /// RetainedFunction - A machine function kept alive after the machine
+  /// function passes which produced it, together with the per-function
+  /// information above, until another sequence of machine function passes
+  /// picks it up.
+  struct RetainedFunction {
+    MachineFunction *MF;
+    std::vector<MCCFIInstruction> FrameInstructions;
+    std::vector<LandingPadInfo> LandingPads;
+    DenseMap<MCSymbol*, SmallVector<unsigned, 4> > LPadToCallSiteMap;
+    DenseMap<MCSymbol*, unsigned> CallSiteMap;
+    unsigned CurCallSite;
+    std::vector<const GlobalValue *> TypeInfos;
+    std::vector<unsigned> FilterIds;
+    std::vector<unsigned> FilterEnds;
+    bool CallsEHReturn;
+    bool CallsUnwindInit;
+    bool HasEHFunclets;
+    EHPersonality PersonalityTypeCache;
+    VariableDbgInfoMapTy VariableDbgInfos;
+  };
+
+  /// RetainMachineFunctions - True if the machine functions should be kept
+  /// alive at the end of their machine function passes, so that a module pass
+  /// can work on all of them before they are emitted.
+  bool RetainMachineFunctions;
+
+  /// RetainedFunctions - The machine functions kept alive, by function.
+  DenseMap<const Function *, RetainedFunction> RetainedFunctions;
+
+  /// swapFunctionInfo - Exchange the per-function information of \p RF with
+  /// the one of the current function.
+  void swapFunctionInfo(RetainedFunction &RF);
+
+public:
+
   MachineModuleInfo();  // DUMMY CONSTRUCTOR, DO NOT CALL.
   // Real constructor.
   MachineModuleInfo(const MCAsmInfo &MAI, const MCRegisterInfo &MRI,
@@ -216,6 +252,24 @@ public:
   ///
   void EndFunction();
 
+  /// setRetainMachineFunctions - Keep the machine functions alive at the end
+  /// of their machine function passes instead of destroying them.
+  void setRetainMachineFunctions(bool V) { RetainMachineFunctions = V; }
+  bool retainsMachineFunctions() const { return RetainMachineFunctions; }
+
+  /// retainMachineFunction - Take ownership of \p MF along with the
+  /// information of the current function, and discard the latter.
+  void retainMachineFunction(MachineFunction *MF);
+
+  /// getRetainedMachineFunction - Return the machine function retained for
+  /// \p F, or null if there is none.
+  MachineFunction *getRetainedMachineFunction(const Function &F) const;
+
+  /// takeRetainedMachineFunction - Give up the ownership of the machine
+  /// function retained for \p F, if any, and make its information the one of
+  /// the current function.
+  MachineFunction *takeRetainedMachineFunction(const Function &F);
+
   const MCContext &getContext() const { return Context; }
   MCContext &getContext() { return Context; }
 
@@ -374,6 +374,10 @@ namespace llvm {
   /// and propagates register usage information of callee to caller
   /// if available with PysicalRegisterUsageInfo pass.
   FunctionPass *createRegUsageInfoPropPass();
+
+  /// This pass replaces repeated sequences of machine instructions of the
+  /// module with calls to functions containing one copy of the sequence.
+  ModulePass *createMachineOutlinerPass();
 } // End llvm namespace
 
 /// Target machine pass initializer for passes with dependencies. Use with
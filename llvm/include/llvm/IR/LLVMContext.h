@@ -34,6 +34,7 @@ template <typename T> class SmallVectorImpl;
 class Function;
 class DebugLoc;
 class OptBisect;
+class raw_ostream;
 
 /// This is an important class for using LLVM in a threaded context.  It
 /// (opaquely) owns and manages the core "global" data of LLVM's core
@@ -243,6 +244,36 @@ public:
   /// \brief Access the object which manages optimization bisection for failure
   /// analysis.
   OptBisect &getOptBisect();
+
+  /// \brief Print the number of entries in, and the approximate memory used
+  /// by, each of the tables in which this context uniques constants, metadata,
+  /// attributes and types, with a breakdown of the metadata nodes by kind.
+  void printUniquingTableStats(raw_ostream &OS) const;
+
+  /// \brief Destroy the aggregate constants, constant expressions and
+  /// constant data arrays and vectors which have no uses.
+  ///
+  /// Constants stay in the uniquing tables until the context is destroyed,
+  /// even once the modules which used them are deleted. As with
+  /// Constant::removeDeadConstantUsers, pointers to unused constants held
+  /// outside of the IR must not be used afterwards. Constants which metadata
+  /// refers to are kept.
+  ///
+  /// \returns the number of constants destroyed.
+  unsigned dropTriviallyDeadConstants();
+
+  /// \brief Destroy the uniqued debug locations which are not used by the
+  /// modules of this context nor by other metadata.
+  ///
+  /// Debug locations stay in the context until it is destroyed, even once the
+  /// instructions which used them are deleted, which happens to most of the
+  /// locations created by inlining. Nothing is destroyed if a module is still
+  /// being materialized. Debug locations held outside of the modules, as by a
+  /// DebugLoc of a MachineInstr or of an instruction which is not in a
+  /// function, must not be used afterwards.
+  ///
+  /// \returns the number of debug locations destroyed.
+  unsigned dropUnusedDebugLocations();
 private:
   LLVMContext(LLVMContext&) = delete;
   void operator=(LLVMContext&) = delete;
@@ -0,0 +1,188 @@
+//===- PassInstrumentation.h - Callbacks around pass execution --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This header defines the callbacks which the new pass managers and analysis
+/// managers run around the passes and analyses they run, and the standard
+/// users of these callbacks: per pass timing, per pass change of the
+/// instruction count, and per analysis run and invalidation counts.
+///
+/// The same callbacks object can be registered with the analysis managers of
+/// all IR unit types (see \c AnalysisManager::setPassInstrumentation); the
+/// pass managers find it through the analysis manager they are run with.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_PASSINSTRUMENTATION_H
+#define LLVM_IR_PASSINSTRUMENTATION_H
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Timer.h"
+#include <functional>
+#include <memory>
+
+namespace llvm {
+
+class Function;
+class Module;
+class raw_ostream;
+
+/// \brief The unit of IR a pass or an analysis runs on, as seen by the
+/// instrumentation callbacks.
+class PassInstrumentationIRUnit {
+public:
+  PassInstrumentationIRUnit(StringRef Name,
+                            function_ref<unsigned()> CountInstructions)
+      : Name(Name), CountInstructions(CountInstructions) {}
+
+  StringRef getName() const { return Name; }
+
+  /// \brief Count the instructions in the IR unit.
+  ///
+  /// This walks the whole IR unit, so it is only done for the callbacks that
+  /// need it.
+  unsigned getInstructionCount() const { return CountInstructions(); }
+
+private:
+  StringRef Name;
+  function_ref<unsigned()> CountInstructions;
+};
+
+/// \brief Callbacks run around the passes and analyses of the new pass
+/// manager.
+class PassInstrumentationCallbacks {
+public:
+  /// A callback run before a pass. If any of them returns false, the pass
+  /// is skipped.
+  typedef std::function<bool(StringRef PassName,
+                             const PassInstrumentationIRUnit &IR)>
+      BeforePassFunc;
+  typedef std::function<void(StringRef PassName,
+                             const PassInstrumentationIRUnit &IR)>
+      PassFunc;
+  typedef std::function<void(StringRef AnalysisName,
+                             const PassInstrumentationIRUnit &IR)>
+      AnalysisFunc;
+
+  void registerBeforePassCallback(BeforePassFunc C) {
+    BeforePassCallbacks.push_back(std::move(C));
+  }
+  void registerAfterPassCallback(PassFunc C) {
+    AfterPassCallbacks.push_back(std::move(C));
+  }
+  void registerPassSkippedCallback(PassFunc C) {
+    PassSkippedCallbacks.push_back(std::move(C));
+  }
+  void registerBeforeAnalysisCallback(AnalysisFunc C) {
+    BeforeAnalysisCallbacks.push_back(std::move(C));
+  }
+  void registerAfterAnalysisCallback(AnalysisFunc C) {
+    AfterAnalysisCallbacks.push_back(std::move(C));
+  }
+  void registerAnalysisInvalidatedCallback(AnalysisFunc C) {
+    AnalysisInvalidatedCallbacks.push_back(std::move(C));
+  }
+
+  /// \brief Run the callbacks registered for the point before a pass.
+  ///
+  /// \returns false if the pass should be skipped.
+  bool runBeforePass(StringRef PassName,
+                     const PassInstrumentationIRUnit &IR) const;
+  void runAfterPass(StringRef PassName,
+                    const PassInstrumentationIRUnit &IR) const;
+  void runPassSkipped(StringRef PassName,
+                      const PassInstrumentationIRUnit &IR) const;
+  void runBeforeAnalysis(StringRef AnalysisName,
+                         const PassInstrumentationIRUnit &IR) const;
+  void runAfterAnalysis(StringRef AnalysisName,
+                        const PassInstrumentationIRUnit &IR) const;
+  void runAnalysisInvalidated(StringRef AnalysisName,
+                              const PassInstrumentationIRUnit &IR) const;
+
+private:
+  SmallVector<BeforePassFunc, 4> BeforePassCallbacks;
+  SmallVector<PassFunc, 4> AfterPassCallbacks;
+  SmallVector<PassFunc, 4> PassSkippedCallbacks;
+  SmallVector<AnalysisFunc, 4> BeforeAnalysisCallbacks;
+  SmallVector<AnalysisFunc, 4> AfterAnalysisCallbacks;
+  SmallVector<AnalysisFunc, 4> AnalysisInvalidatedCallbacks;
+};
+
+/// \brief Count the instructions of the IR units of the basic pass managers.
+unsigned getIRUnitInstructionCount(const Module &M);
+unsigned getIRUnitInstructionCount(const Function &F);
+
+/// \brief Measures the time spent in each pass.
+///
+/// The time of a pass does not include the time of the passes it runs itself,
+/// as pass managers and adaptors do, so that the times add up to the total.
+class PassTimingInfo {
+public:
+  PassTimingInfo();
+  ~PassTimingInfo();
+
+  void registerCallbacks(PassInstrumentationCallbacks &PIC);
+
+  /// \brief Print the times of all passes and reset them.
+  void print(raw_ostream &OS);
+
+private:
+  void startPass(StringRef PassName);
+  void stopPass();
+
+  TimerGroup TG;
+  StringMap<std::unique_ptr<Timer>> Timers;
+  /// The timers of the passes which are currently running, innermost last.
+  SmallVector<Timer *, 8> ActiveTimers;
+};
+
+/// \brief Measures how much each pass grows or shrinks the IR it runs on, in
+/// instructions.
+///
+/// The change of a pass includes the changes of the passes it runs itself.
+class PassInstructionCountTracker {
+public:
+  void registerCallbacks(PassInstrumentationCallbacks &PIC);
+
+  /// \brief Print the changes of all passes which changed the instruction
+  /// count, largest first.
+  void print(raw_ostream &OS) const;
+
+private:
+  struct PassCounts {
+    unsigned Runs = 0;
+    int64_t Delta = 0;
+  };
+  StringMap<PassCounts> Counts;
+  /// The instruction counts before the passes which are currently running.
+  SmallVector<unsigned, 8> CountsBefore;
+};
+
+/// \brief Counts how often each analysis is computed and invalidated.
+class AnalysisRunCounter {
+public:
+  void registerCallbacks(PassInstrumentationCallbacks &PIC);
+
+  /// \brief Print the counts of all analyses, most often computed first.
+  void print(raw_ostream &OS) const;
+
+private:
+  struct AnalysisCounts {
+    unsigned Runs = 0;
+    unsigned Invalidations = 0;
+  };
+  StringMap<AnalysisCounts> Counts;
+};
+
+} // end namespace llvm
+
+#endif
@@ -43,6 +43,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/PassInstrumentation.h"
 #include "llvm/IR/PassManagerInternal.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/TypeName.h"
@@ -247,13 +248,30 @@ public:
     if (DebugLogging)
       dbgs() << "Starting " << getTypeName<IRUnitT>() << " pass manager run.\n";
 
+    const PassInstrumentationCallbacks *PIC = AM.getPassInstrumentation();
+    auto CountInstructions = [&IR] { return getIRUnitInstructionCount(IR); };
+
     for (unsigned Idx = 0, Size = Passes.size(); Idx != Size; ++Idx) {
       if (DebugLogging)
         dbgs() << "Running pass: " << Passes[Idx]->name() << " on "
                << IR.getName() << "\n";
 
+      // Take the name of the IR unit before running the pass, which may
+      // delete it.
+      std::string IRName;
+      if (PIC)
+        IRName = IR.getName();
+      PassInstrumentationIRUnit IRUnit(IRName, CountInstructions);
+      if (PIC && !PIC->runBeforePass(Passes[Idx]->name(), IRUnit)) {
+        PIC->runPassSkipped(Passes[Idx]->name(), IRUnit);
+        continue;
+      }
+
       PreservedAnalyses PassPA = Passes[Idx]->run(IR, AM);
 
+      if (PIC)
+        PIC->runAfterPass(Passes[Idx]->name(), IRUnit);
+
       // Update the analysis manager as each pass runs and potentially
       // invalidates analyses. We also update the preserved set of analyses
       // based on what analyses we have already handled the invalidation for
@@ -483,21 +501,32 @@ public:
   ///
   /// A flag can be passed to indicate that the manager should perform debug
   /// logging.
-  AnalysisManager(bool DebugLogging = false) : DebugLogging(DebugLogging) {}
+  AnalysisManager(bool DebugLogging = false)
+      : DebugLogging(DebugLogging), PIC(nullptr) {}
 
   // We have to explicitly define all the special member functions because MSVC
   // refuses to generate them.
   AnalysisManager(AnalysisManager &&Arg)
       : BaseT(std::move(static_cast<BaseT &>(Arg))),
         AnalysisResults(std::move(Arg.AnalysisResults)),
-        DebugLogging(std::move(Arg.DebugLogging)) {}
+        DebugLogging(std::move(Arg.DebugLogging)), PIC(Arg.PIC) {}
   AnalysisManager &operator=(AnalysisManager &&RHS) {
     BaseT::operator=(std::move(static_cast<BaseT &>(RHS)));
     AnalysisResults = std::move(RHS.AnalysisResults);
     DebugLogging = std::move(RHS.DebugLogging);
+    PIC = RHS.PIC;
     return *this;
   }
 
+  /// \brief Set the instrumentation callbacks to run around the analyses of
+  /// this manager and the passes run with it, or null for none.
+  void setPassInstrumentation(const PassInstrumentationCallbacks *Callbacks) {
+    PIC = Callbacks;
+  }
+  const PassInstrumentationCallbacks *getPassInstrumentation() const {
+    return PIC;
+  }
+
   /// \brief Returns true if the analysis manager has an empty results cache.
   bool empty() const {
     assert(AnalysisResults.empty() == AnalysisResultLists.empty() &&
@@ -535,7 +564,18 @@ private:
       if (DebugLogging)
         dbgs() << "Running analysis: " << P.name() << "\n";
       AnalysisResultListT &ResultList = AnalysisResultLists[&IR];
-      ResultList.emplace_back(PassID, P.run(IR, *this));
+      if (PIC) {
+        std::string IRName = IR.getName();
+        auto CountInstructions = [&IR] {
+          return getIRUnitInstructionCount(IR);
+        };
+        PassInstrumentationIRUnit IRUnit(IRName, CountInstructions);
+        PIC->runBeforeAnalysis(P.name(), IRUnit);
+        ResultList.emplace_back(PassID, P.run(IR, *this));
+        PIC->runAfterAnalysis(P.name(), IRUnit);
+      } else {
+        ResultList.emplace_back(PassID, P.run(IR, *this));
+      }
 
       // P.run may have inserted elements into AnalysisResults and invalidated
       // RI.
@@ -565,6 +605,8 @@ private:
     if (DebugLogging)
       dbgs() << "Invalidating analysis: " << this->lookupPass(PassID).name()
              << "\n";
+    if (PIC)
+      notifyInvalidated(PassID, IR);
     AnalysisResultLists[&IR].erase(RI->second);
     AnalysisResults.erase(RI);
   }
@@ -595,6 +637,8 @@ private:
         if (DebugLogging)
           dbgs() << "Invalidating analysis: " << this->lookupPass(PassID).name()
                  << "\n";
+        if (PIC)
+          notifyInvalidated(PassID, IR);
 
         InvalidatedPassIDs.push_back(I->first);
         I = ResultsList.erase(I);
@@ -616,6 +660,16 @@ private:
     return PA;
   }
 
+  /// \brief Run the instrumentation callbacks for the invalidation of the
+  /// result of the analysis \p PassID on \p IR.
+  void notifyInvalidated(void *PassID, IRUnitT &IR) {
+    std::string IRName = IR.getName();
+    auto CountInstructions = [&IR] { return getIRUnitInstructionCount(IR); };
+    PIC->runAnalysisInvalidated(this->lookupPass(PassID).name(),
+                                PassInstrumentationIRUnit(IRName,
+                                                          CountInstructions));
+  }
+
   /// \brief List of function analysis pass IDs and associated concept pointers.
   ///
   /// Requires iterators to be valid across appending new entries and arbitrary
@@ -646,6 +700,9 @@ private:
 
   /// \brief A flag indicating whether debug logging is enabled.
   bool DebugLogging;
+
+  /// \brief The instrumentation callbacks, if any.
+  const PassInstrumentationCallbacks *PIC;
 };
 
 extern template class AnalysisManager<Module>;
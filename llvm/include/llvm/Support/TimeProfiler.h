@@ -0,0 +1,94 @@
+//===- llvm/Support/TimeProfiler.h - Hierarchical Time Profiler -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares a lightweight profiler which records nested, named time
+// intervals ("scopes") and writes them out in the Chrome trace event format,
+// which can be loaded into chrome://tracing or similar viewers.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_TIMEPROFILER_H
+#define LLVM_SUPPORT_TIMEPROFILER_H
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+#include <type_traits>
+
+namespace llvm {
+
+class raw_ostream;
+
+struct TimeTraceProfiler;
+extern TimeTraceProfiler *TimeTraceProfilerInstance;
+
+/// \brief Initialize the time trace profiler.
+///
+/// This sets up the global \p TimeTraceProfilerInstance variable to be the
+/// profiler instance.
+void timeTraceProfilerInitialize();
+
+/// \brief Clean up the time trace profiler, if it was initialized.
+void timeTraceProfilerCleanup();
+
+/// \brief Is the time trace profiler enabled, i.e. initialized?
+inline bool timeTraceProfilerEnabled() {
+  return TimeTraceProfilerInstance != nullptr;
+}
+
+/// \brief Write the recorded profile to \p OS in the Chrome trace event
+/// format.
+void timeTraceProfilerWrite(raw_ostream &OS);
+
+/// \brief Manually begin a time section, with the given \p Name and
+/// \p Detail.
+///
+/// Time sections must be ended with timeTraceProfilerEnd and may be nested.
+void timeTraceProfilerBegin(StringRef Name, StringRef Detail);
+
+/// \brief Like the above, but only computes \p Detail when the profiler is
+/// enabled.
+void timeTraceProfilerBegin(StringRef Name,
+                            function_ref<std::string()> Detail);
+
+/// \brief Manually end the last time section.
+void timeTraceProfilerEnd();
+
+/// \brief The TimeTraceScope is a helper class to call the begin and end
+/// functions of the time trace profiler.
+///
+/// When the profiler is disabled, constructing and destroying it costs a
+/// single test of a global pointer.
+struct TimeTraceScope {
+  TimeTraceScope(StringRef Name, StringRef Detail) {
+    if (TimeTraceProfilerInstance != nullptr)
+      timeTraceProfilerBegin(Name, Detail);
+  }
+  /// \brief Begin a section whose detail is computed by the callable
+  /// \p Detail only when the profiler is enabled.
+  template <typename DetailFn,
+            typename = typename std::enable_if<
+                !std::is_convertible<DetailFn, StringRef>::value>::type>
+  TimeTraceScope(StringRef Name, DetailFn &&Detail) {
+    if (TimeTraceProfilerInstance != nullptr)
+      timeTraceProfilerBegin(Name, function_ref<std::string()>(Detail));
+  }
+  ~TimeTraceScope() {
+    if (TimeTraceProfilerInstance != nullptr)
+      timeTraceProfilerEnd();
+  }
+
+private:
+  TimeTraceScope(const TimeTraceScope &) = delete;
+  void operator=(const TimeTraceScope &) = delete;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_SUPPORT_TIMEPROFILER_H
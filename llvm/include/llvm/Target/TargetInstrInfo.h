@@ -1439,6 +1439,68 @@ public:
     return None;
   }
 
+  /// Represents how an instruction should be mapped by the outliner.
+  /// \p Legal instructions are those which are safe to outline.
+  /// \p Illegal instructions are those which cannot be outlined.
+  /// \p Invisible instructions are instructions which can be outlined, but
+  /// shouldn't actually impact the outlining result.
+  enum MachineOutlinerInstrType { Legal, Illegal, Invisible };
+
+  /// Return true if the function \p MF can have instructions outlined from it,
+  /// which are then replaced by calls to the outlined functions.
+  virtual bool isFunctionSafeToOutlineFrom(MachineFunction &MF) const {
+    return false;
+  }
+
+  /// Return how the outliner should treat the instruction \p MI. Only called
+  /// for the instructions of functions for which isFunctionSafeToOutlineFrom
+  /// returned true.
+  virtual MachineOutlinerInstrType
+  getOutliningType(const MachineInstr &MI) const {
+    llvm_unreachable(
+        "Target didn't implement TargetInstrInfo::getOutliningType!");
+  }
+
+  /// Return the number of instructions saved by outlining a sequence of
+  /// \p SequenceSize instructions that occurs \p Occurrences times. The
+  /// sequence ends in a return when \p CanBeTailCall is true, so that it can
+  /// be reached with a tail call instead of a call.
+  ///
+  /// The outliner only outlines sequences with a positive benefit.
+  virtual int getOutliningBenefit(size_t SequenceSize, size_t Occurrences,
+                                  bool CanBeTailCall) const {
+    llvm_unreachable(
+        "Target didn't implement TargetInstrInfo::getOutliningBenefit!");
+  }
+
+  /// Insert a custom prologue for the outlined function \p MF, whose body is
+  /// \p MBB. Called after the outlined instructions have been added.
+  virtual void insertOutlinerPrologue(MachineBasicBlock &MBB,
+                                      MachineFunction &MF,
+                                      bool IsTailCall) const {
+    llvm_unreachable(
+        "Target didn't implement TargetInstrInfo::insertOutlinerPrologue!");
+  }
+
+  /// Insert a custom epilogue, typically a return, for the outlined function
+  /// \p MF, whose body is \p MBB.
+  virtual void insertOutlinerEpilogue(MachineBasicBlock &MBB,
+                                      MachineFunction &MF,
+                                      bool IsTailCall) const {
+    llvm_unreachable(
+        "Target didn't implement TargetInstrInfo::insertOutlinerEpilogue!");
+  }
+
+  /// Insert a call to the outlined function \p MF before \p It in \p MBB,
+  /// and return an iterator to the call. The call is a tail call when
+  /// \p IsTailCall is true.
+  virtual MachineBasicBlock::iterator
+  insertOutlinedCall(MachineBasicBlock &MBB, MachineBasicBlock::iterator It,
+                     MachineFunction &MF, bool IsTailCall) const {
+    llvm_unreachable(
+        "Target didn't implement TargetInstrInfo::insertOutlinedCall!");
+  }
+
 private:
   unsigned CallFrameSetupOpcode, CallFrameDestroyOpcode;
   unsigned CatchRetOpcode;
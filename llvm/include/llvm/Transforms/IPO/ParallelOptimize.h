@@ -0,0 +1,55 @@
+//===- ParallelOptimize.h - Parallel function optimization ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares a utility which runs per-function optimizations on the
+// functions of a module in parallel.
+//
+// An LLVMContext can only be used by one thread at a time, so the functions
+// are not optimized in place. Instead, the module is split into partitions
+// which each define a subset of the functions, and each partition is moved to
+// its own context by way of bitcode, as for parallel code generation. The
+// optimized function bodies are then linked back into the original module.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_IPO_PARALLELOPTIMIZE_H
+#define LLVM_TRANSFORMS_IPO_PARALLELOPTIMIZE_H
+
+#include <functional>
+
+namespace llvm {
+
+class Module;
+
+/// Optimize the function definitions of \p M on up to \p ThreadCount threads.
+///
+/// \p OptimizePartition is called once per partition, concurrently and each
+/// time on a different thread and in a different LLVMContext. A partition
+/// contains the definitions of some of the functions of \p M, the definitions
+/// of all the global variables, and declarations of everything else.
+/// \p OptimizePartition may change the function definitions of the partition
+/// and add global values, such as the lookup tables SimplifyCFG creates, which
+/// are carried over to \p M. It must not remove or rename the global values of
+/// the partition, nor change anything else about them.
+///
+/// Since function passes do not look at the bodies of other functions, the
+/// result is the same as optimizing the functions in order in a single
+/// thread, whatever the number of threads, up to the names of the global
+/// values the optimizations add.
+///
+/// \returns false, without changing \p M, if the functions of \p M cannot be
+/// optimized separately, or if there is no point in doing so, in which case
+/// the caller should optimize them itself.
+bool optimizeFunctionsInParallel(
+    Module &M, unsigned ThreadCount,
+    const std::function<void(Module &MPart)> &OptimizePartition);
+
+} // end namespace llvm
+
+#endif
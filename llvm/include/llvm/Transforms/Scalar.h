@@ -331,6 +331,13 @@ FunctionPass *createEarlyCSEPass();
 //
 FunctionPass *createGVNHoistPass();
 
+//===----------------------------------------------------------------------===//
+//
+// NewGVN - This pass performs global value numbering on congruence classes
+// over SSA form and MemorySSA, including loads and phis.
+//
+FunctionPass *createNewGVNPass();
+
 //===----------------------------------------------------------------------===//
 //
 // MergedLoadStoreMotion - This pass merges loads and stores in diamonds. Loads
@@ -490,6 +497,12 @@ FunctionPass *createNaryReassociatePass();
 // llvm.loop.distribute.enable metadata data override this default.
 FunctionPass *createLoopDistributePass(bool ProcessAllLoopsByDefault);
 
+//===----------------------------------------------------------------------===//
+//
+// LoopFuse - Fuse adjacent loops with the same trip count.
+//
+FunctionPass *createLoopFusePass();
+
 //===----------------------------------------------------------------------===//
 //
 // LoopLoadElimination - Perform loop-aware load elimination.
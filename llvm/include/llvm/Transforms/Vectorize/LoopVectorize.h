@@ -100,6 +100,10 @@ struct LoopVectorizePass : public PassInfoMixin<LoopVectorizePass> {
                OptimizationRemarkEmitter &ORE);
 
   bool processLoop(Loop *L);
+
+  /// Vectorize the outer loop \p L as a whole, its inner loop running in
+  /// lockstep for all the lanes.
+  bool processOuterLoop(Loop *L);
 };
 }
 
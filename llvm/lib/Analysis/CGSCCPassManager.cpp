@@ -11,6 +11,13 @@
 
 using namespace llvm;
 
+unsigned llvm::getIRUnitInstructionCount(const LazyCallGraph::SCC &C) {
+  unsigned Count = 0;
+  for (LazyCallGraph::Node &N : C)
+    Count += getIRUnitInstructionCount(N.getFunction());
+  return Count;
+}
+
 // Explicit instantiations for the core proxy templates.
 namespace llvm {
 template class PassManager<LazyCallGraph::SCC>;
@@ -17,6 +17,16 @@
 
 using namespace llvm;
 
+unsigned llvm::getIRUnitInstructionCount(const Loop &L) {
+  // The blocks of a removed loop may have been deleted.
+  if (L.isInvalid())
+    return 0;
+  unsigned Count = 0;
+  for (const BasicBlock *BB : L.blocks())
+    Count += BB->size();
+  return Count;
+}
+
 // Explicit instantiations for core typedef'ed templates.
 namespace llvm {
 template class PassManager<Loop>;
@@ -95,7 +95,16 @@ static void skipAbbreviatedField(BitstreamCursor &Cursor,
   }
 }
 
-
+/// Return whether \p NumElts elements of at least \p MinBits bits each can
+/// follow the current position, so that it is safe to reserve room for them.
+static bool canHoldElements(const BitstreamCursor &Cursor, uint64_t NumElts,
+                            unsigned MinBits) {
+  const BitstreamReader *R = Cursor.getBitStreamReader();
+  if (!R->getMappedBytes())
+    return false;
+  uint64_t BitsLeft = R->getMappedSize() * CHAR_BIT - Cursor.GetCurrentBitNo();
+  return NumElts <= BitsLeft / MinBits;
+}
 
 /// skipRecord - Read the current record and discard it.
 void BitstreamCursor::skipRecord(unsigned AbbrevID) {
@@ -179,12 +188,15 @@ unsigned BitstreamCursor::readRecord(unsigned AbbrevID,
   if (AbbrevID == bitc::UNABBREV_RECORD) {
     unsigned Code = ReadVBR(6);
     unsigned NumElts = ReadVBR(6);
+    if (canHoldElements(*this, NumElts, 6))
+      Vals.reserve(Vals.size() + NumElts);
     for (unsigned i = 0; i != NumElts; ++i)
       Vals.push_back(ReadVBR64(6));
     return Code;
   }
 
   const BitCodeAbbrev *Abbv = getAbbrev(AbbrevID);
+  Vals.reserve(Vals.size() + Abbv->getNumOperandInfos());
 
   // Read the record code first.
   assert(Abbv->getNumOperandInfos() != 0 && "no record code in abbreviation?");
@@ -223,6 +235,8 @@ unsigned BitstreamCursor::readRecord(unsigned AbbrevID,
       if (!EltEnc.isEncoding())
         report_fatal_error(
             "Array element type has to be an encoding of a type");
+      if (canHoldElements(*this, NumElts, 1))
+        Vals.reserve(Vals.size() + NumElts);
 
       // Read all the elements.
       switch (EltEnc.getEncoding()) {
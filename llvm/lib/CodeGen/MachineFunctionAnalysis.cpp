@@ -22,7 +22,8 @@ char MachineFunctionAnalysis::ID = 0;
 
 MachineFunctionAnalysis::MachineFunctionAnalysis(
     const TargetMachine &tm, MachineFunctionInitializer *MFInitializer)
-    : FunctionPass(ID), TM(tm), MF(nullptr), MFInitializer(MFInitializer) {
+    : FunctionPass(ID), TM(tm), MMI(nullptr), MF(nullptr),
+      MFInitializer(MFInitializer) {
   initializeMachineModuleInfoPass(*PassRegistry::getPassRegistry());
 }
 
@@ -47,8 +48,10 @@ bool MachineFunctionAnalysis::doInitialization(Module &M) {
 
 bool MachineFunctionAnalysis::runOnFunction(Function &F) {
   assert(!MF && "MachineFunctionAnalysis already initialized!");
-  MF = new MachineFunction(&F, TM, NextFnNum++,
-                           getAnalysis<MachineModuleInfo>());
+  MMI = &getAnalysis<MachineModuleInfo>();
+  if ((MF = MMI->takeRetainedMachineFunction(F)))
+    return false;
+  MF = new MachineFunction(&F, TM, NextFnNum++, *MMI);
   if (MFInitializer) {
     if (MFInitializer->initializeMachineFunction(*MF))
       report_fatal_error("Unable to initialize machine function");
@@ -57,6 +60,9 @@ bool MachineFunctionAnalysis::runOnFunction(Function &F) {
 }
 
 void MachineFunctionAnalysis::releaseMemory() {
-  delete MF;
+  if (MF && MMI->retainsMachineFunctions())
+    MMI->retainMachineFunction(MF);
+  else
+    delete MF;
   MF = nullptr;
 }
@@ -189,7 +189,8 @@ void MMIAddrLabelMapCallbackPtr::allUsesReplacedWith(Value *V2) {
 MachineModuleInfo::MachineModuleInfo(const MCAsmInfo &MAI,
                                      const MCRegisterInfo &MRI,
                                      const MCObjectFileInfo *MOFI)
-  : ImmutablePass(ID), Context(&MAI, &MRI, MOFI, nullptr, false) {
+  : ImmutablePass(ID), Context(&MAI, &MRI, MOFI, nullptr, false),
+    RetainMachineFunctions(false) {
   initializeMachineModuleInfoPass(*PassRegistry::getPassRegistry());
 }
 
@@ -222,6 +223,10 @@ bool MachineModuleInfo::doFinalization(Module &M) {
 
   Personalities.clear();
 
+  for (auto &Entry : RetainedFunctions)
+    delete Entry.second.MF;
+  RetainedFunctions.clear();
+
   delete AddrLabelSymbols;
   AddrLabelSymbols = nullptr;
 
@@ -252,6 +257,51 @@ void MachineModuleInfo::EndFunction() {
   VariableDbgInfos.clear();
 }
 
+void MachineModuleInfo::swapFunctionInfo(RetainedFunction &RF) {
+  std::swap(FrameInstructions, RF.FrameInstructions);
+  std::swap(LandingPads, RF.LandingPads);
+  std::swap(LPadToCallSiteMap, RF.LPadToCallSiteMap);
+  std::swap(CallSiteMap, RF.CallSiteMap);
+  std::swap(CurCallSite, RF.CurCallSite);
+  std::swap(TypeInfos, RF.TypeInfos);
+  std::swap(FilterIds, RF.FilterIds);
+  std::swap(FilterEnds, RF.FilterEnds);
+  std::swap(CallsEHReturn, RF.CallsEHReturn);
+  std::swap(CallsUnwindInit, RF.CallsUnwindInit);
+  std::swap(HasEHFunclets, RF.HasEHFunclets);
+  std::swap(PersonalityTypeCache, RF.PersonalityTypeCache);
+  std::swap(VariableDbgInfos, RF.VariableDbgInfos);
+}
+
+void MachineModuleInfo::retainMachineFunction(MachineFunction *MF) {
+  const Function *F = MF->getFunction();
+  assert(!RetainedFunctions.count(F) && "Machine function already retained!");
+  RetainedFunction &RF = RetainedFunctions[F];
+  RF.MF = MF;
+  RF.CurCallSite = 0;
+  RF.CallsEHReturn = RF.CallsUnwindInit = RF.HasEHFunclets = false;
+  RF.PersonalityTypeCache = EHPersonality::Unknown;
+  // The current function is left with the empty information of RF.
+  swapFunctionInfo(RF);
+}
+
+MachineFunction *
+MachineModuleInfo::getRetainedMachineFunction(const Function &F) const {
+  auto I = RetainedFunctions.find(&F);
+  return I == RetainedFunctions.end() ? nullptr : I->second.MF;
+}
+
+MachineFunction *
+MachineModuleInfo::takeRetainedMachineFunction(const Function &F) {
+  auto I = RetainedFunctions.find(&F);
+  if (I == RetainedFunctions.end())
+    return nullptr;
+  MachineFunction *MF = I->second.MF;
+  swapFunctionInfo(I->second);
+  RetainedFunctions.erase(I);
+  return MF;
+}
+
 //===- Address of Block Management ----------------------------------------===//
 
 /// getAddrLabelSymbolToEmit - Return the symbol to be used for the specified
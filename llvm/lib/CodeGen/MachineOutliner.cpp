@@ -0,0 +1,679 @@
+//===---- MachineOutliner.cpp - Outline instructions -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Replaces repeated sequences of machine instructions with calls to
+/// functions containing a single copy of the sequence.
+///
+/// The instructions of every basic block in the module are mapped to
+/// integers, so that identical instructions get the same integer, and a
+/// suffix tree is built for the resulting string. Every internal node of the
+/// tree represents a substring repeated at least twice: the sequences which
+/// the target says are worth outlining are moved into new functions named
+/// OUTLINED_FUNCTION_N, and their occurrences are replaced by calls.
+///
+/// A sequence ending in a return is reached through a tail call and includes
+/// that return, other sequences are reached through a call and get a return
+/// added by the target.
+///
+/// The outliner works on the machine functions of the whole module. It makes
+/// the MachineModuleInfo retain the machine functions built by the
+/// MachineFunctionAnalysis running before it, and another
+/// MachineFunctionAnalysis scheduled after it picks them up again for the
+/// remaining passes. Outlining happens after register allocation and block
+/// placement, so only physical registers are involved.
+///
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/CodeGen/MachineFrameInfo.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetInstrInfo.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetRegisterInfo.h"
+#include "llvm/Target/TargetSubtargetInfo.h"
+#include <algorithm>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "machine-outliner"
+
+STATISTIC(NumOutlined, "Number of candidates outlined");
+STATISTIC(FunctionsCreated, "Number of functions created");
+
+namespace {
+
+const unsigned EmptyIdx = ~0U;
+
+/// A node in a suffix tree.
+///
+/// The edge leading into the node is labelled by the substring
+/// [StartIdx, *EndIdx] of the string the tree was built for. Leaves share
+/// their end index, which is what makes Ukkonen's algorithm linear.
+struct SuffixTreeNode {
+  /// The children of this node, keyed by the first integer of their edge.
+  DenseMap<unsigned, SuffixTreeNode *> Children;
+
+  /// Start index of the edge leading into this node.
+  unsigned StartIdx;
+
+  /// End index (inclusive) of the edge leading into this node.
+  unsigned *EndIdx;
+
+  /// For leaves, the start index of the suffix spelled by the path from the
+  /// root to the leaf.
+  unsigned SuffixIdx = EmptyIdx;
+
+  /// For internal nodes, the node spelling the same string minus its first
+  /// integer, or the root.
+  SuffixTreeNode *Link;
+
+  /// Length of the string spelled by the path from the root to this node.
+  unsigned ConcatLen = 0;
+
+  bool IsLeaf;
+
+  SuffixTreeNode(unsigned StartIdx, unsigned *EndIdx, SuffixTreeNode *Link,
+                 bool IsLeaf)
+      : StartIdx(StartIdx), EndIdx(EndIdx), Link(Link), IsLeaf(IsLeaf) {}
+
+  bool isRoot() const { return StartIdx == EmptyIdx; }
+
+  /// Length of the edge leading into this node.
+  unsigned size() const {
+    if (isRoot())
+      return 0;
+    return *EndIdx - StartIdx + 1;
+  }
+};
+
+/// A suffix tree, built with Ukkonen's algorithm.
+///
+/// The last integer of the string must be unique, so that every suffix ends
+/// in a leaf.
+class SuffixTree {
+  ArrayRef<unsigned> Str;
+
+  SpecificBumpPtrAllocator<SuffixTreeNode> NodeAllocator;
+  BumpPtrAllocator InternalEndIdxAllocator;
+
+  /// The end index shared by every leaf.
+  unsigned LeafEndIdx = EmptyIdx;
+
+  /// The point where the next suffix is inserted: Len integers down the edge
+  /// of Node starting with Str[Idx].
+  struct {
+    SuffixTreeNode *Node;
+    unsigned Idx = EmptyIdx;
+    unsigned Len = 0;
+  } Active;
+
+  SuffixTreeNode *insertLeaf(SuffixTreeNode &Parent, unsigned StartIdx,
+                             unsigned Edge) {
+    SuffixTreeNode *N = new (NodeAllocator.Allocate())
+        SuffixTreeNode(StartIdx, &LeafEndIdx, nullptr, /*IsLeaf=*/true);
+    Parent.Children[Edge] = N;
+    return N;
+  }
+
+  SuffixTreeNode *insertInternalNode(SuffixTreeNode *Parent, unsigned StartIdx,
+                                     unsigned EndIdx, unsigned Edge) {
+    unsigned *E = new (InternalEndIdxAllocator) unsigned(EndIdx);
+    SuffixTreeNode *N = new (NodeAllocator.Allocate())
+        SuffixTreeNode(StartIdx, E, Root, /*IsLeaf=*/false);
+    if (Parent)
+      Parent->Children[Edge] = N;
+    return N;
+  }
+
+  /// Add the suffixes of Str[0, EndIdx] which are not yet in the tree, and
+  /// return how many of them are still pending.
+  unsigned extend(unsigned EndIdx, unsigned SuffixesToAdd) {
+    SuffixTreeNode *NeedsLink = nullptr;
+
+    while (SuffixesToAdd > 0) {
+      if (Active.Len == 0)
+        Active.Idx = EndIdx;
+
+      unsigned FirstChar = Str[Active.Idx];
+      auto It = Active.Node->Children.find(FirstChar);
+
+      if (It == Active.Node->Children.end()) {
+        insertLeaf(*Active.Node, EndIdx, FirstChar);
+        if (NeedsLink) {
+          NeedsLink->Link = Active.Node;
+          NeedsLink = nullptr;
+        }
+      } else {
+        SuffixTreeNode *NextNode = It->second;
+        unsigned SubstringLen = NextNode->size();
+
+        // Walk down the edge if the active point is past its end.
+        if (Active.Len >= SubstringLen) {
+          Active.Idx += SubstringLen;
+          Active.Len -= SubstringLen;
+          Active.Node = NextNode;
+          continue;
+        }
+
+        unsigned LastChar = Str[EndIdx];
+
+        // The suffix is already in the tree, and so are the shorter ones.
+        if (Str[NextNode->StartIdx + Active.Len] == LastChar) {
+          if (NeedsLink && !Active.Node->isRoot()) {
+            NeedsLink->Link = Active.Node;
+            NeedsLink = nullptr;
+          }
+          Active.Len++;
+          break;
+        }
+
+        // Split the edge at the active point and hang a new leaf there.
+        SuffixTreeNode *SplitNode =
+            insertInternalNode(Active.Node, NextNode->StartIdx,
+                               NextNode->StartIdx + Active.Len - 1, FirstChar);
+        insertLeaf(*SplitNode, EndIdx, LastChar);
+        NextNode->StartIdx += Active.Len;
+        SplitNode->Children[Str[NextNode->StartIdx]] = NextNode;
+
+        if (NeedsLink)
+          NeedsLink->Link = SplitNode;
+        NeedsLink = SplitNode;
+      }
+
+      SuffixesToAdd--;
+
+      if (Active.Node->isRoot()) {
+        if (Active.Len > 0) {
+          Active.Len--;
+          Active.Idx = EndIdx - SuffixesToAdd + 1;
+        }
+      } else {
+        Active.Node = Active.Node->Link;
+      }
+    }
+
+    return SuffixesToAdd;
+  }
+
+  /// Compute the string length of every node and the suffix index of every
+  /// leaf.
+  void setSuffixIndices() {
+    SmallVector<std::pair<SuffixTreeNode *, unsigned>, 32> Worklist;
+    Worklist.push_back({Root, 0});
+    while (!Worklist.empty()) {
+      SuffixTreeNode *N;
+      unsigned ParentLen;
+      std::tie(N, ParentLen) = Worklist.pop_back_val();
+      N->ConcatLen = ParentLen + N->size();
+      if (N->IsLeaf)
+        N->SuffixIdx = Str.size() - N->ConcatLen;
+      for (auto &Child : N->Children)
+        Worklist.push_back({Child.second, N->ConcatLen});
+    }
+  }
+
+public:
+  SuffixTreeNode *Root = nullptr;
+
+  SuffixTree(ArrayRef<unsigned> Str) : Str(Str) {
+    Root = insertInternalNode(nullptr, EmptyIdx, EmptyIdx, 0);
+    Active.Node = Root;
+
+    unsigned SuffixesToAdd = 0;
+    for (unsigned PfxEndIdx = 0, End = Str.size(); PfxEndIdx < End;
+         PfxEndIdx++) {
+      SuffixesToAdd++;
+      LeafEndIdx = PfxEndIdx;
+      SuffixesToAdd = extend(PfxEndIdx, SuffixesToAdd);
+    }
+
+    setSuffixIndices();
+  }
+};
+
+/// Maps the instructions of the module to integers.
+///
+/// Identical instructions of the same subtarget map to the same integer.
+/// Instructions which cannot be outlined, and the ends of the basic blocks,
+/// each map to an integer of their own, so that no repeated sequence crosses
+/// them.
+struct InstructionMapper {
+  /// The next integer for a legal instruction, counting up.
+  unsigned LegalInstrNumber = 0;
+
+  /// The next integer for an illegal instruction, counting down. The last
+  /// two integers are the empty and tombstone keys of DenseMap<unsigned>.
+  unsigned IllegalInstrNumber = -3;
+
+  typedef DenseMap<MachineInstr *, unsigned, MachineInstrExpressionTrait>
+      InstrMapTy;
+  DenseMap<const TargetSubtargetInfo *, InstrMapTy> InstructionIntegerMaps;
+
+  /// The string the suffix tree is built for.
+  std::vector<unsigned> UnsignedVec;
+
+  /// The instruction each integer of UnsignedVec was mapped from.
+  std::vector<MachineBasicBlock::iterator> InstrList;
+
+  void mapToLegalUnsigned(MachineBasicBlock::iterator It, InstrMapTy &Map) {
+    auto Inserted = Map.insert({&*It, LegalInstrNumber});
+    if (Inserted.second) {
+      LegalInstrNumber++;
+      assert(LegalInstrNumber < IllegalInstrNumber &&
+             "Instruction mapping overflow!");
+    }
+    UnsignedVec.push_back(Inserted.first->second);
+    InstrList.push_back(It);
+  }
+
+  void mapToIllegalUnsigned(MachineBasicBlock::iterator It) {
+    UnsignedVec.push_back(IllegalInstrNumber--);
+    InstrList.push_back(It);
+    assert(LegalInstrNumber < IllegalInstrNumber &&
+           "Instruction mapping overflow!");
+  }
+
+  static TargetInstrInfo::MachineOutlinerInstrType
+  getOutliningType(const MachineInstr &MI, const TargetInstrInfo &TII) {
+    if (MI.isDebugValue())
+      return TargetInstrInfo::Invisible;
+
+    // Labels, CFI and inline assembly are tied to their place in the
+    // function, and bundles are not worth the trouble.
+    if (MI.isPosition() || MI.isInlineAsm() || MI.isBundle())
+      return TargetInstrInfo::Illegal;
+
+    // Branches would leave the outlined function.
+    if (MI.isTerminator() && !MI.isReturn())
+      return TargetInstrInfo::Illegal;
+
+    // Operands referring to the function itself don't mean the same thing
+    // from another function.
+    for (const MachineOperand &MO : MI.operands())
+      if (MO.isMBB() || MO.isFI() || MO.isCPI() || MO.isJTI() ||
+          MO.isTargetIndex() || MO.isBlockAddress() || MO.isCFIIndex() ||
+          MO.isMetadata() || MO.isMCSymbol())
+        return TargetInstrInfo::Illegal;
+
+    return TII.getOutliningType(MI);
+  }
+
+  void convertToUnsignedVec(MachineBasicBlock &MBB,
+                            const TargetInstrInfo &TII) {
+    InstrMapTy &Map = InstructionIntegerMaps[&MBB.getParent()->getSubtarget()];
+
+    for (MachineBasicBlock::iterator It = MBB.begin(), Et = MBB.end();
+         It != Et; ++It) {
+      switch (getOutliningType(*It, TII)) {
+      case TargetInstrInfo::Illegal:
+        mapToIllegalUnsigned(It);
+        break;
+      case TargetInstrInfo::Legal:
+        mapToLegalUnsigned(It, Map);
+        break;
+      case TargetInstrInfo::Invisible:
+        break;
+      }
+    }
+
+    // Repeated sequences don't span basic blocks.
+    mapToIllegalUnsigned(MBB.end());
+  }
+};
+
+/// A repeated sequence of instructions and the places it occurs at.
+struct OutlinedFunction {
+  /// Indices in the mapped string of the occurrences of the sequence.
+  std::vector<unsigned> Occurrences;
+
+  /// Number of mapped instructions in the sequence.
+  unsigned Length;
+
+  /// True if the sequence ends in a return, and is reached through a tail
+  /// call.
+  bool IsTailCall;
+
+  /// The number of instructions saved by outlining the sequence.
+  int Benefit;
+
+  /// The machine function created for the sequence.
+  MachineFunction *MF = nullptr;
+};
+
+class MachineOutliner : public ModulePass {
+  void findCandidates(SuffixTree &ST, InstructionMapper &Mapper,
+                      std::vector<OutlinedFunction> &Candidates);
+  void pruneOverlaps(InstructionMapper &Mapper,
+                     std::vector<OutlinedFunction> &Candidates);
+  MachineFunction *createOutlinedFunction(Module &M, OutlinedFunction &OF,
+                                          InstructionMapper &Mapper,
+                                          MachineModuleInfo &MMI,
+                                          const TargetMachine &TM,
+                                          unsigned FunctionNum,
+                                          unsigned Name);
+  void replaceOccurrences(OutlinedFunction &OF, InstructionMapper &Mapper);
+
+public:
+  static char ID;
+
+  MachineOutliner() : ModulePass(ID) {
+    initializeMachineOutlinerPass(*PassRegistry::getPassRegistry());
+  }
+
+  const char *getPassName() const override { return "Machine Outliner"; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<MachineModuleInfo>();
+    AU.addRequired<TargetPassConfig>();
+    AU.setPreservesAll();
+    ModulePass::getAnalysisUsage(AU);
+  }
+
+  bool doInitialization(Module &M) override;
+  bool runOnModule(Module &M) override;
+};
+
+} // end anonymous namespace
+
+char MachineOutliner::ID = 0;
+
+ModulePass *llvm::createMachineOutlinerPass() { return new MachineOutliner(); }
+
+INITIALIZE_PASS_BEGIN(MachineOutliner, "machine-outliner",
+                      "Machine Function Outliner", false, false)
+INITIALIZE_PASS_DEPENDENCY(MachineModuleInfo)
+INITIALIZE_PASS_DEPENDENCY(TargetPassConfig)
+INITIALIZE_PASS_END(MachineOutliner, "machine-outliner",
+                    "Machine Function Outliner", false, false)
+
+static const TargetInstrInfo &getInstrInfo(const MachineInstr &MI) {
+  return *MI.getParent()->getParent()->getSubtarget().getInstrInfo();
+}
+
+void MachineOutliner::findCandidates(
+    SuffixTree &ST, InstructionMapper &Mapper,
+    std::vector<OutlinedFunction> &Candidates) {
+  SmallVector<SuffixTreeNode *, 32> Worklist;
+  Worklist.push_back(ST.Root);
+
+  while (!Worklist.empty()) {
+    SuffixTreeNode *N = Worklist.pop_back_val();
+
+    OutlinedFunction OF;
+    for (auto &Child : N->Children) {
+      if (Child.second->IsLeaf)
+        OF.Occurrences.push_back(Child.second->SuffixIdx);
+      else
+        Worklist.push_back(Child.second);
+    }
+
+    // Every leaf child of an internal node is an occurrence of the string
+    // the node spells.
+    if (N->isRoot() || N->ConcatLen < 2 || OF.Occurrences.size() < 2)
+      continue;
+
+    OF.Length = N->ConcatLen;
+    const MachineInstr &LastMI =
+        *Mapper.InstrList[OF.Occurrences.front() + OF.Length - 1];
+    OF.IsTailCall = LastMI.isReturn();
+    OF.Benefit = getInstrInfo(LastMI).getOutliningBenefit(
+        OF.Length, OF.Occurrences.size(), OF.IsTailCall);
+    if (OF.Benefit < 1)
+      continue;
+
+    Candidates.push_back(std::move(OF));
+  }
+}
+
+void MachineOutliner::pruneOverlaps(
+    InstructionMapper &Mapper, std::vector<OutlinedFunction> &Candidates) {
+  // Outline the most profitable sequences first, and drop the occurrences of
+  // the others which overlap the ones already taken.
+  std::stable_sort(Candidates.begin(), Candidates.end(),
+                   [](const OutlinedFunction &LHS, const OutlinedFunction &RHS) {
+                     if (LHS.Benefit != RHS.Benefit)
+                       return LHS.Benefit > RHS.Benefit;
+                     return LHS.Length > RHS.Length;
+                   });
+
+  BitVector Taken(Mapper.UnsignedVec.size());
+  auto Keep = Candidates.begin();
+  for (OutlinedFunction &OF : Candidates) {
+    std::sort(OF.Occurrences.begin(), OF.Occurrences.end());
+
+    std::vector<unsigned> Occurrences;
+    unsigned LastEnd = 0;
+    for (unsigned StartIdx : OF.Occurrences) {
+      unsigned EndIdx = StartIdx + OF.Length;
+      // A sequence may overlap itself, as in the occurrences of "aa" in
+      // "aaa".
+      if (StartIdx < LastEnd)
+        continue;
+      int FirstTaken = StartIdx == 0 ? Taken.find_first()
+                                     : Taken.find_next(StartIdx - 1);
+      if (FirstTaken != -1 && (unsigned)FirstTaken < EndIdx)
+        continue;
+      Occurrences.push_back(StartIdx);
+      LastEnd = EndIdx;
+    }
+
+    if (Occurrences.size() < 2)
+      continue;
+
+    const MachineInstr &FirstMI = *Mapper.InstrList[Occurrences.front()];
+    OF.Benefit = getInstrInfo(FirstMI).getOutliningBenefit(
+        OF.Length, Occurrences.size(), OF.IsTailCall);
+    if (OF.Benefit < 1)
+      continue;
+
+    for (unsigned StartIdx : Occurrences)
+      Taken.set(StartIdx, StartIdx + OF.Length);
+    OF.Occurrences = std::move(Occurrences);
+    if (&*Keep != &OF)
+      *Keep = std::move(OF);
+    ++Keep;
+  }
+  Candidates.erase(Keep, Candidates.end());
+}
+
+/// Collect the registers \p Begin to \p End read before writing them, and
+/// the registers they write.
+static void collectRegisters(MachineBasicBlock::iterator Begin,
+                             MachineBasicBlock::iterator End,
+                             const TargetRegisterInfo &TRI,
+                             SmallSetVector<unsigned, 8> &Uses,
+                             SmallSetVector<unsigned, 8> &Defs) {
+  for (MachineInstr &MI : make_range(Begin, End)) {
+    if (MI.isDebugValue())
+      continue;
+    for (const MachineOperand &MO : MI.operands()) {
+      if (!MO.isReg() || !MO.getReg() || !MO.readsReg())
+        continue;
+      unsigned Reg = MO.getReg();
+      if (std::none_of(Defs.begin(), Defs.end(), [&](unsigned Def) {
+            return TRI.isSubRegisterEq(Def, Reg);
+          }))
+        Uses.insert(Reg);
+    }
+    for (const MachineOperand &MO : MI.operands())
+      if (MO.isReg() && MO.getReg() && MO.isDef())
+        Defs.insert(MO.getReg());
+  }
+}
+
+MachineFunction *MachineOutliner::createOutlinedFunction(
+    Module &M, OutlinedFunction &OF, InstructionMapper &Mapper,
+    MachineModuleInfo &MMI, const TargetMachine &TM, unsigned FunctionNum,
+    unsigned Name) {
+  MachineBasicBlock::iterator Begin = Mapper.InstrList[OF.Occurrences.front()];
+  MachineBasicBlock::iterator End =
+      std::next(Mapper.InstrList[OF.Occurrences.front() + OF.Length - 1]);
+  const Function &OrigF = *Begin->getParent()->getParent()->getFunction();
+
+  // The IR function is only there for the rest of the code generator to visit
+  // the machine function.
+  LLVMContext &Ctx = M.getContext();
+  Function *F = Function::Create(
+      FunctionType::get(Type::getVoidTy(Ctx), false),
+      GlobalValue::InternalLinkage, "OUTLINED_FUNCTION_" + Twine(Name), &M);
+  F->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+  F->addFnAttr(Attribute::OptimizeForSize);
+  F->addFnAttr(Attribute::MinSize);
+  F->addFnAttr(Attribute::NoUnwind);
+  // The outlined function must get the subtarget of the code it came from.
+  for (StringRef Kind : {"target-cpu", "target-features"})
+    if (OrigF.hasFnAttribute(Kind))
+      F->addAttribute(AttributeSet::FunctionIndex, OrigF.getFnAttribute(Kind));
+  BasicBlock *EntryBB = BasicBlock::Create(Ctx, "entry", F);
+  ReturnInst::Create(Ctx, EntryBB);
+
+  MachineFunction *MF = new MachineFunction(F, TM, FunctionNum, MMI);
+  MachineBasicBlock *MBB = MF->CreateMachineBasicBlock();
+  MF->push_back(MBB);
+  const TargetInstrInfo &TII = *MF->getSubtarget().getInstrInfo();
+
+  for (MachineInstr &MI : make_range(Begin, End)) {
+    if (MI.isDebugValue())
+      continue;
+    MachineInstr *NewMI = MF->CloneMachineInstr(&MI);
+    // The memory operands and locations describe only one of the
+    // occurrences.
+    NewMI->dropMemRefs();
+    NewMI->setDebugLoc(DebugLoc());
+    MBB->insert(MBB->end(), NewMI);
+  }
+
+  TII.insertOutlinerPrologue(*MBB, *MF, OF.IsTailCall);
+  TII.insertOutlinerEpilogue(*MBB, *MF, OF.IsTailCall);
+
+  MachineRegisterInfo &MRI = MF->getRegInfo();
+  MRI.freezeReservedRegs(*MF);
+  MRI.leaveSSA();
+  MRI.invalidateLiveness();
+  MF->getProperties().set(
+      MachineFunctionProperties::Property::AllVRegsAllocated);
+
+  DEBUG(dbgs() << "Outlined " << OF.Occurrences.size()
+               << " occurrences into:\n";
+        MF->print(dbgs()));
+
+  MMI.retainMachineFunction(MF);
+  FunctionsCreated++;
+  return MF;
+}
+
+void MachineOutliner::replaceOccurrences(OutlinedFunction &OF,
+                                         InstructionMapper &Mapper) {
+  for (unsigned StartIdx : OF.Occurrences) {
+    MachineBasicBlock::iterator Begin = Mapper.InstrList[StartIdx];
+    MachineBasicBlock::iterator End =
+        std::next(Mapper.InstrList[StartIdx + OF.Length - 1]);
+    MachineBasicBlock &MBB = *Begin->getParent();
+    MachineFunction &CallerMF = *MBB.getParent();
+    const TargetInstrInfo &TII = *CallerMF.getSubtarget().getInstrInfo();
+    const TargetRegisterInfo &TRI = *CallerMF.getSubtarget().getRegisterInfo();
+
+    SmallSetVector<unsigned, 8> Uses, Defs;
+    collectRegisters(Begin, End, TRI, Uses, Defs);
+
+    MachineBasicBlock::iterator Call =
+        TII.insertOutlinedCall(MBB, Begin, *OF.MF, OF.IsTailCall);
+    Call->setDebugLoc(Begin->getDebugLoc());
+
+    // Keep the registers flowing through the sequence visible to the passes
+    // running after the outliner.
+    MachineInstrBuilder MIB(CallerMF, &*Call);
+    for (unsigned Reg : Uses)
+      MIB.addReg(Reg, RegState::Implicit);
+    if (!OF.IsTailCall)
+      for (unsigned Reg : Defs)
+        MIB.addReg(Reg, RegState::Implicit | RegState::Define);
+
+    // The debug values stay where the sequence was.
+    for (MachineBasicBlock::iterator It = Begin; It != End;) {
+      MachineInstr &MI = *It++;
+      if (!MI.isDebugValue())
+        MI.eraseFromParent();
+    }
+
+    NumOutlined++;
+  }
+}
+
+bool MachineOutliner::doInitialization(Module &M) {
+  // Keep the machine functions around until the whole module is compiled to
+  // this point.
+  MachineModuleInfo *MMI = getAnalysisIfAvailable<MachineModuleInfo>();
+  assert(MMI && "MMI not around yet??");
+  MMI->setRetainMachineFunctions(true);
+  return false;
+}
+
+bool MachineOutliner::runOnModule(Module &M) {
+  MachineModuleInfo &MMI = getAnalysis<MachineModuleInfo>();
+  // The machine functions are picked up again by the passes after this one.
+  MMI.setRetainMachineFunctions(false);
+
+  if (skipModule(M))
+    return false;
+
+  const TargetMachine &TM =
+      getAnalysis<TargetPassConfig>().getTM<TargetMachine>();
+
+  InstructionMapper Mapper;
+  unsigned NextFunctionNum = 0;
+  for (Function &F : M) {
+    MachineFunction *MF = MMI.getRetainedMachineFunction(F);
+    if (!MF)
+      continue;
+    NextFunctionNum = std::max(NextFunctionNum, MF->getFunctionNumber() + 1);
+
+    if (F.hasFnAttribute(Attribute::OptimizeNone))
+      continue;
+    const TargetInstrInfo *TII = MF->getSubtarget().getInstrInfo();
+    if (!TII->isFunctionSafeToOutlineFrom(*MF))
+      continue;
+
+    for (MachineBasicBlock &MBB : *MF)
+      if (!MBB.empty())
+        Mapper.convertToUnsignedVec(MBB, *TII);
+  }
+
+  if (Mapper.UnsignedVec.empty())
+    return false;
+
+  SuffixTree ST(Mapper.UnsignedVec);
+  std::vector<OutlinedFunction> Candidates;
+  findCandidates(ST, Mapper, Candidates);
+  pruneOverlaps(Mapper, Candidates);
+
+  unsigned Name = 0;
+  for (OutlinedFunction &OF : Candidates) {
+    OF.MF = createOutlinedFunction(M, OF, Mapper, MMI, TM, NextFunctionNum++,
+                                   Name++);
+    replaceOccurrences(OF, Mapper);
+  }
+
+  return !Candidates.empty();
+}
@@ -21,6 +21,7 @@
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/ScopedNoAliasAA.h"
 #include "llvm/Analysis/TypeBasedAliasAnalysis.h"
+#include "llvm/CodeGen/MachineFunctionAnalysis.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/RegAllocRegistry.h"
 #include "llvm/CodeGen/RegisterUsageInfo.h"
@@ -82,6 +83,9 @@ static cl::opt<bool> EnableImplicitNullChecks(
     "enable-implicit-null-checks",
     cl::desc("Fold null checks into faulting memory operations"),
     cl::init(false));
+static cl::opt<bool> EnableMachineOutliner("enable-machine-outliner",
+    cl::Hidden, cl::desc("Outline repeated machine instruction sequences"),
+    cl::init(false));
 static cl::opt<bool> PrintLSR("print-lsr-output", cl::Hidden,
     cl::desc("Print LLVM IR produced by the loop-reduce pass"));
 static cl::opt<bool> PrintISelInput("print-isel-input", cl::Hidden,
@@ -650,6 +654,14 @@ void TargetPassConfig::addMachinePasses() {
     // clobbered registers, to be used to optimize call sites.
     addPass(createRegUsageInfoCollector());
 
+  // The outliner works on the whole module: the machine functions built so
+  // far are retained until it runs, and the MachineFunctionAnalysis added
+  // after it hands them to the remaining passes.
+  if (EnableMachineOutliner) {
+    addPass(createMachineOutlinerPass(), false, false);
+    addPass(new MachineFunctionAnalysis(*TM, nullptr), false, false);
+  }
+
   addPass(&FuncletLayoutID, false);
 
   addPass(&StackMapLivenessID, false);
@@ -590,6 +590,10 @@ private:
 public:
   typename MapTy::iterator begin() { return Map.begin(); }
   typename MapTy::iterator end() { return Map.end(); }
+  typename MapTy::const_iterator begin() const { return Map.begin(); }
+  typename MapTy::const_iterator end() const { return Map.end(); }
+  size_t size() const { return Map.size(); }
+  size_t getMemorySize() const { return Map.getMemorySize(); }
 
   void freeConstants() {
     for (auto &I : Map)
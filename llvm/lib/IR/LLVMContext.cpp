@@ -351,3 +351,15 @@ void LLVMContext::setDiscardValueNames(bool Discard) {
 OptBisect &LLVMContext::getOptBisect() {
   return pImpl->getOptBisect();
 }
+
+void LLVMContext::printUniquingTableStats(raw_ostream &OS) const {
+  pImpl->printUniquingTableStats(OS);
+}
+
+unsigned LLVMContext::dropTriviallyDeadConstants() {
+  return pImpl->dropTriviallyDeadConstants();
+}
+
+unsigned LLVMContext::dropUnusedDebugLocations() {
+  return pImpl->dropUnusedDebugLocations();
+}
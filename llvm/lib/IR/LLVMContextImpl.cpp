@@ -12,12 +12,15 @@
 //===----------------------------------------------------------------------===//
 
 #include "LLVMContextImpl.h"
+#include "AttributeSetNode.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/OptBisect.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 using namespace llvm;
 
@@ -162,6 +165,315 @@ void Module::dropTriviallyDeadConstantArrays() {
   Context.pImpl->dropTriviallyDeadConstantArrays();
 }
 
+unsigned LLVMContextImpl::dropTriviallyDeadConstants() {
+  unsigned NumDropped = 0;
+  SmallVector<Constant *, 32> Dead;
+  // Destroying a constant can make its operands dead, so repeat until no dead
+  // constants are left. The dead constants are collected first, since
+  // destroying them changes the tables. A constant metadata still refers to is
+  // kept, as destroying it would leave the metadata dangling.
+  auto IsDead = [](Constant *C) {
+    return C->use_empty() && !C->isUsedByMetadata();
+  };
+  do {
+    Dead.clear();
+    for (ConstantArray *C : ArrayConstants)
+      if (IsDead(C))
+        Dead.push_back(C);
+    for (ConstantStruct *C : StructConstants)
+      if (IsDead(C))
+        Dead.push_back(C);
+    for (ConstantVector *C : VectorConstants)
+      if (IsDead(C))
+        Dead.push_back(C);
+    for (ConstantExpr *C : ExprConstants)
+      if (IsDead(C))
+        Dead.push_back(C);
+    for (auto &Entry : CDSConstants)
+      for (ConstantDataSequential *C = Entry.second; C; C = C->Next)
+        if (IsDead(C))
+          Dead.push_back(C);
+
+    for (Constant *C : Dead)
+      C->destroyConstant();
+    NumDropped += Dead.size();
+  } while (!Dead.empty());
+  return NumDropped;
+}
+
+unsigned LLVMContextImpl::dropUnusedDebugLocations() {
+  // A materializer may refer to metadata it has not attached yet.
+  for (Module *M : OwnedModules)
+    if (M->getMaterializer())
+      return 0;
+
+  DenseSet<const DILocation *> Live;
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+  auto MarkLive = [&](const Metadata *MD) {
+    // A location keeps the locations it is inlined at alive.
+    for (auto *L = dyn_cast_or_null<DILocation>(MD); L && Live.insert(L).second;
+         L = dyn_cast_or_null<DILocation>(L->getRawInlinedAt()))
+      ;
+  };
+  auto MarkOperandsLive = [&](const MDNode *N) {
+    for (const MDOperand &Op : N->operands())
+      MarkLive(Op);
+  };
+
+  // Locations are used by instructions and by other metadata, which can be
+  // attached to anything or be an operand of an intrinsic.
+  for (Module *M : OwnedModules) {
+    for (const NamedMDNode &NMD : M->named_metadata())
+      for (const MDNode *N : NMD.operands())
+        MarkLive(N);
+    for (const GlobalVariable &GV : M->globals()) {
+      MDs.clear();
+      GV.getAllMetadata(MDs);
+      for (const auto &MD : MDs)
+        MarkLive(MD.second);
+    }
+    for (const Function &F : *M) {
+      MDs.clear();
+      F.getAllMetadata(MDs);
+      for (const auto &MD : MDs)
+        MarkLive(MD.second);
+      for (const BasicBlock &BB : F)
+        for (const Instruction &I : BB) {
+          MDs.clear();
+          I.getAllMetadata(MDs);
+          for (const auto &MD : MDs)
+            MarkLive(MD.second);
+        }
+    }
+  }
+  for (const auto &Entry : MetadataAsValues)
+    MarkLive(Entry.first);
+  for (const MDNode *N : DistinctMDNodes)
+    MarkOperandsLive(N);
+#define HANDLE_MDNODE_LEAF_UNIQUABLE(CLASS)                                    \
+  if (Metadata::CLASS##Kind != Metadata::DILocationKind)                       \
+    for (const CLASS *N : CLASS##s)                                            \
+      MarkOperandsLive(N);
+#include "llvm/IR/Metadata.def"
+
+  // Nodes which are not resolved yet may still be replaced, and so are kept.
+  std::vector<DILocation *> Dead;
+  for (DILocation *L : DILocations)
+    if (!Live.count(L) && L->isResolved())
+      Dead.push_back(L);
+
+  // The dead locations can refer to each other, so they are all removed from
+  // the table while their operands are intact, and all dropped before any of
+  // them is deleted.
+  for (DILocation *L : Dead)
+    DILocations.erase(L);
+  for (DILocation *L : Dead)
+    L->dropAllReferences();
+  for (DILocation *L : Dead)
+    delete L;
+  return Dead.size();
+}
+
+namespace {
+
+/// The number of entries in, and the memory used by, a uniquing table.
+struct TableStats {
+  StringRef Name;
+  size_t Entries = 0;
+  size_t Bytes = 0;
+  /// For metadata, the number of distinct nodes of the kind, which are not
+  /// uniqued but are owned by the context as well.
+  size_t Distinct = 0;
+
+  explicit TableStats(StringRef Name) : Name(Name) {}
+};
+
+} // end anonymous namespace
+
+template <class ConstantClass>
+static TableStats getConstantStats(StringRef Name,
+                                   const ConstantUniqueMap<ConstantClass> &Map) {
+  TableStats Stats(Name);
+  Stats.Entries = Map.size();
+  Stats.Bytes = Map.getMemorySize();
+  for (const ConstantClass *C : Map)
+    Stats.Bytes += sizeof(ConstantClass) + C->getNumOperands() * sizeof(Use);
+  return Stats;
+}
+
+template <class MapTy>
+static TableStats getMapStats(StringRef Name, const MapTy &Map,
+                              size_t EntrySize) {
+  TableStats Stats(Name);
+  Stats.Entries = Map.size();
+  Stats.Bytes = Map.getMemorySize() + Map.size() * EntrySize;
+  return Stats;
+}
+
+static size_t getMDNodeSize(const MDNode *N) {
+  size_t Size = N->getNumOperands() * sizeof(MDOperand);
+  switch (N->getMetadataID()) {
+  default:
+    llvm_unreachable("Invalid MDNode subclass");
+#define HANDLE_MDNODE_LEAF(CLASS)                                              \
+  case Metadata::CLASS##Kind:                                                  \
+    return Size + sizeof(CLASS);
+#include "llvm/IR/Metadata.def"
+  }
+}
+
+static void printTableStats(raw_ostream &OS, ArrayRef<TableStats> Tables) {
+  OS << "     Entries        Bytes  Table\n";
+  for (const TableStats &T : Tables)
+    OS << format("%12zu %12zu", T.Entries, T.Bytes) << "  " << T.Name << "\n";
+}
+
+void LLVMContextImpl::printUniquingTableStats(raw_ostream &OS) const {
+  std::vector<TableStats> Constants;
+
+  TableStats Ints("ConstantInt");
+  Ints.Entries = IntConstants.size();
+  Ints.Bytes = IntConstants.getMemorySize();
+  for (const auto &Entry : IntConstants) {
+    Ints.Bytes += sizeof(ConstantInt);
+    // Wide values are stored out of line, both in the key and the constant.
+    if (Entry.first.getBitWidth() > 64)
+      Ints.Bytes += 2 * Entry.first.getNumWords() * sizeof(uint64_t);
+  }
+  Constants.push_back(Ints);
+  Constants.push_back(getMapStats("ConstantFP", FPConstants,
+                                  sizeof(ConstantFP)));
+  Constants.push_back(getConstantStats("ConstantArray", ArrayConstants));
+  Constants.push_back(getConstantStats("ConstantStruct", StructConstants));
+  Constants.push_back(getConstantStats("ConstantVector", VectorConstants));
+  Constants.push_back(getConstantStats("ConstantExpr", ExprConstants));
+
+  TableStats CDS("ConstantDataSequential");
+  CDS.Bytes = CDSConstants.getNumBuckets() * (sizeof(void *) + sizeof(unsigned));
+  for (const auto &Entry : CDSConstants) {
+    // The elements are stored once, in the key, for all the constants with
+    // the same elements.
+    CDS.Bytes += Entry.getKeyLength();
+    for (ConstantDataSequential *C = Entry.second; C; C = C->Next) {
+      ++CDS.Entries;
+      CDS.Bytes += sizeof(ConstantDataArray);
+    }
+  }
+  Constants.push_back(CDS);
+
+  Constants.push_back(getMapStats("ConstantAggregateZero", CAZConstants,
+                                  sizeof(ConstantAggregateZero)));
+  Constants.push_back(getMapStats("ConstantPointerNull", CPNConstants,
+                                  sizeof(ConstantPointerNull)));
+  Constants.push_back(getMapStats("UndefValue", UVConstants,
+                                  sizeof(UndefValue)));
+  Constants.push_back(getMapStats("BlockAddress", BlockAddresses,
+                                  sizeof(BlockAddress) + 2 * sizeof(Use)));
+  TableStats Asms("InlineAsm");
+  Asms.Entries = InlineAsms.size();
+  Asms.Bytes = InlineAsms.getMemorySize();
+  for (const InlineAsm *IA : InlineAsms)
+    Asms.Bytes += sizeof(InlineAsm) + IA->getAsmString().size() +
+                  IA->getConstraintString().size();
+  Constants.push_back(Asms);
+
+  std::vector<TableStats> MDTables;
+  TableStats Strings("MDString");
+  Strings.Entries = MDStringCache.size();
+  Strings.Bytes =
+      MDStringCache.getAllocator().getTotalMemory() +
+      MDStringCache.getNumBuckets() * (sizeof(void *) + sizeof(unsigned));
+  MDTables.push_back(Strings);
+  MDTables.push_back(getMapStats("ValueAsMetadata", ValuesAsMetadata,
+                                 sizeof(ValueAsMetadata)));
+  MDTables.push_back(getMapStats("MetadataAsValue", MetadataAsValues,
+                                 sizeof(MetadataAsValue)));
+
+  // The nodes, by kind, in the order of Metadata.def.
+  std::vector<TableStats> Nodes;
+  DenseMap<unsigned, unsigned> NodeIndex;
+#define HANDLE_MDNODE_LEAF(CLASS)                                              \
+  NodeIndex[Metadata::CLASS##Kind] = Nodes.size();                             \
+  Nodes.push_back(TableStats(#CLASS));
+#include "llvm/IR/Metadata.def"
+#define HANDLE_MDNODE_LEAF_UNIQUABLE(CLASS)                                    \
+  {                                                                            \
+    TableStats &T = Nodes[NodeIndex[Metadata::CLASS##Kind]];                   \
+    T.Entries = CLASS##s.size();                                               \
+    T.Bytes += CLASS##s.getMemorySize();                                       \
+    for (const CLASS *N : CLASS##s)                                            \
+      T.Bytes += getMDNodeSize(N);                                             \
+  }
+#include "llvm/IR/Metadata.def"
+  for (const MDNode *N : DistinctMDNodes) {
+    TableStats &T = Nodes[NodeIndex[N->getMetadataID()]];
+    ++T.Distinct;
+    T.Bytes += getMDNodeSize(N);
+  }
+
+  std::vector<TableStats> Attributes;
+  TableStats Attrs("Attribute");
+  Attrs.Entries = AttrsSet.size();
+  for (const AttributeImpl &A : AttrsSet)
+    Attrs.Bytes += A.isStringAttribute()
+                       ? sizeof(StringAttributeImpl) +
+                             A.getKindAsString().size() +
+                             A.getValueAsString().size()
+                       : sizeof(IntAttributeImpl);
+  Attributes.push_back(Attrs);
+  TableStats AttrNodes("AttributeSetNode");
+  AttrNodes.Entries = AttrsSetNodes.size();
+  for (const AttributeSetNode &N : AttrsSetNodes)
+    AttrNodes.Bytes +=
+        sizeof(AttributeSetNode) + N.getNumAttributes() * sizeof(Attribute);
+  Attributes.push_back(AttrNodes);
+  TableStats AttrLists("AttributeSet");
+  AttrLists.Entries = AttrsLists.size();
+  for (const AttributeSetImpl &L : AttrsLists)
+    AttrLists.Bytes +=
+        sizeof(AttributeSetImpl) + L.getNumSlots() * sizeof(IndexAttrPair);
+  Attributes.push_back(AttrLists);
+
+  // The types themselves are allocated together; only their tables are
+  // counted per kind.
+  std::vector<TableStats> Types;
+  Types.push_back(getMapStats("IntegerType", IntegerTypes, 0));
+  Types.push_back(getMapStats("FunctionType", FunctionTypes, 0));
+  Types.push_back(getMapStats("StructType (literal)", AnonStructTypes, 0));
+  TableStats Named("StructType (named)");
+  Named.Entries = NamedStructTypes.size();
+  Named.Bytes = NamedStructTypes.getNumBuckets() *
+                (sizeof(void *) + sizeof(unsigned));
+  Types.push_back(Named);
+  Types.push_back(getMapStats("ArrayType", ArrayTypes, 0));
+  Types.push_back(getMapStats("VectorType", VectorTypes, 0));
+  TableStats Pointers("PointerType");
+  Pointers.Entries = PointerTypes.size() + ASPointerTypes.size();
+  Pointers.Bytes = PointerTypes.getMemorySize() + ASPointerTypes.getMemorySize();
+  Types.push_back(Pointers);
+  TableStats Storage("(type storage)");
+  Storage.Bytes = TypeAllocator.getTotalMemory();
+  Types.push_back(Storage);
+
+  OS << "===" << std::string(73, '-') << "===\n"
+     << "                      LLVMContext uniquing tables\n"
+     << "===" << std::string(73, '-') << "===\n";
+  OS << "\nConstants:\n";
+  printTableStats(OS, Constants);
+  OS << "\nMetadata:\n";
+  printTableStats(OS, MDTables);
+  OS << "\nMetadata nodes:\n";
+  OS << "     Uniqued     Distinct        Bytes  Kind\n";
+  for (const TableStats &T : Nodes)
+    if (T.Entries || T.Distinct)
+      OS << format("%12zu %12zu %12zu", T.Entries, T.Distinct, T.Bytes) << "  "
+         << T.Name << "\n";
+  OS << "\nAttributes:\n";
+  printTableStats(OS, Attributes);
+  OS << "\nTypes:\n";
+  printTableStats(OS, Types);
+}
+
 namespace llvm {
 /// \brief Make MDOperand transparent for hashing.
 ///
@@ -1179,6 +1179,10 @@ public:
 
   /// Destroy the ConstantArrays if they are not used.
   void dropTriviallyDeadConstantArrays();
+  unsigned dropTriviallyDeadConstants();
+  unsigned dropUnusedDebugLocations();
+
+  void printUniquingTableStats(raw_ostream &OS) const;
 
   /// \brief Access the object which manages optimization bisection for failure
   /// analysis.
@@ -0,0 +1,196 @@
+//===- PassInstrumentation.cpp - Callbacks around pass execution ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/PassInstrumentation.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace llvm;
+
+bool PassInstrumentationCallbacks::runBeforePass(
+    StringRef PassName, const PassInstrumentationIRUnit &IR) const {
+  // Run all the callbacks even if one asks to skip the pass, so that each of
+  // them sees a matching skipped callback.
+  bool ShouldRun = true;
+  for (const BeforePassFunc &C : BeforePassCallbacks)
+    ShouldRun &= C(PassName, IR);
+  return ShouldRun;
+}
+
+void PassInstrumentationCallbacks::runAfterPass(
+    StringRef PassName, const PassInstrumentationIRUnit &IR) const {
+  for (const PassFunc &C : AfterPassCallbacks)
+    C(PassName, IR);
+}
+
+void PassInstrumentationCallbacks::runPassSkipped(
+    StringRef PassName, const PassInstrumentationIRUnit &IR) const {
+  for (const PassFunc &C : PassSkippedCallbacks)
+    C(PassName, IR);
+}
+
+void PassInstrumentationCallbacks::runBeforeAnalysis(
+    StringRef AnalysisName, const PassInstrumentationIRUnit &IR) const {
+  for (const AnalysisFunc &C : BeforeAnalysisCallbacks)
+    C(AnalysisName, IR);
+}
+
+void PassInstrumentationCallbacks::runAfterAnalysis(
+    StringRef AnalysisName, const PassInstrumentationIRUnit &IR) const {
+  for (const AnalysisFunc &C : AfterAnalysisCallbacks)
+    C(AnalysisName, IR);
+}
+
+void PassInstrumentationCallbacks::runAnalysisInvalidated(
+    StringRef AnalysisName, const PassInstrumentationIRUnit &IR) const {
+  for (const AnalysisFunc &C : AnalysisInvalidatedCallbacks)
+    C(AnalysisName, IR);
+}
+
+unsigned llvm::getIRUnitInstructionCount(const Module &M) {
+  unsigned Count = 0;
+  for (const Function &F : M)
+    Count += getIRUnitInstructionCount(F);
+  return Count;
+}
+
+unsigned llvm::getIRUnitInstructionCount(const Function &F) {
+  unsigned Count = 0;
+  for (const BasicBlock &BB : F)
+    Count += BB.size();
+  return Count;
+}
+
+//===----------------------------------------------------------------------===//
+// PassTimingInfo
+//===----------------------------------------------------------------------===//
+
+PassTimingInfo::PassTimingInfo() : TG("Pass execution timing report") {}
+
+PassTimingInfo::~PassTimingInfo() {}
+
+void PassTimingInfo::registerCallbacks(PassInstrumentationCallbacks &PIC) {
+  PIC.registerBeforePassCallback(
+      [this](StringRef PassName, const PassInstrumentationIRUnit &) {
+        startPass(PassName);
+        return true;
+      });
+  PIC.registerAfterPassCallback(
+      [this](StringRef, const PassInstrumentationIRUnit &) { stopPass(); });
+  PIC.registerPassSkippedCallback(
+      [this](StringRef, const PassInstrumentationIRUnit &) { stopPass(); });
+}
+
+void PassTimingInfo::startPass(StringRef PassName) {
+  // The enclosing pass, typically a pass manager or an adaptor, is paused
+  // while the pass runs.
+  if (!ActiveTimers.empty())
+    ActiveTimers.back()->stopTimer();
+
+  std::unique_ptr<Timer> &T = Timers[PassName];
+  if (!T)
+    T = llvm::make_unique<Timer>(PassName, TG);
+  ActiveTimers.push_back(T.get());
+  T->startTimer();
+}
+
+void PassTimingInfo::stopPass() {
+  assert(!ActiveTimers.empty() && "no pass is running");
+  ActiveTimers.pop_back_val()->stopTimer();
+  if (!ActiveTimers.empty())
+    ActiveTimers.back()->startTimer();
+}
+
+void PassTimingInfo::print(raw_ostream &OS) { TG.print(OS); }
+
+//===----------------------------------------------------------------------===//
+// PassInstructionCountTracker
+//===----------------------------------------------------------------------===//
+
+void PassInstructionCountTracker::registerCallbacks(
+    PassInstrumentationCallbacks &PIC) {
+  PIC.registerBeforePassCallback(
+      [this](StringRef, const PassInstrumentationIRUnit &IR) {
+        CountsBefore.push_back(IR.getInstructionCount());
+        return true;
+      });
+  PIC.registerAfterPassCallback(
+      [this](StringRef PassName, const PassInstrumentationIRUnit &IR) {
+        assert(!CountsBefore.empty() && "no pass is running");
+        PassCounts &C = Counts[PassName];
+        ++C.Runs;
+        C.Delta += int64_t(IR.getInstructionCount()) -
+                   int64_t(CountsBefore.pop_back_val());
+      });
+  PIC.registerPassSkippedCallback(
+      [this](StringRef, const PassInstrumentationIRUnit &) {
+        assert(!CountsBefore.empty() && "no pass is running");
+        CountsBefore.pop_back();
+      });
+}
+
+void PassInstructionCountTracker::print(raw_ostream &OS) const {
+  std::vector<std::pair<StringRef, PassCounts>> Changed;
+  for (const auto &Entry : Counts)
+    if (Entry.second.Delta)
+      Changed.push_back(std::make_pair(Entry.first(), Entry.second));
+  std::sort(Changed.begin(), Changed.end(),
+            [](const std::pair<StringRef, PassCounts> &LHS,
+               const std::pair<StringRef, PassCounts> &RHS) {
+              int64_t L = std::abs(LHS.second.Delta);
+              int64_t R = std::abs(RHS.second.Delta);
+              if (L != R)
+                return L > R;
+              return LHS.first < RHS.first;
+            });
+
+  OS << "Instruction count changes per pass:\n";
+  OS << "     Change      Runs  Pass\n";
+  for (const auto &Entry : Changed)
+    OS << format("%+11lld %9u", (long long)Entry.second.Delta,
+                 Entry.second.Runs)
+       << "  " << Entry.first << "\n";
+}
+
+//===----------------------------------------------------------------------===//
+// AnalysisRunCounter
+//===----------------------------------------------------------------------===//
+
+void AnalysisRunCounter::registerCallbacks(PassInstrumentationCallbacks &PIC) {
+  PIC.registerAfterAnalysisCallback(
+      [this](StringRef AnalysisName, const PassInstrumentationIRUnit &) {
+        ++Counts[AnalysisName].Runs;
+      });
+  PIC.registerAnalysisInvalidatedCallback(
+      [this](StringRef AnalysisName, const PassInstrumentationIRUnit &) {
+        ++Counts[AnalysisName].Invalidations;
+      });
+}
+
+void AnalysisRunCounter::print(raw_ostream &OS) const {
+  std::vector<std::pair<StringRef, AnalysisCounts>> Sorted;
+  for (const auto &Entry : Counts)
+    Sorted.push_back(std::make_pair(Entry.first(), Entry.second));
+  std::sort(Sorted.begin(), Sorted.end(),
+            [](const std::pair<StringRef, AnalysisCounts> &LHS,
+               const std::pair<StringRef, AnalysisCounts> &RHS) {
+              if (LHS.second.Runs != RHS.second.Runs)
+                return LHS.second.Runs > RHS.second.Runs;
+              return LHS.first < RHS.first;
+            });
+
+  OS << "Analysis runs and invalidations:\n";
+  OS << "      Runs  Invalidations  Analysis\n";
+  for (const auto &Entry : Sorted)
+    OS << format("%10u %14u", Entry.second.Runs, Entry.second.Invalidations)
+       << "  " << Entry.first << "\n";
+}
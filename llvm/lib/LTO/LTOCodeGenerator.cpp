@@ -550,6 +550,10 @@ bool LTOCodeGenerator::optimize(bool DisableVerify, bool DisableInline,
   // Run our queue of passes all at once now, efficiently.
   passes.run(*MergedModule);
 
+  // Inlining leaves most of the debug locations of the inlined functions
+  // unused; free them before code generation.
+  Context.dropUnusedDebugLocations();
+
   return true;
 }
 
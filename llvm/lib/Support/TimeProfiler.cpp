@@ -0,0 +1,211 @@
+//===-- TimeProfiler.cpp - Hierarchical Time Profiler ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the hierarchical time profiler.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace llvm {
+
+static cl::opt<unsigned> TimeTraceGranularity(
+    "time-trace-granularity",
+    cl::desc(
+        "Minimum time granularity (in microseconds) traced by time profiler"),
+    cl::init(500));
+
+TimeTraceProfiler *TimeTraceProfilerInstance = nullptr;
+
+namespace {
+typedef steady_clock::time_point TimePointType;
+typedef microseconds DurationType;
+
+struct Entry {
+  TimePointType Start;
+  DurationType Duration;
+  std::string Name;
+  std::string Detail;
+
+  Entry(TimePointType S, std::string N, std::string D)
+      : Start(S), Duration(0), Name(std::move(N)), Detail(std::move(D)) {}
+};
+
+/// \brief Write \p S as a JSON string literal.
+void writeJSONString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (unsigned char C : S) {
+    switch (C) {
+    case '"':
+      OS << "\\\"";
+      break;
+    case '\\':
+      OS << "\\\\";
+      break;
+    case '\n':
+      OS << "\\n";
+      break;
+    case '\t':
+      OS << "\\t";
+      break;
+    default:
+      if (C < 0x20)
+        OS << format("\\u%04x", C);
+      else
+        OS << C;
+    }
+  }
+  OS << '"';
+}
+} // end anonymous namespace
+
+struct TimeTraceProfiler {
+  TimeTraceProfiler() : StartTime(steady_clock::now()) {}
+
+  void begin(std::string Name, std::string Detail) {
+    Stack.emplace_back(steady_clock::now(), std::move(Name),
+                       std::move(Detail));
+  }
+
+  void end() {
+    // Tolerate unbalanced calls, e.g. when the profiler was initialized while
+    // a TimeTraceScope was already alive.
+    if (Stack.empty())
+      return;
+
+    Entry &E = Stack.back();
+    E.Duration = duration_cast<DurationType>(steady_clock::now() - E.Start);
+
+    // Only include sections longer than the granularity in the trace.
+    if (E.Duration.count() >= TimeTraceGranularity)
+      Entries.push_back(E);
+
+    // Track the total time taken by each name, counting only the outermost
+    // section of a name: a template instantiation that instantiates other
+    // templates from within is counted once.
+    if (std::none_of(std::next(Stack.rbegin()), Stack.rend(),
+                     [&](const Entry &Val) { return Val.Name == E.Name; })) {
+      auto &Total = TotalPerName[E.Name];
+      ++Total.first;
+      Total.second += E.Duration;
+    }
+
+    Stack.pop_back();
+  }
+
+  void write(raw_ostream &OS) {
+    // Close the sections that are still open, so that they show up too.
+    while (!Stack.empty())
+      end();
+
+    OS << "{ \"traceEvents\": [\n";
+
+    bool First = true;
+    auto BeginEvent = [&]() {
+      if (!First)
+        OS << ",\n";
+      First = false;
+    };
+
+    // Emit all recorded sections on the first thread.
+    for (const Entry &E : Entries) {
+      BeginEvent();
+      OS << "{ \"pid\": 1, \"tid\": 0, \"ph\": \"X\", \"ts\": "
+         << duration_cast<DurationType>(E.Start - StartTime).count()
+         << ", \"dur\": " << E.Duration.count() << ", \"name\": ";
+      writeJSONString(OS, E.Name);
+      OS << ", \"args\": { \"detail\": ";
+      writeJSONString(OS, E.Detail);
+      OS << " } }";
+    }
+
+    // Emit the totals, longest first, each on its own thread so that they
+    // are displayed as separate tracks.
+    std::vector<NameAndCountAndDurationType> SortedTotals;
+    SortedTotals.reserve(TotalPerName.size());
+    for (const auto &Total : TotalPerName)
+      SortedTotals.emplace_back(Total.getKey(), Total.getValue());
+    std::sort(SortedTotals.begin(), SortedTotals.end(),
+              [](const NameAndCountAndDurationType &A,
+                 const NameAndCountAndDurationType &B) {
+                if (A.second.second != B.second.second)
+                  return A.second.second > B.second.second;
+                return A.first < B.first;
+              });
+    unsigned Tid = 1;
+    for (const auto &Total : SortedTotals) {
+      unsigned Count = Total.second.first;
+      auto DurUs = Total.second.second.count();
+      BeginEvent();
+      OS << "{ \"pid\": 1, \"tid\": " << Tid++
+         << ", \"ph\": \"X\", \"ts\": 0, \"dur\": " << DurUs
+         << ", \"name\": ";
+      writeJSONString(OS, "Total " + Total.first);
+      OS << ", \"args\": { \"count\": " << Count << ", \"avg ms\": "
+         << DurUs / Count / 1000 << " } }";
+    }
+
+    OS << "\n] }\n";
+  }
+
+  typedef std::pair<unsigned, DurationType> CountAndDurationType;
+  typedef std::pair<std::string, CountAndDurationType>
+      NameAndCountAndDurationType;
+
+  std::vector<Entry> Stack;
+  std::vector<Entry> Entries;
+  StringMap<CountAndDurationType> TotalPerName;
+  TimePointType StartTime;
+};
+
+void timeTraceProfilerInitialize() {
+  assert(TimeTraceProfilerInstance == nullptr &&
+         "Profiler should not be initialized");
+  TimeTraceProfilerInstance = new TimeTraceProfiler();
+}
+
+void timeTraceProfilerCleanup() {
+  delete TimeTraceProfilerInstance;
+  TimeTraceProfilerInstance = nullptr;
+}
+
+void timeTraceProfilerWrite(raw_ostream &OS) {
+  assert(TimeTraceProfilerInstance != nullptr &&
+         "Profiler object can't be null");
+  TimeTraceProfilerInstance->write(OS);
+}
+
+void timeTraceProfilerBegin(StringRef Name, StringRef Detail) {
+  if (TimeTraceProfilerInstance != nullptr)
+    TimeTraceProfilerInstance->begin(Name, Detail);
+}
+
+void timeTraceProfilerBegin(StringRef Name,
+                            function_ref<std::string()> Detail) {
+  if (TimeTraceProfilerInstance != nullptr)
+    TimeTraceProfilerInstance->begin(Name, Detail());
+}
+
+void timeTraceProfilerEnd() {
+  if (TimeTraceProfilerInstance != nullptr)
+    TimeTraceProfilerInstance->end();
+}
+
+} // end namespace llvm
@@ -3995,3 +3995,75 @@ AArch64InstrInfo::getSerializableBitmaskMachineOperandTargetFlags() const {
       {MO_TLS, "aarch64-tls"}};
   return makeArrayRef(TargetFlags);
 }
+
+bool AArch64InstrInfo::isFunctionSafeToOutlineFrom(MachineFunction &MF) const {
+  // Only tail calls are used to reach the outlined functions, which leaves
+  // the stack alone.
+  return true;
+}
+
+AArch64InstrInfo::MachineOutlinerInstrType
+AArch64InstrInfo::getOutliningType(const MachineInstr &MI) const {
+  // KILLs don't generate any code.
+  if (MI.isKill())
+    return MachineOutlinerInstrType::Invisible;
+
+  // The return ends the tail called outlined function, and uses LR as it was
+  // on entry to the original function.
+  if (MI.isReturn())
+    return (MI.getOpcode() == AArch64::RET ||
+            MI.getOpcode() == AArch64::RET_ReallyLR)
+               ? MachineOutlinerInstrType::Legal
+               : MachineOutlinerInstrType::Illegal;
+  if (MI.isCall())
+    return MachineOutlinerInstrType::Illegal;
+
+  if (MI.getFlag(MachineInstr::FrameSetup) ||
+      MI.getFlag(MachineInstr::FrameDestroy))
+    return MachineOutlinerInstrType::Illegal;
+
+  // Keep the stack and the link register out of the outlined functions.
+  if (MI.readsRegister(AArch64::SP, &RI) ||
+      MI.modifiesRegister(AArch64::SP, &RI) ||
+      MI.readsRegister(AArch64::LR, &RI) ||
+      MI.modifiesRegister(AArch64::LR, &RI))
+    return MachineOutlinerInstrType::Illegal;
+
+  return MachineOutlinerInstrType::Legal;
+}
+
+int AArch64InstrInfo::getOutliningBenefit(size_t SequenceSize,
+                                          size_t Occurrences,
+                                          bool CanBeTailCall) const {
+  // A BL to the outlined function would clobber LR, which isn't saved
+  // anywhere, so only sequences ending with a return are outlined.
+  if (!CanBeTailCall)
+    return 0;
+
+  // One branch per occurrence, and the outlined sequence with its return.
+  unsigned NotOutlinedSize = SequenceSize * Occurrences;
+  unsigned OutlinedSize = Occurrences + SequenceSize;
+
+  return NotOutlinedSize > OutlinedSize ? NotOutlinedSize - OutlinedSize : 0;
+}
+
+void AArch64InstrInfo::insertOutlinerPrologue(MachineBasicBlock &MBB,
+                                              MachineFunction &MF,
+                                              bool IsTailCall) const {}
+
+void AArch64InstrInfo::insertOutlinerEpilogue(MachineBasicBlock &MBB,
+                                              MachineFunction &MF,
+                                              bool IsTailCall) const {
+  assert(IsTailCall && "Only tail calls to outlined functions are emitted!");
+}
+
+MachineBasicBlock::iterator
+AArch64InstrInfo::insertOutlinedCall(MachineBasicBlock &MBB,
+                                     MachineBasicBlock::iterator It,
+                                     MachineFunction &MF,
+                                     bool IsTailCall) const {
+  assert(IsTailCall && "Only tail calls to outlined functions are emitted!");
+  return BuildMI(MBB, It, DebugLoc(), get(AArch64::TCRETURNdi))
+      .addGlobalAddress(MF.getFunction())
+      .addImm(0);
+}
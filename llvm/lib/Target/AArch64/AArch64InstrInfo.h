@@ -204,6 +204,19 @@ public:
   ArrayRef<std::pair<unsigned, const char *>>
   getSerializableBitmaskMachineOperandTargetFlags() const override;
 
+  bool isFunctionSafeToOutlineFrom(MachineFunction &MF) const override;
+  MachineOutlinerInstrType
+  getOutliningType(const MachineInstr &MI) const override;
+  int getOutliningBenefit(size_t SequenceSize, size_t Occurrences,
+                          bool CanBeTailCall) const override;
+  void insertOutlinerPrologue(MachineBasicBlock &MBB, MachineFunction &MF,
+                              bool IsTailCall) const override;
+  void insertOutlinerEpilogue(MachineBasicBlock &MBB, MachineFunction &MF,
+                              bool IsTailCall) const override;
+  MachineBasicBlock::iterator
+  insertOutlinedCall(MachineBasicBlock &MBB, MachineBasicBlock::iterator It,
+                     MachineFunction &MF, bool IsTailCall) const override;
+
 private:
   void instantiateCondBranch(MachineBasicBlock &MBB, const DebugLoc &DL,
                              MachineBasicBlock *TBB,
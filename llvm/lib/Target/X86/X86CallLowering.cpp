@@ -0,0 +1,131 @@
+//===-- llvm/lib/Target/X86/X86CallLowering.cpp - Call lowering -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the lowering of LLVM calls to machine code calls for
+/// GlobalISel.
+///
+//===----------------------------------------------------------------------===//
+
+#include "X86CallLowering.h"
+#include "X86CallingConv.h"
+#include "X86ISelLowering.h"
+#include "X86Subtarget.h"
+
+#include "llvm/CodeGen/CallingConvLower.h"
+#include "llvm/CodeGen/GlobalISel/MachineIRBuilder.h"
+#include "llvm/CodeGen/MachineInstrBuilder.h"
+
+using namespace llvm;
+
+#ifndef LLVM_BUILD_GLOBAL_ISEL
+#error "This shouldn't be built without GISel"
+#endif
+
+#include "X86GenCallingConv.inc"
+
+X86CallLowering::X86CallLowering(const X86TargetLowering &TLI)
+  : CallLowering(&TLI) {
+}
+
+/// Get the simple value type used by the calling convention for \p Ty, or
+/// return false if \p Ty does not have one.
+static bool getCCValueType(const TargetLowering &TLI, const DataLayout &DL,
+                           Type *Ty, MVT &ValVT) {
+  EVT VT = TLI.getValueType(DL, Ty, /*AllowUnknown=*/true);
+  if (!VT.isSimple() || VT == MVT::Other)
+    return false;
+  ValVT = VT.getSimpleVT();
+  return true;
+}
+
+bool X86CallLowering::lowerReturn(MachineIRBuilder &MIRBuilder,
+                                  const Value *Val, unsigned VReg) const {
+  MachineFunction &MF = MIRBuilder.getMF();
+  const Function &F = *MF.getFunction();
+  const X86Subtarget &STI = MF.getSubtarget<X86Subtarget>();
+
+  assert(((Val && VReg) || (!Val && !VReg)) && "Return value without a vreg");
+  unsigned ResReg = 0;
+  if (VReg) {
+    MVT ValVT;
+    if (!getCCValueType(*getTLI(), F.getParent()->getDataLayout(),
+                        Val->getType(), ValVT))
+      return false;
+
+    SmallVector<CCValAssign, 1> RVLocs;
+    CCState CCInfo(F.getCallingConv(), F.isVarArg(), MF, RVLocs,
+                   F.getContext());
+    if (RetCC_X86(0, ValVT, ValVT, CCValAssign::Full, ISD::ArgFlagsTy(),
+                  CCInfo))
+      return false;
+
+    // Values that need to be extended or split are not supported yet.
+    if (RVLocs.size() != 1 || !RVLocs[0].isRegLoc() ||
+        RVLocs[0].getLocInfo() != CCValAssign::Full)
+      return false;
+    ResReg = RVLocs[0].getLocReg();
+    MIRBuilder.buildInstr(TargetOpcode::COPY, ResReg, VReg);
+  }
+
+  MachineInstr *Return =
+      MIRBuilder.buildInstr(STI.is64Bit() ? X86::RETQ : X86::RETL);
+  assert(Return && "Unable to build a return instruction?!");
+  if (ResReg)
+    MachineInstrBuilder(MF, Return).addReg(ResReg, RegState::Implicit);
+  return true;
+}
+
+bool X86CallLowering::lowerFormalArguments(
+    MachineIRBuilder &MIRBuilder, const Function::ArgumentListType &Args,
+    const SmallVectorImpl<unsigned> &VRegs) const {
+  MachineFunction &MF = MIRBuilder.getMF();
+  const Function &F = *MF.getFunction();
+  const DataLayout &DL = F.getParent()->getDataLayout();
+
+  // Variadic functions need their register save area set up.
+  if (F.isVarArg())
+    return false;
+
+  SmallVector<CCValAssign, 16> ArgLocs;
+  CCState CCInfo(F.getCallingConv(), F.isVarArg(), MF, ArgLocs, F.getContext());
+
+  unsigned NumArgs = Args.size();
+  Function::const_arg_iterator CurOrigArg = Args.begin();
+  for (unsigned i = 0; i != NumArgs; ++i, ++CurOrigArg) {
+    // Arguments with ABI attributes change how they are passed.
+    if (CurOrigArg->hasByValOrInAllocaAttr() || CurOrigArg->hasNestAttr() ||
+        CurOrigArg->hasSExtAttr() || CurOrigArg->hasZExtAttr() ||
+        CurOrigArg->hasStructRetAttr())
+      return false;
+
+    MVT ValVT;
+    if (!getCCValueType(*getTLI(), DL, CurOrigArg->getType(), ValVT))
+      return false;
+    if (CC_X86(i, ValVT, ValVT, CCValAssign::Full, ISD::ArgFlagsTy(), CCInfo))
+      return false;
+  }
+  if (ArgLocs.size() != Args.size())
+    return false;
+
+  // Arguments passed on the stack and arguments that need to be extended are
+  // not supported yet.
+  for (CCValAssign &VA : ArgLocs)
+    if (!VA.isRegLoc() || (VA.getLocInfo() != CCValAssign::Full &&
+                           VA.getLocInfo() != CCValAssign::BCvt))
+      return false;
+
+  for (unsigned i = 0, e = ArgLocs.size(); i != e; ++i) {
+    CCValAssign &VA = ArgLocs[i];
+    // Transform the arguments in physical registers into virtual ones.
+    MIRBuilder.getMBB().addLiveIn(VA.getLocReg());
+    MIRBuilder.buildInstr(TargetOpcode::COPY, VRegs[i], VA.getLocReg());
+  }
+  return true;
+}
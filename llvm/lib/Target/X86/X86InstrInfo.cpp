@@ -8008,6 +8008,82 @@ X86InstrInfo::getSerializableDirectMachineOperandTargetFlags() const {
   return makeArrayRef(TargetFlags);
 }
 
+bool X86InstrInfo::isFunctionSafeToOutlineFrom(MachineFunction &MF) const {
+  // The return address pushed by a call to an outlined function would
+  // overwrite the red zone.
+  return !MF.getInfo<X86MachineFunctionInfo>()->getUsesRedZone();
+}
+
+X86InstrInfo::MachineOutlinerInstrType
+X86InstrInfo::getOutliningType(const MachineInstr &MI) const {
+  // KILLs don't generate any code.
+  if (MI.isKill())
+    return MachineOutlinerInstrType::Invisible;
+
+  // Only the plain returns can end an outlined function, the calls and tail
+  // calls don't expect the return address of the outlined call on the stack.
+  if (MI.isReturn())
+    return (MI.getOpcode() == X86::RETQ || MI.getOpcode() == X86::RETL)
+               ? MachineOutlinerInstrType::Legal
+               : MachineOutlinerInstrType::Illegal;
+  if (MI.isCall())
+    return MachineOutlinerInstrType::Illegal;
+
+  // The frame setup and destroy code describes the frame of its function.
+  if (MI.getFlag(MachineInstr::FrameSetup) ||
+      MI.getFlag(MachineInstr::FrameDestroy))
+    return MachineOutlinerInstrType::Illegal;
+
+  // The call to the outlined function moves the stack pointer and changes the
+  // instruction pointer, so nothing may depend on them.
+  if (MI.readsRegister(X86::RSP, &RI) || MI.modifiesRegister(X86::RSP, &RI) ||
+      MI.readsRegister(X86::RIP, &RI) || MI.modifiesRegister(X86::RIP, &RI))
+    return MachineOutlinerInstrType::Illegal;
+
+  return MachineOutlinerInstrType::Legal;
+}
+
+int X86InstrInfo::getOutliningBenefit(size_t SequenceSize,
+                                      size_t Occurrences,
+                                      bool CanBeTailCall) const {
+  unsigned NotOutlinedSize = SequenceSize * Occurrences;
+
+  // One call or jump per occurrence, the outlined sequence, and a return
+  // unless the sequence already ends with one.
+  unsigned OutlinedSize = Occurrences + SequenceSize + (CanBeTailCall ? 0 : 1);
+
+  return NotOutlinedSize > OutlinedSize ? NotOutlinedSize - OutlinedSize : 0;
+}
+
+void X86InstrInfo::insertOutlinerPrologue(MachineBasicBlock &MBB,
+                                          MachineFunction &MF,
+                                          bool IsTailCall) const {}
+
+void X86InstrInfo::insertOutlinerEpilogue(MachineBasicBlock &MBB,
+                                          MachineFunction &MF,
+                                          bool IsTailCall) const {
+  // A tail called sequence ends with the return of its original function.
+  if (IsTailCall)
+    return;
+
+  unsigned RetOpc = Subtarget.is64Bit() ? X86::RETQ : X86::RETL;
+  MBB.insert(MBB.end(), BuildMI(MF, DebugLoc(), get(RetOpc)));
+}
+
+MachineBasicBlock::iterator
+X86InstrInfo::insertOutlinedCall(MachineBasicBlock &MBB,
+                                 MachineBasicBlock::iterator It,
+                                 MachineFunction &MF, bool IsTailCall) const {
+  unsigned Opc;
+  if (IsTailCall)
+    Opc = Subtarget.is64Bit() ? X86::TAILJMPd64 : X86::TAILJMPd;
+  else
+    Opc = Subtarget.is64Bit() ? X86::CALL64pcrel32 : X86::CALLpcrel32;
+
+  return BuildMI(MBB, It, DebugLoc(), get(Opc))
+      .addGlobalAddress(MF.getFunction());
+}
+
 namespace {
   /// Create Global Base Reg pass. This initializes the PIC
   /// global base register for x86-32.
@@ -529,6 +529,24 @@ public:
   ArrayRef<std::pair<unsigned, const char *>>
   getSerializableDirectMachineOperandTargetFlags() const override;
 
+  bool isFunctionSafeToOutlineFrom(MachineFunction &MF) const override;
+
+  MachineOutlinerInstrType
+  getOutliningType(const MachineInstr &MI) const override;
+
+  int getOutliningBenefit(size_t SequenceSize, size_t Occurrences,
+                          bool CanBeTailCall) const override;
+
+  void insertOutlinerPrologue(MachineBasicBlock &MBB, MachineFunction &MF,
+                              bool IsTailCall) const override;
+
+  void insertOutlinerEpilogue(MachineBasicBlock &MBB, MachineFunction &MF,
+                              bool IsTailCall) const override;
+
+  MachineBasicBlock::iterator
+  insertOutlinedCall(MachineBasicBlock &MBB, MachineBasicBlock::iterator It,
+                     MachineFunction &MF, bool IsTailCall) const override;
+
 protected:
   /// Commutes the operands in the given instruction by changing the operands
   /// order and/or changing the instruction's opcode and/or the immediate value
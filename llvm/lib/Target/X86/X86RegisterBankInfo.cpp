@@ -0,0 +1,91 @@
+//===- X86RegisterBankInfo.cpp -----------------------------------*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+/// This file implements the targeting of the RegisterBankInfo class for X86.
+/// \todo This should be generated by TableGen.
+//===----------------------------------------------------------------------===//
+
+#include "X86RegisterBankInfo.h"
+#include "X86InstrInfo.h" // For XXXRegClassID.
+#include "llvm/CodeGen/GlobalISel/RegisterBank.h"
+#include "llvm/CodeGen/GlobalISel/RegisterBankInfo.h"
+#include "llvm/Target/TargetRegisterInfo.h"
+#include "llvm/Target/TargetSubtargetInfo.h"
+
+using namespace llvm;
+
+#ifndef LLVM_BUILD_GLOBAL_ISEL
+#error "You shouldn't build this"
+#endif
+
+X86RegisterBankInfo::X86RegisterBankInfo(const TargetRegisterInfo &TRI)
+    : RegisterBankInfo(X86::NumRegisterBanks) {
+  // Initialize the GPR bank.
+  createRegisterBank(X86::GPRRegBankID, "GPR");
+  // The GPR register bank is fully defined by all the registers in
+  // GR64 + its subclasses and sub-registers.
+  addRegBankCoverage(X86::GPRRegBankID, X86::GR64RegClassID, TRI);
+  const RegisterBank &RBGPR = getRegBank(X86::GPRRegBankID);
+  (void)RBGPR;
+  assert(RBGPR.covers(*TRI.getRegClass(X86::GR32RegClassID)) &&
+         "Subclass not added?");
+  assert(RBGPR.covers(*TRI.getRegClass(X86::GR8RegClassID)) &&
+         "Subclass not added?");
+  assert(RBGPR.getSize() == 64 && "GPRs should hold up to 64-bit");
+
+  // Initialize the VECR bank.
+  createRegisterBank(X86::VECRRegBankID, "VECR");
+  // The vector registers are defined by VR512 and its sub-registers. The
+  // scalar floating point classes alias the XMM registers but are not
+  // sub-classes of the vector ones, so add them explicitly.
+  addRegBankCoverage(X86::VECRRegBankID, X86::VR512RegClassID, TRI);
+  addRegBankCoverage(X86::VECRRegBankID, X86::FR64XRegClassID, TRI);
+  addRegBankCoverage(X86::VECRRegBankID, X86::FR32XRegClassID, TRI);
+  const RegisterBank &RBVECR = getRegBank(X86::VECRRegBankID);
+  (void)RBVECR;
+  assert(RBVECR.covers(*TRI.getRegClass(X86::VR128RegClassID)) &&
+         "Subclass not added?");
+  assert(RBVECR.covers(*TRI.getRegClass(X86::FR64RegClassID)) &&
+         "Subclass not added?");
+  assert(RBVECR.getSize() == 512 && "VECRs should hold up to 512-bit");
+
+  assert(verify(TRI) && "Invalid register bank information");
+}
+
+const RegisterBank &X86RegisterBankInfo::getRegBankFromRegClass(
+    const TargetRegisterClass &RC) const {
+  if (getRegBank(X86::GPRRegBankID).covers(RC))
+    return getRegBank(X86::GPRRegBankID);
+  if (getRegBank(X86::VECRRegBankID).covers(RC))
+    return getRegBank(X86::VECRRegBankID);
+  llvm_unreachable("Register class not supported");
+}
+
+RegisterBankInfo::InstructionMapping
+X86RegisterBankInfo::getInstrMapping(const MachineInstr &MI) const {
+  RegisterBankInfo::InstructionMapping Mapping = getInstrMappingImpl(MI);
+  if (Mapping.isValid())
+    return Mapping;
+
+  // The generic instructions only cover integer operations for now: vectors
+  // go in the vector registers, scalars in the GPRs.
+  LLT Ty = MI.getType();
+  unsigned BankID;
+  if (Ty.isVector())
+    BankID = X86::VECRRegBankID;
+  else
+    BankID = X86::GPRRegBankID;
+
+  Mapping = InstructionMapping{1, 1, MI.getNumOperands()};
+  int Size = Ty.isSized() ? Ty.getSizeInBits() : 0;
+  for (unsigned Idx = 0; Idx < MI.getNumOperands(); ++Idx)
+    Mapping.setOperandMapping(Idx, Size, getRegBank(BankID));
+
+  return Mapping;
+}
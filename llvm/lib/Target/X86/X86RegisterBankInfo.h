@@ -0,0 +1,46 @@
+//===- X86RegisterBankInfo.h ------------------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+/// This file declares the targeting of the RegisterBankInfo class for X86.
+/// \todo This should be generated by TableGen.
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_TARGET_X86_X86REGISTERBANKINFO_H
+#define LLVM_LIB_TARGET_X86_X86REGISTERBANKINFO_H
+
+#include "llvm/CodeGen/GlobalISel/RegisterBankInfo.h"
+
+namespace llvm {
+
+class TargetRegisterInfo;
+
+namespace X86 {
+enum {
+  GPRRegBankID = 0,  /// General Purpose Registers: 8 to 64-bit.
+  VECRRegBankID = 1, /// Floating Point/Vector Registers: XMM, YMM, ZMM.
+  NumRegisterBanks
+};
+} // End X86 namespace.
+
+/// This class provides the information for the target register banks.
+class X86RegisterBankInfo : public RegisterBankInfo {
+public:
+  X86RegisterBankInfo(const TargetRegisterInfo &TRI);
+
+  /// Get a register bank that covers \p RC.
+  ///
+  /// \pre \p RC is a user-defined register class (as opposed as one
+  /// generated by TableGen).
+  const RegisterBank &
+  getRegBankFromRegClass(const TargetRegisterClass &RC) const override;
+
+  InstructionMapping getInstrMapping(const MachineInstr &MI) const override;
+};
+} // End llvm namespace.
+#endif
@@ -14,6 +14,7 @@
 #include "X86Subtarget.h"
 #include "X86InstrInfo.h"
 #include "X86TargetMachine.h"
+#include "llvm/ADT/StringSwitch.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/GlobalValue.h"
@@ -204,6 +205,8 @@ void X86Subtarget::initSubtargetFeatures(StringRef CPU, StringRef FS) {
   
   InstrItins = getInstrItineraryForCPU(CPUName);
 
+  initPrefetchParameters(CPUName);
+
   // It's important to keep the MCSubtargetInfo feature bits in sync with
   // target data structure which is shared with MC code emitter, etc.
   if (In64BitMode)
@@ -293,6 +296,58 @@ void X86Subtarget::initializeEnvironment() {
   // FIXME: this is a known good value for Yonah. How about others?
   MaxInlineSizeThreshold = 128;
   UseSoftFloat = false;
+  CacheLineSize = 64;
+  PrefetchDistance = 0;
+  MinPrefetchStride = 1;
+  MaxPrefetchIterationsAhead = UINT_MAX;
+}
+
+void X86Subtarget::initPrefetchParameters(StringRef CPU) {
+  // The hardware prefetchers of all of these cores follow sequential streams
+  // on their own, so software prefetches are only inserted for accesses whose
+  // stride is too large for them. The IP-based stride prefetcher of the
+  // Intel big cores tracks strides of up to 2KB; the Atom family and Knights
+  // Landing prefetchers give up much earlier. The distance (in instructions)
+  // roughly covers a miss to DRAM at the sustained IPC of each core.
+  enum PrefetchKind { NoPrefetch, BigCore, SmallCore, ManyCore, AMDCore };
+  PrefetchKind Kind = StringSwitch<PrefetchKind>(CPU)
+                          .Cases("nehalem", "corei7", "westmere", BigCore)
+                          .Cases("sandybridge", "corei7-avx", BigCore)
+                          .Cases("ivybridge", "core-avx-i", BigCore)
+                          .Cases("haswell", "core-avx2", "broadwell", BigCore)
+                          .Cases("skylake", "skylake-avx512", "skx", BigCore)
+                          .Case("cannonlake", BigCore)
+                          .Cases("atom", "bonnell", SmallCore)
+                          .Cases("silvermont", "slm", SmallCore)
+                          .Case("knl", ManyCore)
+                          .Cases("bdver1", "bdver2", "bdver3", AMDCore)
+                          .Cases("bdver4", "btver2", "znver1", AMDCore)
+                          .Default(NoPrefetch);
+
+  switch (Kind) {
+  case NoPrefetch:
+    break;
+  case BigCore:
+    PrefetchDistance = 800;
+    MinPrefetchStride = 2048;
+    MaxPrefetchIterationsAhead = 16;
+    break;
+  case SmallCore:
+    PrefetchDistance = 300;
+    MinPrefetchStride = 512;
+    MaxPrefetchIterationsAhead = 8;
+    break;
+  case ManyCore:
+    PrefetchDistance = 400;
+    MinPrefetchStride = 512;
+    MaxPrefetchIterationsAhead = 8;
+    break;
+  case AMDCore:
+    PrefetchDistance = 600;
+    MinPrefetchStride = 1024;
+    MaxPrefetchIterationsAhead = 8;
+    break;
+  }
 }
 
 X86Subtarget &X86Subtarget::initializeSubtargetDependencies(StringRef CPU,
@@ -314,7 +369,7 @@ X86Subtarget::X86Subtarget(const Triple &TT, StringRef CPU, StringRef FS,
       In16BitMode(TargetTriple.getArch() == Triple::x86 &&
                   TargetTriple.getEnvironment() == Triple::CODE16),
       TSInfo(), InstrInfo(initializeSubtargetDependencies(CPU, FS)),
-      TLInfo(TM, *this), FrameLowering(*this, getStackAlignment()) {
+      TLInfo(TM, *this), FrameLowering(*this, getStackAlignment()), GISel() {
   // Determine the PICStyle based on the target selected.
   if (!isPositionIndependent())
     setPICStyle(PICStyles::None);
@@ -328,6 +383,16 @@ X86Subtarget::X86Subtarget(const Triple &TT, StringRef CPU, StringRef FS,
     setPICStyle(PICStyles::GOT);
 }
 
+const CallLowering *X86Subtarget::getCallLowering() const {
+  assert(GISel && "Access to GlobalISel APIs not set");
+  return GISel->getCallLowering();
+}
+
+const RegisterBankInfo *X86Subtarget::getRegBankInfo() const {
+  assert(GISel && "Access to GlobalISel APIs not set");
+  return GISel->getRegBankInfo();
+}
+
 bool X86Subtarget::enableEarlyIfConversion() const {
   return hasCMov() && X86EarlyIfConv;
 }
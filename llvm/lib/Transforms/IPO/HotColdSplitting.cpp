@@ -0,0 +1,340 @@
+//===- HotColdSplitting.cpp - Outline cold regions of functions -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass outlines the cold regions of functions into separate functions.
+// MachineBlockPlacement only moves the cold blocks to the end of their
+// function, so the error handling paths of hot functions still share cache
+// lines and pages with the hot code. Outlining them into functions placed in
+// the .text.unlikely section moves them away from the hot code entirely.
+//
+// A block is cold if its profile count is cold according to the profile
+// summary, or if it is unlikely to be executed at all: it ends in unreachable
+// or calls a function marked cold. Blocks which can only be reached from cold
+// blocks, or which can only lead to cold blocks, are cold too. A cold region is
+// a cold block together with the cold blocks it dominates, as long as it can
+// only be entered through that block.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/HotColdSplitting.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/EHPersonalities.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/ProfileData/ProfileCommon.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/Utils/CodeExtractor.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "hotcoldsplit"
+
+STATISTIC(NumColdRegionsOutlined, "Number of cold regions outlined");
+
+static cl::opt<unsigned> MinOutliningSize(
+    "hotcoldsplit-min-size", cl::init(3), cl::Hidden,
+    cl::desc("Minimum number of instructions in a cold region for it to be "
+             "outlined"));
+
+typedef function_ref<BlockFrequencyInfo &(Function &)> BFIGetterTy;
+
+/// Returns true if \p BB is unlikely to be executed, whatever the profile.
+static bool isUnlikelyExecuted(const BasicBlock &BB) {
+  if (isa<UnreachableInst>(BB.getTerminator()))
+    return true;
+  for (const Instruction &I : BB)
+    if (ImmutableCallSite CS = ImmutableCallSite(&I))
+      if (CS.hasFnAttr(Attribute::Cold))
+        return true;
+  return false;
+}
+
+/// Returns true if \p BB can be moved to an outlined function. The exception
+/// handling blocks must stay in the function of their landing pads, and the
+/// returns must stay in the function they return from.
+static bool mayOutlineBlock(BasicBlock &BB) {
+  const TerminatorInst *TI = BB.getTerminator();
+  if (TI->isExceptional() || isa<ReturnInst>(TI))
+    return false;
+  return CodeExtractor(&BB).isEligible();
+}
+
+namespace {
+class HotColdSplitting {
+public:
+  HotColdSplitting(ProfileSummaryInfo *PSI, BFIGetterTy GetBFI)
+      : PSI(PSI), GetBFI(GetBFI) {}
+  bool run(Module &M);
+
+private:
+  bool shouldOutlineFrom(const Function &F) const;
+  void findColdBlocks(Function &F, SmallPtrSetImpl<BasicBlock *> &Cold);
+  bool outlineColdRegions(Function &F);
+  Function *outlineRegion(ArrayRef<BasicBlock *> Region);
+
+  ProfileSummaryInfo *PSI;
+  BFIGetterTy GetBFI;
+};
+} // end anonymous namespace
+
+bool HotColdSplitting::shouldOutlineFrom(const Function &F) const {
+  if (F.isDeclaration() || F.hasFnAttribute(Attribute::OptimizeNone))
+    return false;
+
+  // Cold functions, including the ones outlined by this pass, are left to
+  // the code generator as a whole.
+  if (PSI->isColdFunction(&F))
+    return false;
+
+  // Don't move code out of a section chosen by the user.
+  if (F.hasSection())
+    return false;
+
+  // The blocks of a funclet must stay in the function of its pad.
+  if (F.hasPersonalityFn() &&
+      isFuncletEHPersonality(classifyEHPersonality(F.getPersonalityFn())))
+    return false;
+
+  return true;
+}
+
+void HotColdSplitting::findColdBlocks(Function &F,
+                                      SmallPtrSetImpl<BasicBlock *> &Cold) {
+  BasicBlock *Entry = &F.getEntryBlock();
+  BlockFrequencyInfo *BFI = F.getEntryCount() ? &GetBFI(F) : nullptr;
+  for (BasicBlock &BB : F) {
+    if (&BB == Entry)
+      continue;
+    if (isUnlikelyExecuted(BB)) {
+      Cold.insert(&BB);
+      continue;
+    }
+    if (BFI)
+      if (Optional<uint64_t> Count = BFI->getBlockProfileCount(&BB))
+        if (PSI->isColdCount(*Count))
+          Cold.insert(&BB);
+  }
+
+  // Propagate the coldness to the blocks only reached from cold blocks and to
+  // the blocks only leading to cold blocks.
+  auto IsCold = [&](BasicBlock *BB) { return Cold.count(BB) != 0; };
+  bool Changed;
+  do {
+    Changed = false;
+    for (BasicBlock &BB : F) {
+      if (&BB == Entry || Cold.count(&BB))
+        continue;
+      bool AllPredsCold = pred_begin(&BB) != pred_end(&BB) &&
+                          all_of(predecessors(&BB), IsCold);
+      bool AllSuccsCold = succ_begin(&BB) != succ_end(&BB) &&
+                          all_of(successors(&BB), IsCold);
+      if (AllPredsCold || AllSuccsCold) {
+        Cold.insert(&BB);
+        Changed = true;
+      }
+    }
+  } while (Changed);
+}
+
+Function *HotColdSplitting::outlineRegion(ArrayRef<BasicBlock *> Region) {
+  Function *OrigF = Region.front()->getParent();
+  Module *M = OrigF->getParent();
+
+  // Keep a location for the call replacing the region.
+  DebugLoc DL;
+  for (const Instruction &I : *Region.front())
+    if ((DL = I.getDebugLoc()))
+      break;
+
+  // The dominator tree is not handed to the extractor: it cannot update it when
+  // it splits the phis off a header entered from several blocks and the rest
+  // of the header has no single successor, as in a shared error block ending
+  // in unreachable.
+  Function *OutF = CodeExtractor(Region).extractCodeRegion();
+  if (!OutF)
+    return nullptr;
+
+  OutF->addFnAttr(Attribute::Cold);
+  OutF->addFnAttr(Attribute::MinSize);
+  OutF->addFnAttr(Attribute::NoInline);
+  if (Triple(M->getTargetTriple()).isOSBinFormatELF())
+    OutF->setSection((Twine(".text") + getUnlikelySectionPrefix()).str());
+
+  // The outlined function has no subprogram of its own, so the variables of
+  // the original function cannot be described in it.
+  for (BasicBlock &BB : *OutF)
+    for (auto I = BB.begin(), E = BB.end(); I != E;) {
+      Instruction *Inst = &*I++;
+      if (isa<DbgInfoIntrinsic>(Inst))
+        Inst->eraseFromParent();
+    }
+
+  // A region without exits used to end in unreachable, and so does the call
+  // replacing it.
+  bool Returns = any_of(*OutF, [](const BasicBlock &BB) {
+    return isa<ReturnInst>(BB.getTerminator());
+  });
+  if (!Returns)
+    OutF->setDoesNotReturn();
+
+  for (User *U : OutF->users())
+    if (auto *CI = dyn_cast<CallInst>(U)) {
+      if (!CI->getDebugLoc())
+        CI->setDebugLoc(DL);
+      if (!Returns) {
+        TerminatorInst *TI = CI->getParent()->getTerminator();
+        new UnreachableInst(M->getContext(), TI);
+        TI->eraseFromParent();
+      }
+    }
+
+  DEBUG(dbgs() << "HotColdSplitting: outlined " << OutF->getName()
+               << " from " << OrigF->getName() << "\n");
+  ++NumColdRegionsOutlined;
+  return OutF;
+}
+
+bool HotColdSplitting::outlineColdRegions(Function &F) {
+  SmallPtrSet<BasicBlock *, 16> Cold;
+  findColdBlocks(F, Cold);
+  if (Cold.empty())
+    return false;
+
+  DominatorTree DT(F);
+  SmallPtrSet<BasicBlock *, 16> Assigned;
+  SmallVector<SmallVector<BasicBlock *, 8>, 4> Regions;
+  ReversePostOrderTraversal<Function *> RPOT(&F);
+  for (BasicBlock *Header : RPOT) {
+    if (!Cold.count(Header) || Assigned.count(Header) ||
+        !mayOutlineBlock(*Header))
+      continue;
+
+    // Grow the region over the cold blocks dominated by its header.
+    SetVector<BasicBlock *> Region;
+    SmallVector<BasicBlock *, 8> Worklist;
+    Region.insert(Header);
+    Worklist.push_back(Header);
+    while (!Worklist.empty()) {
+      BasicBlock *BB = Worklist.pop_back_val();
+      for (BasicBlock *Succ : successors(BB))
+        if (Cold.count(Succ) && !Assigned.count(Succ) &&
+            DT.dominates(Header, Succ) && mayOutlineBlock(*Succ) &&
+            Region.insert(Succ))
+          Worklist.push_back(Succ);
+    }
+
+    // Drop the blocks which can be entered from outside the region, until
+    // the header is its only entry.
+    bool Changed;
+    do {
+      Changed = false;
+      SmallVector<BasicBlock *, 8> Entered;
+      for (BasicBlock *BB : Region)
+        if (BB != Header && any_of(predecessors(BB), [&](BasicBlock *Pred) {
+              return !Region.count(Pred);
+            }))
+          Entered.push_back(BB);
+      for (BasicBlock *BB : Entered)
+        Changed |= Region.remove(BB);
+    } while (Changed);
+
+    unsigned Size = 0;
+    for (BasicBlock *BB : Region)
+      for (Instruction &I : *BB)
+        if (!isa<PHINode>(I) && !isa<DbgInfoIntrinsic>(I))
+          ++Size;
+    if (Size < MinOutliningSize)
+      continue;
+
+    Assigned.insert(Region.begin(), Region.end());
+    Regions.emplace_back(Region.begin(), Region.end());
+  }
+
+  // The regions are disjoint, so extracting one leaves the others intact.
+  bool Changed = false;
+  for (auto &Region : Regions) {
+    if (outlineRegion(Region))
+      Changed = true;
+  }
+  return Changed;
+}
+
+bool HotColdSplitting::run(Module &M) {
+  // Outlining adds functions to the module, visit the original ones only.
+  SmallVector<Function *, 16> Worklist;
+  for (Function &F : M)
+    if (shouldOutlineFrom(F))
+      Worklist.push_back(&F);
+
+  bool Changed = false;
+  for (Function *F : Worklist)
+    Changed |= outlineColdRegions(*F);
+  return Changed;
+}
+
+PreservedAnalyses HotColdSplittingPass::run(Module &M,
+                                            ModuleAnalysisManager &AM) {
+  auto &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  ProfileSummaryInfo *PSI = &AM.getResult<ProfileSummaryAnalysis>(M);
+  auto GetBFI = [&FAM](Function &F) -> BlockFrequencyInfo & {
+    return FAM.getResult<BlockFrequencyAnalysis>(F);
+  };
+  if (!HotColdSplitting(PSI, GetBFI).run(M))
+    return PreservedAnalyses::all();
+  return PreservedAnalyses::none();
+}
+
+namespace {
+struct HotColdSplittingLegacyPass : public ModulePass {
+  static char ID; // Pass identification, replacement for typeid
+  HotColdSplittingLegacyPass() : ModulePass(ID) {
+    initializeHotColdSplittingLegacyPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override {
+    if (skipModule(M))
+      return false;
+    ProfileSummaryInfo *PSI =
+        getAnalysis<ProfileSummaryInfoWrapperPass>().getPSI(M);
+    auto GetBFI = [this](Function &F) -> BlockFrequencyInfo & {
+      return this->getAnalysis<BlockFrequencyInfoWrapperPass>(F).getBFI();
+    };
+    return HotColdSplitting(PSI, GetBFI).run(M);
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<BlockFrequencyInfoWrapperPass>();
+    AU.addRequired<ProfileSummaryInfoWrapperPass>();
+  }
+};
+} // end anonymous namespace
+
+char HotColdSplittingLegacyPass::ID = 0;
+INITIALIZE_PASS_BEGIN(HotColdSplittingLegacyPass, "hotcoldsplit",
+                      "Hot Cold Splitting", false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ProfileSummaryInfoWrapperPass)
+INITIALIZE_PASS_END(HotColdSplittingLegacyPass, "hotcoldsplit",
+                    "Hot Cold Splitting", false, false)
+
+ModulePass *llvm::createHotColdSplittingPass() {
+  return new HotColdSplittingLegacyPass();
+}
@@ -0,0 +1,269 @@
+//===- ParallelOptimize.cpp - Run function passes on several threads ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements running per-function optimizations on the functions of
+// a module in parallel, on partitions of the module in separate contexts.
+//
+// Every partition gets the definitions of all the global variables, so that
+// the optimizations see the same initializers whatever the partition of the
+// function they optimize. Once optimized, the partitions are parsed back into
+// the context of the module and linked into it, after turning everything but
+// their function definitions into declarations. Linking resolves global values
+// by name, so for the duration of the linking the unnamed global values of the
+// module get a name and the local ones get external linkage. The global values
+// which the optimizations created, such as the lookup tables of SimplifyCFG,
+// keep their definitions and their local linkage, so that each partition
+// brings its own, renamed if needed.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/ParallelOptimize.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <algorithm>
+
+using namespace llvm;
+
+/// Returns whether the function definitions of \p M can be moved to another
+/// module and back.
+static bool canMoveFunctions(const Module &M) {
+  // Module cloning and linking do not handle ifuncs.
+  if (!M.ifunc_empty())
+    return false;
+
+  // A blockaddress refers to a block of one specific function body, which
+  // would be left behind when the body is replaced.
+  for (const Function &F : M)
+    for (const BasicBlock &BB : F)
+      if (BB.hasAddressTaken())
+        return false;
+  return true;
+}
+
+static unsigned getInstructionCount(const Function &F) {
+  unsigned Count = 0;
+  for (const BasicBlock &BB : F)
+    Count += BB.size();
+  return Count;
+}
+
+static std::unique_ptr<Module> parsePartition(const SmallString<0> &BC,
+                                              LLVMContext &Ctx) {
+  ErrorOr<std::unique_ptr<Module>> MOrErr = parseBitcodeFile(
+      MemoryBufferRef(StringRef(BC.data(), BC.size()), "<partition>"), Ctx);
+  if (!MOrErr)
+    report_fatal_error("Failed to read bitcode");
+  return std::move(MOrErr.get());
+}
+
+/// Turn everything but the function definitions of \p MPart into
+/// declarations, so that linking it only brings in the functions. The global
+/// values which are not among \p ModuleNames, the names of the global values
+/// of the module, were created by the optimizations and are left alone.
+///
+/// The subprograms of the functions are detached from their compile unit,
+/// which the module already has; the index of the compile unit of each
+/// function is added to \p SubprogramUnits.
+static void stripToFunctions(
+    Module &MPart, const StringSet<> &ModuleNames,
+    std::vector<std::pair<std::string, unsigned>> &SubprogramUnits) {
+  NamedMDNode *CUs = MPart.getNamedMetadata("llvm.dbg.cu");
+  for (Function &F : MPart) {
+    if (F.isDeclaration() || !ModuleNames.count(F.getName()))
+      continue;
+    F.setLinkage(GlobalValue::ExternalLinkage);
+    F.setComdat(nullptr);
+
+    DISubprogram *SP = F.getSubprogram();
+    if (!SP || !SP->getUnit() || !CUs)
+      continue;
+    for (unsigned I = 0, E = CUs->getNumOperands(); I != E; ++I)
+      if (CUs->getOperand(I) == SP->getUnit()) {
+        SubprogramUnits.push_back(std::make_pair(F.getName(), I));
+        SP->replaceUnit(nullptr);
+        break;
+      }
+  }
+
+  for (auto I = MPart.global_begin(), E = MPart.global_end(); I != E;) {
+    GlobalVariable &GV = *I++;
+    if (GV.use_empty()) {
+      GV.eraseFromParent();
+      continue;
+    }
+    if (!ModuleNames.count(GV.getName()))
+      continue;
+    GV.setInitializer(nullptr);
+    GV.setComdat(nullptr);
+    GV.clearMetadata();
+    GV.setLinkage(GlobalValue::ExternalLinkage);
+  }
+
+  while (!MPart.named_metadata_empty())
+    MPart.eraseNamedMetadata(&*MPart.named_metadata_begin());
+  MPart.setModuleInlineAsm("");
+}
+
+bool llvm::optimizeFunctionsInParallel(
+    Module &M, unsigned ThreadCount,
+    const std::function<void(Module &MPart)> &OptimizePartition) {
+  std::vector<Function *> Definitions;
+  for (Function &F : M)
+    if (!F.isDeclaration())
+      Definitions.push_back(&F);
+  unsigned PartitionCount =
+      std::min<size_t>(ThreadCount, Definitions.size());
+  if (PartitionCount < 2 || !canMoveFunctions(M))
+    return false;
+
+  // Assign the functions to partitions, largest first, each to the partition
+  // with the fewest instructions so far.
+  DenseMap<const Function *, unsigned> FunctionPartition;
+  {
+    std::vector<std::pair<unsigned, Function *>> Sizes;
+    for (Function *F : Definitions)
+      Sizes.push_back(std::make_pair(getInstructionCount(*F), F));
+    std::stable_sort(Sizes.begin(), Sizes.end(),
+                     [](const std::pair<unsigned, Function *> &LHS,
+                        const std::pair<unsigned, Function *> &RHS) {
+                       return LHS.first > RHS.first;
+                     });
+    std::vector<uint64_t> Load(PartitionCount);
+    for (const auto &Size : Sizes) {
+      unsigned P = std::min_element(Load.begin(), Load.end()) - Load.begin();
+      Load[P] += Size.first;
+      FunctionPartition[Size.second] = P;
+    }
+  }
+
+  std::vector<GlobalValue *> GlobalValues;
+  for (Function &F : M)
+    GlobalValues.push_back(&F);
+  for (GlobalVariable &GV : M.globals())
+    GlobalValues.push_back(&GV);
+  for (GlobalAlias &GA : M.aliases())
+    GlobalValues.push_back(&GA);
+
+  // Name the unnamed global values before cloning, so that the partitions
+  // refer to them by the same name.
+  std::vector<std::string> TemporaryNames;
+  for (GlobalValue *GV : GlobalValues)
+    if (!GV->hasName()) {
+      GV->setName("__llvm_parallel_unnamed");
+      TemporaryNames.push_back(GV->getName());
+    }
+
+  std::vector<SmallString<0>> Bitcode(PartitionCount);
+  for (unsigned I = 0; I != PartitionCount; ++I) {
+    ValueToValueMapTy VMap;
+    std::unique_ptr<Module> MPart =
+        CloneModule(&M, VMap, [&](const GlobalValue *GV) {
+          if (isa<GlobalVariable>(GV))
+            return true;
+          auto It = FunctionPartition.find(dyn_cast<Function>(GV));
+          return It != FunctionPartition.end() && It->second == I;
+        });
+    raw_svector_ostream OS(Bitcode[I]);
+    WriteBitcodeToFile(MPart.get(), OS);
+  }
+
+  // Each partition is read into, optimized in, and written back from its own
+  // context.
+  {
+    ThreadPool Pool(PartitionCount);
+    for (unsigned I = 0; I != PartitionCount; ++I)
+      Pool.async([&OptimizePartition, &Bitcode, I] {
+        LLVMContext Ctx;
+        std::unique_ptr<Module> MPart = parsePartition(Bitcode[I], Ctx);
+        OptimizePartition(*MPart);
+        Bitcode[I].clear();
+        raw_svector_ostream OS(Bitcode[I]);
+        WriteBitcodeToFile(MPart.get(), OS);
+      });
+  }
+
+  // Remember what linking changes, and prepare the module to receive the
+  // optimized function definitions.
+  struct SavedGlobalValue {
+    std::string Name;
+    GlobalValue::LinkageTypes Linkage;
+    Comdat *C;
+  };
+  std::vector<SavedGlobalValue> Saved;
+  for (GlobalValue *GV : GlobalValues) {
+    Function *F = dyn_cast<Function>(GV);
+    if (!GV->hasLocalLinkage() && !(F && !F->isDeclaration()))
+      continue;
+    Saved.push_back({GV->getName(), GV->getLinkage(),
+                     F ? F->getComdat() : nullptr});
+    if (F && !F->isDeclaration()) {
+      F->deleteBody();
+      F->setComdat(nullptr);
+    }
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+  }
+  std::vector<std::string> FunctionOrder;
+  for (Function &F : M)
+    FunctionOrder.push_back(F.getName());
+  StringSet<> ModuleNames;
+  for (GlobalValue *GV : GlobalValues)
+    ModuleNames.insert(GV->getName());
+
+  std::vector<std::pair<std::string, unsigned>> SubprogramUnits;
+  for (unsigned I = 0; I != PartitionCount; ++I) {
+    std::unique_ptr<Module> MPart = parsePartition(Bitcode[I], M.getContext());
+    Bitcode[I].clear();
+    stripToFunctions(*MPart, ModuleNames, SubprogramUnits);
+    if (Linker::linkModules(M, std::move(MPart)))
+      report_fatal_error("Failed to link optimized functions into the module");
+  }
+
+  // Restore what linking changed.
+  if (NamedMDNode *CUs = M.getNamedMetadata("llvm.dbg.cu"))
+    for (const auto &SU : SubprogramUnits)
+      M.getFunction(SU.first)->getSubprogram()->replaceUnit(
+          cast<DICompileUnit>(CUs->getOperand(SU.second)));
+
+  // Linking appended the function definitions to the module; move everything
+  // back in its original order, followed by the declarations the
+  // optimizations added.
+  std::vector<Function *> Order;
+  SmallPtrSet<Function *, 16> Known;
+  for (const std::string &Name : FunctionOrder) {
+    Order.push_back(M.getFunction(Name));
+    Known.insert(Order.back());
+  }
+  for (Function &F : M)
+    if (!Known.count(&F))
+      Order.push_back(&F);
+  for (Function *F : Order)
+    M.getFunctionList().splice(M.end(), M.getFunctionList(), F->getIterator());
+  for (const SavedGlobalValue &S : Saved) {
+    GlobalValue *GV = M.getNamedValue(S.Name);
+    GV->setLinkage(S.Linkage);
+    if (Function *F = dyn_cast<Function>(GV))
+      F->setComdat(S.C);
+  }
+  for (const std::string &Name : TemporaryNames)
+    M.getNamedValue(Name)->setName("");
+
+  return true;
+}
@@ -13,12 +13,14 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/CFG.h"
 #include "llvm/Analysis/IndirectCallPromotionAnalysis.h"
 #include "llvm/Analysis/IndirectCallSiteVisitor.h"
+#include "llvm/Analysis/TypeMetadataUtils.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/IRBuilder.h"
@@ -44,6 +46,8 @@ using namespace llvm;
 
 STATISTIC(NumOfPGOICallPromotion, "Number of indirect call promotions.");
 STATISTIC(NumOfPGOICallsites, "Number of indirect call candidate sites.");
+STATISTIC(NumOfPGOVTableCmpPromotion,
+          "Number of virtual call promotions comparing vtable pointers.");
 
 // Command line option to disable indirect-call promotion with the default as
 // false. This is for debug purpose.
@@ -85,6 +89,14 @@ static cl::opt<bool> ICPInvokeOnly("icp-invoke-only", cl::init(false),
                                    cl::desc("Run indirect-call promotion for "
                                             "invoke instruction only"));
 
+// If the option is set to true, virtual calls known from the type metadata are
+// promoted by comparing the vtable pointer rather than the function pointer
+// loaded from it, whenever a single vtable provides the promoted target.
+static cl::opt<bool>
+    ICPVTableCmp("icp-vtable-cmp", cl::init(true), cl::Hidden,
+                 cl::desc("Promote virtual calls by comparing vtable "
+                          "pointers"));
+
 // Dump the function level IR if the transformation happened in this
 // function. For debug use only.
 static cl::opt<bool>
@@ -126,6 +138,39 @@ ModulePass *llvm::createPGOIndirectCallPromotionLegacyPass(bool InLTO) {
 }
 
 namespace {
+// The virtual calls of a module, found from the llvm.type.test intrinsics and
+// the type metadata of the vtables. This is used to guard a promoted virtual
+// call with a comparison of the vtable pointer: the function pointer then only
+// needs to be loaded when the promoted target is not called.
+class VirtualCallInfo {
+private:
+  // A virtual call: the vtable pointer it loads its callee from, the type
+  // identifier of the vtable and the offset of the callee from the address
+  // point of the vtable.
+  struct VirtualCall {
+    Value *VTablePtr;
+    Metadata *TypeId;
+    uint64_t Offset;
+  };
+
+  const DataLayout &DL;
+  DenseMap<const Instruction *, VirtualCall> Calls;
+
+  // The vtables and the offsets of their address points for each type
+  // identifier.
+  DenseMap<Metadata *, std::vector<std::pair<GlobalVariable *, uint64_t>>>
+      TypeIdMembers;
+
+public:
+  VirtualCallInfo(Module &M);
+
+  // If Inst is a virtual call and a single vtable address point provides
+  // Target in the slot Inst loads from, return that address point and set
+  // VTablePtr to the vtable pointer of the call. Return null otherwise.
+  Constant *getVTableAddressPoint(const Instruction *Inst, Function *Target,
+                                  Value *&VTablePtr) const;
+};
+
 // The class for main data structure to promote indirect calls to conditional
 // direct calls.
 class ICallPromotionFunc {
@@ -137,6 +182,9 @@ private:
   // defines.
   InstrProfSymtab *Symtab;
 
+  // The virtual calls of the module.
+  const VirtualCallInfo *VCallInfo;
+
   enum TargetStatus {
     OK,                   // Should be able to promote.
     NotAvailableInModule, // Cannot find the target in current module.
@@ -205,13 +253,102 @@ private:
   ICallPromotionFunc &operator=(const ICallPromotionFunc &other) = delete;
 
 public:
-  ICallPromotionFunc(Function &Func, Module *Modu, InstrProfSymtab *Symtab)
-      : F(Func), M(Modu), Symtab(Symtab) {
+  ICallPromotionFunc(Function &Func, Module *Modu, InstrProfSymtab *Symtab,
+                     const VirtualCallInfo *VCallInfo)
+      : F(Func), M(Modu), Symtab(Symtab), VCallInfo(VCallInfo) {
   }
   bool processFunction();
 };
 } // end anonymous namespace
 
+VirtualCallInfo::VirtualCallInfo(Module &M) : DL(M.getDataLayout()) {
+  Function *TypeTestFunc =
+      M.getFunction(Intrinsic::getName(Intrinsic::type_test));
+  if (!TypeTestFunc)
+    return;
+
+  // Only the type tests feeding an llvm.assume tell that the vtable pointer
+  // is a vtable of the tested type.
+  for (const Use &U : TypeTestFunc->uses()) {
+    auto *CI = dyn_cast<CallInst>(U.getUser());
+    if (!CI)
+      continue;
+    SmallVector<DevirtCallSite, 1> DevirtCalls;
+    SmallVector<CallInst *, 1> Assumes;
+    findDevirtualizableCallsForTypeTest(DevirtCalls, Assumes, CI);
+    if (Assumes.empty())
+      continue;
+    Metadata *TypeId =
+        cast<MetadataAsValue>(CI->getArgOperand(1))->getMetadata();
+    for (DevirtCallSite &Call : DevirtCalls)
+      Calls[Call.CS.getInstruction()] = {CI->getArgOperand(0), TypeId,
+                                         Call.Offset};
+  }
+  if (Calls.empty())
+    return;
+
+  SmallVector<MDNode *, 2> Types;
+  for (GlobalVariable &GV : M.globals()) {
+    Types.clear();
+    GV.getMetadata(LLVMContext::MD_type, Types);
+    for (MDNode *Type : Types) {
+      uint64_t Offset =
+          cast<ConstantInt>(
+              cast<ConstantAsMetadata>(Type->getOperand(0))->getValue())
+              ->getZExtValue();
+      TypeIdMembers[Type->getOperand(1).get()].push_back({&GV, Offset});
+    }
+  }
+}
+
+Constant *VirtualCallInfo::getVTableAddressPoint(const Instruction *Inst,
+                                                 Function *Target,
+                                                 Value *&VTablePtr) const {
+  auto CallIt = Calls.find(Inst);
+  if (CallIt == Calls.end())
+    return nullptr;
+  auto MembersIt = TypeIdMembers.find(CallIt->second.TypeId);
+  if (MembersIt == TypeIdMembers.end())
+    return nullptr;
+
+  GlobalVariable *VTable = nullptr;
+  uint64_t AddressPoint = 0;
+  for (auto &Member : MembersIt->second) {
+    GlobalVariable *GV = Member.first;
+    if (!GV->isConstant() || !GV->hasDefinitiveInitializer())
+      continue;
+    auto *Init = dyn_cast<ConstantArray>(GV->getInitializer());
+    if (!Init)
+      continue;
+
+    uint64_t ElemSize =
+        DL.getTypeAllocSize(Init->getType()->getElementType());
+    uint64_t SlotOffset = Member.second + CallIt->second.Offset;
+    if (SlotOffset % ElemSize != 0 ||
+        SlotOffset / ElemSize >= Init->getNumOperands())
+      continue;
+    if (Init->getOperand(SlotOffset / ElemSize)->stripPointerCasts() != Target)
+      continue;
+
+    // If several vtables provide the target, comparing the function pointer
+    // catches more calls than comparing with any one of the vtables.
+    if (VTable)
+      return nullptr;
+    VTable = GV;
+    AddressPoint = Member.second;
+  }
+  if (!VTable)
+    return nullptr;
+
+  VTablePtr = CallIt->second.VTablePtr;
+  LLVMContext &Ctx = VTable->getContext();
+  Type *Int8Ty = Type::getInt8Ty(Ctx);
+  Constant *VTableI8 = ConstantExpr::getBitCast(
+      VTable, Int8Ty->getPointerTo(VTable->getType()->getAddressSpace()));
+  return ConstantExpr::getInBoundsGetElementPtr(
+      Int8Ty, VTableI8, ConstantInt::get(Type::getInt64Ty(Ctx), AddressPoint));
+}
+
 ICallPromotionFunc::TargetStatus
 ICallPromotionFunc::isPromotionLegal(Instruction *Inst, uint64_t Target,
                                      Function *&TargetFunction) {
@@ -306,22 +443,20 @@ ICallPromotionFunc::getPromotionCandidatesForCallSite(
   return Ret;
 }
 
-// Create a diamond structure for If_Then_Else. Also update the profile
-// count. Do the fix-up for the invoke instruction.
-static void createIfThenElse(Instruction *Inst, Function *DirectCallee,
-                             uint64_t Count, uint64_t TotalCount,
-                             BasicBlock **DirectCallBB,
+// Create a diamond structure for If_Then_Else, taking the then branch when
+// Actual equals Expected. Also update the profile count. Do the fix-up for the
+// invoke instruction.
+static void createIfThenElse(Instruction *Inst, Value *Actual,
+                             Constant *Expected, uint64_t Count,
+                             uint64_t TotalCount, BasicBlock **DirectCallBB,
                              BasicBlock **IndirectCallBB,
                              BasicBlock **MergeBB) {
-  CallSite CS(Inst);
-  Value *OrigCallee = CS.getCalledValue();
-
   IRBuilder<> BBBuilder(Inst);
   LLVMContext &Ctx = Inst->getContext();
   Value *BCI1 =
-      BBBuilder.CreateBitCast(OrigCallee, Type::getInt8PtrTy(Ctx), "");
+      BBBuilder.CreatePointerCast(Actual, Type::getInt8PtrTy(Ctx), "");
   Value *BCI2 =
-      BBBuilder.CreateBitCast(DirectCallee, Type::getInt8PtrTy(Ctx), "");
+      BBBuilder.CreatePointerCast(Expected, Type::getInt8PtrTy(Ctx), "");
   Value *PtrCmp = BBBuilder.CreateICmpEQ(BCI1, BCI2, "");
 
   uint64_t ElseCount = TotalCount - Count;
@@ -490,6 +625,41 @@ static Instruction *createDirectCallInst(const Instruction *Inst,
   return insertCallRetCast(Inst, NewInst, DirectCallee);
 }
 
+// When a virtual call is guarded by a vtable comparison, the function pointer
+// it loads from the vtable is only needed when the comparison fails. Sink the
+// load, and the address computation and casts that only feed it, from the
+// block that ends with the comparison to the indirect call.
+static void sinkCalleeLoad(Instruction *Inst, BasicBlock *CmpBB) {
+  SmallVector<Instruction *, 4> Chain;
+  Value *V = CallSite(Inst).getCalledValue();
+  while (auto *I = dyn_cast<Instruction>(V)) {
+    if (I->getParent() != CmpBB || !I->hasOneUse())
+      break;
+    if (auto *LI = dyn_cast<LoadInst>(I)) {
+      if (!LI->isSimple())
+        break;
+      // The slot cannot change between its load and the call, unless
+      // something in between writes to memory.
+      for (auto It = std::next(LI->getIterator()), E = CmpBB->end(); It != E;
+           ++It)
+        if (It->mayWriteToMemory())
+          return;
+      Chain.push_back(LI);
+      V = LI->getPointerOperand();
+    } else if (isa<BitCastInst>(I) || isa<GetElementPtrInst>(I)) {
+      Chain.push_back(I);
+      V = I->getOperand(0);
+    } else
+      break;
+  }
+
+  // Only sink anything if the load itself is sunk.
+  while (!Chain.empty() && !isa<LoadInst>(Chain.back()))
+    Chain.pop_back();
+  for (Instruction *I : reverse(Chain))
+    I->moveBefore(Inst);
+}
+
 // Create a PHI to unify the return values of calls.
 static void insertCallRetPHI(Instruction *Inst, Instruction *CallResult,
                              Function *DirectCallee) {
@@ -522,20 +692,32 @@ static void insertCallRetPHI(Instruction *Inst, Instruction *CallResult,
 //     else
 //        Ret2 = (*Foo)(Args);
 //     Ret = phi(Ret1, Ret2);
+// For a virtual call Foo = VTable[N], where DirectCallee is only found in the
+// vtable VT, the condition becomes VTable == VT instead, and the load of Foo
+// moves to the else branch.
 // It adds type casts for the args do not match the parameters and the return
 // value. Branch weights metadata also updated.
 void ICallPromotionFunc::promote(Instruction *Inst, Function *DirectCallee,
                                  uint64_t Count, uint64_t TotalCount) {
   assert(DirectCallee != nullptr);
   BasicBlock *BB = Inst->getParent();
-  // Just to suppress the non-debug build warning.
-  (void)BB;
   DEBUG(dbgs() << "\n\n== Basic Block Before ==\n");
   DEBUG(dbgs() << *BB << "\n");
 
+  Value *VTablePtr = nullptr;
+  Constant *AddressPoint = nullptr;
+  if (ICPVTableCmp && VCallInfo)
+    AddressPoint =
+        VCallInfo->getVTableAddressPoint(Inst, DirectCallee, VTablePtr);
+
   BasicBlock *DirectCallBB, *IndirectCallBB, *MergeBB;
-  createIfThenElse(Inst, DirectCallee, Count, TotalCount, &DirectCallBB,
-                   &IndirectCallBB, &MergeBB);
+  if (AddressPoint)
+    createIfThenElse(Inst, VTablePtr, AddressPoint, Count, TotalCount,
+                     &DirectCallBB, &IndirectCallBB, &MergeBB);
+  else
+    createIfThenElse(Inst, CallSite(Inst).getCalledValue(), DirectCallee,
+                     Count, TotalCount, &DirectCallBB, &IndirectCallBB,
+                     &MergeBB);
 
   Instruction *NewInst =
       createDirectCallInst(Inst, DirectCallee, DirectCallBB, MergeBB);
@@ -544,6 +726,10 @@ void ICallPromotionFunc::promote(Instruction *Inst, Function *DirectCallee,
   Inst->removeFromParent();
   IndirectCallBB->getInstList().insert(IndirectCallBB->getFirstInsertionPt(),
                                        Inst);
+  if (AddressPoint) {
+    sinkCalleeLoad(Inst, BB);
+    NumOfPGOVTableCmpPromotion++;
+  }
 
   if (InvokeInst *II = dyn_cast<InvokeInst>(Inst)) {
     // At this point, the original indirect invoke instruction has the original
@@ -570,7 +756,8 @@ void ICallPromotionFunc::promote(Instruction *Inst, Function *DirectCallee,
   emitOptimizationRemark(
       F.getContext(), "pgo-icall-prom", F, Inst->getDebugLoc(),
       Twine("Promote indirect call to ") + DirectCallee->getName() +
-          " with count " + Twine(Count) + " out of " + Twine(TotalCount));
+          " with count " + Twine(Count) + " out of " + Twine(TotalCount) +
+          (AddressPoint ? " by comparing the vtable pointer" : ""));
 }
 
 // Promote indirect-call to conditional direct-call for one callsite.
@@ -627,13 +814,14 @@ static bool promoteIndirectCalls(Module &M, bool InLTO) {
     return false;
   InstrProfSymtab Symtab;
   Symtab.create(M, InLTO);
+  VirtualCallInfo VCallInfo(M);
   bool Changed = false;
   for (auto &F : M) {
     if (F.isDeclaration())
       continue;
     if (F.hasFnAttribute(Attribute::OptimizeNone))
       continue;
-    ICallPromotionFunc ICallPromotion(F, &M, &Symtab);
+    ICallPromotionFunc ICallPromotion(F, &M, &Symtab, &VCallInfo);
     bool FuncChanged = ICallPromotion.processFunction();
     if (ICPDUMPAFTER && FuncChanged) {
       DEBUG(dbgs() << "\n== IR Dump After =="; F.print(dbgs()));
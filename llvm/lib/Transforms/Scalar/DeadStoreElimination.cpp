@@ -10,8 +10,9 @@
 // This file implements a trivial dead store elimination that only considers
 // basic-block local redundant stores.
 //
-// FIXME: This should eventually be extended to be a post-dominator tree
-// traversal.  Doing so would be pretty trivial.
+// With -enable-dse-memoryssa, it instead uses MemorySSA and the post-dominator
+// tree to also find stores overwritten in other blocks, and stores to
+// non-escaping allocas which are never read.
 //
 //===----------------------------------------------------------------------===//
 
@@ -25,6 +26,7 @@
 #include "llvm/Analysis/GlobalsModRef.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/MemoryDependenceAnalysis.h"
+#include "llvm/Analysis/PostDominators.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/Constants.h"
@@ -40,6 +42,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/MemorySSA.h"
 #include <map>
 using namespace llvm;
 
@@ -49,12 +52,32 @@ STATISTIC(NumRedundantStores, "Number of redundant stores deleted");
 STATISTIC(NumFastStores, "Number of stores deleted");
 STATISTIC(NumFastOther , "Number of other instrs removed");
 STATISTIC(NumCompletePartials, "Number of stores dead by later partials");
+STATISTIC(NumCrossBlockStores,
+          "Number of stores deleted by later stores in other blocks");
+STATISTIC(NumNeverReadStores,
+          "Number of stores to non-escaping allocas never read");
+STATISTIC(NumScanLimitReached,
+          "Number of times a MemorySSA scan limit was reached");
 
 static cl::opt<bool>
 EnablePartialOverwriteTracking("enable-dse-partial-overwrite-tracking",
   cl::init(true), cl::Hidden,
   cl::desc("Enable partial-overwrite tracking in DSE"));
 
+static cl::opt<bool>
+EnableMemorySSA("enable-dse-memoryssa", cl::init(false), cl::Hidden,
+  cl::desc("Use MemorySSA to find dead stores, also across basic blocks"));
+
+static cl::opt<unsigned>
+MemorySSAScanLimit("dse-memoryssa-scanlimit", cl::init(150), cl::Hidden,
+  cl::desc("The number of memory accesses to look at for reads of a store "
+           "before giving up on it (default = 150)"));
+
+static cl::opt<unsigned>
+MemorySSAWalkLimit("dse-memoryssa-walklimit", cl::init(70), cl::Hidden,
+  cl::desc("The number of earlier stores to look at for each store which may "
+           "overwrite them (default = 70)"));
+
 
 //===----------------------------------------------------------------------===//
 // Helper functions
@@ -461,6 +484,59 @@ static OverwriteResult isOverwrite(const MemoryLocation &Later,
   return OverwriteUnknown;
 }
 
+/// If the later store \p Later, of \p LaterLoc at \p LaterOffset, overwrites
+/// the end or the beginning of the memory intrinsic \p Earlier, of
+/// \p EarlierLoc at \p EarlierOffset, as told by \p OR, shorten \p Earlier to
+/// the part which is not overwritten.  Returns true if \p Earlier was changed.
+static bool tryToShorten(Instruction *Earlier, const MemoryLocation &EarlierLoc,
+                         int64_t EarlierOffset, Instruction *Later,
+                         const MemoryLocation &LaterLoc, int64_t LaterOffset,
+                         OverwriteResult OR) {
+  if (!(OR == OverwriteEnd && isShortenableAtTheEnd(Earlier)) &&
+      !(OR == OverwriteBegin && isShortenableAtTheBeginning(Earlier)))
+    return false;
+
+  // TODO: base this on the target vector size so that if the earlier
+  // store was too small to get vector writes anyway then its likely
+  // a good idea to shorten it
+  // Power of 2 vector writes are probably always a bad idea to optimize
+  // as any store/memset/memcpy is likely using vector instructions so
+  // shortening it to not vector size is likely to be slower
+  MemIntrinsic *EarlierIntrinsic = cast<MemIntrinsic>(Earlier);
+  unsigned EarlierAlign = EarlierIntrinsic->getAlignment();
+  bool IsOverwriteEnd = (OR == OverwriteEnd);
+  if (!IsOverwriteEnd)
+    LaterOffset = int64_t(LaterOffset + LaterLoc.Size);
+
+  if (!((llvm::isPowerOf2_64(LaterOffset) && EarlierAlign <= LaterOffset) ||
+        ((EarlierAlign != 0) && LaterOffset % EarlierAlign == 0)))
+    return false;
+
+  DEBUG(dbgs() << "DSE: Remove Dead Store:\n  OW "
+               << (IsOverwriteEnd ? "END" : "BEGIN") << ": " << *Earlier
+               << "\n  KILLER (offset " << LaterOffset << ", "
+               << EarlierLoc.Size << ")" << *Later << '\n');
+
+  int64_t NewLength = IsOverwriteEnd
+                          ? LaterOffset - EarlierOffset
+                          : EarlierLoc.Size - (LaterOffset - EarlierOffset);
+
+  Value *EarlierWriteLength = EarlierIntrinsic->getLength();
+  Value *TrimmedLength =
+      ConstantInt::get(EarlierWriteLength->getType(), NewLength);
+  EarlierIntrinsic->setLength(TrimmedLength);
+
+  if (!IsOverwriteEnd) {
+    int64_t OffsetMoved = (LaterOffset - EarlierOffset);
+    Value *Indices[1] = {
+        ConstantInt::get(EarlierWriteLength->getType(), OffsetMoved)};
+    GetElementPtrInst *NewDestGEP = GetElementPtrInst::CreateInBounds(
+        EarlierIntrinsic->getRawDest(), Indices, "", Earlier);
+    EarlierIntrinsic->setDest(NewDestGEP);
+  }
+  return true;
+}
+
 /// If 'Inst' might be a self read (i.e. a noop copy of a
 /// memory region into an identical pointer) then it doesn't actually make its
 /// input dead in the traditional sense.  Consider this case:
@@ -950,51 +1026,9 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
           // We erased DepWrite; start over.
           InstDep = MD->getDependency(Inst);
           continue;
-        } else if ((OR == OverwriteEnd && isShortenableAtTheEnd(DepWrite)) ||
-                   ((OR == OverwriteBegin &&
-                     isShortenableAtTheBeginning(DepWrite)))) {
-          // TODO: base this on the target vector size so that if the earlier
-          // store was too small to get vector writes anyway then its likely
-          // a good idea to shorten it
-          // Power of 2 vector writes are probably always a bad idea to optimize
-          // as any store/memset/memcpy is likely using vector instructions so
-          // shortening it to not vector size is likely to be slower
-          MemIntrinsic *DepIntrinsic = cast<MemIntrinsic>(DepWrite);
-          unsigned DepWriteAlign = DepIntrinsic->getAlignment();
-          bool IsOverwriteEnd = (OR == OverwriteEnd);
-          if (!IsOverwriteEnd)
-            InstWriteOffset = int64_t(InstWriteOffset + Loc.Size);
-
-          if ((llvm::isPowerOf2_64(InstWriteOffset) &&
-               DepWriteAlign <= InstWriteOffset) ||
-              ((DepWriteAlign != 0) && InstWriteOffset % DepWriteAlign == 0)) {
-
-            DEBUG(dbgs() << "DSE: Remove Dead Store:\n  OW "
-                         << (IsOverwriteEnd ? "END" : "BEGIN") << ": "
-                         << *DepWrite << "\n  KILLER (offset "
-                         << InstWriteOffset << ", " << DepLoc.Size << ")"
-                         << *Inst << '\n');
-
-            int64_t NewLength =
-                IsOverwriteEnd
-                    ? InstWriteOffset - DepWriteOffset
-                    : DepLoc.Size - (InstWriteOffset - DepWriteOffset);
-
-            Value *DepWriteLength = DepIntrinsic->getLength();
-            Value *TrimmedLength =
-                ConstantInt::get(DepWriteLength->getType(), NewLength);
-            DepIntrinsic->setLength(TrimmedLength);
-
-            if (!IsOverwriteEnd) {
-              int64_t OffsetMoved = (InstWriteOffset - DepWriteOffset);
-              Value *Indices[1] = {
-                  ConstantInt::get(DepWriteLength->getType(), OffsetMoved)};
-              GetElementPtrInst *NewDestGEP = GetElementPtrInst::CreateInBounds(
-                  DepIntrinsic->getRawDest(), Indices, "", DepWrite);
-              DepIntrinsic->setDest(NewDestGEP);
-            }
-            MadeChange = true;
-          }
+        } else if (tryToShorten(DepWrite, DepLoc, DepWriteOffset, Inst, Loc,
+                                InstWriteOffset, OR)) {
+          MadeChange = true;
         }
       }
 
@@ -1037,21 +1071,293 @@ static bool eliminateDeadStores(Function &F, AliasAnalysis *AA,
   return MadeChange;
 }
 
+//===----------------------------------------------------------------------===//
+// MemorySSA-based DSE
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// Removes the stores of a function which are overwritten before being read,
+/// or which are to non-escaping allocas and never read, using MemorySSA to
+/// find the reads, so that stores in different blocks are handled too.
+///
+/// For each store, the walk goes up the chain of defining accesses, through
+/// blocks with a single predecessor, looking for earlier stores which it
+/// overwrites. An earlier store is dead if the later one post-dominates it and
+/// none of the memory accesses reachable through the MemorySSA uses of the
+/// earlier store, up to the later one, may read its location.
+class MemorySSADSE {
+  AliasAnalysis &AA;
+  MemorySSA &MSSA;
+  PostDominatorTree &PDT;
+  const TargetLibraryInfo &TLI;
+  const DataLayout &DL;
+
+  /// The instructions which may write memory, in program order.
+  SmallVector<Instruction *, 64> Writes;
+  /// The instructions which were deleted.
+  SmallPtrSet<Instruction *, 16> Deleted;
+  /// The blocks with an instruction which may throw.
+  SmallPtrSet<BasicBlock *, 16> ThrowingBlocks;
+  /// Whether an underlying object is an alloca which does not escape, whose
+  /// contents the caller cannot see.
+  DenseMap<const Value *, bool> InvisibleToCaller;
+  InstOverlapIntervalsTy IOL;
+
+public:
+  MemorySSADSE(Function &F, AliasAnalysis &AA, MemorySSA &MSSA,
+               DominatorTree &DT, PostDominatorTree &PDT,
+               const TargetLibraryInfo &TLI)
+      : AA(AA), MSSA(MSSA), PDT(PDT), TLI(TLI),
+        DL(F.getParent()->getDataLayout()) {
+    for (BasicBlock &BB : F) {
+      // Dead blocks may have strange pointer cycles that will confuse alias
+      // analysis.
+      if (!DT.isReachableFromEntry(&BB))
+        continue;
+      for (Instruction &I : BB) {
+        if (I.mayThrow())
+          ThrowingBlocks.insert(&BB);
+        if (hasMemoryWrite(&I, TLI) &&
+            dyn_cast_or_null<MemoryDef>(MSSA.getMemoryAccess(&I)))
+          Writes.push_back(&I);
+      }
+    }
+  }
+
+  bool run();
+
+private:
+  bool isInvisibleToCaller(const Value *UO);
+  bool mayThrowBetween(Instruction *Earlier, Instruction *Later,
+                       const Value *EarlierUO);
+  bool isReadBefore(MemoryDef *EarlierDef, const MemoryLocation &EarlierLoc,
+                    MemoryAccess *Later);
+  bool eliminateOverwrittenStores(Instruction *Later);
+  bool eliminateNeverReadStore(Instruction *I);
+  void deleteDeadInstruction(Instruction *I);
+};
+} // end anonymous namespace
+
+bool MemorySSADSE::isInvisibleToCaller(const Value *UO) {
+  if (!isa<AllocaInst>(UO))
+    return false;
+  auto It = InvisibleToCaller.find(UO);
+  if (It != InvisibleToCaller.end())
+    return It->second;
+  bool Invisible = !PointerMayBeCaptured(UO, /*ReturnCaptures=*/true,
+                                         /*StoreCaptures=*/true);
+  InvisibleToCaller[UO] = Invisible;
+  return Invisible;
+}
+
+/// Returns true if an instruction between \p Earlier and \p Later may throw,
+/// so that the caller may see the memory written by \p Earlier.
+bool MemorySSADSE::mayThrowBetween(Instruction *Earlier, Instruction *Later,
+                                   const Value *EarlierUO) {
+  if (isInvisibleToCaller(EarlierUO))
+    return false;
+  if (Earlier->getParent() == Later->getParent())
+    return ThrowingBlocks.count(Earlier->getParent());
+  return !ThrowingBlocks.empty();
+}
+
+/// Returns true if a memory access reachable from \p EarlierDef before
+/// \p Later may read \p EarlierLoc, or if there are too many accesses to look
+/// at. If \p Later is null, all the reachable accesses are looked at.
+bool MemorySSADSE::isReadBefore(MemoryDef *EarlierDef,
+                                const MemoryLocation &EarlierLoc,
+                                MemoryAccess *Later) {
+  SmallVector<MemoryAccess *, 32> WorkList;
+  SmallPtrSet<MemoryAccess *, 32> Visited;
+  auto PushUses = [&](MemoryAccess *MA) {
+    for (User *U : MA->users()) {
+      auto *UseAccess = cast<MemoryAccess>(U);
+      if (Visited.insert(UseAccess).second)
+        WorkList.push_back(UseAccess);
+    }
+  };
+  PushUses(EarlierDef);
+
+  for (unsigned I = 0; I != WorkList.size(); ++I) {
+    if (I == MemorySSAScanLimit) {
+      ++NumScanLimitReached;
+      return true;
+    }
+
+    MemoryAccess *UseAccess = WorkList[I];
+    // The later store ends the paths through it.
+    if (UseAccess == Later)
+      continue;
+    if (isa<MemoryPhi>(UseAccess)) {
+      PushUses(UseAccess);
+      continue;
+    }
+
+    Instruction *UseInst = cast<MemoryUseOrDef>(UseAccess)->getMemoryInst();
+    if (AA.getModRefInfo(UseInst, EarlierLoc) & MRI_Ref)
+      return true;
+    // A write which does not read the location passes its contents on.
+    if (isa<MemoryDef>(UseAccess))
+      PushUses(UseAccess);
+  }
+  return false;
+}
+
+void MemorySSADSE::deleteDeadInstruction(Instruction *I) {
+  SmallVector<Instruction *, 32> NowDeadInsts;
+  NowDeadInsts.push_back(I);
+  --NumFastOther;
+
+  do {
+    Instruction *DeadInst = NowDeadInsts.pop_back_val();
+    ++NumFastOther;
+
+    if (MemoryAccess *MA = MSSA.getMemoryAccess(DeadInst))
+      MSSA.removeMemoryAccess(MA);
+
+    for (unsigned op = 0, e = DeadInst->getNumOperands(); op != e; ++op) {
+      Value *Op = DeadInst->getOperand(op);
+      DeadInst->setOperand(op, nullptr);
+
+      // If this operand just became dead, add it to the NowDeadInsts list.
+      if (!Op->use_empty()) continue;
+
+      if (Instruction *OpI = dyn_cast<Instruction>(Op))
+        if (isInstructionTriviallyDead(OpI, &TLI))
+          NowDeadInsts.push_back(OpI);
+    }
+
+    IOL.erase(DeadInst);
+    Deleted.insert(DeadInst);
+    DeadInst->eraseFromParent();
+  } while (!NowDeadInsts.empty());
+}
+
+/// Delete or shorten the stores before \p Later which it overwrites.
+bool MemorySSADSE::eliminateOverwrittenStores(Instruction *Later) {
+  MemoryLocation LaterLoc = getLocForWrite(Later, AA);
+  if (!LaterLoc.Ptr)
+    return false;
+  auto *LaterDef = cast<MemoryDef>(MSSA.getMemoryAccess(Later));
+  BasicBlock *LaterBB = Later->getParent();
+  if (!PDT.getNode(LaterBB))
+    return false;
+
+  bool MadeChange = false;
+  MemoryAccess *Current = LaterDef->getDefiningAccess();
+  for (unsigned Steps = 0;
+       Steps != MemorySSAWalkLimit && !MSSA.isLiveOnEntryDef(Current) &&
+       !isa<MemoryPhi>(Current);
+       ++Steps) {
+    auto *EarlierDef = cast<MemoryDef>(Current);
+    Current = EarlierDef->getDefiningAccess();
+
+    Instruction *Earlier = EarlierDef->getMemoryInst();
+    if (!hasMemoryWrite(Earlier, TLI) || !isRemovable(Earlier))
+      continue;
+    MemoryLocation EarlierLoc = getLocForWrite(Earlier, AA);
+    if (!EarlierLoc.Ptr)
+      continue;
+
+    // The later store has to be executed whenever the earlier one is, before
+    // the caller can see memory again.
+    BasicBlock *EarlierBB = Earlier->getParent();
+    if (EarlierBB != LaterBB &&
+        (!PDT.getNode(EarlierBB) || !PDT.dominates(LaterBB, EarlierBB)))
+      continue;
+    const Value *EarlierUO = GetUnderlyingObject(EarlierLoc.Ptr, DL);
+    if (mayThrowBetween(Earlier, Later, EarlierUO))
+      continue;
+    // Memory intrinsics may read what they overwrite.
+    if (AA.getModRefInfo(Later, EarlierLoc) & MRI_Ref)
+      continue;
+
+    int64_t EarlierOffset, LaterOffset;
+    OverwriteResult OR = isOverwrite(LaterLoc, EarlierLoc, DL, TLI,
+                                     EarlierOffset, LaterOffset, Earlier, IOL);
+    if (OR == OverwriteUnknown)
+      continue;
+    if (isReadBefore(EarlierDef, EarlierLoc, LaterDef))
+      continue;
+
+    if (OR == OverwriteComplete) {
+      DEBUG(dbgs() << "DSE: Remove Dead Store:\n  DEAD: " << *Earlier
+                   << "\n  KILLER: " << *Later << '\n');
+      if (EarlierBB != LaterBB)
+        ++NumCrossBlockStores;
+      ++NumFastStores;
+      deleteDeadInstruction(Earlier);
+      MadeChange = true;
+      continue;
+    }
+
+    MadeChange |= tryToShorten(Earlier, EarlierLoc, EarlierOffset, Later,
+                               LaterLoc, LaterOffset, OR);
+  }
+  return MadeChange;
+}
+
+/// Delete \p I if it stores to a non-escaping alloca which is not read
+/// afterwards.
+bool MemorySSADSE::eliminateNeverReadStore(Instruction *I) {
+  if (!isRemovable(I))
+    return false;
+  MemoryLocation Loc = getLocForWrite(I, AA);
+  if (!Loc.Ptr || !isInvisibleToCaller(GetUnderlyingObject(Loc.Ptr, DL)))
+    return false;
+  if (isReadBefore(cast<MemoryDef>(MSSA.getMemoryAccess(I)), Loc, nullptr))
+    return false;
+
+  DEBUG(dbgs() << "DSE: Remove Store Never Read:\n  DEAD: " << *I << '\n');
+  ++NumNeverReadStores;
+  ++NumFastStores;
+  deleteDeadInstruction(I);
+  return true;
+}
+
+bool MemorySSADSE::run() {
+  bool MadeChange = false;
+  for (Instruction *I : Writes)
+    if (!Deleted.count(I))
+      MadeChange |= eliminateOverwrittenStores(I);
+  for (Instruction *I : Writes)
+    if (!Deleted.count(I))
+      MadeChange |= eliminateNeverReadStore(I);
+  return MadeChange;
+}
+
+static bool eliminateDeadStoresMemorySSA(Function &F, AliasAnalysis &AA,
+                                         DominatorTree &DT,
+                                         const TargetLibraryInfo &TLI) {
+  // Like GVNHoist, build MemorySSA here while it is only used when asked for.
+  MemorySSA MSSA(F, &AA, &DT);
+  PostDominatorTree PDT;
+  PDT.recalculate(F);
+  return MemorySSADSE(F, AA, MSSA, DT, PDT, TLI).run();
+}
+
 //===----------------------------------------------------------------------===//
 // DSE Pass
 //===----------------------------------------------------------------------===//
 PreservedAnalyses DSEPass::run(Function &F, FunctionAnalysisManager &AM) {
   AliasAnalysis *AA = &AM.getResult<AAManager>(F);
   DominatorTree *DT = &AM.getResult<DominatorTreeAnalysis>(F);
-  MemoryDependenceResults *MD = &AM.getResult<MemoryDependenceAnalysis>(F);
   const TargetLibraryInfo *TLI = &AM.getResult<TargetLibraryAnalysis>(F);
 
-  if (!eliminateDeadStores(F, AA, MD, DT, TLI))
-    return PreservedAnalyses::all();
+  if (EnableMemorySSA) {
+    if (!eliminateDeadStoresMemorySSA(F, *AA, *DT, *TLI))
+      return PreservedAnalyses::all();
+  } else {
+    MemoryDependenceResults *MD = &AM.getResult<MemoryDependenceAnalysis>(F);
+    if (!eliminateDeadStores(F, AA, MD, DT, TLI))
+      return PreservedAnalyses::all();
+  }
+
   PreservedAnalyses PA;
   PA.preserve<DominatorTreeAnalysis>();
   PA.preserve<GlobalsAA>();
-  PA.preserve<MemoryDependenceAnalysis>();
+  if (!EnableMemorySSA)
+    PA.preserve<MemoryDependenceAnalysis>();
   return PA;
 }
 
@@ -1069,11 +1375,14 @@ public:
 
     DominatorTree *DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
     AliasAnalysis *AA = &getAnalysis<AAResultsWrapperPass>().getAAResults();
-    MemoryDependenceResults *MD =
-        &getAnalysis<MemoryDependenceWrapperPass>().getMemDep();
     const TargetLibraryInfo *TLI =
         &getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
 
+    if (EnableMemorySSA)
+      return eliminateDeadStoresMemorySSA(F, *AA, *DT, *TLI);
+
+    MemoryDependenceResults *MD =
+        &getAnalysis<MemoryDependenceWrapperPass>().getMemDep();
     return eliminateDeadStores(F, AA, MD, DT, TLI);
   }
 
@@ -1081,11 +1390,13 @@ public:
     AU.setPreservesCFG();
     AU.addRequired<DominatorTreeWrapperPass>();
     AU.addRequired<AAResultsWrapperPass>();
-    AU.addRequired<MemoryDependenceWrapperPass>();
     AU.addRequired<TargetLibraryInfoWrapperPass>();
     AU.addPreserved<DominatorTreeWrapperPass>();
     AU.addPreserved<GlobalsAAWrapperPass>();
-    AU.addPreserved<MemoryDependenceWrapperPass>();
+    if (!EnableMemorySSA) {
+      AU.addRequired<MemoryDependenceWrapperPass>();
+      AU.addPreserved<MemoryDependenceWrapperPass>();
+    }
   }
 
   static char ID; // Pass identification, replacement for typeid
@@ -15,6 +15,8 @@
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/CodeMetrics.h"
 #include "llvm/Analysis/InstructionSimplify.h"
@@ -33,6 +35,8 @@
 #include "llvm/IR/Module.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
@@ -57,7 +61,26 @@ static cl::opt<unsigned> MaxPrefetchIterationsAhead(
     "max-prefetch-iters-ahead",
     cl::desc("Max number of iterations to prefetch ahead"), cl::Hidden);
 
+static cl::opt<bool>
+PrefetchIndirect("loop-prefetch-indirect", cl::Hidden, cl::init(false),
+                 cl::desc("Prefetch indirect addresses such as a[b[i]]"));
+
+// A cache miss profile, typically produced from sampled cache miss events,
+// lists the memory accesses worth prefetching. Each line reads
+//   <function> <line> <column> [<distance>]
+// where line and column are those of the access' debug location (a column of
+// 0 matches any column) and the optional distance, in instructions, overrides
+// the prefetch distance of the target. Lines starting with '#' are comments.
+// When a profile is given, only the accesses it lists are prefetched, and
+// they are prefetched regardless of their stride.
+static cl::opt<std::string>
+    PrefetchHintsFile("prefetch-hints-file",
+                      cl::desc("Cache miss profile selecting the accesses to "
+                               "prefetch"),
+                      cl::value_desc("filename"), cl::Hidden);
+
 STATISTIC(NumPrefetches, "Number of prefetches inserted");
+STATISTIC(NumIndirectPrefetches, "Number of indirect prefetches inserted");
 
 namespace llvm {
   void initializeLoopDataPrefetchPass(PassRegistry&);
@@ -65,6 +88,44 @@ namespace llvm {
 
 namespace {
 
+  /// An access to prefetch, read from the cache miss profile.
+  struct PrefetchHint {
+    unsigned Line;
+    unsigned Column;
+    unsigned Distance;
+  };
+
+  /// Find the load that makes an address computation variant in a loop, if
+  /// that is the only variant part of the address. For a[b[i]], this is the
+  /// load of b[i].
+  struct IndexLoadFinder {
+    const Loop *L;
+    LoadInst *IndexLoad;
+    bool Valid;
+
+    IndexLoadFinder(const Loop *L) : L(L), IndexLoad(nullptr), Valid(true) {}
+
+    bool follow(const SCEV *S) {
+      if (const auto *AR = dyn_cast<SCEVAddRecExpr>(S)) {
+        if (L->contains(AR->getLoop()))
+          Valid = false;
+        return false;
+      }
+      if (const auto *U = dyn_cast<SCEVUnknown>(S)) {
+        auto *I = dyn_cast<Instruction>(U->getValue());
+        if (I && L->contains(I)) {
+          auto *LoadI = dyn_cast<LoadInst>(I);
+          if (!LoadI || (IndexLoad && IndexLoad != LoadI))
+            Valid = false;
+          else
+            IndexLoad = LoadI;
+        }
+      }
+      return Valid;
+    }
+    bool isDone() const { return !Valid; }
+  };
+
   class LoopDataPrefetch : public FunctionPass {
   public:
     static char ID; // Pass ID, replacement for typeid
@@ -74,6 +135,7 @@ namespace {
 
     void getAnalysisUsage(AnalysisUsage &AU) const override {
       AU.addRequired<AssumptionCacheTracker>();
+      AU.addRequired<DominatorTreeWrapperPass>();
       AU.addPreserved<DominatorTreeWrapperPass>();
       AU.addRequired<LoopInfoWrapperPass>();
       AU.addPreserved<LoopInfoWrapperPass>();
@@ -84,11 +146,27 @@ namespace {
       AU.addRequired<TargetTransformInfoWrapperPass>();
     }
 
+    bool doInitialization(Module &M) override;
     bool runOnFunction(Function &F) override;
 
   private:
     bool runOnLoop(Loop *L);
 
+    /// \brief Read the cache miss profile named by -prefetch-hints-file.
+    void readHints(Module &M);
+
+    /// \brief Return the profile entry matching \p MemI, if any.
+    const PrefetchHint *getHint(const Instruction *MemI) const;
+
+    /// \brief Prefetch the address \p PtrSCEV of \p MemI, which depends on
+    /// the value loaded from an affine recurrence in \p L, \p ItersAhead
+    /// iterations ahead.
+    bool insertIndirectPrefetch(Loop *L, Instruction *MemI,
+                                const SCEV *PtrSCEV, unsigned ItersAhead);
+
+    /// \brief Insert a prefetch of \p PrefPtrValue before \p MemI.
+    void insertPrefetch(Instruction *MemI, Value *PrefPtrValue);
+
     /// \brief Check if the the stride of the accesses is large enough to
     /// warrant a prefetch.
     bool isStrideLargeEnough(const SCEVAddRecExpr *AR);
@@ -112,10 +190,18 @@ namespace {
     }
 
     AssumptionCache *AC;
+    DominatorTree *DT;
     LoopInfo *LI;
     ScalarEvolution *SE;
     const TargetTransformInfo *TTI;
     const DataLayout *DL;
+
+    /// The cache miss profile, indexed by function name.
+    StringMap<SmallVector<PrefetchHint, 4>> Hints;
+
+    /// The profile entries of the current function, or null if the current
+    /// function is not in the profile.
+    const SmallVectorImpl<PrefetchHint> *FunctionHints;
   };
 }
 
@@ -123,6 +209,7 @@ char LoopDataPrefetch::ID = 0;
 INITIALIZE_PASS_BEGIN(LoopDataPrefetch, "loop-data-prefetch",
                       "Loop Data Prefetch", false, false)
 INITIALIZE_PASS_DEPENDENCY(AssumptionCacheTracker)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
@@ -147,22 +234,82 @@ bool LoopDataPrefetch::isStrideLargeEnough(const SCEVAddRecExpr *AR) {
   return TargetMinStride <= AbsStride;
 }
 
+void LoopDataPrefetch::readHints(Module &M) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr =
+      MemoryBuffer::getFile(PrefetchHintsFile);
+  if (std::error_code EC = BufOrErr.getError()) {
+    M.getContext().emitError("could not open prefetch hints file '" +
+                             PrefetchHintsFile + "': " + EC.message());
+    return;
+  }
+
+  for (line_iterator LineIt(**BufOrErr, /*SkipBlanks=*/true, '#');
+       !LineIt.is_at_eof(); ++LineIt) {
+    SmallVector<StringRef, 4> Fields;
+    SplitString(*LineIt, Fields);
+
+    PrefetchHint Hint = {0, 0, 0};
+    if (Fields.size() < 3 || Fields.size() > 4 ||
+        Fields[1].getAsInteger(10, Hint.Line) ||
+        Fields[2].getAsInteger(10, Hint.Column) ||
+        (Fields.size() == 4 && Fields[3].getAsInteger(10, Hint.Distance))) {
+      M.getContext().emitError("malformed prefetch hint at " +
+                               PrefetchHintsFile + ":" +
+                               Twine(LineIt.line_number()));
+      return;
+    }
+    Hints[Fields[0]].push_back(Hint);
+  }
+}
+
+const PrefetchHint *
+LoopDataPrefetch::getHint(const Instruction *MemI) const {
+  const DebugLoc &Loc = MemI->getDebugLoc();
+  if (!FunctionHints || !Loc)
+    return nullptr;
+
+  for (const PrefetchHint &Hint : *FunctionHints)
+    if (Hint.Line == Loc.getLine() &&
+        (!Hint.Column || Hint.Column == Loc.getCol()))
+      return &Hint;
+  return nullptr;
+}
+
+bool LoopDataPrefetch::doInitialization(Module &M) {
+  Hints.clear();
+  if (!PrefetchHintsFile.empty())
+    readHints(M);
+  return false;
+}
+
 bool LoopDataPrefetch::runOnFunction(Function &F) {
   if (skipFunction(F))
     return false;
 
+  DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
   LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
   SE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
   DL = &F.getParent()->getDataLayout();
   AC = &getAnalysis<AssumptionCacheTracker>().getAssumptionCache(F);
   TTI = &getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
 
+  FunctionHints = nullptr;
+  if (!PrefetchHintsFile.empty()) {
+    // With a cache miss profile, only the functions it lists are prefetched.
+    auto HintsIt = Hints.find(F.getName());
+    if (HintsIt == Hints.end())
+      return false;
+    FunctionHints = &HintsIt->second;
+  }
+
   // If PrefetchDistance is not set, don't run the pass.  This gives an
   // opportunity for targets to run this pass for selected subtargets only
-  // (whose TTI sets PrefetchDistance).
-  if (getPrefetchDistance() == 0)
+  // (whose TTI sets PrefetchDistance). The profile can still request
+  // prefetches with their own distance.
+  if (getPrefetchDistance() == 0 && !FunctionHints)
     return false;
-  assert(TTI->getCacheLineSize() && "Cache line size is not set for target");
+  assert((TTI->getCacheLineSize() || FunctionHints) &&
+         "Cache line size is not set for target");
 
   bool MadeChange = false;
 
@@ -207,7 +354,7 @@ bool LoopDataPrefetch::runOnLoop(Loop *L) {
   if (!ItersAhead)
     ItersAhead = 1;
 
-  if (ItersAhead > getMaxPrefetchIterationsAhead())
+  if (ItersAhead > getMaxPrefetchIterationsAhead() && !FunctionHints)
     return MadeChange;
 
   Function *F = L->getHeader()->getParent();
@@ -239,14 +386,29 @@ bool LoopDataPrefetch::runOnLoop(Loop *L) {
       if (L->isLoopInvariant(PtrValue))
         continue;
 
+      // The profile knows better than the stride heuristic which accesses
+      // miss in the cache.
+      unsigned AccessItersAhead = ItersAhead;
+      const PrefetchHint *Hint = getHint(MemI);
+      if (FunctionHints) {
+        if (!Hint)
+          continue;
+        if (Hint->Distance)
+          AccessItersAhead = std::max(Hint->Distance / LoopSize, 1u);
+      }
+
       const SCEV *LSCEV = SE->getSCEV(PtrValue);
       const SCEVAddRecExpr *LSCEVAddRec = dyn_cast<SCEVAddRecExpr>(LSCEV);
-      if (!LSCEVAddRec)
+      if (!LSCEVAddRec) {
+        if ((PrefetchIndirect || Hint) &&
+            insertIndirectPrefetch(L, MemI, LSCEV, AccessItersAhead))
+          MadeChange = true;
         continue;
+      }
 
       // Check if the the stride of the accesses is large enough to warrant a
       // prefetch.
-      if (!isStrideLargeEnough(LSCEVAddRec))
+      if (!Hint && !isStrideLargeEnough(LSCEVAddRec))
         continue;
 
       // We don't want to double prefetch individual cache lines. If this load
@@ -268,7 +430,7 @@ bool LoopDataPrefetch::runOnLoop(Loop *L) {
         continue;
 
       const SCEV *NextLSCEV = SE->getAddExpr(LSCEVAddRec, SE->getMulExpr(
-        SE->getConstant(LSCEVAddRec->getType(), ItersAhead),
+        SE->getConstant(LSCEVAddRec->getType(), AccessItersAhead),
         LSCEVAddRec->getStepRecurrence(*SE)));
       if (!isSafeToExpand(NextLSCEV, *SE))
         continue;
@@ -279,16 +441,7 @@ bool LoopDataPrefetch::runOnLoop(Loop *L) {
       SCEVExpander SCEVE(*SE, J->getModule()->getDataLayout(), "prefaddr");
       Value *PrefPtrValue = SCEVE.expandCodeFor(NextLSCEV, I8Ptr, MemI);
 
-      IRBuilder<> Builder(MemI);
-      Module *M = (*I)->getParent()->getParent();
-      Type *I32 = Type::getInt32Ty((*I)->getContext());
-      Value *PrefetchFunc = Intrinsic::getDeclaration(M, Intrinsic::prefetch);
-      Builder.CreateCall(
-          PrefetchFunc,
-          {PrefPtrValue,
-           ConstantInt::get(I32, MemI->mayReadFromMemory() ? 0 : 1),
-           ConstantInt::get(I32, 3), ConstantInt::get(I32, 1)});
-      ++NumPrefetches;
+      insertPrefetch(MemI, PrefPtrValue);
       DEBUG(dbgs() << "  Access: " << *PtrValue << ", SCEV: " << *LSCEV
                    << "\n");
       emitOptimizationRemark(F->getContext(), DEBUG_TYPE, *F,
@@ -302,3 +455,83 @@ bool LoopDataPrefetch::runOnLoop(Loop *L) {
   return MadeChange;
 }
 
+
+bool LoopDataPrefetch::insertIndirectPrefetch(Loop *L, Instruction *MemI,
+                                              const SCEV *PtrSCEV,
+                                              unsigned ItersAhead) {
+  IndexLoadFinder Finder(L);
+  visitAll(PtrSCEV, Finder);
+  LoadInst *IndexLoad = Finder.IndexLoad;
+  if (!Finder.Valid || !IndexLoad || !IndexLoad->isSimple() ||
+      !isSafeToExpand(PtrSCEV, *SE))
+    return false;
+
+  // The index must come from an affine recurrence of this loop, such as b[i].
+  const auto *IndexAR =
+      dyn_cast<SCEVAddRecExpr>(SE->getSCEV(IndexLoad->getPointerOperand()));
+  if (!IndexAR || IndexAR->getLoop() != L || !IndexAR->isAffine())
+    return false;
+
+  // The index of a later iteration is loaded speculatively. This is only
+  // valid if the loop is known to load the indices of all of its iterations,
+  // that is if it runs to its computed trip count and loads one index in
+  // every iteration.
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!Latch || L->getExitingBlock() != Latch ||
+      !DT->dominates(IndexLoad->getParent(), Latch))
+    return false;
+  const SCEV *BackedgeTakenCount = SE->getBackedgeTakenCount(L);
+  if (isa<SCEVCouldNotCompute>(BackedgeTakenCount))
+    return false;
+  for (BasicBlock *BB : L->blocks())
+    for (Instruction &I : *BB)
+      if (!isGuaranteedToTransferExecutionToSuccessor(&I))
+        return false;
+
+  // Load the index of iteration min(i + ItersAhead, BackedgeTakenCount).
+  Type *IntTy = SE->getEffectiveSCEVType(IndexAR->getType());
+  const SCEV *AheadIter = SE->getUMinExpr(
+      SE->getAddRecExpr(SE->getConstant(IntTy, ItersAhead), SE->getOne(IntTy),
+                        L, SCEV::FlagAnyWrap),
+      SE->getTruncateOrZeroExtend(BackedgeTakenCount, IntTy));
+  const SCEV *NextIndexSCEV = IndexAR->evaluateAtIteration(AheadIter, *SE);
+  if (!isSafeToExpand(NextIndexSCEV, *SE))
+    return false;
+
+  SCEVExpander SCEVE(*SE, *DL, "prefaddr");
+  Value *NextIndexPtr = SCEVE.expandCodeFor(
+      NextIndexSCEV, IndexLoad->getPointerOperand()->getType(), IndexLoad);
+  IRBuilder<> Builder(IndexLoad);
+  LoadInst *NextIndex = Builder.CreateAlignedLoad(
+      NextIndexPtr, IndexLoad->getAlignment(), "prefidx");
+
+  // Compute the address of MemI from the index loaded ahead.
+  ValueToValueMap RewriteMap;
+  RewriteMap[IndexLoad] = NextIndex;
+  const SCEV *NextPtrSCEV =
+      SCEVParameterRewriter::rewrite(PtrSCEV, *SE, RewriteMap);
+  Type *I8Ptr = Type::getInt8PtrTy(MemI->getContext());
+  Value *PrefPtrValue = SCEVE.expandCodeFor(NextPtrSCEV, I8Ptr, MemI);
+
+  insertPrefetch(MemI, PrefPtrValue);
+  ++NumIndirectPrefetches;
+  DEBUG(dbgs() << "  Indirect access: " << *MemI << ", index: " << *IndexLoad
+               << "\n");
+  Function *F = L->getHeader()->getParent();
+  emitOptimizationRemark(F->getContext(), DEBUG_TYPE, *F, MemI->getDebugLoc(),
+                         "prefetched indirect memory access");
+  return true;
+}
+
+void LoopDataPrefetch::insertPrefetch(Instruction *MemI, Value *PrefPtrValue) {
+  IRBuilder<> Builder(MemI);
+  Module *M = MemI->getModule();
+  Type *I32 = Type::getInt32Ty(MemI->getContext());
+  Value *PrefetchFunc = Intrinsic::getDeclaration(M, Intrinsic::prefetch);
+  Builder.CreateCall(
+      PrefetchFunc,
+      {PrefPtrValue,
+       ConstantInt::get(I32, MemI->mayReadFromMemory() ? 0 : 1),
+       ConstantInt::get(I32, 3), ConstantInt::get(I32, 1)});
+  ++NumPrefetches;
+}
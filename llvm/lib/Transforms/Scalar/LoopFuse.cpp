@@ -0,0 +1,513 @@
+//===- LoopFuse.cpp - Loop Fusion Pass ------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the Loop Fusion Pass. Two loops are fused when:
+//
+//  - they are in simplified form, leave only from their latch, and contain no
+//    calls, volatile or atomic accesses, or instructions which may throw;
+//  - the exit block of the first one is the preheader of the second one, and
+//    contains nothing but its branch;
+//  - they are control flow equivalent;
+//  - their backedge-taken counts are the same SCEV;
+//  - the second loop doesn't use the values computed by the first one, and
+//    for every pair of memory accesses from the two loops, DependenceAnalysis
+//    proves them independent, or their addresses show that the access of the
+//    second loop never touches what a later iteration of the first loop
+//    accesses.
+//
+// The body of the second loop is then executed right after the body of the
+// first one in every iteration, under the exit condition of the second loop.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Scalar/LoopFuse.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/OptimizationDiagnosticInfo.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+
+using namespace llvm;
+
+#define LF_NAME "loop-fusion"
+#define DEBUG_TYPE LF_NAME
+
+STATISTIC(FuseCounter, "Number of loops fused");
+STATISTIC(NumFusionCandidates, "Number of candidates for loop fusion");
+STATISTIC(NotSimplifiedForm, "Loop is not in simplified form");
+STATISTIC(InvalidExitingBlock, "Loop exits from blocks other than its latch");
+STATISTIC(AddressTakenBB, "Loop has an address taken block");
+STATISTIC(MayThrowException, "Loop may throw an exception");
+STATISTIC(UnsupportedAccess,
+          "Loop contains calls, volatile or atomic memory accesses");
+STATISTIC(UncomputableTripCount, "Loop trip count is not computable");
+STATISTIC(NonEmptyPreheader, "Code between the loops");
+STATISTIC(NotControlFlowEquivalent, "Loops are not control flow equivalent");
+STATISTIC(NonEqualTripCount, "Loops have different trip counts");
+STATISTIC(InvalidDependencies, "Dependences prevent fusion");
+
+namespace {
+
+/// Rewrites the recurrences of one loop into recurrences of another one, with
+/// the same start and step.
+class AddRecLoopReplacer : public SCEVRewriteVisitor<AddRecLoopReplacer> {
+public:
+  AddRecLoopReplacer(ScalarEvolution &SE, const Loop &OldL, const Loop &NewL)
+      : SCEVRewriteVisitor(SE), OldL(OldL), NewL(NewL), Valid(true) {}
+
+  bool isValid() const { return Valid; }
+
+  const SCEV *visitAddRecExpr(const SCEVAddRecExpr *Expr) {
+    const Loop *ExprL = Expr->getLoop();
+    // The recurrences of the loops nested in the old loop may start at values
+    // varying with it.
+    if (ExprL != &OldL && OldL.contains(ExprL)) {
+      Valid = false;
+      return Expr;
+    }
+
+    SmallVector<const SCEV *, 2> Operands;
+    for (const SCEV *Op : Expr->operands())
+      Operands.push_back(visit(Op));
+    return SE.getAddRecExpr(Operands, ExprL == &OldL ? &NewL : ExprL,
+                            SCEV::FlagAnyWrap);
+  }
+
+private:
+  const Loop &OldL;
+  const Loop &NewL;
+  bool Valid;
+};
+
+class LoopFuser {
+public:
+  LoopFuser(Function &F, LoopInfo &LI, DominatorTree &DT,
+            PostDominatorTree &PDT, ScalarEvolution &SE, DependenceInfo &DI,
+            OptimizationRemarkEmitter &ORE)
+      : F(F), LI(LI), DT(DT), PDT(PDT), SE(SE), DI(DI), ORE(ORE),
+        DL(F.getParent()->getDataLayout()) {}
+
+  bool run() {
+    std::vector<Loop *> TopLevelLoops(LI.begin(), LI.end());
+    return fuseSiblings(TopLevelLoops);
+  }
+
+private:
+  /// Fuse the adjacent loops among \p Loops, which are the children of the
+  /// same loop, and then the adjacent loops nested in each of them.
+  bool fuseSiblings(const std::vector<Loop *> &Loops);
+
+  /// Return true if \p L may be fused with its neighbours.
+  bool isCandidate(Loop *L);
+
+  /// Return true if \p L0 and \p L1, which follows it, may be fused.
+  bool canFuse(Loop *L0, Loop *L1);
+
+  /// Return true if the loops \p L0 and \p L1 still compute the same values
+  /// once fused.
+  bool dependencesAllowFusion(Loop *L0, Loop *L1);
+
+  /// Return true if \p I0 from \p L0 and \p I1 from \p L1, one of which
+  /// writes to memory, may be executed in the order of the fused loop.
+  bool accessesAllowFusion(Loop *L0, Loop *L1, Instruction *I0,
+                           Instruction *I1);
+
+  /// Fuse \p L1 into \p L0.
+  void fuse(Loop *L0, Loop *L1);
+
+  /// Report that \p L is not a candidate for fusion.
+  bool reportInvalidCandidate(Loop *L, Statistic &Stat, const Twine &Msg) {
+    ++Stat;
+    DEBUG(dbgs() << "LF: Loop " << L->getHeader()->getName()
+                 << " is not a candidate: " << Msg << "\n");
+    ORE.emitOptimizationRemarkMissed(LF_NAME, L, "loop not fused: " + Msg);
+    return false;
+  }
+
+  /// Report that \p L0 and \p L1 cannot be fused.
+  bool reportInvalidPair(Loop *L0, Loop *L1, Statistic &Stat,
+                         const Twine &Msg) {
+    ++Stat;
+    DEBUG(dbgs() << "LF: Loops " << L0->getHeader()->getName() << " and "
+                 << L1->getHeader()->getName() << " cannot be fused: " << Msg
+                 << "\n");
+    ORE.emitOptimizationRemarkMissed(
+        LF_NAME, L0, "loop not fused with the loop " +
+                         L1->getHeader()->getName() + ": " + Msg);
+    return false;
+  }
+
+  Function &F;
+  LoopInfo &LI;
+  DominatorTree &DT;
+  PostDominatorTree &PDT;
+  ScalarEvolution &SE;
+  DependenceInfo &DI;
+  OptimizationRemarkEmitter &ORE;
+  const DataLayout &DL;
+
+  /// The loops already checked by isCandidate.
+  DenseMap<Loop *, bool> Candidates;
+};
+
+} // end anonymous namespace
+
+static Value *getPointerOperand(Instruction *I) {
+  if (auto *LI = dyn_cast<LoadInst>(I))
+    return LI->getPointerOperand();
+  return cast<StoreInst>(I)->getPointerOperand();
+}
+
+static Type *getAccessType(Instruction *I) {
+  if (auto *SI = dyn_cast<StoreInst>(I))
+    return SI->getValueOperand()->getType();
+  return I->getType();
+}
+
+bool LoopFuser::fuseSiblings(const std::vector<Loop *> &Loops) {
+  // The list of loops changes as they get fused, work on a copy.
+  SmallVector<Loop *, 8> Siblings(Loops.begin(), Loops.end());
+
+  DenseMap<BasicBlock *, Loop *> ByPreheader;
+  for (Loop *L : Siblings)
+    if (BasicBlock *Preheader = L->getLoopPreheader())
+      ByPreheader[Preheader] = L;
+
+  bool Changed = false;
+  SmallPtrSet<Loop *, 8> Fused;
+  for (Loop *L0 : Siblings) {
+    if (Fused.count(L0))
+      continue;
+
+    // Keep fusing the loop with the one following it.
+    while (BasicBlock *ExitBlock = L0->getExitBlock()) {
+      Loop *L1 = ByPreheader.lookup(ExitBlock);
+      if (!L1 || Fused.count(L1) || !isCandidate(L0) || !isCandidate(L1) ||
+          !canFuse(L0, L1))
+        break;
+
+      ByPreheader.erase(ExitBlock);
+      Fused.insert(L1);
+      fuse(L0, L1);
+      Changed = true;
+    }
+  }
+
+  for (Loop *L : Siblings)
+    if (!Fused.count(L))
+      Changed |= fuseSiblings(L->getSubLoops());
+
+  return Changed;
+}
+
+bool LoopFuser::isCandidate(Loop *L) {
+  auto Cached = Candidates.find(L);
+  if (Cached != Candidates.end())
+    return Cached->second;
+  bool &IsCandidate = Candidates[L];
+
+  if (!L->isLoopSimplifyForm())
+    return IsCandidate = reportInvalidCandidate(L, NotSimplifiedForm,
+                                                "not in simplified form");
+
+  BasicBlock *Latch = L->getLoopLatch();
+  auto *LatchBr = dyn_cast<BranchInst>(Latch->getTerminator());
+  if (L->getExitingBlock() != Latch || !L->getExitBlock() || !LatchBr ||
+      !LatchBr->isConditional())
+    return IsCandidate = reportInvalidCandidate(
+               L, InvalidExitingBlock, "exits from blocks other than its latch");
+
+  for (BasicBlock *BB : L->blocks()) {
+    if (BB->hasAddressTaken())
+      return IsCandidate = reportInvalidCandidate(L, AddressTakenBB,
+                                                  "has an address taken block");
+
+    for (Instruction &I : *BB) {
+      if (I.mayThrow())
+        return IsCandidate = reportInvalidCandidate(L, MayThrowException,
+                                                    "may throw an exception");
+      if (auto *LI = dyn_cast<LoadInst>(&I)) {
+        if (LI->isSimple())
+          continue;
+      } else if (auto *SI = dyn_cast<StoreInst>(&I)) {
+        if (SI->isSimple())
+          continue;
+      } else if (!I.mayReadOrWriteMemory()) {
+        continue;
+      }
+      return IsCandidate = reportInvalidCandidate(
+                 L, UnsupportedAccess,
+                 "contains calls, volatile or atomic memory accesses");
+    }
+  }
+
+  if (isa<SCEVCouldNotCompute>(SE.getBackedgeTakenCount(L)))
+    return IsCandidate = reportInvalidCandidate(L, UncomputableTripCount,
+                                                "trip count not computable");
+
+  ++NumFusionCandidates;
+  return IsCandidate = true;
+}
+
+bool LoopFuser::canFuse(Loop *L0, Loop *L1) {
+  BasicBlock *Preheader = L1->getLoopPreheader();
+  if (&Preheader->front() != Preheader->getTerminator())
+    return reportInvalidPair(L0, L1, NonEmptyPreheader,
+                             "code between the loops");
+
+  if (!DT.dominates(L0->getHeader(), L1->getHeader()) ||
+      !PDT.dominates(L1->getHeader(), L0->getHeader()))
+    return reportInvalidPair(L0, L1, NotControlFlowEquivalent,
+                             "not control flow equivalent");
+
+  if (SE.getBackedgeTakenCount(L0) != SE.getBackedgeTakenCount(L1))
+    return reportInvalidPair(L0, L1, NonEqualTripCount,
+                             "different trip counts");
+
+  if (!dependencesAllowFusion(L0, L1))
+    return reportInvalidPair(L0, L1, InvalidDependencies,
+                             "dependences prevent fusion");
+
+  return true;
+}
+
+bool LoopFuser::dependencesAllowFusion(Loop *L0, Loop *L1) {
+  SmallVector<Instruction *, 16> Accesses0, Accesses1;
+  for (BasicBlock *BB : L0->blocks())
+    for (Instruction &I : *BB)
+      if (isa<LoadInst>(I) || isa<StoreInst>(I))
+        Accesses0.push_back(&I);
+
+  for (BasicBlock *BB : L1->blocks())
+    for (Instruction &I : *BB) {
+      // Once fused, the second loop would see the values the first one
+      // computes in the same iteration instead of the last ones.
+      for (Value *Op : I.operands())
+        if (auto *OpI = dyn_cast<Instruction>(Op))
+          if (L0->contains(OpI))
+            return false;
+      if (isa<LoadInst>(I) || isa<StoreInst>(I))
+        Accesses1.push_back(&I);
+    }
+
+  for (Instruction *I0 : Accesses0)
+    for (Instruction *I1 : Accesses1)
+      if ((isa<StoreInst>(I0) || isa<StoreInst>(I1)) &&
+          !accessesAllowFusion(L0, L1, I0, I1))
+        return false;
+
+  return true;
+}
+
+bool LoopFuser::accessesAllowFusion(Loop *L0, Loop *L1, Instruction *I0,
+                                    Instruction *I1) {
+  if (!DI.depends(I0, I1, /*PossiblyLoopIndependent=*/true))
+    return true;
+
+  // Once fused, the access of the second loop in some iteration comes before
+  // the accesses of the first loop in the later iterations. Express both
+  // addresses in terms of the iterations of the fused loop to check that
+  // they never meet.
+  AddRecLoopReplacer Rewriter(SE, *L1, *L0);
+  const SCEV *Ptr0 = SE.getSCEV(getPointerOperand(I0));
+  const SCEV *Ptr1 = Rewriter.visit(SE.getSCEV(getPointerOperand(I1)));
+  if (!Rewriter.isValid() || Ptr0->getType() != Ptr1->getType())
+    return false;
+
+  auto GetStep = [&](const SCEV *Ptr) -> const SCEVConstant * {
+    if (SE.isLoopInvariant(Ptr, L0))
+      return cast<SCEVConstant>(SE.getZero(SE.getEffectiveSCEVType(
+          Ptr->getType())));
+    auto *AR = dyn_cast<SCEVAddRecExpr>(Ptr);
+    if (!AR || AR->getLoop() != L0 || !AR->isAffine())
+      return nullptr;
+    return dyn_cast<SCEVConstant>(AR->getStepRecurrence(SE));
+  };
+  const SCEVConstant *Step0 = GetStep(Ptr0);
+  const SCEVConstant *Step1 = GetStep(Ptr1);
+  auto *Dist = dyn_cast<SCEVConstant>(SE.getMinusSCEV(Ptr1, Ptr0));
+  if (!Step0 || Step0 != Step1 || !Dist)
+    return false;
+
+  int64_t Step = Step0->getAPInt().getSExtValue();
+  int64_t D = Dist->getAPInt().getSExtValue();
+  int64_t Size0 = DL.getTypeStoreSize(getAccessType(I0));
+  int64_t Size1 = DL.getTypeStoreSize(getAccessType(I1));
+
+  // The same locations are accessed in every iteration.
+  if (Step == 0)
+    return D >= Size0 || D + Size1 <= 0;
+  // The first loop moves away from the access of the second one after a
+  // single iteration.
+  if (Step > 0)
+    return D + Size1 <= Step;
+  return Step + Size0 <= D;
+}
+
+void LoopFuser::fuse(Loop *L0, Loop *L1) {
+  BasicBlock *Preheader0 = L0->getLoopPreheader();
+  BasicBlock *Header0 = L0->getHeader();
+  BasicBlock *Latch0 = L0->getLoopLatch();
+  BasicBlock *Preheader1 = L1->getLoopPreheader();
+  BasicBlock *Header1 = L1->getHeader();
+  BasicBlock *Latch1 = L1->getLoopLatch();
+
+  DEBUG(dbgs() << "LF: Fusing loops " << Header0->getName() << " and "
+               << Header1->getName() << "\n");
+  ORE.emitOptimizationRemark(LF_NAME, L0,
+                             "fused with the loop " + Header1->getName());
+  ++FuseCounter;
+
+  SE.forgetLoop(L0);
+  SE.forgetLoop(L1);
+
+  // The backedge of the fused loop comes from the second latch.
+  for (auto I = Header0->begin(); auto *PN = dyn_cast<PHINode>(I); ++I)
+    PN->setIncomingBlock(PN->getBasicBlockIndex(Latch0), Latch1);
+
+  // The header PHIs of the second loop move to the first header. Their
+  // initial values don't depend on the first loop.
+  SmallVector<PHINode *, 8> PHIs;
+  for (auto I = Header1->begin(); auto *PN = dyn_cast<PHINode>(I); ++I)
+    PHIs.push_back(PN);
+  for (PHINode *PN : PHIs) {
+    PN->setIncomingBlock(PN->getBasicBlockIndex(Preheader1), Preheader0);
+    PN->moveBefore(Header0->getFirstNonPHI());
+  }
+
+  // The first latch falls through to the second loop, whose latch decides
+  // whether to iterate again.
+  auto *LatchBr0 = cast<BranchInst>(Latch0->getTerminator());
+  Value *Cond0 = LatchBr0->getCondition();
+  BranchInst::Create(Header1, LatchBr0);
+  LatchBr0->eraseFromParent();
+  RecursivelyDeleteTriviallyDeadInstructions(Cond0);
+
+  auto *LatchBr1 = cast<BranchInst>(Latch1->getTerminator());
+  for (unsigned I = 0, E = LatchBr1->getNumSuccessors(); I != E; ++I)
+    if (LatchBr1->getSuccessor(I) == Header1)
+      LatchBr1->setSuccessor(I, Header0);
+
+  // Nothing reaches the block between the loops anymore.
+  LI.removeBlock(Preheader1);
+  Preheader1->eraseFromParent();
+
+  // Move the blocks and subloops of the second loop into the first one, and
+  // remove it from the loop forest.
+  for (BasicBlock *BB : L1->blocks()) {
+    L0->addBlockEntry(BB);
+    if (LI.getLoopFor(BB) == L1)
+      LI.changeLoopFor(BB, L0);
+  }
+  while (!L1->empty())
+    L0->addChildLoop(L1->removeChildLoop(std::prev(L1->end())));
+  if (Loop *Parent = L1->getParentLoop())
+    Parent->removeChildLoop(std::find(Parent->begin(), Parent->end(), L1));
+  else
+    LI.removeLoop(std::find(LI.begin(), LI.end(), L1));
+  Candidates.erase(L0);
+  Candidates.erase(L1);
+  delete L1;
+
+  DT.recalculate(F);
+  PDT.recalculate(F);
+}
+
+static bool runImpl(Function &F, LoopInfo &LI, DominatorTree &DT,
+                    PostDominatorTree &PDT, ScalarEvolution &SE,
+                    DependenceInfo &DI, OptimizationRemarkEmitter &ORE) {
+  return LoopFuser(F, LI, DT, PDT, SE, DI, ORE).run();
+}
+
+namespace {
+class LoopFuseLegacy : public FunctionPass {
+public:
+  static char ID;
+
+  LoopFuseLegacy() : FunctionPass(ID) {
+    initializeLoopFuseLegacyPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override {
+    if (skipFunction(F))
+      return false;
+
+    auto &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    auto &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    auto &PDT = getAnalysis<PostDominatorTreeWrapperPass>().getPostDomTree();
+    auto &SE = getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+    auto &DI = getAnalysis<DependenceAnalysisWrapperPass>().getDI();
+    auto &ORE = getAnalysis<OptimizationRemarkEmitterWrapperPass>().getORE();
+
+    return runImpl(F, LI, DT, PDT, SE, DI, ORE);
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequiredID(LoopSimplifyID);
+    AU.addRequiredID(LCSSAID);
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<PostDominatorTreeWrapperPass>();
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+    AU.addRequired<DependenceAnalysisWrapperPass>();
+    AU.addRequired<OptimizationRemarkEmitterWrapperPass>();
+
+    AU.addPreservedID(LoopSimplifyID);
+    AU.addPreservedID(LCSSAID);
+    AU.addPreserved<LoopInfoWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addPreserved<PostDominatorTreeWrapperPass>();
+  }
+};
+} // end anonymous namespace
+
+PreservedAnalyses LoopFusePass::run(Function &F, FunctionAnalysisManager &AM) {
+  auto &LI = AM.getResult<LoopAnalysis>(F);
+  auto &DT = AM.getResult<DominatorTreeAnalysis>(F);
+  auto &PDT = AM.getResult<PostDominatorTreeAnalysis>(F);
+  auto &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+  auto &DI = AM.getResult<DependenceAnalysis>(F);
+  auto &ORE = AM.getResult<OptimizationRemarkEmitterAnalysis>(F);
+
+  if (!runImpl(F, LI, DT, PDT, SE, DI, ORE))
+    return PreservedAnalyses::all();
+  PreservedAnalyses PA;
+  PA.preserve<LoopAnalysis>();
+  PA.preserve<DominatorTreeAnalysis>();
+  PA.preserve<PostDominatorTreeAnalysis>();
+  return PA;
+}
+
+char LoopFuseLegacy::ID = 0;
+static const char lf_name[] = "Loop Fusion";
+
+INITIALIZE_PASS_BEGIN(LoopFuseLegacy, LF_NAME, lf_name, false, false)
+INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
+INITIALIZE_PASS_DEPENDENCY(LCSSAWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(PostDominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DependenceAnalysisWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(OptimizationRemarkEmitterWrapperPass)
+INITIALIZE_PASS_END(LoopFuseLegacy, LF_NAME, lf_name, false, false)
+
+FunctionPass *llvm::createLoopFusePass() { return new LoopFuseLegacy(); }
@@ -0,0 +1,940 @@
+//===- NewGVN.cpp - Global Value Numbering on MemorySSA -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass performs global value numbering over SSA form and MemorySSA,
+// without the memory dependence queries GVN is built on.
+//
+// The values of the function are partitioned into congruence classes. The
+// partition starts out optimistic: every instruction is in a class of values
+// which are not known yet, and every block but the entry is unreachable. The
+// instructions are then symbolically evaluated, in reverse post order, to an
+// expression over the leaders of the classes of their operands, and moved to
+// the class of that expression, which gets their users evaluated again, until
+// nothing changes anymore. Only the edges a branch can take given the classes
+// of its condition become reachable, and the operands of phis coming from the
+// unreachable edges are ignored.
+//
+// Loads are evaluated over the memory state they read, as given by the
+// MemorySSA walker, so that two loads of congruent addresses which read the
+// same memory state are congruent. A MemoryPhi whose reachable incoming memory
+// states are congruent is congruent to them, and a load of the address of the
+// store defining its memory state is congruent to the stored value. An
+// operation on phis of its block is evaluated as a phi of the operation in
+// each predecessor when all of these are available, which finds congruences
+// through phis (phi-of-ops).
+//
+// Finally, each instruction is replaced by a member of its class which
+// dominates it, if any. Every evaluation of an instruction is linear in its
+// number of operands, and instructions are only evaluated again when one of
+// their inputs changes class, which keeps the pass close to linear in
+// practice.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Scalar/NewGVN.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/Analysis/GlobalsModRef.h"
+#include "llvm/Analysis/InstructionSimplify.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/MemorySSA.h"
+#include <algorithm>
+using namespace llvm;
+
+#define DEBUG_TYPE "newgvn"
+
+STATISTIC(NumGVNInstrDeleted, "Number of instructions deleted");
+STATISTIC(NumGVNInstrReplaced, "Number of instructions replaced");
+STATISTIC(NumGVNIterations, "Number of iterations over the touched values");
+STATISTIC(NumGVNIterationLimit,
+          "Number of functions given up on at the iteration limit");
+
+static cl::opt<unsigned> MaxIterations(
+    "newgvn-max-iterations", cl::init(100), cl::Hidden,
+    cl::desc("The maximum number of iterations over the touched values "
+             "before giving up on a function (default = 100)"));
+
+namespace {
+
+/// The symbolic value of an instruction, over the leaders of the classes of
+/// its operands.
+struct Expression {
+  unsigned Opcode = 0;
+  /// The predicate of a comparison.
+  unsigned Predicate = 0;
+  Type *Ty = nullptr;
+  /// The type a getelementptr indexes, the block of a phi, or the memory state
+  /// a load or a call reads.
+  const void *Extra = nullptr;
+  /// The leaders of the operands. For a phi, each reachable predecessor,
+  /// followed by the leader of the value coming from it.
+  SmallVector<Value *, 4> Operands;
+  /// The indices of an extractvalue or an insertvalue.
+  SmallVector<unsigned, 2> Indices;
+
+  bool operator==(const Expression &Other) const {
+    return Opcode == Other.Opcode && Predicate == Other.Predicate &&
+           Ty == Other.Ty && Extra == Other.Extra &&
+           Operands == Other.Operands && Indices == Other.Indices;
+  }
+
+  hash_code getHashValue() const {
+    return hash_combine(
+        Opcode, Predicate, Ty, Extra,
+        hash_combine_range(Operands.begin(), Operands.end()),
+        hash_combine_range(Indices.begin(), Indices.end()));
+  }
+};
+
+struct ExpressionKeyInfo {
+  static const Expression *getEmptyKey() {
+    return DenseMapInfo<const Expression *>::getEmptyKey();
+  }
+  static const Expression *getTombstoneKey() {
+    return DenseMapInfo<const Expression *>::getTombstoneKey();
+  }
+  static unsigned getHashValue(const Expression *E) {
+    return E->getHashValue();
+  }
+  static bool isEqual(const Expression *LHS, const Expression *RHS) {
+    if (LHS == RHS)
+      return true;
+    if (LHS == getEmptyKey() || LHS == getTombstoneKey() ||
+        RHS == getEmptyKey() || RHS == getTombstoneKey())
+      return false;
+    return *LHS == *RHS;
+  }
+};
+
+/// A set of values known to be equal.
+struct CongruenceClass {
+  CongruenceClass(Value *Leader, const Expression *Expr)
+      : Leader(Leader), Expr(Expr) {}
+
+  /// The value the expressions over the members refer to: a member, or the
+  /// constant or argument the members are equal to. Null for the class of the
+  /// instructions which are not known yet.
+  Value *Leader;
+  /// The expression the members evaluate to, or null if the class stands for
+  /// a single value.
+  const Expression *Expr;
+  SmallPtrSet<Instruction *, 4> Members;
+};
+
+class NewGVN {
+  Function &F;
+  DominatorTree *DT;
+  const TargetLibraryInfo *TLI;
+  MemorySSA *MSSA;
+  MemorySSAWalker *Walker;
+  const DataLayout &DL;
+
+  SpecificBumpPtrAllocator<Expression> ExpressionAllocator;
+  std::vector<std::unique_ptr<CongruenceClass>> CongruenceClasses;
+  /// The class of the instructions which are not known yet.
+  CongruenceClass *TOPClass = nullptr;
+  DenseMap<Instruction *, CongruenceClass *> ValueToClass;
+  DenseMap<const Expression *, CongruenceClass *, ExpressionKeyInfo>
+      ExpressionToClass;
+  /// The classes of the instructions which are only equal to themselves.
+  DenseMap<Instruction *, CongruenceClass *> UniqueClasses;
+  /// The classes of the constants and arguments.
+  DenseMap<Value *, CongruenceClass *> ValueClasses;
+
+  /// The leaders of the MemoryPhis; null while not known yet.
+  DenseMap<const MemoryAccess *, MemoryAccess *> MemoryLeaders;
+  /// The loads and calls which read each memory state.
+  DenseMap<const MemoryAccess *, SmallPtrSet<Instruction *, 2>> MemoryUsers;
+  /// The instructions whose evaluation depends on a value they do not use,
+  /// such as the value stored to the address of a load.
+  DenseMap<const Value *, SmallPtrSet<Instruction *, 2>> AdditionalUsers;
+
+  DenseSet<const BasicBlock *> ReachableBlocks;
+  DenseSet<BasicBlockEdge> ReachableEdges;
+
+  /// The reverse post order numbers of the instructions and MemoryPhis.
+  DenseMap<const Value *, unsigned> InstrDFS;
+  std::vector<Value *> DFSToValue;
+  /// The range of numbers of the values of each block.
+  DenseMap<const BasicBlock *, std::pair<unsigned, unsigned>> BlockInstRange;
+  BitVector TouchedInstructions;
+
+  SmallVector<Instruction *, 8> InstructionsToErase;
+
+public:
+  NewGVN(Function &F, DominatorTree *DT, const TargetLibraryInfo *TLI,
+         MemorySSA *MSSA)
+      : F(F), DT(DT), TLI(TLI), MSSA(MSSA), Walker(MSSA->getWalker()),
+        DL(F.getParent()->getDataLayout()) {}
+
+  bool runGVN();
+
+private:
+  CongruenceClass *createClass(Value *Leader, const Expression *Expr);
+  CongruenceClass *getClassForValue(Value *V);
+  CongruenceClass *getClassForExpression(const Expression &E,
+                                         Instruction *I);
+  CongruenceClass *getUniqueClass(Instruction *I);
+  Value *lookupOperandLeader(Value *V) const;
+  MemoryAccess *lookupMemoryLeader(MemoryAccess *MA) const;
+  unsigned getRank(const Value *V) const;
+  bool shouldSwapOperands(const Value *A, const Value *B) const;
+
+  void createOperationExpression(Instruction *I, ArrayRef<Value *> Ops,
+                                 Expression &E) const;
+  Value *simplifyOperation(Instruction *I, const Expression &E) const;
+  void createPHIExpression(
+      BasicBlock *BB, Type *Ty,
+      SmallVectorImpl<std::pair<BasicBlock *, Value *>> &Incoming,
+      Expression &E) const;
+
+  CongruenceClass *performSymbolicEvaluation(Instruction *I);
+  CongruenceClass *evaluatePHI(PHINode *PN);
+  CongruenceClass *evaluatePhiOfOps(Instruction *I);
+  CongruenceClass *evaluateLoad(LoadInst *LI);
+  CongruenceClass *evaluateCall(CallInst *CI);
+
+  void valueNumberInstruction(Instruction *I);
+  void valueNumberMemoryPhi(MemoryPhi *MP);
+  void moveToClass(Instruction *I, CongruenceClass *New);
+  void processOutgoingEdges(TerminatorInst *TI);
+  void updateReachableEdge(BasicBlock *From, BasicBlock *To);
+
+  void touch(const Value *V);
+  void markUsersTouched(Value *V);
+  void markMemoryUsersTouched(MemoryAccess *MA);
+  void addAdditionalUser(Value *V, Instruction *User);
+
+  bool eliminateInstructions();
+  bool replaceInstruction(Instruction *I, Value *Repl);
+};
+
+} // end anonymous namespace
+
+CongruenceClass *NewGVN::createClass(Value *Leader, const Expression *Expr) {
+  CongruenceClasses.push_back(make_unique<CongruenceClass>(Leader, Expr));
+  return CongruenceClasses.back().get();
+}
+
+CongruenceClass *NewGVN::getClassForValue(Value *V) {
+  if (auto *I = dyn_cast<Instruction>(V)) {
+    if (CongruenceClass *CC = ValueToClass.lookup(I))
+      return CC;
+    return getUniqueClass(I);
+  }
+  CongruenceClass *&CC = ValueClasses[V];
+  if (!CC)
+    CC = createClass(V, nullptr);
+  return CC;
+}
+
+CongruenceClass *NewGVN::getClassForExpression(const Expression &E,
+                                               Instruction *I) {
+  auto It = ExpressionToClass.find(&E);
+  if (It != ExpressionToClass.end())
+    return It->second;
+  Expression *Stored = new (ExpressionAllocator.Allocate()) Expression(E);
+  CongruenceClass *CC = createClass(I, Stored);
+  ExpressionToClass[Stored] = CC;
+  return CC;
+}
+
+CongruenceClass *NewGVN::getUniqueClass(Instruction *I) {
+  CongruenceClass *&CC = UniqueClasses[I];
+  if (!CC)
+    CC = createClass(I, nullptr);
+  return CC;
+}
+
+/// \returns the leader of the class of \p V, or null if \p V is not known
+/// yet.
+Value *NewGVN::lookupOperandLeader(Value *V) const {
+  if (auto *I = dyn_cast<Instruction>(V)) {
+    CongruenceClass *CC = ValueToClass.lookup(I);
+    return CC ? CC->Leader : I;
+  }
+  return V;
+}
+
+/// \returns the leader of the memory state \p MA, or null if \p MA is not
+/// known yet.
+MemoryAccess *NewGVN::lookupMemoryLeader(MemoryAccess *MA) const {
+  if (!isa<MemoryPhi>(MA))
+    return MA;
+  return MemoryLeaders.lookup(MA);
+}
+
+/// \returns the rank which orders the operands of commutative operations:
+/// constants first, then arguments, then instructions.
+unsigned NewGVN::getRank(const Value *V) const {
+  if (isa<Constant>(V))
+    return 0;
+  if (auto *A = dyn_cast<Argument>(V))
+    return 1 + A->getArgNo();
+  return 1 + F.arg_size() + InstrDFS.lookup(V);
+}
+
+bool NewGVN::shouldSwapOperands(const Value *A, const Value *B) const {
+  unsigned RankA = getRank(A), RankB = getRank(B);
+  return RankA > RankB || (RankA == RankB && std::less<const Value *>()(B, A));
+}
+
+static bool isOperation(const Instruction *I) {
+  return isa<BinaryOperator>(I) || isa<CmpInst>(I) || isa<CastInst>(I) ||
+         isa<SelectInst>(I) || isa<GetElementPtrInst>(I) ||
+         isa<ExtractValueInst>(I) || isa<InsertValueInst>(I) ||
+         isa<ExtractElementInst>(I) || isa<InsertElementInst>(I) ||
+         isa<ShuffleVectorInst>(I);
+}
+
+/// Fill \p E with the expression of the operation \p I over \p Ops, the
+/// leaders of its operands, in canonical form.
+void NewGVN::createOperationExpression(Instruction *I, ArrayRef<Value *> Ops,
+                                       Expression &E) const {
+  E.Opcode = I->getOpcode();
+  E.Ty = I->getType();
+  E.Operands.append(Ops.begin(), Ops.end());
+  if (auto *CI = dyn_cast<CmpInst>(I)) {
+    E.Predicate = CI->getPredicate();
+    if (shouldSwapOperands(E.Operands[0], E.Operands[1])) {
+      std::swap(E.Operands[0], E.Operands[1]);
+      E.Predicate = CI->getSwappedPredicate();
+    }
+  } else if (I->isCommutative()) {
+    if (shouldSwapOperands(E.Operands[0], E.Operands[1]))
+      std::swap(E.Operands[0], E.Operands[1]);
+  } else if (auto *GEP = dyn_cast<GetElementPtrInst>(I)) {
+    E.Extra = GEP->getSourceElementType();
+  } else if (auto *EVI = dyn_cast<ExtractValueInst>(I)) {
+    E.Indices.append(EVI->idx_begin(), EVI->idx_end());
+  } else if (auto *IVI = dyn_cast<InsertValueInst>(I)) {
+    E.Indices.append(IVI->idx_begin(), IVI->idx_end());
+  }
+}
+
+/// \returns an existing value the operation \p I is equal to, given \p E, its
+/// expression, or null.
+Value *NewGVN::simplifyOperation(Instruction *I, const Expression &E) const {
+  // The operands are leaders, which need not dominate I, so the
+  // simplifications must not depend on the context of I.
+  ArrayRef<Value *> Ops = E.Operands;
+  if (isa<BinaryOperator>(I))
+    return SimplifyBinOp(E.Opcode, Ops[0], Ops[1], DL, TLI);
+  if (isa<CmpInst>(I))
+    return SimplifyCmpInst(E.Predicate, Ops[0], Ops[1], DL, TLI);
+  if (isa<SelectInst>(I))
+    return SimplifySelectInst(Ops[0], Ops[1], Ops[2], DL, TLI);
+  if (auto *GEP = dyn_cast<GetElementPtrInst>(I))
+    return SimplifyGEPInst(GEP->getSourceElementType(), Ops, DL, TLI);
+  if (isa<CastInst>(I)) {
+    if (auto *C = dyn_cast<Constant>(Ops[0]))
+      return ConstantFoldCastOperand(E.Opcode, C, E.Ty, DL);
+    return nullptr;
+  }
+  if (isa<ExtractValueInst>(I))
+    return SimplifyExtractValueInst(Ops[0], E.Indices, DL, TLI);
+  if (isa<InsertValueInst>(I))
+    return SimplifyInsertValueInst(Ops[0], Ops[1], E.Indices, DL, TLI);
+  if (isa<ExtractElementInst>(I))
+    return SimplifyExtractElementInst(Ops[0], Ops[1], DL, TLI);
+  return nullptr;
+}
+
+/// Fill \p E with the expression of a phi of \p BB, given the leaders of the
+/// values coming from its reachable predecessors in \p Incoming.
+void NewGVN::createPHIExpression(
+    BasicBlock *BB, Type *Ty,
+    SmallVectorImpl<std::pair<BasicBlock *, Value *>> &Incoming,
+    Expression &E) const {
+  std::sort(Incoming.begin(), Incoming.end(),
+            [&](const std::pair<BasicBlock *, Value *> &LHS,
+                const std::pair<BasicBlock *, Value *> &RHS) {
+              return BlockInstRange.lookup(LHS.first).first <
+                     BlockInstRange.lookup(RHS.first).first;
+            });
+  // A predecessor with several edges to BB has the same value on each.
+  Incoming.erase(std::unique(Incoming.begin(), Incoming.end()),
+                 Incoming.end());
+
+  E.Opcode = Instruction::PHI;
+  E.Ty = Ty;
+  E.Extra = BB;
+  for (const auto &In : Incoming) {
+    E.Operands.push_back(In.first);
+    E.Operands.push_back(In.second);
+  }
+}
+
+CongruenceClass *NewGVN::evaluatePHI(PHINode *PN) {
+  BasicBlock *BB = PN->getParent();
+  SmallVector<std::pair<BasicBlock *, Value *>, 4> Incoming;
+  for (unsigned I = 0, E = PN->getNumIncomingValues(); I != E; ++I) {
+    BasicBlock *Pred = PN->getIncomingBlock(I);
+    Value *V = PN->getIncomingValue(I);
+    if (V == PN || !ReachableEdges.count({Pred, BB}))
+      continue;
+    // Optimistically ignore the values which are not known yet. They come
+    // from back edges, and get PN evaluated again once known. A value
+    // congruent to PN does not change what PN is either.
+    Value *Leader = lookupOperandLeader(V);
+    if (!Leader || Leader == PN)
+      continue;
+    Incoming.push_back(std::make_pair(Pred, Leader));
+  }
+  if (Incoming.empty())
+    return TOPClass;
+
+  // A phi whose incoming values are all congruent is congruent to them, as
+  // long as they dominate it.
+  Value *Same = Incoming.front().second;
+  if (std::all_of(Incoming.begin(), Incoming.end(),
+                  [&](const std::pair<BasicBlock *, Value *> &In) {
+                    return In.second == Same;
+                  })) {
+    auto *SameInst = dyn_cast<Instruction>(Same);
+    if (!SameInst || DT->dominates(SameInst, PN))
+      return getClassForValue(Same);
+  }
+
+  Expression E;
+  createPHIExpression(BB, PN->getType(), Incoming, E);
+  return getClassForExpression(E, PN);
+}
+
+/// Evaluate the operation \p I on phis of its block as the phi of the
+/// operation translated into each reachable predecessor, when the translated
+/// operation is available at the end of all of them.
+///
+/// \returns the class of the phi, or null.
+CongruenceClass *NewGVN::evaluatePhiOfOps(Instruction *I) {
+  BasicBlock *BB = I->getParent();
+  bool UsesPhi = false;
+  for (Value *Op : I->operands()) {
+    auto *OpI = dyn_cast<Instruction>(Op);
+    if (!OpI || OpI->getParent() != BB)
+      continue;
+    // An operand defined in BB by anything but a phi does not exist in the
+    // predecessors.
+    if (!isa<PHINode>(OpI))
+      return nullptr;
+    UsesPhi = true;
+  }
+  if (!UsesPhi)
+    return nullptr;
+
+  SmallVector<std::pair<BasicBlock *, Value *>, 4> Incoming;
+  SmallPtrSet<BasicBlock *, 4> Visited;
+  for (BasicBlock *Pred : predecessors(BB)) {
+    if (!Visited.insert(Pred).second || !ReachableEdges.count({Pred, BB}))
+      continue;
+
+    SmallVector<Value *, 4> Ops;
+    for (Value *Op : I->operands()) {
+      auto *PN = dyn_cast<PHINode>(Op);
+      if (PN && PN->getParent() == BB) {
+        Op = PN->getIncomingValueForBlock(Pred);
+        addAdditionalUser(Op, I);
+      }
+      Value *Leader = lookupOperandLeader(Op);
+      if (!Leader)
+        return nullptr;
+      Ops.push_back(Leader);
+    }
+
+    Expression E;
+    createOperationExpression(I, Ops, E);
+    Value *Avail = simplifyOperation(I, E);
+    if (Avail) {
+      Avail = lookupOperandLeader(Avail);
+    } else {
+      auto It = ExpressionToClass.find(&E);
+      if (It != ExpressionToClass.end())
+        Avail = It->second->Leader;
+    }
+    if (!Avail)
+      return nullptr;
+    auto *AvailInst = dyn_cast<Instruction>(Avail);
+    if (AvailInst && !DT->dominates(AvailInst->getParent(), Pred))
+      return nullptr;
+    addAdditionalUser(Avail, I);
+    Incoming.push_back(std::make_pair(Pred, Avail));
+  }
+  if (Incoming.empty())
+    return nullptr;
+
+  DEBUG(dbgs() << "Found phi of ops for " << *I << "\n");
+  Expression E;
+  createPHIExpression(BB, I->getType(), Incoming, E);
+  return getClassForExpression(E, I);
+}
+
+CongruenceClass *NewGVN::evaluateLoad(LoadInst *LI) {
+  auto *MU = dyn_cast_or_null<MemoryUse>(MSSA->getMemoryAccess(LI));
+  if (!LI->isSimple() || !MU)
+    return getUniqueClass(LI);
+  Value *Ptr = lookupOperandLeader(LI->getPointerOperand());
+  if (!Ptr)
+    return TOPClass;
+
+  if (auto *C = dyn_cast<Constant>(Ptr))
+    if (Constant *Folded = ConstantFoldLoadFromConstPtr(C, LI->getType(), DL))
+      return getClassForValue(Folded);
+
+  MemoryAccess *Clobber = Walker->getClobberingMemoryAccess(MU);
+  MemoryUsers[Clobber].insert(LI);
+  MemoryAccess *Mem = lookupMemoryLeader(Clobber);
+  if (!Mem)
+    return TOPClass;
+
+  // A load of the address a store writes reads the stored value.
+  if (auto *MD = dyn_cast<MemoryDef>(Mem))
+    if (auto *SI = dyn_cast_or_null<StoreInst>(MD->getMemoryInst()))
+      if (SI->isSimple() &&
+          SI->getValueOperand()->getType() == LI->getType()) {
+        addAdditionalUser(SI->getPointerOperand(), LI);
+        if (lookupOperandLeader(SI->getPointerOperand()) == Ptr) {
+          addAdditionalUser(SI->getValueOperand(), LI);
+          return getClassForValue(SI->getValueOperand());
+        }
+      }
+
+  Expression E;
+  E.Opcode = LI->getOpcode();
+  E.Ty = LI->getType();
+  E.Extra = Mem;
+  E.Operands.push_back(Ptr);
+  return getClassForExpression(E, LI);
+}
+
+CongruenceClass *NewGVN::evaluateCall(CallInst *CI) {
+  if (!CI->onlyReadsMemory() || CI->hasOperandBundles() ||
+      CI->isConvergent())
+    return getUniqueClass(CI);
+
+  Expression E;
+  E.Opcode = CI->getOpcode();
+  E.Ty = CI->getType();
+  for (Value *Op : CI->operands()) {
+    Value *Leader = lookupOperandLeader(Op);
+    if (!Leader)
+      return TOPClass;
+    E.Operands.push_back(Leader);
+  }
+
+  // Calls which do not access memory at all are equal whatever the state of
+  // memory, even if MemorySSA was built without the alias analysis needed to
+  // know that.
+  if (CI->doesNotAccessMemory())
+    return getClassForExpression(E, CI);
+
+  if (MemoryAccess *MA = MSSA->getMemoryAccess(CI)) {
+    auto *MU = dyn_cast<MemoryUse>(MA);
+    if (!MU)
+      return getUniqueClass(CI);
+    MemoryAccess *Clobber = Walker->getClobberingMemoryAccess(MU);
+    MemoryUsers[Clobber].insert(CI);
+    MemoryAccess *Mem = lookupMemoryLeader(Clobber);
+    if (!Mem)
+      return TOPClass;
+    E.Extra = Mem;
+  }
+  return getClassForExpression(E, CI);
+}
+
+/// \returns the class \p I belongs to given the current classes of its
+/// inputs.
+CongruenceClass *NewGVN::performSymbolicEvaluation(Instruction *I) {
+  if (auto *PN = dyn_cast<PHINode>(I))
+    return evaluatePHI(PN);
+  if (auto *LI = dyn_cast<LoadInst>(I))
+    return evaluateLoad(LI);
+  if (auto *CI = dyn_cast<CallInst>(I))
+    return evaluateCall(CI);
+  if (!isOperation(I))
+    return getUniqueClass(I);
+
+  SmallVector<Value *, 4> Ops;
+  for (Value *Op : I->operands()) {
+    Value *Leader = lookupOperandLeader(Op);
+    if (!Leader)
+      return TOPClass;
+    Ops.push_back(Leader);
+  }
+  Expression E;
+  createOperationExpression(I, Ops, E);
+  if (Value *V = simplifyOperation(I, E)) {
+    addAdditionalUser(V, I);
+    return getClassForValue(V);
+  }
+
+  auto It = ExpressionToClass.find(&E);
+  if (It != ExpressionToClass.end())
+    return It->second;
+  if (CongruenceClass *CC = evaluatePhiOfOps(I))
+    return CC;
+  return getClassForExpression(E, I);
+}
+
+void NewGVN::touch(const Value *V) {
+  auto It = InstrDFS.find(V);
+  if (It != InstrDFS.end())
+    TouchedInstructions.set(It->second);
+}
+
+void NewGVN::markUsersTouched(Value *V) {
+  for (User *U : V->users())
+    if (auto *I = dyn_cast<Instruction>(U))
+      touch(I);
+  auto It = AdditionalUsers.find(V);
+  if (It != AdditionalUsers.end())
+    for (Instruction *I : It->second)
+      touch(I);
+}
+
+void NewGVN::markMemoryUsersTouched(MemoryAccess *MA) {
+  for (User *U : MA->users())
+    if (isa<MemoryPhi>(U))
+      touch(U);
+  auto It = MemoryUsers.find(MA);
+  if (It != MemoryUsers.end())
+    for (Instruction *I : It->second)
+      touch(I);
+}
+
+void NewGVN::addAdditionalUser(Value *V, Instruction *User) {
+  if (isa<Instruction>(V))
+    AdditionalUsers[V].insert(User);
+}
+
+void NewGVN::moveToClass(Instruction *I, CongruenceClass *New) {
+  CongruenceClass *Old = ValueToClass.lookup(I);
+  if (Old == New)
+    return;
+  DEBUG(dbgs() << "Moving " << *I << " to a new class\n");
+  Old->Members.erase(I);
+  New->Members.insert(I);
+  ValueToClass[I] = New;
+  markUsersTouched(I);
+
+  if (Old == TOPClass || Old->Leader != I)
+    return;
+  if (Old->Members.empty()) {
+    if (Old->Expr)
+      ExpressionToClass.erase(Old->Expr);
+    return;
+  }
+  // The expressions over the old leader are stale.
+  Old->Leader = *std::min_element(
+      Old->Members.begin(), Old->Members.end(),
+      [&](const Instruction *LHS, const Instruction *RHS) {
+        return InstrDFS.lookup(LHS) < InstrDFS.lookup(RHS);
+      });
+  for (Instruction *M : Old->Members)
+    markUsersTouched(M);
+}
+
+void NewGVN::valueNumberMemoryPhi(MemoryPhi *MP) {
+  BasicBlock *BB = MP->getBlock();
+  MemoryAccess *Same = nullptr;
+  bool AllSame = true;
+  for (unsigned I = 0, E = MP->getNumIncomingValues(); I != E; ++I) {
+    if (!ReachableEdges.count({MP->getIncomingBlock(I), BB}))
+      continue;
+    MemoryAccess *Leader = lookupMemoryLeader(MP->getIncomingValue(I));
+    if (!Leader || Leader == MP)
+      continue;
+    if (Same && Same != Leader) {
+      AllSame = false;
+      break;
+    }
+    Same = Leader;
+  }
+
+  MemoryAccess *New = AllSame ? Same : MP;
+  MemoryAccess *&Leader = MemoryLeaders[MP];
+  if (Leader == New)
+    return;
+  Leader = New;
+  markMemoryUsersTouched(MP);
+}
+
+void NewGVN::updateReachableEdge(BasicBlock *From, BasicBlock *To) {
+  if (!ReachableEdges.insert({From, To}).second)
+    return;
+  const auto &Range = BlockInstRange[To];
+  if (ReachableBlocks.insert(To).second) {
+    TouchedInstructions.set(Range.first, Range.second);
+    return;
+  }
+  // Only the phis of To see the new edge.
+  if (MemoryPhi *MP = MSSA->getMemoryAccess(To))
+    touch(MP);
+  for (Instruction &I : *To) {
+    if (!isa<PHINode>(I))
+      break;
+    touch(&I);
+  }
+}
+
+void NewGVN::processOutgoingEdges(TerminatorInst *TI) {
+  BasicBlock *BB = TI->getParent();
+  if (auto *BI = dyn_cast<BranchInst>(TI)) {
+    if (BI->isConditional()) {
+      Value *Cond = lookupOperandLeader(BI->getCondition());
+      if (!Cond)
+        return;
+      if (auto *CI = dyn_cast<ConstantInt>(Cond)) {
+        updateReachableEdge(BB, BI->getSuccessor(CI->isOne() ? 0 : 1));
+        return;
+      }
+    }
+  } else if (auto *SI = dyn_cast<SwitchInst>(TI)) {
+    Value *Cond = lookupOperandLeader(SI->getCondition());
+    if (!Cond)
+      return;
+    if (auto *CI = dyn_cast<ConstantInt>(Cond)) {
+      updateReachableEdge(BB, SI->findCaseValue(CI).getCaseSuccessor());
+      return;
+    }
+  }
+  for (BasicBlock *Succ : TI->successors())
+    updateReachableEdge(BB, Succ);
+}
+
+void NewGVN::valueNumberInstruction(Instruction *I) {
+  if (auto *TI = dyn_cast<TerminatorInst>(I))
+    processOutgoingEdges(TI);
+  if (I->getType()->isVoidTy())
+    return;
+  moveToClass(I, performSymbolicEvaluation(I));
+}
+
+static void patchReplacementInstruction(Instruction *I, Value *Repl) {
+  auto *ReplInst = dyn_cast<Instruction>(Repl);
+  if (!ReplInst || ReplInst->getOpcode() != I->getOpcode())
+    return;
+
+  // Patch the replacement so that it is not more restrictive than the value
+  // being replaced, which it may not execute under the same conditions as.
+  ReplInst->andIRFlags(I);
+  static const unsigned KnownIDs[] = {
+      LLVMContext::MD_tbaa,           LLVMContext::MD_alias_scope,
+      LLVMContext::MD_noalias,        LLVMContext::MD_range,
+      LLVMContext::MD_fpmath,         LLVMContext::MD_invariant_load,
+      LLVMContext::MD_invariant_group};
+  combineMetadata(ReplInst, I, KnownIDs);
+}
+
+bool NewGVN::replaceInstruction(Instruction *I, Value *Repl) {
+  bool HasUses = !I->use_empty();
+  bool CanErase = !I->mayHaveSideEffects() && !I->isEHPad() &&
+                  !isa<TerminatorInst>(I);
+  if (!HasUses && !CanErase)
+    return false;
+
+  DEBUG(dbgs() << "Replacing " << *I << " with " << *Repl << "\n");
+  patchReplacementInstruction(I, Repl);
+  if (HasUses) {
+    I->replaceAllUsesWith(Repl);
+    ++NumGVNInstrReplaced;
+  }
+  if (CanErase) {
+    InstructionsToErase.push_back(I);
+    ++NumGVNInstrDeleted;
+  }
+  return true;
+}
+
+bool NewGVN::eliminateInstructions() {
+  DT->updateDFSNumbers();
+  bool Changed = false;
+  for (const auto &CC : CongruenceClasses) {
+    if (CC.get() == TOPClass || CC->Members.empty())
+      continue;
+
+    // Constants and arguments are available everywhere.
+    if (!isa<Instruction>(CC->Leader)) {
+      for (Instruction *M : CC->Members)
+        Changed |= replaceInstruction(M, CC->Leader);
+      continue;
+    }
+    if (CC->Members.size() == 1)
+      continue;
+
+    // Walk the members in dominator tree order, keeping a stack of the
+    // members which dominate the current one, and replace each member by
+    // the innermost of them.
+    SmallVector<Instruction *, 8> Members(CC->Members.begin(),
+                                          CC->Members.end());
+    std::sort(Members.begin(), Members.end(),
+              [&](Instruction *LHS, Instruction *RHS) {
+                unsigned LHSIn = DT->getNode(LHS->getParent())->getDFSNumIn();
+                unsigned RHSIn = DT->getNode(RHS->getParent())->getDFSNumIn();
+                if (LHSIn != RHSIn)
+                  return LHSIn < RHSIn;
+                return InstrDFS.lookup(LHS) < InstrDFS.lookup(RHS);
+              });
+    SmallVector<Instruction *, 8> Stack;
+    for (Instruction *M : Members) {
+      const DomTreeNode *N = DT->getNode(M->getParent());
+      while (!Stack.empty()) {
+        const DomTreeNode *Top = DT->getNode(Stack.back()->getParent());
+        if (Top->getDFSNumIn() <= N->getDFSNumIn() &&
+            N->getDFSNumOut() <= Top->getDFSNumOut())
+          break;
+        Stack.pop_back();
+      }
+      // The value of an invoke is only available on its normal edge.
+      if (Stack.empty() ||
+          (isa<InvokeInst>(Stack.back()) && !DT->dominates(Stack.back(), M))) {
+        Stack.push_back(M);
+        continue;
+      }
+      Changed |= replaceInstruction(M, Stack.back());
+    }
+  }
+
+  for (Instruction *I : InstructionsToErase)
+    I->eraseFromParent();
+  return Changed;
+}
+
+bool NewGVN::runGVN() {
+  // Number the MemoryPhis and instructions in reverse post order, which
+  // evaluates every instruction after the definitions of its operands except
+  // for the incoming values of phis on back edges.
+  ReversePostOrderTraversal<Function *> RPOT(&F);
+  for (BasicBlock *BB : RPOT) {
+    unsigned Start = DFSToValue.size();
+    if (MemoryPhi *MP = MSSA->getMemoryAccess(BB)) {
+      InstrDFS[MP] = DFSToValue.size();
+      DFSToValue.push_back(MP);
+    }
+    for (Instruction &I : *BB) {
+      InstrDFS[&I] = DFSToValue.size();
+      DFSToValue.push_back(&I);
+    }
+    BlockInstRange[BB] = std::make_pair(Start, (unsigned)DFSToValue.size());
+  }
+
+  TOPClass = createClass(nullptr, nullptr);
+  for (Value *V : DFSToValue) {
+    auto *I = dyn_cast<Instruction>(V);
+    if (I && !I->getType()->isVoidTy()) {
+      TOPClass->Members.insert(I);
+      ValueToClass[I] = TOPClass;
+    }
+  }
+
+  TouchedInstructions.resize(DFSToValue.size());
+  BasicBlock *Entry = &F.getEntryBlock();
+  ReachableBlocks.insert(Entry);
+  const auto &EntryRange = BlockInstRange[Entry];
+  TouchedInstructions.set(EntryRange.first, EntryRange.second);
+
+  unsigned Iterations = 0;
+  while (TouchedInstructions.any()) {
+    if (++Iterations > MaxIterations) {
+      DEBUG(dbgs() << "Giving up on " << F.getName() << " after "
+                   << MaxIterations << " iterations\n");
+      ++NumGVNIterationLimit;
+      return false;
+    }
+    ++NumGVNIterations;
+    for (int Idx = TouchedInstructions.find_first(); Idx != -1;
+         Idx = TouchedInstructions.find_next(Idx)) {
+      TouchedInstructions.reset(Idx);
+      Value *V = DFSToValue[Idx];
+      if (auto *MP = dyn_cast<MemoryPhi>(V)) {
+        if (ReachableBlocks.count(MP->getBlock()))
+          valueNumberMemoryPhi(MP);
+        continue;
+      }
+      auto *I = cast<Instruction>(V);
+      if (ReachableBlocks.count(I->getParent()))
+        valueNumberInstruction(I);
+    }
+  }
+  DEBUG(dbgs() << "Value numbering of " << F.getName() << " converged in "
+               << Iterations << " iterations\n");
+
+  return eliminateInstructions();
+}
+
+PreservedAnalyses NewGVNPass::run(Function &F,
+                                  AnalysisManager<Function> &AM) {
+  auto &DT = AM.getResult<DominatorTreeAnalysis>(F);
+  auto &TLI = AM.getResult<TargetLibraryAnalysis>(F);
+  auto &MSSA = AM.getResult<MemorySSAAnalysis>(F);
+  if (!NewGVN(F, &DT, &TLI, &MSSA).runGVN())
+    return PreservedAnalyses::all();
+
+  PreservedAnalyses PA;
+  PA.preserve<DominatorTreeAnalysis>();
+  PA.preserve<GlobalsAA>();
+  return PA;
+}
+
+namespace {
+class NewGVNLegacyPass : public FunctionPass {
+public:
+  static char ID;
+
+  NewGVNLegacyPass() : FunctionPass(ID) {
+    initializeNewGVNLegacyPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override {
+    if (skipFunction(F))
+      return false;
+    auto &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    auto &TLI = getAnalysis<TargetLibraryInfoWrapperPass>().getTLI();
+    auto &MSSA = getAnalysis<MemorySSAWrapperPass>().getMSSA();
+    return NewGVN(F, &DT, &TLI, &MSSA).runGVN();
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<TargetLibraryInfoWrapperPass>();
+    AU.addRequired<MemorySSAWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addPreserved<GlobalsAAWrapperPass>();
+  }
+};
+} // end anonymous namespace
+
+char NewGVNLegacyPass::ID = 0;
+INITIALIZE_PASS_BEGIN(NewGVNLegacyPass, "newgvn",
+                      "Global Value Numbering on MemorySSA", false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(MemorySSAWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(GlobalsAAWrapperPass)
+INITIALIZE_PASS_END(NewGVNLegacyPass, "newgvn",
+                    "Global Value Numbering on MemorySSA", false, false)
+
+FunctionPass *llvm::createNewGVNPass() { return new NewGVNLegacyPass(); }
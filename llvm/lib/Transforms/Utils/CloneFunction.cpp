@@ -14,6 +14,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/InstructionSimplify.h"
@@ -657,8 +659,6 @@ Loop *llvm::cloneLoopWithPreheader(BasicBlock *Before, BasicBlock *LoopDomBB,
                                    const Twine &NameSuffix, LoopInfo *LI,
                                    DominatorTree *DT,
                                    SmallVectorImpl<BasicBlock *> &Blocks) {
-  assert(OrigLoop->getSubLoops().empty() && 
-         "Loop to be cloned cannot have inner loop");
   Function *F = OrigLoop->getHeader()->getParent();
   Loop *ParentLoop = OrigLoop->getParentLoop();
 
@@ -668,6 +668,17 @@ Loop *llvm::cloneLoopWithPreheader(BasicBlock *Before, BasicBlock *LoopDomBB,
   else
     LI->addTopLevelLoop(NewLoop);
 
+  // Create the new inner loops, nested like the original ones.
+  DenseMap<Loop *, Loop *> LMap;
+  LMap[OrigLoop] = NewLoop;
+  for (Loop *CurLoop : depth_first(OrigLoop)) {
+    if (CurLoop == OrigLoop)
+      continue;
+    Loop *NewCurLoop = new Loop();
+    LMap[CurLoop->getParentLoop()]->addChildLoop(NewCurLoop);
+    LMap[CurLoop] = NewCurLoop;
+  }
+
   BasicBlock *OrigPH = OrigLoop->getLoopPreheader();
   assert(OrigPH && "No preheader");
   BasicBlock *NewPH = CloneBasicBlock(OrigPH, VMap, NameSuffix, F);
@@ -687,7 +698,7 @@ Loop *llvm::cloneLoopWithPreheader(BasicBlock *Before, BasicBlock *LoopDomBB,
     VMap[BB] = NewBB;
 
     // Update LoopInfo.
-    NewLoop->addBasicBlockToLoop(NewBB, *LI);
+    LMap[LI->getLoopFor(BB)]->addBasicBlockToLoop(NewBB, *LI);
 
     // Add DominatorTree node. After seeing all blocks, update to correct IDom.
     DT->addNewBlock(NewBB, NewPH);
@@ -695,6 +706,11 @@ Loop *llvm::cloneLoopWithPreheader(BasicBlock *Before, BasicBlock *LoopDomBB,
     Blocks.push_back(NewBB);
   }
 
+  // The blocks of the inner loops were not necessarily added header first.
+  for (const auto &Loops : LMap)
+    Loops.second->moveToHeader(
+        cast<BasicBlock>(VMap[Loops.first->getHeader()]));
+
   for (BasicBlock *BB : OrigLoop->getBlocks()) {
     // Update DominatorTree.
     BasicBlock *IDomBB = DT->getNode(BB)->getIDom()->getBlock();
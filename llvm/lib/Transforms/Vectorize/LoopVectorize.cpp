@@ -49,7 +49,9 @@
 #include "llvm/Transforms/Vectorize/LoopVectorize.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
@@ -89,6 +91,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Transforms/Utils/LoopUtils.h"
 #include "llvm/Transforms/Utils/LoopVersioning.h"
@@ -105,6 +108,8 @@ using namespace llvm::PatternMatch;
 
 STATISTIC(LoopsVectorized, "Number of loops vectorized");
 STATISTIC(LoopsAnalyzed, "Number of loops analyzed for vectorization");
+STATISTIC(LoopEpiloguesVectorized, "Number of loop epilogues vectorized");
+STATISTIC(OuterLoopsVectorized, "Number of outer loops vectorized");
 
 static cl::opt<bool>
     EnableIfConversion("enable-if-conversion", cl::init(true), cl::Hidden,
@@ -122,6 +127,24 @@ static cl::opt<bool> MaximizeBandwidth(
     cl::desc("Maximize bandwidth when selecting vectorization factor which "
              "will be determined by the smallest type in loop."));
 
+static cl::opt<bool> EnableEpilogueVectorization(
+    "enable-epilogue-vectorization", cl::init(false), cl::Hidden,
+    cl::desc("Enable vectorization of the remainder of vectorized loops with "
+             "a narrower vectorization factor."));
+
+/// We only vectorize the remainder of loops which leave at least this many
+/// iterations to it, that is whose vectorization factor times interleave count
+/// is at least this number.
+static cl::opt<unsigned> EpilogueVectorizationMinVF(
+    "epilogue-vectorization-min-vf", cl::init(16), cl::Hidden,
+    cl::desc("Only vectorize the remainder of loops whose vectorization "
+             "factor times interleave count is at least this value."));
+
+static cl::opt<bool> EnableOuterLoopVectorization(
+    "enable-outer-loop-vectorization", cl::init(false), cl::Hidden,
+    cl::desc("Enable vectorization of outer loops whose inner loop has the "
+             "same control flow in all the vector lanes."));
+
 static cl::opt<bool> EnableInterleavedMemAccesses(
     "enable-interleaved-mem-accesses", cl::init(false), cl::Hidden,
     cl::desc("Enable vectorization on interleaved memory accesses in a loop"));
@@ -1626,6 +1649,12 @@ public:
   /// possible.
   VectorizationFactor selectVectorizationFactor(bool OptForSize);
 
+  /// \return The vectorization factor of the vector epilogue of the loop once
+  /// it is vectorized with \p MainVF and interleaved \p MainIC times, or 1 if
+  /// the remainder iterations are better left to the scalar loop. Must be
+  /// called after selectVectorizationFactor.
+  unsigned selectEpilogueVectorizationFactor(unsigned MainVF, unsigned MainIC);
+
   /// \return The size (in bits) of the smallest and widest types in the code
   /// that needs to be vectorized. We ignore values that remain scalar such as
   /// 64 bit loop indices.
@@ -1804,6 +1833,15 @@ static void addInnerLoop(Loop &L, SmallVectorImpl<Loop *> &V) {
     addInnerLoop(*InnerL, V);
 }
 
+/// Collect the loops whose only inner loop is innermost.
+static void addOuterLoop(Loop &L, SmallVectorImpl<Loop *> &V) {
+  if (L.getSubLoops().size() == 1 && L.getSubLoops()[0]->empty())
+    return V.push_back(&L);
+
+  for (Loop *InnerL : L)
+    addOuterLoop(*InnerL, V);
+}
+
 /// The LoopVectorize Pass.
 struct LoopVectorize : public FunctionPass {
   /// Pass identification, replacement for typeid
@@ -3715,9 +3753,10 @@ void InnerLoopVectorizer::vectorizeLoop() {
       if (!LCSSAPhi)
         break;
 
-      // All PHINodes need to have a single entry edge, or two if
-      // we already fixed them.
-      assert(LCSSAPhi->getNumIncomingValues() < 3 && "Invalid LCSSA PHI");
+      // All PHINodes need to have a single entry edge from the loop, plus
+      // one from the middle block of each vector loop already created for it.
+      assert(LCSSAPhi->getBasicBlockIndex(LoopMiddleBlock) == -1 &&
+             "Invalid LCSSA PHI");
 
       // We found our reduction value exit-PHI. Update it with the
       // incoming bypass edge.
@@ -3915,7 +3954,7 @@ void InnerLoopVectorizer::fixLCSSAPHIs() {
     auto *LCSSAPhi = dyn_cast<PHINode>(&LEI);
     if (!LCSSAPhi)
       break;
-    if (LCSSAPhi->getNumIncomingValues() == 1)
+    if (LCSSAPhi->getBasicBlockIndex(LoopMiddleBlock) == -1)
       LCSSAPhi->addIncoming(UndefValue::get(LCSSAPhi->getType()),
                             LoopMiddleBlock);
   }
@@ -4326,9 +4365,12 @@ void InnerLoopVectorizer::updateAnalysis() {
   // Forget the original basic block.
   PSE.getSE()->forgetLoop(OrigLoop);
 
-  // Update the dominator tree information.
-  assert(DT->properlyDominates(LoopBypassBlocks.front(), LoopExitBlock) &&
-         "Entry does not dominate exit.");
+  // Update the dominator tree information. The exit block is usually dominated
+  // by the entry of the skeleton, unless the loop is the remainder of another
+  // vector loop whose middle block branches to the exit too.
+  BasicBlock *ExitDom = DT->findNearestCommonDominator(
+      DT->getNode(LoopExitBlock)->getIDom()->getBlock(),
+      LoopBypassBlocks.front());
 
   // We don't predicate stores by this point, so the vector body should be a
   // single loop.
@@ -4337,7 +4379,7 @@ void InnerLoopVectorizer::updateAnalysis() {
   DT->addNewBlock(LoopMiddleBlock, LoopVectorBody);
   DT->addNewBlock(LoopScalarPreHeader, LoopBypassBlocks[0]);
   DT->changeImmediateDominator(LoopScalarBody, LoopScalarPreHeader);
-  DT->changeImmediateDominator(LoopExitBlock, LoopBypassBlocks[0]);
+  DT->changeImmediateDominator(LoopExitBlock, ExitDom);
 
   DEBUG(DT->verifyDomTree());
 }
@@ -5357,6 +5399,38 @@ LoopVectorizationCostModel::selectVectorizationFactor(bool OptForSize) {
   return Factor;
 }
 
+unsigned
+LoopVectorizationCostModel::selectEpilogueVectorizationFactor(unsigned MainVF,
+                                                              unsigned MainIC) {
+  // The scalar loop runs fewer than MainVF * MainIC iterations after the
+  // vector loop, or all of them when there are fewer than that. A vector
+  // epilogue costs a second copy of the loop and of its runtime checks, so it
+  // is only worth it when that leaves many iterations to the scalar loop.
+  if (MainVF * MainIC < EpilogueVectorizationMinVF)
+    return 1;
+
+  // Unless the vector loop is interleaved, the epilogue must be narrower than
+  // the vector loop to run at all.
+  unsigned MaxVF = MainIC > 1 ? MainVF : MainVF / 2;
+  float Cost = expectedCost(1).first;
+  unsigned Width = 1;
+  for (unsigned i = 2; i <= MaxVF; i *= 2) {
+    VectorizationCostTy C = expectedCost(i);
+    float VectorCost = C.first / (float)i;
+    DEBUG(dbgs() << "LV: Vector epilogue of width " << i
+                 << " costs: " << (int)VectorCost << ".\n");
+    if (!C.second)
+      continue;
+    if (VectorCost < Cost) {
+      Cost = VectorCost;
+      Width = i;
+    }
+  }
+
+  DEBUG(dbgs() << "LV: Selecting epilogue VF: " << Width << ".\n");
+  return Width;
+}
+
 std::pair<unsigned, unsigned>
 LoopVectorizationCostModel::getSmallestAndWidestTypes() {
   unsigned MinWidth = -1U;
@@ -6390,6 +6464,944 @@ static void AddRuntimeUnrollDisableMetaData(Loop *L) {
   }
 }
 
+//===----------------------------------------------------------------------===//
+// Outer loop vectorization.
+//
+// An outer loop whose inner loop has the same control flow for all the lanes
+// of the vector loop, such as a loop over the pixels of an image running a
+// fixed-size stencil, is vectorized as a whole: the loop nest is cloned into a
+// vector loop nest which runs VF iterations of the outer loop at a time, with
+// the branches of the nest left as they are. The original loop nest runs the
+// remaining iterations.
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// The plan to vectorize an outer loop: the recipe which produces the vector
+/// form of each instruction of the loop nest which varies across the lanes.
+/// The other instructions compute the same value for all the lanes, and are
+/// kept as they are.
+class OuterLoopVectorizationPlan {
+public:
+  enum RecipeKind {
+    /// The induction variable of the outer loop.
+    RK_Induction,
+    /// Replace the instruction with its vector form.
+    RK_Widen,
+    /// Replace the load or store with one of consecutive elements.
+    RK_WidenMemory,
+    /// Replace the load or store with one for each lane.
+    RK_Scalarize
+  };
+
+  OuterLoopVectorizationPlan(Loop *L) : TheLoop(L), Induction(nullptr) {}
+
+  /// \return True if \p V is the same for all the lanes.
+  bool isUniform(const Value *V) const {
+    auto *I = dyn_cast<Instruction>(V);
+    return !I || !Recipes.count(I);
+  }
+
+  /// \return The recipe of the varying instruction \p I.
+  RecipeKind getRecipe(const Instruction *I) const {
+    assert(!isUniform(I) && "Uniform instructions have no recipe");
+    return Recipes.find(I)->second;
+  }
+
+  /// The outer loop.
+  Loop *TheLoop;
+  /// The integer induction variable of the outer loop.
+  PHINode *Induction;
+  InductionDescriptor InductionDesc;
+  /// The recipes of the varying instructions.
+  DenseMap<const Instruction *, RecipeKind> Recipes;
+};
+
+/// Checks whether an outer loop can be vectorized, and builds its plan.
+///
+/// The outer loop must have a single inner loop, and an integer induction
+/// variable as its only header phi. Every branch of the loop nest but the
+/// exiting branch of the outer loop must be the same for all the lanes, so
+/// that the control flow of the nest does not need to be predicated. The
+/// iterations of the outer loop must be annotated as independent.
+class OuterLoopVectorizationLegality {
+public:
+  OuterLoopVectorizationLegality(Loop *L, ScalarEvolution *SE,
+                                 const DataLayout &DL,
+                                 OptimizationRemarkEmitter *ORE,
+                                 LoopVectorizeHints *Hints)
+      : TheLoop(L), SE(SE), DL(DL), ORE(ORE), Hints(Hints), Plan(L) {}
+
+  /// \return True if the loop nest can be vectorized, in which case its plan
+  /// is available from getPlan.
+  bool canVectorize();
+
+  const OuterLoopVectorizationPlan &getPlan() const { return Plan; }
+
+private:
+  /// Check the shape of the loop nest and the outer loop induction.
+  bool canVectorizeLoopNest();
+
+  /// Find the varying instructions, check that they can be vectorized, and
+  /// give them a recipe.
+  bool canVectorizeInstrs();
+
+  /// \return The distance in bytes between the values of \p S in consecutive
+  /// iterations of the outer loop, if it is a known constant.
+  Optional<int64_t> getStride(const SCEV *S) const;
+
+  void emitAnalysis(const LoopAccessReport &Message) const {
+    emitAnalysisDiag(TheLoop, *Hints, *ORE, Message);
+  }
+
+  Loop *TheLoop;
+  ScalarEvolution *SE;
+  const DataLayout &DL;
+  OptimizationRemarkEmitter *ORE;
+  LoopVectorizeHints *Hints;
+  OuterLoopVectorizationPlan Plan;
+};
+
+/// Estimates the cost of the plan of an outer loop for each vectorization
+/// factor. Instructions of the inner loop are weighted by its trip count.
+class OuterLoopVectorizationCostModel {
+public:
+  OuterLoopVectorizationCostModel(const OuterLoopVectorizationPlan &Plan,
+                                  ScalarEvolution *SE,
+                                  const TargetTransformInfo &TTI,
+                                  const DataLayout &DL,
+                                  const LoopVectorizeHints *Hints)
+      : Plan(Plan), SE(SE), TTI(TTI), DL(DL), Hints(Hints) {}
+
+  /// \return The most profitable vectorization factor, or 1 if the loop is
+  /// not worth vectorizing.
+  unsigned selectVectorizationFactor();
+
+private:
+  /// \return The expected cost of one iteration of the loop nest vectorized
+  /// with \p VF, or of the scalar loop nest if \p VF is 1.
+  unsigned expectedCost(unsigned VF);
+
+  /// \return The cost of \p I in the loop nest vectorized with \p VF.
+  unsigned getInstructionCost(Instruction *I, unsigned VF);
+
+  const OuterLoopVectorizationPlan &Plan;
+  ScalarEvolution *SE;
+  const TargetTransformInfo &TTI;
+  const DataLayout &DL;
+  const LoopVectorizeHints *Hints;
+};
+
+/// Creates the vector loop nest of an outer loop following its plan.
+class OuterLoopVectorizer {
+public:
+  OuterLoopVectorizer(const OuterLoopVectorizationPlan &Plan, LoopInfo *LI,
+                      DominatorTree *DT, ScalarEvolution *SE,
+                      const DataLayout &DL, unsigned VF)
+      : Plan(Plan), LI(LI), DT(DT), SE(SE), DL(DL), VF(VF),
+        Builder(Plan.TheLoop->getHeader()->getContext()),
+        VectorPreHeader(nullptr) {}
+
+  /// Create the vector loop nest in front of the original one, which is left
+  /// to run the remaining iterations.
+  /// \return The vector outer loop.
+  Loop *vectorize();
+
+private:
+  /// \return The clone in the vector loop nest of \p V, which is \p V itself
+  /// if it is defined outside the loop nest.
+  Value *getClone(Value *V) {
+    Value *Clone = VMap.lookup(V);
+    return Clone ? Clone : V;
+  }
+
+  /// \return The vector form of \p V, broadcasting uniform values.
+  Value *getVectorValue(Value *V);
+
+  /// \return The value of \p V in lane \p Lane.
+  Value *getScalarValue(Value *V, unsigned Lane);
+
+  /// Set the insertion point to the definition of \p V in the vector loop
+  /// nest, where its vector and scalar forms are placed.
+  void setInsertPointAt(Value *V);
+
+  /// Create the vector form of the varying instruction \p I.
+  void vectorizeInstruction(Instruction *I);
+
+  /// Create the vector form of the load or store \p I.
+  void vectorizeMemoryInstruction(Instruction *I);
+
+  const OuterLoopVectorizationPlan &Plan;
+  LoopInfo *LI;
+  DominatorTree *DT;
+  ScalarEvolution *SE;
+  const DataLayout &DL;
+  unsigned VF;
+  IRBuilder<> Builder;
+
+  BasicBlock *VectorPreHeader;
+  /// Maps the loop nest to the vector loop nest.
+  ValueToValueMapTy VMap;
+  /// The vector form of the values of the loop nest.
+  DenseMap<Value *, Value *> VectorValues;
+  /// The values of the loop nest in each lane.
+  DenseMap<std::pair<Value *, unsigned>, Value *> ScalarValues;
+  /// The vector phis, whose incoming values are added once all the vector
+  /// values are created.
+  SmallVector<std::pair<PHINode *, PHINode *>, 4> VectorPhis;
+};
+
+} // end anonymous namespace
+
+bool OuterLoopVectorizationLegality::canVectorize() {
+  return canVectorizeLoopNest() && canVectorizeInstrs();
+}
+
+bool OuterLoopVectorizationLegality::canVectorizeLoopNest() {
+  if (TheLoop->getSubLoops().size() != 1 ||
+      !TheLoop->getSubLoops()[0]->empty()) {
+    emitAnalysis(VectorizationReport()
+                 << "outer loop does not have a single innermost loop");
+    return false;
+  }
+
+  for (Loop *L : {TheLoop, TheLoop->getSubLoops()[0]}) {
+    BasicBlock *Latch = L->getLoopLatch();
+    if (!L->getLoopPreheader() || !Latch || L->getExitingBlock() != Latch ||
+        !L->getExitBlock() || !L->hasDedicatedExits() ||
+        !isa<BranchInst>(Latch->getTerminator())) {
+      emitAnalysis(VectorizationReport()
+                   << "loop control flow is not understood by vectorizer");
+      return false;
+    }
+  }
+
+  if (isa<SCEVCouldNotCompute>(SE->getBackedgeTakenCount(TheLoop))) {
+    emitAnalysis(VectorizationReport()
+                 << "could not determine number of loop iterations");
+    return false;
+  }
+
+  // The vector loop nest runs the iterations of the outer loop in any order,
+  // since it runs VF of them at once.
+  if (!TheLoop->isAnnotatedParallel()) {
+    emitAnalysis(VectorizationReport()
+                 << "outer loop iterations are not annotated as parallel");
+    return false;
+  }
+
+  for (Instruction &I : *TheLoop->getHeader()) {
+    auto *Phi = dyn_cast<PHINode>(&I);
+    if (!Phi)
+      break;
+    InductionDescriptor ID;
+    if (Plan.Induction || !InductionDescriptor::isInductionPHI(Phi, SE, ID) ||
+        ID.getKind() != InductionDescriptor::IK_IntInduction ||
+        !ID.getConstIntStepValue()) {
+      emitAnalysis(VectorizationReport(Phi)
+                   << "outer loop phi is not a simple induction variable");
+      return false;
+    }
+    Plan.Induction = Phi;
+    Plan.InductionDesc = ID;
+  }
+  if (!Plan.Induction) {
+    emitAnalysis(VectorizationReport()
+                 << "outer loop has no induction variable");
+    return false;
+  }
+
+  return true;
+}
+
+Optional<int64_t>
+OuterLoopVectorizationLegality::getStride(const SCEV *S) const {
+  if (SE->isLoopInvariant(S, TheLoop))
+    return 0;
+  auto *AR = dyn_cast<SCEVAddRecExpr>(S);
+  if (!AR || !AR->isAffine())
+    return None;
+  const SCEV *Step = AR->getStepRecurrence(*SE);
+  if (AR->getLoop() == TheLoop) {
+    if (auto *C = dyn_cast<SCEVConstant>(Step))
+      return C->getAPInt().getSExtValue();
+    return None;
+  }
+  // The value of a recurrence of the inner loop in a given iteration of the
+  // inner loop only depends on the outer loop through its start.
+  if (!TheLoop->contains(AR->getLoop()) || !SE->isLoopInvariant(Step, TheLoop))
+    return None;
+  return getStride(AR->getStart());
+}
+
+bool OuterLoopVectorizationLegality::canVectorizeInstrs() {
+  // The induction variable of the outer loop varies across the lanes, and so
+  // does everything computed from it.
+  SmallPtrSet<const Instruction *, 32> Varying;
+  Varying.insert(Plan.Induction);
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (BasicBlock *BB : TheLoop->blocks())
+      for (Instruction &I : *BB) {
+        if (Varying.count(&I))
+          continue;
+        for (Value *Op : I.operands()) {
+          auto *OpI = dyn_cast<Instruction>(Op);
+          if (OpI && Varying.count(OpI)) {
+            Varying.insert(&I);
+            Changed = true;
+            break;
+          }
+        }
+      }
+  }
+
+  BasicBlock *Latch = TheLoop->getLoopLatch();
+  for (BasicBlock *BB : TheLoop->blocks()) {
+    for (Instruction &I : *BB) {
+      for (User *U : I.users())
+        if (!TheLoop->contains(cast<Instruction>(U))) {
+          emitAnalysis(VectorizationReport(&I)
+                       << "value defined in the loop nest is used outside "
+                          "of it");
+          return false;
+        }
+
+      if (auto *Load = dyn_cast<LoadInst>(&I)) {
+        if (!Load->isSimple()) {
+          emitAnalysis(VectorizationReport(&I)
+                       << "read with atomic ordering or volatile read");
+          return false;
+        }
+      } else if (auto *Store = dyn_cast<StoreInst>(&I)) {
+        if (!Store->isSimple()) {
+          emitAnalysis(VectorizationReport(&I)
+                       << "write with atomic ordering or volatile write");
+          return false;
+        }
+      } else if (I.mayHaveSideEffects()) {
+        // Uniform instructions only run once for all the lanes.
+        emitAnalysis(VectorizationReport(&I)
+                     << "instruction with side effects cannot be vectorized");
+        return false;
+      }
+
+      if (!Varying.count(&I))
+        continue;
+
+      if (isa<TerminatorInst>(&I)) {
+        // The exiting branch of the outer loop is replaced by the one of the
+        // vector loop.
+        if (BB == Latch)
+          continue;
+        emitAnalysis(VectorizationReport(&I)
+                     << "control flow differs across the lanes");
+        return false;
+      }
+
+      if (&I == Plan.Induction) {
+        Plan.Recipes[&I] = OuterLoopVectorizationPlan::RK_Induction;
+        continue;
+      }
+
+      Type *Ty = isa<StoreInst>(&I)
+                     ? cast<StoreInst>(&I)->getValueOperand()->getType()
+                     : I.getType();
+      if (!VectorType::isValidElementType(Ty)) {
+        emitAnalysis(VectorizationReport(&I)
+                     << "instruction return type cannot be vectorized");
+        return false;
+      }
+
+      if (isa<LoadInst>(&I) || isa<StoreInst>(&I)) {
+        // Accesses to consecutive elements in consecutive iterations of the
+        // outer loop are widened, and the others are done lane by lane. Loads
+        // of uniform addresses are uniform.
+        Value *Ptr = getPointerOperand(&I);
+        Optional<int64_t> Stride = getStride(SE->getSCEV(Ptr));
+        bool Consecutive =
+            Stride && *Stride == (int64_t)DL.getTypeAllocSize(Ty) &&
+            DL.getTypeAllocSizeInBits(Ty) == DL.getTypeSizeInBits(Ty);
+        Plan.Recipes[&I] = Consecutive
+                               ? OuterLoopVectorizationPlan::RK_WidenMemory
+                               : OuterLoopVectorizationPlan::RK_Scalarize;
+        continue;
+      }
+
+      if (auto *CI = dyn_cast<CallInst>(&I)) {
+        Intrinsic::ID ID = getVectorIntrinsicIDForCall(CI, nullptr);
+        bool HasScalarOpd = false;
+        for (unsigned Idx = 0, E = CI->getNumArgOperands(); Idx != E; ++Idx)
+          HasScalarOpd |= hasVectorInstrinsicScalarOpd(ID, Idx);
+        if (!ID || !isTriviallyVectorizable(ID) || HasScalarOpd) {
+          emitAnalysis(VectorizationReport(&I)
+                       << "call instruction cannot be vectorized");
+          return false;
+        }
+        Plan.Recipes[&I] = OuterLoopVectorizationPlan::RK_Widen;
+        continue;
+      }
+
+      if (!isa<BinaryOperator>(&I) && !isa<CastInst>(&I) &&
+          !isa<CmpInst>(&I) && !isa<SelectInst>(&I) &&
+          !isa<GetElementPtrInst>(&I) && !isa<PHINode>(&I)) {
+        emitAnalysis(VectorizationReport(&I)
+                     << "instruction cannot be vectorized");
+        return false;
+      }
+      Plan.Recipes[&I] = OuterLoopVectorizationPlan::RK_Widen;
+    }
+  }
+
+  return true;
+}
+
+unsigned OuterLoopVectorizationCostModel::getInstructionCost(Instruction *I,
+                                                             unsigned VF) {
+  // Uniform instructions run once for all the lanes.
+  unsigned Width = Plan.isUniform(I) ? 1 : VF;
+  Type *RetTy = ToVectorTy(I->getType(), Width);
+
+  switch (I->getOpcode()) {
+  case Instruction::GetElementPtr:
+  case Instruction::PHI:
+  case Instruction::Br:
+    return 0;
+  case Instruction::Add:
+  case Instruction::FAdd:
+  case Instruction::Sub:
+  case Instruction::FSub:
+  case Instruction::Mul:
+  case Instruction::FMul:
+  case Instruction::UDiv:
+  case Instruction::SDiv:
+  case Instruction::FDiv:
+  case Instruction::URem:
+  case Instruction::SRem:
+  case Instruction::FRem:
+  case Instruction::Shl:
+  case Instruction::LShr:
+  case Instruction::AShr:
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+    return TTI.getArithmeticInstrCost(I->getOpcode(), RetTy);
+  case Instruction::Select: {
+    Value *Cond = cast<SelectInst>(I)->getCondition();
+    Type *CondTy =
+        ToVectorTy(Cond->getType(), Plan.isUniform(Cond) ? 1 : Width);
+    return TTI.getCmpSelInstrCost(I->getOpcode(), RetTy, CondTy);
+  }
+  case Instruction::ICmp:
+  case Instruction::FCmp:
+    return TTI.getCmpSelInstrCost(
+        I->getOpcode(), ToVectorTy(I->getOperand(0)->getType(), Width));
+  case Instruction::Load:
+  case Instruction::Store: {
+    Type *ValTy = isa<StoreInst>(I)
+                      ? cast<StoreInst>(I)->getValueOperand()->getType()
+                      : I->getType();
+    unsigned Alignment = isa<StoreInst>(I) ? cast<StoreInst>(I)->getAlignment()
+                                           : cast<LoadInst>(I)->getAlignment();
+    unsigned AS = getPointerOperand(I)->getType()->getPointerAddressSpace();
+    if (Width == 1)
+      return TTI.getMemoryOpCost(I->getOpcode(), ValTy, Alignment, AS);
+    Type *VectorTy = VectorType::get(ValTy, VF);
+    if (Plan.getRecipe(I) == OuterLoopVectorizationPlan::RK_WidenMemory)
+      return TTI.getMemoryOpCost(I->getOpcode(), VectorTy, Alignment, AS);
+    // One access per lane, and the insertion or extraction of its element.
+    unsigned ElementOpcode = isa<StoreInst>(I) ? Instruction::ExtractElement
+                                               : Instruction::InsertElement;
+    unsigned Cost = 0;
+    for (unsigned Lane = 0; Lane < VF; ++Lane)
+      Cost += TTI.getMemoryOpCost(I->getOpcode(), ValTy, Alignment, AS) +
+              TTI.getVectorInstrCost(ElementOpcode, VectorTy, Lane);
+    return Cost;
+  }
+  case Instruction::Call: {
+    Intrinsic::ID ID = getVectorIntrinsicIDForCall(cast<CallInst>(I), nullptr);
+    if (!ID)
+      return TTI.getUserCost(I);
+    SmallVector<Type *, 4> Tys;
+    for (Value *ArgOp : cast<CallInst>(I)->arg_operands())
+      Tys.push_back(ToVectorTy(ArgOp->getType(), Width));
+    FastMathFlags FMF;
+    if (auto *FPMO = dyn_cast<FPMathOperator>(I))
+      FMF = FPMO->getFastMathFlags();
+    return TTI.getIntrinsicInstrCost(ID, RetTy, Tys, FMF);
+  }
+  default:
+    if (auto *CI = dyn_cast<CastInst>(I))
+      return TTI.getCastInstrCost(
+          CI->getOpcode(), RetTy,
+          ToVectorTy(CI->getOperand(0)->getType(), Width));
+    return TTI.getUserCost(I);
+  }
+}
+
+unsigned OuterLoopVectorizationCostModel::expectedCost(unsigned VF) {
+  Loop *InnerLoop = Plan.TheLoop->getSubLoops()[0];
+  unsigned InnerTripCount = SE->getSmallConstantTripCount(InnerLoop);
+  unsigned Cost = 0;
+  for (BasicBlock *BB : Plan.TheLoop->blocks()) {
+    unsigned Weight =
+        InnerTripCount && InnerLoop->contains(BB) ? InnerTripCount : 1;
+    for (Instruction &I : *BB) {
+      if (isa<DbgInfoIntrinsic>(&I))
+        continue;
+      unsigned C = getInstructionCost(&I, VF);
+      // Check if we should override the cost.
+      if (ForceTargetInstructionCost.getNumOccurrences() > 0)
+        C = ForceTargetInstructionCost;
+      Cost += Weight * C;
+    }
+  }
+  return Cost;
+}
+
+unsigned OuterLoopVectorizationCostModel::selectVectorizationFactor() {
+  if (unsigned UserVF = Hints->getWidth()) {
+    DEBUG(dbgs() << "LV: Using user VF " << UserVF << ".\n");
+    return UserVF;
+  }
+
+  // As in getSmallestAndWidestTypes, only the loaded and stored values are
+  // examined, so that the induction and the address computations do not
+  // limit the width.
+  unsigned WidestType = 8;
+  for (const auto &Recipe : Plan.Recipes) {
+    const Instruction *I = Recipe.first;
+    if (!isa<LoadInst>(I) && !isa<StoreInst>(I))
+      continue;
+    Type *Ty = isa<StoreInst>(I)
+                   ? cast<StoreInst>(I)->getValueOperand()->getType()
+                   : I->getType();
+    // Ignore the pointers which are not loaded or stored consecutively.
+    if (Ty->isPointerTy() &&
+        Recipe.second != OuterLoopVectorizationPlan::RK_WidenMemory)
+      continue;
+    WidestType = std::max<unsigned>(WidestType, DL.getTypeSizeInBits(Ty));
+  }
+  unsigned MaxVF = TTI.getRegisterBitWidth(true) / WidestType;
+
+  float Cost = expectedCost(1);
+  unsigned Width = 1;
+  DEBUG(dbgs() << "LV: Scalar loop nest costs: " << (int)Cost << ".\n");
+  for (unsigned i = 2; i <= MaxVF; i *= 2) {
+    float VectorCost = expectedCost(i) / (float)i;
+    DEBUG(dbgs() << "LV: Vector loop nest of width " << i
+                 << " costs: " << (int)VectorCost << ".\n");
+    if (VectorCost < Cost) {
+      Cost = VectorCost;
+      Width = i;
+    }
+  }
+
+  DEBUG(dbgs() << "LV: Selecting outer loop VF: " << Width << ".\n");
+  return Width;
+}
+
+void OuterLoopVectorizer::setInsertPointAt(Value *V) {
+  auto *I = dyn_cast<Instruction>(V);
+  if (!I || !Plan.TheLoop->contains(I)) {
+    Builder.SetInsertPoint(VectorPreHeader->getTerminator());
+    return;
+  }
+  auto *Clone = cast<Instruction>(getClone(I));
+  if (isa<PHINode>(Clone))
+    Builder.SetInsertPoint(&*Clone->getParent()->getFirstInsertionPt());
+  else if (Plan.isUniform(I))
+    Builder.SetInsertPoint(&*++Clone->getIterator());
+  else
+    Builder.SetInsertPoint(Clone);
+}
+
+Value *OuterLoopVectorizer::getVectorValue(Value *V) {
+  auto It = VectorValues.find(V);
+  if (It != VectorValues.end())
+    return It->second;
+
+  assert(Plan.isUniform(V) && "Varying value used before its definition");
+  Value *Scalar = getClone(V);
+  if (auto *C = dyn_cast<Constant>(Scalar))
+    return ConstantVector::getSplat(VF, C);
+
+  IRBuilder<>::InsertPointGuard Guard(Builder);
+  setInsertPointAt(V);
+  Value *Broadcast = Builder.CreateVectorSplat(VF, Scalar, "broadcast");
+  VectorValues[V] = Broadcast;
+  return Broadcast;
+}
+
+Value *OuterLoopVectorizer::getScalarValue(Value *V, unsigned Lane) {
+  if (Plan.isUniform(V))
+    return getClone(V);
+
+  auto Key = std::make_pair(V, Lane);
+  auto It = ScalarValues.find(Key);
+  if (It != ScalarValues.end())
+    return It->second;
+
+  auto *I = cast<Instruction>(V);
+  Value *Scalar;
+  if (isa<GetElementPtrInst>(I) || isa<CastInst>(I)) {
+    // Addresses are cheaper to compute again in each lane than to extract
+    // from their vector form.
+    Instruction *New = I->clone();
+    for (unsigned Op = 0, E = I->getNumOperands(); Op != E; ++Op)
+      New->setOperand(Op, getScalarValue(I->getOperand(Op), Lane));
+    IRBuilder<>::InsertPointGuard Guard(Builder);
+    setInsertPointAt(V);
+    Scalar = Builder.Insert(New);
+  } else {
+    Value *Vector = getVectorValue(V);
+    IRBuilder<>::InsertPointGuard Guard(Builder);
+    setInsertPointAt(V);
+    Scalar = Builder.CreateExtractElement(Vector, Builder.getInt32(Lane));
+  }
+  ScalarValues[Key] = Scalar;
+  return Scalar;
+}
+
+void OuterLoopVectorizer::vectorizeMemoryInstruction(Instruction *I) {
+  auto *SI = dyn_cast<StoreInst>(I);
+  Type *ScalarTy = SI ? SI->getValueOperand()->getType() : I->getType();
+  Type *VectorTy = VectorType::get(ScalarTy, VF);
+  Value *Ptr = getPointerOperand(I);
+  unsigned Alignment =
+      SI ? SI->getAlignment() : cast<LoadInst>(I)->getAlignment();
+  // An alignment of 0 means target ABI alignment. We need to use the scalar's
+  // target ABI alignment in such a case.
+  if (!Alignment)
+    Alignment = DL.getABITypeAlignment(ScalarTy);
+
+  if (Plan.getRecipe(I) == OuterLoopVectorizationPlan::RK_WidenMemory) {
+    unsigned AddressSpace = Ptr->getType()->getPointerAddressSpace();
+    Value *VecPtr = Builder.CreateBitCast(getScalarValue(Ptr, 0),
+                                          VectorTy->getPointerTo(AddressSpace));
+    Instruction *NewI;
+    if (SI)
+      NewI = Builder.CreateAlignedStore(
+          getVectorValue(SI->getValueOperand()), VecPtr, Alignment);
+    else
+      NewI = Builder.CreateAlignedLoad(VecPtr, Alignment, "wide.load");
+    propagateMetadata(NewI, I);
+    if (!SI)
+      VectorValues[I] = NewI;
+    return;
+  }
+
+  Value *Vector = UndefValue::get(VectorTy);
+  for (unsigned Lane = 0; Lane < VF; ++Lane) {
+    Value *LanePtr = getScalarValue(Ptr, Lane);
+    Instruction *NewI;
+    if (SI)
+      NewI = Builder.CreateAlignedStore(
+          getScalarValue(SI->getValueOperand(), Lane), LanePtr, Alignment);
+    else
+      NewI = Builder.CreateAlignedLoad(LanePtr, Alignment);
+    propagateMetadata(NewI, I);
+    if (!SI)
+      Vector = Builder.CreateInsertElement(Vector, NewI,
+                                           Builder.getInt32(Lane));
+  }
+  if (!SI)
+    VectorValues[I] = Vector;
+}
+
+void OuterLoopVectorizer::vectorizeInstruction(Instruction *I) {
+  if (Plan.getRecipe(I) != OuterLoopVectorizationPlan::RK_Widen)
+    return vectorizeMemoryInstruction(I);
+
+  Value *New;
+  if (auto *Phi = dyn_cast<PHINode>(I)) {
+    PHINode *VecPhi = Builder.CreatePHI(ToVectorTy(Phi->getType(), VF),
+                                        Phi->getNumIncomingValues(), "vec.phi");
+    VectorPhis.push_back(std::make_pair(Phi, VecPhi));
+    New = VecPhi;
+  } else if (auto *BO = dyn_cast<BinaryOperator>(I)) {
+    New = Builder.CreateBinOp(BO->getOpcode(),
+                              getVectorValue(BO->getOperand(0)),
+                              getVectorValue(BO->getOperand(1)));
+    if (auto *VecOp = dyn_cast<Instruction>(New))
+      VecOp->copyIRFlags(BO);
+  } else if (auto *CI = dyn_cast<CastInst>(I)) {
+    New = Builder.CreateCast(CI->getOpcode(), getVectorValue(CI->getOperand(0)),
+                             ToVectorTy(CI->getType(), VF));
+  } else if (auto *Cmp = dyn_cast<CmpInst>(I)) {
+    Value *A = getVectorValue(Cmp->getOperand(0));
+    Value *B = getVectorValue(Cmp->getOperand(1));
+    if (isa<FCmpInst>(Cmp))
+      New = Builder.CreateFCmp(Cmp->getPredicate(), A, B);
+    else
+      New = Builder.CreateICmp(Cmp->getPredicate(), A, B);
+    if (auto *VecCmp = dyn_cast<Instruction>(New))
+      VecCmp->copyIRFlags(Cmp);
+  } else if (auto *Sel = dyn_cast<SelectInst>(I)) {
+    // A uniform condition selects the same operand in all the lanes.
+    Value *Cond = Sel->getCondition();
+    Cond = Plan.isUniform(Cond) ? getClone(Cond) : getVectorValue(Cond);
+    New = Builder.CreateSelect(Cond, getVectorValue(Sel->getTrueValue()),
+                               getVectorValue(Sel->getFalseValue()));
+  } else if (auto *GEP = dyn_cast<GetElementPtrInst>(I)) {
+    // Uniform operands are left scalar, which makes struct field indices
+    // valid.
+    auto getOperand = [&](Value *Op) {
+      return Plan.isUniform(Op) ? getClone(Op) : getVectorValue(Op);
+    };
+    SmallVector<Value *, 4> Indices;
+    for (Value *Index : make_range(GEP->idx_begin(), GEP->idx_end()))
+      Indices.push_back(getOperand(Index));
+    New = GEP->isInBounds()
+              ? Builder.CreateInBoundsGEP(GEP->getSourceElementType(),
+                                          getOperand(GEP->getPointerOperand()),
+                                          Indices)
+              : Builder.CreateGEP(GEP->getSourceElementType(),
+                                  getOperand(GEP->getPointerOperand()),
+                                  Indices);
+  } else {
+    auto *Call = cast<CallInst>(I);
+    Intrinsic::ID ID = getVectorIntrinsicIDForCall(Call, nullptr);
+    Type *Tys[] = {ToVectorTy(Call->getType(), VF)};
+    Function *VectorF =
+        Intrinsic::getDeclaration(Call->getModule(), ID, Tys);
+    SmallVector<Value *, 4> Args;
+    for (Value *ArgOp : Call->arg_operands())
+      Args.push_back(getVectorValue(ArgOp));
+    CallInst *VecCall = Builder.CreateCall(VectorF, Args);
+    if (isa<FPMathOperator>(VecCall))
+      VecCall->copyFastMathFlags(Call);
+    New = VecCall;
+  }
+  if (auto *NewI = dyn_cast<Instruction>(New))
+    propagateMetadata(NewI, I);
+  VectorValues[I] = New;
+}
+
+Loop *OuterLoopVectorizer::vectorize() {
+  Loop *L = Plan.TheLoop;
+  BasicBlock *CheckBlock = L->getLoopPreheader();
+  BasicBlock *Header = L->getHeader();
+  BasicBlock *Latch = L->getLoopLatch();
+  BasicBlock *ExitBlock = L->getExitBlock();
+  Function *F = Header->getParent();
+  const InductionDescriptor &ID = Plan.InductionDesc;
+
+  // The vector loop runs the largest multiple of VF not larger than the trip
+  // count. The trip count of a loop whose backedge-taken count is the largest
+  // value of its type wraps to 0, like those smaller than VF, and the vector
+  // loop is skipped.
+  const SCEV *BackedgeTakenCount = SE->getBackedgeTakenCount(L);
+  Type *IdxTy = BackedgeTakenCount->getType();
+  const SCEV *ExitCount =
+      SE->getAddExpr(BackedgeTakenCount, SE->getOne(IdxTy));
+  SCEVExpander Exp(*SE, DL, "induction");
+  Value *TripCount =
+      Exp.expandCodeFor(ExitCount, IdxTy, CheckBlock->getTerminator());
+  Builder.SetInsertPoint(CheckBlock->getTerminator());
+  Value *Remainder = Builder.CreateURem(
+      TripCount, ConstantInt::get(IdxTy, VF), "n.mod.vf");
+  Value *VectorTripCount = Builder.CreateSub(TripCount, Remainder, "n.vec");
+  Value *SkipVectorLoop = Builder.CreateICmpEQ(
+      VectorTripCount, ConstantInt::get(IdxTy, 0), "min.iters.check");
+
+  // Clone the loop nest in front of the original one, which is entered from
+  // a new preheader.
+  BasicBlock *ScalarPreHeader = SplitEdge(CheckBlock, Header, DT, LI);
+  ScalarPreHeader->setName("scalar.ph");
+  SmallVector<BasicBlock *, 8> VectorBlocks;
+  Loop *VectorLoop = cloneLoopWithPreheader(
+      ScalarPreHeader, CheckBlock, L, VMap, ".vec", LI, DT, VectorBlocks);
+  remapInstructionsInBlocks(VectorBlocks, VMap);
+  VectorPreHeader = VectorLoop->getLoopPreheader();
+  VectorPreHeader->setName("vector.ph");
+  ReplaceInstWithInst(
+      CheckBlock->getTerminator(),
+      BranchInst::Create(ScalarPreHeader, VectorPreHeader, SkipVectorLoop));
+
+  // The vector loop counts its iterations with a new induction variable, and
+  // exits to a middle block which skips the original loop nest if there are no
+  // iterations left.
+  BasicBlock *VectorHeader = VectorLoop->getHeader();
+  auto *VectorLatch = cast<BasicBlock>(VMap[Latch]);
+  BasicBlock *MiddleBlock = BasicBlock::Create(
+      F->getContext(), "middle.block", F, ScalarPreHeader);
+  if (Loop *ParentLoop = L->getParentLoop())
+    ParentLoop->addBasicBlockToLoop(MiddleBlock, *LI);
+  DT->addNewBlock(MiddleBlock, VectorLatch);
+  DT->changeImmediateDominator(ExitBlock, CheckBlock);
+
+  Builder.SetInsertPoint(&*VectorHeader->begin());
+  PHINode *Index = Builder.CreatePHI(IdxTy, 2, "index");
+  Builder.SetInsertPoint(VectorLatch->getTerminator());
+  Value *IndexNext =
+      Builder.CreateAdd(Index, ConstantInt::get(IdxTy, VF), "index.next");
+  Index->addIncoming(ConstantInt::get(IdxTy, 0), VectorPreHeader);
+  Index->addIncoming(IndexNext, VectorLatch);
+  TerminatorInst *OldLatchBr = VectorLatch->getTerminator();
+  BranchInst *LatchBr = BranchInst::Create(
+      MiddleBlock, VectorHeader,
+      Builder.CreateICmpEQ(IndexNext, VectorTripCount));
+  LatchBr->setDebugLoc(OldLatchBr->getDebugLoc());
+  LatchBr->setMetadata(LLVMContext::MD_loop,
+                       OldLatchBr->getMetadata(LLVMContext::MD_loop));
+  ReplaceInstWithInst(OldLatchBr, LatchBr);
+
+  BranchInst *MiddleBr =
+      BranchInst::Create(ExitBlock, ScalarPreHeader,
+                         ConstantInt::getTrue(F->getContext()), MiddleBlock);
+  Builder.SetInsertPoint(MiddleBr);
+  Type *StepTy = Plan.Induction->getType();
+  Value *EndValue = ID.transform(
+      Builder, Builder.CreateSExtOrTrunc(VectorTripCount, StepTy, "cast.vtc"),
+      SE, DL);
+  EndValue->setName("ind.end");
+  MiddleBr->setCondition(
+      Builder.CreateICmpEQ(TripCount, VectorTripCount, "cmp.n"));
+
+  // The original loop nest resumes where the vector loop stopped.
+  PHINode *ResumePhi = PHINode::Create(StepTy, 2, "bc.resume.val",
+                                       &ScalarPreHeader->front());
+  ResumePhi->addIncoming(ID.getStartValue(), CheckBlock);
+  ResumePhi->addIncoming(EndValue, MiddleBlock);
+  Plan.Induction->setIncomingValue(
+      Plan.Induction->getBasicBlockIndex(ScalarPreHeader), ResumePhi);
+
+  // The value of the induction variable of the outer loop in each lane.
+  Builder.SetInsertPoint(&*VectorHeader->getFirstInsertionPt());
+  Value *Base = ID.transform(
+      Builder, Builder.CreateSExtOrTrunc(Index, StepTy, "cast.index"), SE, DL);
+  int64_t Step = ID.getConstIntStepValue()->getSExtValue();
+  SmallVector<Constant *, 8> LaneSteps;
+  for (unsigned Lane = 0; Lane < VF; ++Lane) {
+    LaneSteps.push_back(ConstantInt::get(StepTy, Lane * Step));
+    ScalarValues[std::make_pair(Plan.Induction, Lane)] =
+        Lane ? Builder.CreateAdd(Base, LaneSteps.back()) : Base;
+  }
+  VectorValues[Plan.Induction] =
+      Builder.CreateAdd(Builder.CreateVectorSplat(VF, Base),
+                        ConstantVector::get(LaneSteps), "vec.ind");
+
+  // Create the vector form of the varying instructions in front of their
+  // clone, visiting definitions before their uses but in phis.
+  LoopBlocksDFS DFS(L);
+  DFS.perform(LI);
+  SmallVector<Instruction *, 32> VaryingClones;
+  for (BasicBlock *BB : make_range(DFS.beginRPO(), DFS.endRPO()))
+    for (Instruction &I : *BB) {
+      // The exiting branch of the vector loop was already replaced.
+      if (Plan.isUniform(&I) || isa<TerminatorInst>(&I))
+        continue;
+      auto *Clone = cast<Instruction>(VMap[&I]);
+      VaryingClones.push_back(Clone);
+      if (&I == Plan.Induction)
+        continue;
+      Builder.SetInsertPoint(Clone);
+      vectorizeInstruction(&I);
+    }
+
+  for (auto &Phis : VectorPhis) {
+    PHINode *Phi = Phis.first;
+    for (unsigned In = 0, E = Phi->getNumIncomingValues(); In != E; ++In)
+      Phis.second->addIncoming(
+          getVectorValue(Phi->getIncomingValue(In)),
+          cast<BasicBlock>(VMap[Phi->getIncomingBlock(In)]));
+  }
+
+  // The scalar clones of the varying instructions are only used by each
+  // other.
+  for (Instruction *Clone : VaryingClones)
+    Clone->dropAllReferences();
+  for (Instruction *Clone : VaryingClones)
+    Clone->eraseFromParent();
+
+  // Remove the vector and scalar forms which ended up unused.
+  SmallVector<WeakVH, 32> MaybeDead;
+  for (BasicBlock *BB : VectorBlocks)
+    for (Instruction &I : *BB)
+      if (isInstructionTriviallyDead(&I))
+        MaybeDead.push_back(&I);
+  for (WeakVH &V : MaybeDead)
+    if (V)
+      RecursivelyDeleteTriviallyDeadInstructions(V);
+
+  // The induction variable of the original loop nest now starts elsewhere.
+  SE->forgetLoop(L);
+  return VectorLoop;
+}
+
+bool LoopVectorizePass::processOuterLoop(Loop *L) {
+#ifndef NDEBUG
+  const std::string DebugLocStr = getDebugLocString(L);
+#endif /* NDEBUG */
+
+  DEBUG(dbgs() << "\nLV: Checking an outer loop in \""
+               << L->getHeader()->getParent()->getName() << "\" from "
+               << DebugLocStr << "\n");
+
+  // The vector loop nest is not interleaved.
+  LoopVectorizeHints Hints(L, true, *ORE);
+  Function *F = L->getHeader()->getParent();
+  if (!Hints.allowVectorization(F, L, AlwaysVectorize)) {
+    DEBUG(dbgs() << "LV: Loop hints prevent vectorization.\n");
+    return false;
+  }
+
+  // Vectorizing the outer loop duplicates the whole loop nest.
+  if (Hints.getForce() != LoopVectorizeHints::FK_Enabled && F->optForSize()) {
+    DEBUG(dbgs() << "LV: Not vectorizing an outer loop when optimizing for "
+                    "size.\n");
+    return false;
+  }
+
+  if (F->hasFnAttribute(Attribute::NoImplicitFloat)) {
+    DEBUG(dbgs() << "LV: Can't vectorize when the NoImplicitFloat"
+                    "attribute is used.\n");
+    return false;
+  }
+
+  const DataLayout &DL = F->getParent()->getDataLayout();
+  OuterLoopVectorizationLegality LVL(L, SE, DL, ORE, &Hints);
+  if (!LVL.canVectorize()) {
+    DEBUG(dbgs() << "LV: Not vectorizing the outer loop: Cannot prove "
+                    "legality.\n");
+    return false;
+  }
+
+  OuterLoopVectorizationCostModel CM(LVL.getPlan(), SE, *TTI, DL, &Hints);
+  unsigned VF = CM.selectVectorizationFactor();
+  if (VF == 1) {
+    DEBUG(dbgs() << "LV: Vectorization of the outer loop is possible but not "
+                    "beneficial.\n");
+    ORE->emitOptimizationRemarkAnalysis(
+        Hints.vectorizeAnalysisPassName(), L,
+        "the cost-model indicates that vectorization of the outer loop is "
+        "not beneficial");
+    return false;
+  }
+
+  DEBUG(dbgs() << "LV: Found a vectorizable outer loop (" << VF << ") in "
+               << DebugLocStr << '\n');
+  OuterLoopVectorizer LB(LVL.getPlan(), LI, DT, SE, DL, VF);
+  Loop *VectorLoop = LB.vectorize();
+  ++OuterLoopsVectorized;
+
+  ORE->emitOptimizationRemark(LV_NAME, L,
+                              Twine("vectorized outer loop (vectorization "
+                                    "width: ") +
+                                  Twine(VF) + ")");
+
+  // Mark the loops of both loop nests as already vectorized. The original one
+  // now runs the remainder iterations.
+  Hints.setAlreadyVectorized();
+  for (Loop *VL : depth_first(VectorLoop))
+    LoopVectorizeHints(VL, true, *ORE).setAlreadyVectorized();
+
+  DEBUG(verifyFunction(*F));
+  return true;
+}
+
 bool LoopVectorizePass::processLoop(Loop *L) {
   assert(L->empty() && "Only process inner loops.");
 
@@ -6588,6 +7600,12 @@ bool LoopVectorizePass::processLoop(Loop *L) {
                                 Twine("interleaved loop (interleaved count: ") +
                                     Twine(IC) + ")");
   } else {
+    // Decide on a vector epilogue while the cost model still describes the
+    // original loop, which is what the remainder loop will look like.
+    unsigned EpilogueVF = 1;
+    if (EnableEpilogueVectorization && !OptForSize)
+      EpilogueVF = CM.selectEpilogueVectorizationFactor(VF.Width, IC);
+
     // If we decided that it is *legal* to vectorize the loop, then do it.
     InnerLoopVectorizer LB(L, PSE, LI, DT, TLI, TTI, AC, ORE, VF.Width, IC);
     LB.vectorize(&LVL, CM.MinBWs, CM.VecValuesToIgnore);
@@ -6604,6 +7622,47 @@ bool LoopVectorizePass::processLoop(Loop *L) {
         LV_NAME, L, Twine("vectorized loop (vectorization width: ") +
                         Twine(VF.Width) + ", interleaved count: " + Twine(IC) +
                         ")");
+
+    // L now runs the remainder iterations of the vector loop, and all the
+    // iterations when the minimum iteration count check of the vector loop
+    // fails. Vectorize it again with the epilogue factor, and no interleaving,
+    // so that both take the vector epilogue. The cached access analysis of L
+    // predates the vector loop, so analyze it afresh.
+    if (EpilogueVF > 1) {
+      PredicatedScalarEvolution EpiloguePSE(*SE, *L);
+      std::unique_ptr<LoopAccessInfo> EpilogueLAI;
+      std::function<const LoopAccessInfo &(Loop &)> GetEpilogueLAA =
+          [&](Loop &Epilogue) -> const LoopAccessInfo & {
+        EpilogueLAI =
+            llvm::make_unique<LoopAccessInfo>(&Epilogue, SE, TLI, AA, DT, LI);
+        return *EpilogueLAI;
+      };
+      LoopVectorizationRequirements EpilogueRequirements(*ORE);
+      LoopVectorizationLegality EpilogueLVL(
+          L, EpiloguePSE, DT, TLI, AA, F, TTI, &GetEpilogueLAA, LI, ORE,
+          &EpilogueRequirements, &Hints);
+      if (EpilogueLVL.canVectorize()) {
+        // The demanded bits of the function predate the vector loop too, so
+        // do not narrow the types of the epilogue.
+        LoopVectorizationCostModel EpilogueCM(L, EpiloguePSE, LI, &EpilogueLVL,
+                                              *TTI, TLI, DB, AC, ORE, F,
+                                              &Hints);
+        EpilogueCM.collectValuesToIgnore();
+        InnerLoopVectorizer EpilogueLB(L, EpiloguePSE, LI, DT, TLI, TTI, AC,
+                                       ORE, EpilogueVF, 1);
+        EpilogueLB.vectorize(&EpilogueLVL, EpilogueCM.MinBWs,
+                             EpilogueCM.VecValuesToIgnore);
+        ++LoopEpiloguesVectorized;
+
+        ORE->emitOptimizationRemark(
+            LV_NAME, L,
+            Twine("vectorized epilogue loop (vectorization width: ") +
+                Twine(EpilogueVF) + ")");
+      } else {
+        DEBUG(dbgs() << "LV: Not vectorizing the epilogue: Cannot prove "
+                        "legality.\n");
+      }
+    }
   }
 
   // Mark the loop as already vectorized to avoid vectorizing again.
@@ -6655,10 +7714,28 @@ bool LoopVectorizePass::runImpl(
   for (Loop *L : *LI)
     addInnerLoop(*L, Worklist);
 
-  LoopsAnalyzed += Worklist.size();
+  // Outer loops are tried first, so that their inner loop is not vectorized
+  // on its own.
+  SmallVector<Loop *, 8> OuterWorklist;
+  if (EnableOuterLoopVectorization)
+    for (Loop *L : *LI)
+      addOuterLoop(*L, OuterWorklist);
+
+  LoopsAnalyzed += Worklist.size() + OuterWorklist.size();
 
-  // Now walk the identified inner loops.
   bool Changed = false;
+  while (!OuterWorklist.empty()) {
+    Loop *L = OuterWorklist.pop_back_val();
+    if (!processOuterLoop(L))
+      continue;
+    Changed = true;
+    // The inner loop now only runs the remainder iterations.
+    Worklist.erase(
+        std::remove(Worklist.begin(), Worklist.end(), L->getSubLoops()[0]),
+        Worklist.end());
+  }
+
+  // Now walk the identified inner loops.
   while (!Worklist.empty())
     Changed |= processLoop(Worklist.pop_back_val());
 
@@ -0,0 +1,21 @@
+; RUN: llvm-as < %s | llvm-bcanalyzer -benchmark-runs=3 | FileCheck %s
+
+; CHECK: Decoded {{[1-9][0-9]*}} records in 3 runs
+; CHECK-NEXT: Wall time:
+; CHECK-NOT: Summary of
+
+@str = private constant [6 x i8] c"hello\00"
+
+define i32 @f(i32 %x, i32 %y) {
+entry:
+  %s = add i32 %x, %y
+  %c = icmp sgt i32 %s, 0
+  br i1 %c, label %pos, label %neg
+
+pos:
+  ret i32 %s
+
+neg:
+  %n = sub i32 0, %s
+  ret i32 %n
+}
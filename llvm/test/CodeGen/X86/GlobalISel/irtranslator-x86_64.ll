@@ -0,0 +1,70 @@
+; RUN: llc -O0 -stop-after=irtranslator -global-isel -verify-machineinstrs %s -o - 2>&1 | FileCheck %s
+; REQUIRES: global-isel
+; This file checks that the translation from llvm IR to generic MachineInstr
+; is correct.
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; Tests for add.
+; CHECK: name: addi64
+; CHECK: [[ARG1:%[0-9]+]](64) = COPY %rdi
+; CHECK-NEXT: [[ARG2:%[0-9]+]](64) = COPY %rsi
+; CHECK-NEXT: [[RES:%[0-9]+]](64) = G_ADD s64 [[ARG1]], [[ARG2]]
+; CHECK-NEXT: %rax = COPY [[RES]]
+; CHECK-NEXT: RETQ implicit %rax
+define i64 @addi64(i64 %arg1, i64 %arg2) {
+  %res = add i64 %arg1, %arg2
+  ret i64 %res
+}
+
+; Tests for sub.
+; CHECK: name: subi32
+; CHECK: [[ARG1:%[0-9]+]](32) = COPY %edi
+; CHECK-NEXT: [[ARG2:%[0-9]+]](32) = COPY %esi
+; CHECK-NEXT: [[RES:%[0-9]+]](32) = G_SUB s32 [[ARG1]], [[ARG2]]
+; CHECK-NEXT: %eax = COPY [[RES]]
+; CHECK-NEXT: RETQ implicit %eax
+define i32 @subi32(i32 %arg1, i32 %arg2) {
+  %res = sub i32 %arg1, %arg2
+  ret i32 %res
+}
+
+; Tests for and/or, with arguments past the first registers.
+; CHECK: name: andor
+; CHECK: [[ARG1:%[0-9]+]](64) = COPY %rdi
+; CHECK-NEXT: [[ARG2:%[0-9]+]](64) = COPY %rsi
+; CHECK-NEXT: [[ARG3:%[0-9]+]](64) = COPY %rdx
+; CHECK-NEXT: [[ARG4:%[0-9]+]](64) = COPY %rcx
+; CHECK-NEXT: [[ARG5:%[0-9]+]](64) = COPY %r8
+; CHECK-NEXT: [[ARG6:%[0-9]+]](64) = COPY %r9
+; CHECK-NEXT: [[AND:%[0-9]+]](64) = G_AND s64 [[ARG1]], [[ARG6]]
+; CHECK-NEXT: [[RES:%[0-9]+]](64) = G_OR s64 [[AND]], [[ARG5]]
+; CHECK-NEXT: %rax = COPY [[RES]]
+; CHECK-NEXT: RETQ implicit %rax
+define i64 @andor(i64 %arg1, i64 %arg2, i64 %arg3, i64 %arg4, i64 %arg5, i64 %arg6) {
+  %and = and i64 %arg1, %arg6
+  %res = or i64 %and, %arg5
+  ret i64 %res
+}
+
+; Tests for br.
+; CHECK: name: uncondbr
+; CHECK: body:
+;
+; Entry basic block.
+; CHECK: {{[0-9a-zA-Z._-]+}}:
+;
+; Make sure we have one successor and only one.
+; CHECK-NEXT: successors: %[[END:[0-9a-zA-Z._-]+]]({{0x[a-f0-9]+ / 0x[a-f0-9]+}} = 100.00%)
+;
+; Check that we emit the correct branch.
+; CHECK: G_BR unsized %[[END]]
+;
+; Check that end contains the return instruction.
+; CHECK: [[END]]:
+; CHECK-NEXT: RETQ
+define void @uncondbr() {
+  br label %end
+end:
+  ret void
+}
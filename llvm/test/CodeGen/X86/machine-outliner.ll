@@ -0,0 +1,133 @@
+; RUN: llc -enable-machine-outliner -mtriple=x86_64-unknown-linux < %s | FileCheck %s
+; RUN: llc -mtriple=x86_64-unknown-linux < %s | FileCheck %s -check-prefix=NOOUTLINE
+
+; NOOUTLINE-NOT: OUTLINED_FUNCTION
+
+; Sequences ending with a return are reached through a tail call.
+; CHECK-LABEL: tail1:
+; CHECK-NOT: movl
+; CHECK: jmp OUTLINED_FUNCTION_0
+define void @tail1(i32* %p) #0 {
+  store volatile i32 1, i32* %p
+  %p1 = getelementptr i32, i32* %p, i64 1
+  store volatile i32 2, i32* %p1
+  %p2 = getelementptr i32, i32* %p, i64 2
+  store volatile i32 3, i32* %p2
+  %p3 = getelementptr i32, i32* %p, i64 3
+  store volatile i32 4, i32* %p3
+  ret void
+}
+
+; CHECK-LABEL: tail2:
+; CHECK-NOT: movl
+; CHECK: jmp OUTLINED_FUNCTION_0
+define void @tail2(i32* %p) #0 {
+  store volatile i32 1, i32* %p
+  %p1 = getelementptr i32, i32* %p, i64 1
+  store volatile i32 2, i32* %p1
+  %p2 = getelementptr i32, i32* %p, i64 2
+  store volatile i32 3, i32* %p2
+  %p3 = getelementptr i32, i32* %p, i64 3
+  store volatile i32 4, i32* %p3
+  ret void
+}
+
+; CHECK-LABEL: tail3:
+; CHECK-NOT: movl
+; CHECK: jmp OUTLINED_FUNCTION_0
+define void @tail3(i32* %p) #0 {
+  store volatile i32 1, i32* %p
+  %p1 = getelementptr i32, i32* %p, i64 1
+  store volatile i32 2, i32* %p1
+  %p2 = getelementptr i32, i32* %p, i64 2
+  store volatile i32 3, i32* %p2
+  %p3 = getelementptr i32, i32* %p, i64 3
+  store volatile i32 4, i32* %p3
+  ret void
+}
+
+; Other sequences are reached through a call.
+; CHECK-LABEL: call1:
+; CHECK: callq OUTLINED_FUNCTION_1
+; CHECK-NEXT: movl $10, 16(%rdi)
+; CHECK-NEXT: retq
+define void @call1(i32* %p) #0 {
+  store volatile i32 1, i32* %p
+  %p1 = getelementptr i32, i32* %p, i64 1
+  store volatile i32 2, i32* %p1
+  %p2 = getelementptr i32, i32* %p, i64 2
+  store volatile i32 3, i32* %p2
+  %p3 = getelementptr i32, i32* %p, i64 3
+  store volatile i32 4, i32* %p3
+  %p4 = getelementptr i32, i32* %p, i64 4
+  store volatile i32 10, i32* %p4
+  ret void
+}
+
+; CHECK-LABEL: call2:
+; CHECK: callq OUTLINED_FUNCTION_1
+; CHECK-NEXT: movl $11, 16(%rdi)
+; CHECK-NEXT: retq
+define void @call2(i32* %p) #0 {
+  store volatile i32 1, i32* %p
+  %p1 = getelementptr i32, i32* %p, i64 1
+  store volatile i32 2, i32* %p1
+  %p2 = getelementptr i32, i32* %p, i64 2
+  store volatile i32 3, i32* %p2
+  %p3 = getelementptr i32, i32* %p, i64 3
+  store volatile i32 4, i32* %p3
+  %p4 = getelementptr i32, i32* %p, i64 4
+  store volatile i32 11, i32* %p4
+  ret void
+}
+
+; CHECK-LABEL: call3:
+; CHECK: callq OUTLINED_FUNCTION_1
+; CHECK-NEXT: movl $12, 16(%rdi)
+; CHECK-NEXT: retq
+define void @call3(i32* %p) #0 {
+  store volatile i32 1, i32* %p
+  %p1 = getelementptr i32, i32* %p, i64 1
+  store volatile i32 2, i32* %p1
+  %p2 = getelementptr i32, i32* %p, i64 2
+  store volatile i32 3, i32* %p2
+  %p3 = getelementptr i32, i32* %p, i64 3
+  store volatile i32 4, i32* %p3
+  %p4 = getelementptr i32, i32* %p, i64 4
+  store volatile i32 12, i32* %p4
+  ret void
+}
+
+; Functions using the red zone are left alone, the return address pushed by
+; the call would overwrite it.
+; CHECK-LABEL: redzone:
+; CHECK-NOT: OUTLINED_FUNCTION
+; CHECK: retq
+define void @redzone(i32* %p) #0 {
+  %a = alloca i32
+  store volatile i32 0, i32* %a
+  store volatile i32 1, i32* %p
+  %p1 = getelementptr i32, i32* %p, i64 1
+  store volatile i32 2, i32* %p1
+  %p2 = getelementptr i32, i32* %p, i64 2
+  store volatile i32 3, i32* %p2
+  %p3 = getelementptr i32, i32* %p, i64 3
+  store volatile i32 4, i32* %p3
+  ret void
+}
+
+; CHECK-LABEL: OUTLINED_FUNCTION_0:
+; CHECK: movl $1, (%rdi)
+; CHECK-NEXT: movl $2, 4(%rdi)
+; CHECK-NEXT: movl $3, 8(%rdi)
+; CHECK-NEXT: movl $4, 12(%rdi)
+; CHECK-NEXT: retq
+
+; CHECK-LABEL: OUTLINED_FUNCTION_1:
+; CHECK: movl $1, (%rdi)
+; CHECK-NEXT: movl $2, 4(%rdi)
+; CHECK-NEXT: movl $3, 8(%rdi)
+; CHECK-NEXT: movl $4, 12(%rdi)
+; CHECK-NEXT: retq
+
+attributes #0 = { nounwind }
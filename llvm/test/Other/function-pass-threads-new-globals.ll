@@ -0,0 +1,73 @@
+; The global values the per-function passes create, here the lookup tables of
+; SimplifyCFG, are carried back into the module with their definitions, and
+; keep their local linkage even when two partitions create one of the same name.
+; RUN: opt -O2 -S -function-pass-threads=2 < %s | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK-NOT: external
+; CHECK-DAG: @[[TABLE1:switch.table[.0-9]*]] = private unnamed_addr constant [4 x i32] [i32 10, i32 42, i32 7, i32 99]
+; CHECK-DAG: @[[TABLE2:switch.table[.0-9]*]] = private unnamed_addr constant [4 x i32] [i32 3, i32 1, i32 4, i32 15]
+
+; CHECK-LABEL: define i32 @first(
+; CHECK: getelementptr inbounds [4 x i32], [4 x i32]* @[[TABLE1]]
+define i32 @first(i32 %x) {
+entry:
+  switch i32 %x, label %default [
+    i32 0, label %bb0
+    i32 1, label %bb1
+    i32 2, label %bb2
+    i32 3, label %bb3
+  ]
+
+bb0:
+  br label %exit
+
+bb1:
+  br label %exit
+
+bb2:
+  br label %exit
+
+bb3:
+  br label %exit
+
+default:
+  br label %exit
+
+exit:
+  %r = phi i32 [ 10, %bb0 ], [ 42, %bb1 ], [ 7, %bb2 ], [ 99, %bb3 ], [ 0, %default ]
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @second(
+; CHECK: getelementptr inbounds [4 x i32], [4 x i32]* @[[TABLE2]]
+define i32 @second(i32 %x) {
+entry:
+  switch i32 %x, label %default [
+    i32 0, label %bb0
+    i32 1, label %bb1
+    i32 2, label %bb2
+    i32 3, label %bb3
+  ]
+
+bb0:
+  br label %exit
+
+bb1:
+  br label %exit
+
+bb2:
+  br label %exit
+
+bb3:
+  br label %exit
+
+default:
+  br label %exit
+
+exit:
+  %r = phi i32 [ 3, %bb0 ], [ 1, %bb1 ], [ 4, %bb2 ], [ 15, %bb3 ], [ 0, %default ]
+  ret i32 %r
+}
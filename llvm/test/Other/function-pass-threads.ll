@@ -0,0 +1,70 @@
+; Running the per-function passes on several threads gives the same result as
+; running them on one.
+; RUN: opt -O1 -S < %s > %t.serial
+; RUN: opt -O1 -S -function-pass-threads=3 < %s > %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.parallel
+
+%struct.pair = type { i32, i32 }
+
+@table = internal constant [2 x i32] [i32 10, i32 20]
+@0 = private unnamed_addr constant [4 x i8] c"abc\00"
+@counter = global i32 0
+@alias = alias i32 (i32), i32 (i32)* @lookup
+
+$comdat_fn = comdat any
+
+; CHECK: define i32 @lookup(
+; CHECK: ret i32 20
+define i32 @lookup(i32 %x) !dbg !4 {
+entry:
+  %p = getelementptr [2 x i32], [2 x i32]* @table, i32 0, i32 1
+  %v = load i32, i32* %p, !dbg !6
+  ret i32 %v
+}
+
+; CHECK: define linkonce_odr i32 @comdat_fn({{.*}} comdat
+define linkonce_odr i32 @comdat_fn(i32 %x) comdat {
+entry:
+  %s = alloca %struct.pair
+  %a = getelementptr %struct.pair, %struct.pair* %s, i32 0, i32 0
+  store i32 %x, i32* %a
+  %v = load i32, i32* %a
+  ret i32 %v
+}
+
+; CHECK: define i8* @name(
+define i8* @name() {
+  ret i8* getelementptr ([4 x i8], [4 x i8]* @0, i32 0, i32 0)
+}
+
+; CHECK: define void @bump(
+define void @bump(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %c = load i32, i32* @counter
+  %c.next = add i32 %c, %i
+  store i32 %c.next, i32* @counter
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = call i32 @comdat_fn(i32 %n)
+  %s = call i32 @alias(i32 %r)
+  ret void
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "test", isOptimized: true, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "function-pass-threads.c", directory: ".")
+!2 = !{}
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = distinct !DISubprogram(name: "lookup", scope: !1, file: !1, line: 1, type: !5, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: true, unit: !0, variables: !2)
+!5 = !DISubroutineType(types: !2)
+!6 = !DILocation(line: 2, column: 3, scope: !4)
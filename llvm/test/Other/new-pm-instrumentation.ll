@@ -0,0 +1,40 @@
+; The reports of the pass instrumentation of the new pass manager.
+; RUN: opt -disable-output -disable-verify -passes='instcombine,gvn' \
+; RUN:     -time-passes < %s 2>&1 | FileCheck %s --check-prefix=TIME
+; RUN: opt -disable-output -disable-verify -passes='instcombine,gvn' \
+; RUN:     -print-pass-instruction-deltas < %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=DELTAS
+; RUN: opt -disable-output -disable-verify -passes='instcombine,gvn' \
+; RUN:     -print-analysis-counts < %s 2>&1 | FileCheck %s --check-prefix=COUNTS
+; RUN: opt -disable-output -disable-verify -passes='instcombine,gvn' < %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=NONE --allow-empty
+
+; TIME: Pass execution timing report
+; TIME-DAG: InstCombinePass
+; TIME-DAG: GVN
+; TIME: Total
+
+; InstCombine folds away both instructions, GVN has nothing left to do.
+; DELTAS: Instruction count changes per pass:
+; DELTAS-NEXT: Change Runs Pass
+; DELTAS-NEXT: -2 1 InstCombinePass
+; DELTAS-NOT: GVN
+
+; The function analyses InstCombine does not preserve are computed again for
+; GVN.
+; COUNTS: Analysis runs and invalidations:
+; COUNTS-NEXT: Runs Invalidations Analysis
+; COUNTS-DAG: 2 1 AssumptionAnalysis
+; COUNTS-DAG: 1 0 DominatorTreeAnalysis
+; COUNTS-DAG: 1 1 MemoryDependenceAnalysis
+
+; NONE-NOT: Pass execution timing report
+; NONE-NOT: Instruction count changes
+; NONE-NOT: Analysis runs
+
+define i32 @f(i32 %x) {
+entry:
+  %a = add i32 %x, 0
+  %b = mul i32 %a, 1
+  ret i32 %b
+}
@@ -0,0 +1,27 @@
+; RUN: opt -S -print-context-stats < %s -o /dev/null 2>&1 | FileCheck %s
+
+; CHECK: Constants:
+; CHECK: Entries Bytes Table
+; CHECK: {{^ *[1-9][0-9]* +[0-9]+}} ConstantExpr
+; CHECK: Metadata:
+; CHECK: Metadata nodes:
+; CHECK: Uniqued Distinct Bytes Kind
+; CHECK: {{^ *1 +0 +[0-9]+}} DILocation
+; CHECK: Attributes:
+; CHECK: Types:
+
+@g = global i8* inttoptr (i32 42 to i8*)
+
+define void @f() {
+  ret void, !dbg !5
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "test", isOptimized: false, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "t.c", directory: ".")
+!2 = !{}
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = distinct !DISubprogram(name: "f", scope: !1, file: !1, line: 1, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: false, unit: !0)
+!5 = !DILocation(line: 2, column: 3, scope: !4)
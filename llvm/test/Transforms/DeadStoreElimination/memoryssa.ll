@@ -0,0 +1,143 @@
+; RUN: opt < %s -basicaa -dse -enable-dse-memoryssa -S | FileCheck %s
+; RUN: opt < %s -aa-pipeline=basic-aa -passes=dse -enable-dse-memoryssa -S | FileCheck %s
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+declare void @use(i32*)
+declare void @may_throw() readnone
+declare void @llvm.memset.p0i8.i64(i8* nocapture, i8, i64, i32, i1) nounwind
+
+; The store in exit post-dominates the one in entry.
+define void @cross_block(i32* %P, i1 %c) {
+; CHECK-LABEL: @cross_block(
+; CHECK-NOT: store i32 1
+; CHECK: store i32 2, i32* %P
+entry:
+  store i32 1, i32* %P
+  br i1 %c, label %then, label %exit
+
+then:
+  br label %exit
+
+exit:
+  store i32 2, i32* %P
+  ret void
+}
+
+; The first store is read on one of the paths.
+define i32 @read_on_path(i32* %P, i1 %c) {
+; CHECK-LABEL: @read_on_path(
+; CHECK: store i32 1, i32* %P
+; CHECK: store i32 2, i32* %P
+entry:
+  store i32 1, i32* %P
+  br i1 %c, label %then, label %exit
+
+then:
+  %v = load i32, i32* %P
+  br label %exit
+
+exit:
+  %r = phi i32 [ %v, %then ], [ 0, %entry ]
+  store i32 2, i32* %P
+  ret i32 %r
+}
+
+; The second store is only executed on one of the paths.
+define void @not_postdominated(i32* %P, i1 %c) {
+; CHECK-LABEL: @not_postdominated(
+; CHECK: store i32 1, i32* %P
+; CHECK: store i32 2, i32* %P
+entry:
+  store i32 1, i32* %P
+  br i1 %c, label %then, label %exit
+
+then:
+  store i32 2, i32* %P
+  br label %exit
+
+exit:
+  ret void
+}
+
+; The first store is read by the loop before being overwritten.
+define void @read_in_loop(i32* %P, i32* %Q, i32 %n) {
+; CHECK-LABEL: @read_in_loop(
+; CHECK: store i32 1, i32* %P
+; CHECK: store i32 2, i32* %P
+entry:
+  store i32 1, i32* %P
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = load i32, i32* %P
+  %i.next = add i32 %i, %v
+  %done = icmp sge i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  store i32 2, i32* %P
+  ret void
+}
+
+; The caller can see the first store if the call throws.
+define void @throw_between(i32* %P) {
+; CHECK-LABEL: @throw_between(
+; CHECK: store i32 1, i32* %P
+; CHECK: call void @may_throw()
+; CHECK: store i32 2, i32* %P
+  store i32 1, i32* %P
+  call void @may_throw()
+  store i32 2, i32* %P
+  ret void
+}
+
+; Neither store to the alloca is ever read.
+define void @alloca_never_read(i1 %c) {
+; CHECK-LABEL: @alloca_never_read(
+; CHECK-NOT: store
+; CHECK: ret void
+entry:
+  %A = alloca i32
+  store i32 1, i32* %A
+  br i1 %c, label %then, label %exit
+
+then:
+  store i32 2, i32* %A
+  br label %exit
+
+exit:
+  ret void
+}
+
+; The alloca escapes, so the caller may read the last store.
+define void @alloca_escapes() {
+; CHECK-LABEL: @alloca_escapes(
+; CHECK: store i32 1, i32* %A
+; CHECK: call void @use(i32* %A)
+; CHECK: store i32 2, i32* %A
+  %A = alloca i32
+  store i32 1, i32* %A
+  call void @use(i32* %A)
+  store i32 2, i32* %A
+  ret void
+}
+
+; The end of the memset is overwritten in another block.
+define void @partial_end(i8* %P, i1 %c) {
+; CHECK-LABEL: @partial_end(
+; CHECK: call void @llvm.memset.p0i8.i64(i8* %P, i8 0, i64 24, i32 8, i1 false)
+; CHECK: store i64 1
+entry:
+  call void @llvm.memset.p0i8.i64(i8* %P, i8 0, i64 32, i32 8, i1 false)
+  br i1 %c, label %then, label %exit
+
+then:
+  br label %exit
+
+exit:
+  %P24 = getelementptr inbounds i8, i8* %P, i64 24
+  %Q = bitcast i8* %P24 to i64*
+  store i64 1, i64* %Q
+  ret void
+}
@@ -0,0 +1,186 @@
+; RUN: opt < %s -hotcoldsplit -S | FileCheck %s
+; RUN: opt < %s -passes=hotcoldsplit -S | FileCheck %s
+
+target triple = "x86_64-unknown-linux-gnu"
+
+declare void @sink(i32)
+declare void @abort() noreturn nounwind
+declare void @log_error(i32) cold
+
+; The path ending in unreachable is cold without any profile.
+
+; CHECK-LABEL: define void @unreachable_path(
+; CHECK: call void @unreachable_path_if.then(i32 %x)
+; CHECK-NEXT: unreachable
+; CHECK-NOT: call void @abort
+; CHECK: ret void
+define void @unreachable_path(i32 %x) {
+entry:
+  %cmp = icmp eq i32 %x, 0
+  br i1 %cmp, label %if.then, label %if.end
+
+if.then:
+  call void @sink(i32 %x)
+  call void @sink(i32 1)
+  call void @abort()
+  unreachable
+
+if.end:
+  call void @sink(i32 2)
+  ret void
+}
+
+; The call to a cold function makes its block cold, and so are the blocks only
+; reached from it.
+
+; CHECK-LABEL: define i32 @cold_call(
+; CHECK: call void @cold_call_if.then(i32 %x)
+; CHECK-NEXT: br label %if.end
+; CHECK: if.end:
+; CHECK: ret i32
+define i32 @cold_call(i32 %x) {
+entry:
+  %cmp = icmp slt i32 %x, 0
+  br i1 %cmp, label %if.then, label %if.end
+
+if.then:
+  call void @log_error(i32 %x)
+  %c = icmp eq i32 %x, -1
+  br i1 %c, label %minus.one, label %if.end
+
+minus.one:
+  call void @sink(i32 %x)
+  call void @sink(i32 -1)
+  br label %if.end
+
+if.end:
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+; A block with a cold profile count is outlined.
+
+; CHECK-LABEL: define void @profile_cold(
+; CHECK: call void @profile_cold_if.then(i32 %x)
+; CHECK: ret void
+define void @profile_cold(i32 %x) !prof !20 {
+entry:
+  %cmp = icmp eq i32 %x, 0
+  br i1 %cmp, label %if.then, label %if.end, !prof !21
+
+if.then:
+  call void @sink(i32 %x)
+  call void @sink(i32 3)
+  call void @sink(i32 4)
+  br label %if.end
+
+if.end:
+  call void @sink(i32 5)
+  ret void
+}
+
+; Landing pads must stay in the function they are in.
+
+; CHECK-LABEL: define void @landing_pad(
+; CHECK: lpad:
+; CHECK-NEXT: landingpad
+; CHECK-NOT: call void @landing_pad_lpad
+; CHECK: resume
+define void @landing_pad(i32 %x) personality i32 (...)* @__gxx_personality_v0 {
+entry:
+  invoke void @sink(i32 %x)
+          to label %cont unwind label %lpad
+
+cont:
+  ret void
+
+lpad:
+  %lp = landingpad { i8*, i32 }
+          cleanup
+  call void @sink(i32 6)
+  call void @sink(i32 7)
+  call void @log_error(i32 %x)
+  resume { i8*, i32 } %lp
+}
+
+declare i32 @__gxx_personality_v0(...)
+
+; Regions too small to pay for a call are left alone.
+
+; CHECK-LABEL: define void @too_small(
+; CHECK: if.then:
+; CHECK-NEXT: call void @abort()
+; CHECK-NEXT: unreachable
+define void @too_small(i32 %x) {
+entry:
+  %cmp = icmp eq i32 %x, 0
+  br i1 %cmp, label %if.then, label %if.end
+
+if.then:
+  call void @abort()
+  unreachable
+
+if.end:
+  ret void
+}
+
+; A shared error block is entered from several blocks and merges their error
+; codes: its phis stay behind, and the rest of it is outlined.
+
+; CHECK-LABEL: define void @shared_error(
+; CHECK: fail:
+; CHECK-NEXT: %code = phi i32 [ 1, %entry ], [ 2, %next ]
+; CHECK: call void @shared_error_fail.ce(i32 %code, i32 %x)
+; CHECK-NEXT: unreachable
+; CHECK-NOT: call void @abort
+; CHECK: ret void
+define void @shared_error(i32 %x, i32 %y) {
+entry:
+  %c1 = icmp eq i32 %x, 0
+  br i1 %c1, label %fail, label %next
+
+next:
+  %c2 = icmp eq i32 %y, 0
+  br i1 %c2, label %fail, label %ok
+
+fail:
+  %code = phi i32 [ 1, %entry ], [ 2, %next ]
+  call void @sink(i32 %code)
+  call void @sink(i32 %x)
+  call void @abort()
+  unreachable
+
+ok:
+  call void @sink(i32 %y)
+  ret void
+}
+
+; CHECK: define internal void @unreachable_path_if.then(i32 %x) [[NORETURN:#[0-9]+]] section ".text.unlikely"
+; CHECK: call void @sink(i32 %x)
+; CHECK: call void @abort()
+; CHECK: define internal void @cold_call_if.then(i32 %x) [[ATTRS:#[0-9]+]] section ".text.unlikely"
+; CHECK: call void @log_error(i32 %x)
+; CHECK: minus.one:
+; CHECK: define internal void @profile_cold_if.then(i32 %x) [[ATTRS]] section ".text.unlikely"
+; CHECK: define internal void @shared_error_fail.ce(i32 %code, i32 %x) [[NORETURN]] section ".text.unlikely"
+; CHECK-DAG: attributes [[NORETURN]] = { cold minsize noinline noreturn }
+; CHECK-DAG: attributes [[ATTRS]] = { cold minsize noinline }
+
+!llvm.module.flags = !{!1}
+!20 = !{!"function_entry_count", i64 1000}
+!21 = !{!"branch_weights", i32 0, i32 1000}
+
+!1 = !{i32 1, !"ProfileSummary", !2}
+!2 = !{!3, !4, !5, !6, !7, !8, !9, !10}
+!3 = !{!"ProfileFormat", !"InstrProf"}
+!4 = !{!"TotalCount", i64 10000}
+!5 = !{!"MaxCount", i64 1000}
+!6 = !{!"MaxInternalCount", i64 1}
+!7 = !{!"MaxFunctionCount", i64 1000}
+!8 = !{!"NumCounts", i64 3}
+!9 = !{!"NumFunctions", i64 3}
+!10 = !{!"DetailedSummary", !11}
+!11 = !{!12, !13, !14}
+!12 = !{i32 10000, i64 100, i32 1}
+!13 = !{i32 999000, i64 100, i32 1}
+!14 = !{i32 999999, i64 1, i32 2}
@@ -0,0 +1,104 @@
+; RUN: opt -mcpu=generic -mtriple=x86_64-unknown-linux-gnu -loop-data-prefetch -prefetch-hints-file=%S/Inputs/prefetch-hints.txt -S < %s | FileCheck %s
+; RUN: not opt -mcpu=generic -mtriple=x86_64-unknown-linux-gnu -loop-data-prefetch -prefetch-hints-file=%t.missing -S < %s 2>&1 | FileCheck %s --check-prefix=MISSING
+
+; MISSING: error: could not open prefetch hints file
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; Only the load listed in the profile is prefetched, even though neither the
+; subtarget nor the stride call for it.
+; CHECK-LABEL: @hinted(
+define void @hinted(double* nocapture %a, double* nocapture readonly %b, double* nocapture readonly %c) !dbg !6 {
+entry:
+  br label %for.body
+
+; CHECK: for.body:
+for.body:                                         ; preds = %for.body, %entry
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds double, double* %b, i64 %indvars.iv
+; CHECK: call void @llvm.prefetch(i8* %{{.*}}, i32 0, i32 3, i32 1)
+; CHECK-NEXT: {{%[0-9]+}} = load double, double* %arrayidx
+  %0 = load double, double* %arrayidx, align 8, !dbg !8
+  %arrayidx1 = getelementptr inbounds double, double* %c, i64 %indvars.iv
+; CHECK-NOT: call void @llvm.prefetch
+; CHECK: {{%[0-9]+}} = load double, double* %arrayidx1
+  %1 = load double, double* %arrayidx1, align 8, !dbg !9
+  %add = fadd double %0, %1
+  %arrayidx2 = getelementptr inbounds double, double* %a, i64 %indvars.iv
+  store double %add, double* %arrayidx2, align 8
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, 1600
+  br i1 %exitcond, label %for.end, label %for.body
+
+; CHECK: for.end:
+for.end:                                          ; preds = %for.body
+  ret void
+}
+
+; The profile enables indirect prefetching for the loads it lists.
+; CHECK-LABEL: @hinted_indirect(
+define void @hinted_indirect(i32* nocapture %a, i32* nocapture readonly %b, i64 %n) !dbg !10 {
+entry:
+  br label %for.body
+
+; CHECK: for.body:
+for.body:                                         ; preds = %for.body, %entry
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %b, i64 %indvars.iv
+; CHECK: %prefidx = load i32, i32* %{{.*}}, align 4
+; CHECK: %idx = load i32, i32* %arrayidx, align 4
+  %idx = load i32, i32* %arrayidx, align 4
+  %idxprom = sext i32 %idx to i64
+  %arrayidx2 = getelementptr inbounds i32, i32* %a, i64 %idxprom
+; CHECK: call void @llvm.prefetch(i8* %{{.*}}, i32 0, i32 3, i32 1)
+; CHECK-NEXT: {{%[0-9]+}} = load i32, i32* %arrayidx2
+  %0 = load i32, i32* %arrayidx2, align 4, !dbg !11
+  %inc = add nsw i32 %0, 1
+  store i32 %inc, i32* %arrayidx2, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+; CHECK: for.end:
+for.end:                                          ; preds = %for.body
+  ret void
+}
+
+; Functions missing from the profile are left alone.
+; CHECK-LABEL: @not_listed(
+define void @not_listed(double* nocapture %a, double* nocapture readonly %b) !dbg !12 {
+entry:
+  br label %for.body
+
+for.body:                                         ; preds = %for.body, %entry
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds double, double* %b, i64 %indvars.iv
+; CHECK-NOT: call void @llvm.prefetch
+  %0 = load double, double* %arrayidx, align 8, !dbg !13
+  %add = fadd double %0, 1.000000e+00
+  %arrayidx2 = getelementptr inbounds double, double* %a, i64 %indvars.iv
+  store double %add, double* %arrayidx2, align 8
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, 1600
+  br i1 %exitcond, label %for.end, label %for.body
+
+; CHECK: for.end:
+for.end:                                          ; preds = %for.body
+  ret void
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: true, runtimeVersion: 0, emissionKind: LineTablesOnly, enums: !2)
+!1 = !DIFile(filename: "hints.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = !DISubroutineType(types: !2)
+!6 = distinct !DISubprogram(name: "hinted", scope: !1, file: !1, line: 1, type: !4, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: true, unit: !0, variables: !2)
+!8 = !DILocation(line: 3, column: 12, scope: !6)
+!9 = !DILocation(line: 4, column: 12, scope: !6)
+!10 = distinct !DISubprogram(name: "hinted_indirect", scope: !1, file: !1, line: 8, type: !4, isLocal: false, isDefinition: true, scopeLine: 8, isOptimized: true, unit: !0, variables: !2)
+!11 = !DILocation(line: 10, column: 7, scope: !10)
+!12 = distinct !DISubprogram(name: "not_listed", scope: !1, file: !1, line: 14, type: !4, isLocal: false, isDefinition: true, scopeLine: 14, isOptimized: true, unit: !0, variables: !2)
+!13 = !DILocation(line: 16, column: 12, scope: !12)
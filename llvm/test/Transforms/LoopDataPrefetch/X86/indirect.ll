@@ -0,0 +1,65 @@
+; RUN: opt -mcpu=haswell -mtriple=x86_64-unknown-linux-gnu -loop-data-prefetch -loop-prefetch-indirect -prefetch-distance=64 -S < %s | FileCheck %s --check-prefix=INDIRECT --check-prefix=ALL
+; RUN: opt -mcpu=haswell -mtriple=x86_64-unknown-linux-gnu -loop-data-prefetch -prefetch-distance=64 -S < %s | FileCheck %s --check-prefix=NO_INDIRECT --check-prefix=ALL
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; Prefetch a[b[i + d]], loading b[min(i + d, n - 1)] ahead of time.
+; ALL-LABEL: @indirect(
+define void @indirect(i32* nocapture %a, i32* nocapture readonly %b, i64 %n) {
+entry:
+  br label %for.body
+
+; ALL: for.body:
+for.body:                                         ; preds = %for.body, %entry
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %b, i64 %indvars.iv
+; INDIRECT: %prefidx = load i32, i32* %{{.*}}, align 4
+; NO_INDIRECT-NOT: %prefidx
+; ALL: %idx = load i32, i32* %arrayidx, align 4
+  %idx = load i32, i32* %arrayidx, align 4
+  %idxprom = sext i32 %idx to i64
+  %arrayidx2 = getelementptr inbounds i32, i32* %a, i64 %idxprom
+; INDIRECT: call void @llvm.prefetch(i8* %{{.*}}, i32 0, i32 3, i32 1)
+; NO_INDIRECT-NOT: call void @llvm.prefetch
+; ALL: {{%[0-9]+}} = load i32, i32* %arrayidx2, align 4
+  %0 = load i32, i32* %arrayidx2, align 4
+  %inc = add nsw i32 %0, 1
+  store i32 %inc, i32* %arrayidx2, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+; ALL: for.end:
+for.end:                                          ; preds = %for.body
+  ret void
+}
+
+; The loop may leave before loading all of the indices, so loading them ahead
+; of time is not safe.
+; ALL-LABEL: @early_exit(
+define void @early_exit(i32* nocapture %a, i32* nocapture readonly %b, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:                                         ; preds = %for.inc, %entry
+  %indvars.iv = phi i64 [ 0, %entry ], [ %indvars.iv.next, %for.inc ]
+  %arrayidx = getelementptr inbounds i32, i32* %b, i64 %indvars.iv
+  %idx = load i32, i32* %arrayidx, align 4
+  %cmp = icmp slt i32 %idx, 0
+  br i1 %cmp, label %for.end, label %for.inc
+
+for.inc:                                          ; preds = %for.body
+  %idxprom = sext i32 %idx to i64
+  %arrayidx2 = getelementptr inbounds i32, i32* %a, i64 %idxprom
+; ALL-NOT: call void @llvm.prefetch
+  %0 = load i32, i32* %arrayidx2, align 4
+  %inc = add nsw i32 %0, 1
+  store i32 %inc, i32* %arrayidx2, align 4
+  %indvars.iv.next = add nuw nsw i64 %indvars.iv, 1
+  %exitcond = icmp eq i64 %indvars.iv.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+; ALL: for.end:
+for.end:                                          ; preds = %for.inc, %for.body
+  ret void
+}
@@ -0,0 +1,177 @@
+; RUN: opt -loop-fusion -S < %s | FileCheck %s
+; RUN: opt -passes=loop-fusion -aa-pipeline=basic-aa -S < %s | FileCheck %s
+; RUN: opt -loop-fusion -pass-remarks=loop-fusion -pass-remarks-missed=loop-fusion -disable-output < %s 2>&1 | FileCheck %s --check-prefix=REMARKS
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+declare void @f() nounwind
+
+; The second loop reads what the first loop wrote in the same iteration.
+; CHECK-LABEL: @fuse(
+; CHECK: loop0:
+; CHECK-NEXT: %i = phi i64 [ 0, %entry ], [ %i.next, %loop1 ]
+; CHECK-NEXT: %j = phi i64 [ 0, %entry ], [ %j.next, %loop1 ]
+; CHECK: store i32 %t, i32* %a
+; CHECK-NOT: icmp
+; CHECK: br label %loop1
+; CHECK: loop1:
+; CHECK: %v = load i32, i32* %a1
+; CHECK: store i32 %v, i32* %b
+; CHECK: br i1 %c1, label %loop0, label %exit
+; CHECK-NOT: between:
+; REMARKS: remark: {{.*}}fused with the loop loop1
+define void @fuse(i32* noalias %A, i32* noalias %B) {
+entry:
+  br label %loop0
+
+loop0:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop0 ]
+  %a = getelementptr inbounds i32, i32* %A, i64 %i
+  %t = trunc i64 %i to i32
+  store i32 %t, i32* %a
+  %i.next = add nuw nsw i64 %i, 1
+  %c0 = icmp ne i64 %i.next, 100
+  br i1 %c0, label %loop0, label %between
+
+between:
+  br label %loop1
+
+loop1:
+  %j = phi i64 [ 0, %between ], [ %j.next, %loop1 ]
+  %a1 = getelementptr inbounds i32, i32* %A, i64 %j
+  %v = load i32, i32* %a1
+  %b = getelementptr inbounds i32, i32* %B, i64 %j
+  store i32 %v, i32* %b
+  %j.next = add nuw nsw i64 %j, 1
+  %c1 = icmp ne i64 %j.next, 100
+  br i1 %c1, label %loop1, label %exit
+
+exit:
+  ret void
+}
+
+; The second loop reads what the next iteration of the first loop writes.
+; CHECK-LABEL: @forward_read(
+; CHECK: between:
+; REMARKS: remark: {{.*}}loop not fused with the loop loop1: dependences prevent fusion
+define void @forward_read(i32* noalias %A, i32* noalias %B) {
+entry:
+  br label %loop0
+
+loop0:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop0 ]
+  %a = getelementptr inbounds i32, i32* %A, i64 %i
+  %t = trunc i64 %i to i32
+  store i32 %t, i32* %a
+  %i.next = add nuw nsw i64 %i, 1
+  %c0 = icmp ne i64 %i.next, 100
+  br i1 %c0, label %loop0, label %between
+
+between:
+  br label %loop1
+
+loop1:
+  %j = phi i64 [ 0, %between ], [ %j.next, %loop1 ]
+  %j.next = add nuw nsw i64 %j, 1
+  %a1 = getelementptr inbounds i32, i32* %A, i64 %j.next
+  %v = load i32, i32* %a1
+  %b = getelementptr inbounds i32, i32* %B, i64 %j
+  store i32 %v, i32* %b
+  %c1 = icmp ne i64 %j.next, 100
+  br i1 %c1, label %loop1, label %exit
+
+exit:
+  ret void
+}
+
+; CHECK-LABEL: @different_trip_counts(
+; CHECK: between:
+; REMARKS: remark: {{.*}}loop not fused with the loop loop1: different trip counts
+define void @different_trip_counts(i32* noalias %A, i32* noalias %B) {
+entry:
+  br label %loop0
+
+loop0:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop0 ]
+  %a = getelementptr inbounds i32, i32* %A, i64 %i
+  store i32 0, i32* %a
+  %i.next = add nuw nsw i64 %i, 1
+  %c0 = icmp ne i64 %i.next, 100
+  br i1 %c0, label %loop0, label %between
+
+between:
+  br label %loop1
+
+loop1:
+  %j = phi i64 [ 0, %between ], [ %j.next, %loop1 ]
+  %b = getelementptr inbounds i32, i32* %B, i64 %j
+  store i32 1, i32* %b
+  %j.next = add nuw nsw i64 %j, 1
+  %c1 = icmp ne i64 %j.next, 50
+  br i1 %c1, label %loop1, label %exit
+
+exit:
+  ret void
+}
+
+; CHECK-LABEL: @code_between(
+; CHECK: between:
+; REMARKS: remark: {{.*}}loop not fused with the loop loop1: code between the loops
+define void @code_between(i32* noalias %A, i32* noalias %B, i32* noalias %C) {
+entry:
+  br label %loop0
+
+loop0:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop0 ]
+  %a = getelementptr inbounds i32, i32* %A, i64 %i
+  store i32 0, i32* %a
+  %i.next = add nuw nsw i64 %i, 1
+  %c0 = icmp ne i64 %i.next, 100
+  br i1 %c0, label %loop0, label %between
+
+between:
+  store i32 0, i32* %C
+  br label %loop1
+
+loop1:
+  %j = phi i64 [ 0, %between ], [ %j.next, %loop1 ]
+  %b = getelementptr inbounds i32, i32* %B, i64 %j
+  store i32 1, i32* %b
+  %j.next = add nuw nsw i64 %j, 1
+  %c1 = icmp ne i64 %j.next, 100
+  br i1 %c1, label %loop1, label %exit
+
+exit:
+  ret void
+}
+
+; CHECK-LABEL: @call(
+; CHECK: between:
+; REMARKS: remark: {{.*}}loop not fused: contains calls, volatile or atomic memory accesses
+define void @call(i32* noalias %A, i32* noalias %B) {
+entry:
+  br label %loop0
+
+loop0:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop0 ]
+  %a = getelementptr inbounds i32, i32* %A, i64 %i
+  store i32 0, i32* %a
+  call void @f()
+  %i.next = add nuw nsw i64 %i, 1
+  %c0 = icmp ne i64 %i.next, 100
+  br i1 %c0, label %loop0, label %between
+
+between:
+  br label %loop1
+
+loop1:
+  %j = phi i64 [ 0, %between ], [ %j.next, %loop1 ]
+  %b = getelementptr inbounds i32, i32* %B, i64 %j
+  store i32 1, i32* %b
+  %j.next = add nuw nsw i64 %j, 1
+  %c1 = icmp ne i64 %j.next, 100
+  br i1 %c1, label %loop1, label %exit
+
+exit:
+  ret void
+}
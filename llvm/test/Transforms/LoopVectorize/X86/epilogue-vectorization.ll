@@ -0,0 +1,89 @@
+; RUN: opt < %s -loop-vectorize -enable-epilogue-vectorization -force-vector-width=16 -force-vector-interleave=1 -force-target-instruction-cost=1 -pass-remarks=loop-vectorize -S 2>%t | FileCheck %s
+; RUN: FileCheck %s --check-prefix=REMARK < %t
+; RUN: opt < %s -loop-vectorize -force-vector-width=16 -force-vector-interleave=1 -force-target-instruction-cost=1 -S | FileCheck %s --check-prefix=NOEPILOGUE
+; RUN: opt < %s -loop-vectorize -enable-epilogue-vectorization -epilogue-vectorization-min-vf=32 -force-vector-width=16 -force-vector-interleave=1 -force-target-instruction-cost=1 -S | FileCheck %s --check-prefix=NOEPILOGUE
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; The remainder of the vector loop, which is also the whole loop when it runs
+; fewer than 16 iterations, is vectorized again with half the width.
+
+; REMARK: vectorized loop (vectorization width: 16, interleaved count: 1)
+; REMARK: vectorized epilogue loop (vectorization width: 8)
+; REMARK: vectorized loop (vectorization width: 16, interleaved count: 1)
+; REMARK: vectorized epilogue loop (vectorization width: 8)
+
+; CHECK-LABEL: @add(
+; CHECK: vector.body:
+; CHECK: load <16 x i32>
+; CHECK: store <16 x i32>
+; CHECK: middle.block:
+; CHECK: scalar.ph:
+; CHECK: load <8 x i32>
+; CHECK: store <8 x i32>
+; CHECK: for.body:
+; CHECK: load i32
+; CHECK: store i32
+; CHECK: for.end:
+; CHECK-NEXT: ret void
+
+; NOEPILOGUE-LABEL: @add(
+; NOEPILOGUE: load <16 x i32>
+; NOEPILOGUE-NOT: <8 x i32>
+; NOEPILOGUE: ret void
+define void @add(i32* noalias nocapture %a, i32* noalias nocapture readonly %b, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %b, i64 %i
+  %0 = load i32, i32* %arrayidx, align 4
+  %add = add nsw i32 %0, 1
+  %arrayidx2 = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 %add, i32* %arrayidx2, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; The value of the reduction after the loop comes from the scalar loop, the
+; vector loop or the vector epilogue.
+
+; CHECK-LABEL: @sum(
+; CHECK: vector.body:
+; CHECK: load <16 x i32>
+; CHECK: middle.block:
+; CHECK: scalar.ph:
+; CHECK: %bc.merge.rdx = phi i32
+; CHECK: load <8 x i32>
+; CHECK: for.end:
+; CHECK-NEXT: %add.lcssa = phi i32 [ %add, %for.body ], [ %{{.*}}, %middle.block ], [ %{{.*}}, %middle.block{{.+}} ]
+; CHECK-NEXT: ret i32 %add.lcssa
+
+; NOEPILOGUE-LABEL: @sum(
+; NOEPILOGUE: load <16 x i32>
+; NOEPILOGUE-NOT: <8 x i32>
+; NOEPILOGUE: ret i32
+define i32 @sum(i32* nocapture readonly %a, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %s = phi i32 [ 0, %entry ], [ %add, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %a, i64 %i
+  %0 = load i32, i32* %arrayidx, align 4
+  %add = add nsw i32 %0, %s
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  %add.lcssa = phi i32 [ %add, %for.body ]
+  ret i32 %add.lcssa
+}
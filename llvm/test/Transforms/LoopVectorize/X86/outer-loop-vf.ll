@@ -0,0 +1,59 @@
+; RUN: opt < %s -loop-vectorize -enable-outer-loop-vectorization -mcpu=core-avx2 -S | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; for (i = 0; i < n; ++i) {
+;   s = 0;
+;   for (j = 0; j < 8; ++j)
+;     s += in[i + j] * w[j];
+;   out[i] = s;
+; }
+;
+; The widest type loaded or stored is float, so all the lanes of a 256-bit
+; register are used: the i64 induction and the address computations do not
+; limit the width.
+
+; CHECK-LABEL: @stencil_float(
+; CHECK: inner.vec:
+; CHECK: %vec.phi = phi <8 x float>
+; CHECK: load <8 x float>
+; CHECK: fmul fast <8 x float>
+; CHECK: outer.latch.vec:
+; CHECK: store <8 x float>
+; CHECK: %index.next = add i64 %index, 8
+define void @stencil_float(float* noalias %out, float* noalias %in, float* noalias %w, i64 %n) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %s = phi float [ 0.0, %outer ], [ %s.next, %inner ]
+  %idx = add nuw nsw i64 %i, %j
+  %p = getelementptr inbounds float, float* %in, i64 %idx
+  %x = load float, float* %p, align 4, !llvm.mem.parallel_loop_access !0
+  %q = getelementptr inbounds float, float* %w, i64 %j
+  %y = load float, float* %q, align 4, !llvm.mem.parallel_loop_access !0
+  %m = fmul fast float %x, %y
+  %s.next = fadd fast float %s, %m
+  %j.next = add nuw nsw i64 %j, 1
+  %inner.done = icmp eq i64 %j.next, 8
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %s.lcssa = phi float [ %s.next, %inner ]
+  %o = getelementptr inbounds float, float* %out, i64 %i
+  store float %s.lcssa, float* %o, align 4, !llvm.mem.parallel_loop_access !0
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.done = icmp eq i64 %i.next, %n
+  br i1 %outer.done, label %exit, label %outer, !llvm.loop !0
+
+exit:
+  ret void
+}
+
+!0 = distinct !{!0}
@@ -0,0 +1,123 @@
+; RUN: opt < %s -loop-vectorize -enable-outer-loop-vectorization -force-vector-width=4 -pass-remarks-analysis=loop-vectorize -S 2>%t | FileCheck %s
+; RUN: FileCheck %s --check-prefix=REMARK < %t
+; RUN: opt < %s -loop-vectorize -force-vector-width=4 -S | FileCheck %s --check-prefix=DISABLED
+
+target datalayout = "e-m:e-i64:64-i128:128-n32:64-S128"
+
+; for (i = 0; i < n; ++i) {
+;   s = 0;
+;   for (j = 0; j < 8; ++j)
+;     s += in[i + j] * w[j];
+;   out[i] = s;
+; }
+;
+; The inner loop runs the same iterations for all the lanes, and the loads of
+; w are the same for all of them.
+
+; CHECK-LABEL: @stencil(
+; CHECK: %n.vec = sub i64 %n, %n.mod.vf
+; CHECK: %min.iters.check = icmp eq i64 %n.vec, 0
+; CHECK: br i1 %min.iters.check, label %scalar.ph, label %vector.ph
+; CHECK: outer.vec:
+; CHECK: %index = phi i64 [ 0, %vector.ph ], [ %index.next, %outer.latch.vec ]
+; CHECK: inner.vec:
+; CHECK: %vec.phi = phi <4 x i32> [ zeroinitializer, %outer.vec ], [ [[SUM:%.*]], %inner.vec ]
+; CHECK: [[X:%.*]] = load <4 x i32>, <4 x i32>* {{.*}}, align 4
+; CHECK: [[Y:%.*]] = load i32, i32* %q.vec, align 4
+; CHECK: [[M:%.*]] = mul nsw <4 x i32> [[X]],
+; CHECK: [[SUM]] = add nsw <4 x i32> %vec.phi, [[M]]
+; CHECK: br i1 %inner.done.vec, label %outer.latch.vec, label %inner.vec
+; CHECK: outer.latch.vec:
+; CHECK: store <4 x i32> {{.*}}, <4 x i32>* {{.*}}, align 4
+; CHECK: %index.next = add i64 %index, 4
+; CHECK: br i1 {{.*}}, label %middle.block, label %outer.vec
+; CHECK: middle.block:
+; CHECK: %cmp.n = icmp eq i64 %n, %n.vec
+; CHECK: br i1 %cmp.n, label %exit, label %scalar.ph
+; CHECK: scalar.ph:
+; CHECK: %bc.resume.val = phi i64 [ 0, %entry ], [ %ind.end, %middle.block ]
+; CHECK: outer:
+; CHECK: %i = phi i64 [ %bc.resume.val, %scalar.ph ], [ %i.next, %outer.latch ]
+; CHECK: load i32
+; CHECK: store i32
+
+; DISABLED-LABEL: @stencil(
+; DISABLED-NOT: <4 x i32>
+; DISABLED: ret void
+define void @stencil(i32* noalias %out, i32* noalias %in, i32* noalias %w, i64 %n) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %s = phi i32 [ 0, %outer ], [ %s.next, %inner ]
+  %idx = add nuw nsw i64 %i, %j
+  %p = getelementptr inbounds i32, i32* %in, i64 %idx
+  %x = load i32, i32* %p, align 4, !llvm.mem.parallel_loop_access !0
+  %q = getelementptr inbounds i32, i32* %w, i64 %j
+  %y = load i32, i32* %q, align 4, !llvm.mem.parallel_loop_access !0
+  %m = mul nsw i32 %x, %y
+  %s.next = add nsw i32 %s, %m
+  %j.next = add nuw nsw i64 %j, 1
+  %inner.done = icmp eq i64 %j.next, 8
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %s.lcssa = phi i32 [ %s.next, %inner ]
+  %o = getelementptr inbounds i32, i32* %out, i64 %i
+  store i32 %s.lcssa, i32* %o, align 4, !llvm.mem.parallel_loop_access !0
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.done = icmp eq i64 %i.next, %n
+  br i1 %outer.done, label %exit, label %outer, !llvm.loop !0
+
+exit:
+  ret void
+}
+
+; Without the annotation, the iterations of the outer loop may depend on each
+; other.
+
+; REMARK: loop not vectorized: outer loop iterations are not annotated as parallel
+
+; CHECK-LABEL: @not_parallel(
+; CHECK-NOT: <4 x i32>
+; CHECK: ret void
+define void @not_parallel(i32* noalias %out, i32* noalias %in, i32* noalias %w, i64 %n) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %s = phi i32 [ 0, %outer ], [ %s.next, %inner ]
+  %idx = add nuw nsw i64 %i, %j
+  %p = getelementptr inbounds i32, i32* %in, i64 %idx
+  %x = load i32, i32* %p, align 4
+  %q = getelementptr inbounds i32, i32* %w, i64 %j
+  %y = load i32, i32* %q, align 4
+  %m = mul nsw i32 %x, %y
+  %s.next = add nsw i32 %s, %m
+  %j.next = add nuw nsw i64 %j, 1
+  %inner.done = icmp eq i64 %j.next, 8
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %s.lcssa = phi i32 [ %s.next, %inner ]
+  %o = getelementptr inbounds i32, i32* %out, i64 %i
+  store i32 %s.lcssa, i32* %o, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.done = icmp eq i64 %i.next, %n
+  br i1 %outer.done, label %exit, label %outer
+
+exit:
+  ret void
+}
+
+!0 = distinct !{!0}
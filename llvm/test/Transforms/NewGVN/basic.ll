@@ -0,0 +1,91 @@
+; RUN: opt < %s -newgvn -S | FileCheck %s
+; RUN: opt < %s -passes=newgvn -S | FileCheck %s
+; RUN: opt < %s -O2 -enable-newgvn -debug-pass=Structure -o /dev/null 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=PIPELINE
+
+; PIPELINE: Global Value Numbering on MemorySSA
+
+; Operations with commuted operands are congruent, and so is a phi of
+; congruent values.
+define i32 @commuted(i32 %a, i32 %b, i1 %c) {
+; CHECK-LABEL: @commuted(
+; CHECK-NOT: %y =
+; CHECK-NOT: %r =
+; CHECK: ret i32 %x
+entry:
+  %x = add i32 %a, %b
+  br i1 %c, label %then, label %exit
+
+then:
+  %y = add i32 %b, %a
+  br label %exit
+
+exit:
+  %r = phi i32 [ %y, %then ], [ %x, %entry ]
+  ret i32 %r
+}
+
+; Comparisons with swapped operands and predicates are congruent.
+define i1 @swapped_cmp(i32 %a, i32 %b) {
+; CHECK-LABEL: @swapped_cmp(
+; CHECK-NEXT: %c1 = icmp slt i32 %a, %b
+; CHECK-NEXT: ret i1 %c1
+  %c1 = icmp slt i32 %a, %b
+  %c2 = icmp sgt i32 %b, %a
+  %r = and i1 %c1, %c2
+  ret i1 %r
+}
+
+; The induction variables are only congruent under the optimistic assumption
+; that the values coming from the back edge are.
+define i32 @optimistic_loop(i32 %n) {
+; CHECK-LABEL: @optimistic_loop(
+; CHECK: %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+; CHECK-NOT: %j
+; CHECK: ret i32 0
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %j = phi i32 [ 0, %entry ], [ %j.next, %loop ]
+  %i.next = add i32 %i, 1
+  %j.next = add i32 %j, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %r = sub i32 %i.next, %j.next
+  ret i32 %r
+}
+
+; The edge out of a branch on a condition congruent to a constant which is
+; not taken is unreachable, and so is the phi operand coming from it.
+define i32 @unreachable_edge(i32 %a) {
+; CHECK-LABEL: @unreachable_edge(
+; CHECK: br i1 true, label %exit, label %dead
+; CHECK: exit:
+; CHECK-NEXT: ret i32 %a
+entry:
+  %c = icmp eq i32 %a, %a
+  br i1 %c, label %exit, label %dead
+
+dead:
+  br label %exit
+
+exit:
+  %p = phi i32 [ %a, %entry ], [ 0, %dead ]
+  ret i32 %p
+}
+
+declare i32 @pure(i32) readnone nounwind
+
+define i32 @readnone_calls(i32 %x) {
+; CHECK-LABEL: @readnone_calls(
+; CHECK-NEXT: %a = call i32 @pure(i32 %x)
+; CHECK-NEXT: ret i32 0
+  %a = call i32 @pure(i32 %x)
+  %b = call i32 @pure(i32 %x)
+  %r = sub i32 %a, %b
+  ret i32 %r
+}
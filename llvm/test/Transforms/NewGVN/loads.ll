@@ -0,0 +1,86 @@
+; RUN: opt < %s -newgvn -S | FileCheck %s
+; RUN: opt < %s -passes=newgvn -S | FileCheck %s
+
+define i32 @store_forward(i32* %p, i32 %v) {
+; CHECK-LABEL: @store_forward(
+; CHECK-NOT: load
+; CHECK: ret i32 %v
+  store i32 %v, i32* %p
+  %l = load i32, i32* %p
+  ret i32 %l
+}
+
+define i32 @redundant_load(i32* %p, i1 %c) {
+; CHECK-LABEL: @redundant_load(
+; CHECK: then:
+; CHECK-NEXT: %s = add i32 %a, %a
+entry:
+  %a = load i32, i32* %p
+  br i1 %c, label %then, label %exit
+
+then:
+  %b = load i32, i32* %p
+  %s = add i32 %a, %b
+  ret i32 %s
+
+exit:
+  ret i32 0
+}
+
+define i32 @clobbered_load(i32* %p, i32* %q) {
+; CHECK-LABEL: @clobbered_load(
+; CHECK: %r = sub i32 %a, %b
+  %a = load i32, i32* %p
+  store i32 1, i32* %q
+  %b = load i32, i32* %p
+  %r = sub i32 %a, %b
+  ret i32 %r
+}
+
+; The store on the unreachable edge does not reach the MemoryPhi, which is
+; then congruent to the memory state before it.
+define i32 @memory_phi_unreachable_edge(i32* %p, i32 %x) {
+; CHECK-LABEL: @memory_phi_unreachable_edge(
+; CHECK: merge:
+; CHECK-NEXT: ret i32 0
+entry:
+  %a = load i32, i32* %p
+  %c = icmp eq i32 %x, %x
+  br i1 %c, label %merge, label %dead
+
+dead:
+  store i32 0, i32* %p
+  br label %merge
+
+merge:
+  %b = load i32, i32* %p
+  %r = sub i32 %a, %b
+  ret i32 %r
+}
+
+define i32 @forward_through_memory_phi(i32* %p, i32 %v, i32 %x) {
+; CHECK-LABEL: @forward_through_memory_phi(
+; CHECK: merge:
+; CHECK-NEXT: ret i32 %v
+entry:
+  store i32 %v, i32* %p
+  %c = icmp eq i32 %x, %x
+  br i1 %c, label %merge, label %dead
+
+dead:
+  store i32 0, i32* %p
+  br label %merge
+
+merge:
+  %b = load i32, i32* %p
+  ret i32 %b
+}
+
+@constant = constant i32 42
+
+define i32 @constant_load() {
+; CHECK-LABEL: @constant_load(
+; CHECK-NEXT: ret i32 42
+  %l = load i32, i32* @constant
+  ret i32 %l
+}
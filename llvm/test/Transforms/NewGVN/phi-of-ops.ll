@@ -0,0 +1,51 @@
+; RUN: opt < %s -newgvn -S | FileCheck %s
+; RUN: opt < %s -passes=newgvn -S | FileCheck %s
+
+; %y is the phi of the additions in the predecessors, which %q already is.
+define i32 @phi_of_ops(i32 %a, i32 %b, i1 %c) {
+; CHECK-LABEL: @phi_of_ops(
+; CHECK: merge:
+; CHECK-NEXT: %p = phi i32 [ %a, %left ], [ %b, %right ]
+; CHECK-NEXT: %q = phi i32 [ %x1, %left ], [ %x2, %right ]
+; CHECK-NEXT: ret i32 0
+entry:
+  br i1 %c, label %left, label %right
+
+left:
+  %x1 = add i32 %a, 1
+  br label %merge
+
+right:
+  %x2 = add i32 %b, 1
+  br label %merge
+
+merge:
+  %p = phi i32 [ %a, %left ], [ %b, %right ]
+  %q = phi i32 [ %x1, %left ], [ %x2, %right ]
+  %y = add i32 %p, 1
+  %r = sub i32 %y, %q
+  ret i32 %r
+}
+
+; The addition is not available in %right, so it is not a phi.
+define i32 @phi_of_ops_unavailable(i32 %a, i32 %b, i1 %c) {
+; CHECK-LABEL: @phi_of_ops_unavailable(
+; CHECK: %y = add i32 %p, 1
+; CHECK: %r = sub i32 %y, %q
+entry:
+  br i1 %c, label %left, label %right
+
+left:
+  %x1 = add i32 %a, 1
+  br label %merge
+
+right:
+  br label %merge
+
+merge:
+  %p = phi i32 [ %a, %left ], [ %b, %right ]
+  %q = phi i32 [ %x1, %left ], [ %b, %right ]
+  %y = add i32 %p, 1
+  %r = sub i32 %y, %q
+  ret i32 %r
+}
@@ -0,0 +1,76 @@
+; RUN: opt < %s -pgo-icall-prom -S | FileCheck %s --check-prefix=ICALL-PROM
+; RUN: opt < %s -passes=pgo-icall-prom -S | FileCheck %s --check-prefix=ICALL-PROM
+; RUN: opt < %s -pgo-icall-prom -icp-vtable-cmp=false -S | FileCheck %s --check-prefix=NO-VTABLE-CMP
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+%struct.A = type { i32 (...)** }
+
+; B overrides A::f, C does not.
+@_ZTV1A = constant [3 x i8*] [i8* null, i8* null, i8* bitcast (i32 (%struct.A*)* @_ZN1A1fEv to i8*)], !type !0
+@_ZTV1B = constant [3 x i8*] [i8* null, i8* null, i8* bitcast (i32 (%struct.A*)* @_ZN1B1fEv to i8*)], !type !0, !type !1
+@_ZTV1C = constant [3 x i8*] [i8* null, i8* null, i8* bitcast (i32 (%struct.A*)* @_ZN1A1fEv to i8*)], !type !0, !type !2
+
+define i32 @_ZN1A1fEv(%struct.A* %this) {
+entry:
+  ret i32 1
+}
+
+define i32 @_ZN1B1fEv(%struct.A* %this) {
+entry:
+  ret i32 2
+}
+
+; B::f is only found in the vtable of B: compare the vtable pointer with it,
+; and only load the function pointer when the comparison fails.
+; ICALL-PROM-LABEL: @call_b(
+; NO-VTABLE-CMP-LABEL: @call_b(
+define i32 @call_b(%struct.A* %obj) {
+entry:
+  %vtable.ptr = bitcast %struct.A* %obj to i32 (%struct.A*)***
+  %vtable = load i32 (%struct.A*)**, i32 (%struct.A*)*** %vtable.ptr, align 8
+  %vtable.i8 = bitcast i32 (%struct.A*)** %vtable to i8*
+  %is.a = call i1 @llvm.type.test(i8* %vtable.i8, metadata !"_ZTS1A")
+  call void @llvm.assume(i1 %is.a)
+  %fptr = load i32 (%struct.A*)*, i32 (%struct.A*)** %vtable, align 8
+; ICALL-PROM-NOT: %fptr = load
+; ICALL-PROM: [[CMP:%[0-9]+]] = icmp eq i8* %vtable.i8, getelementptr inbounds (i8, i8* bitcast ([3 x i8*]* @_ZTV1B to i8*), i64 16)
+; ICALL-PROM-NEXT: br i1 [[CMP]], label %if.true.direct_targ, label %if.false.orig_indirect, !prof [[BRANCH_WEIGHT:![0-9]+]]
+; ICALL-PROM: if.true.direct_targ:
+; ICALL-PROM-NEXT: [[DIRCALL_RET:%[0-9]+]] = call i32 @_ZN1B1fEv(%struct.A* %obj)
+; ICALL-PROM: if.false.orig_indirect:
+; ICALL-PROM-NEXT: %fptr = load i32 (%struct.A*)*, i32 (%struct.A*)** %vtable, align 8
+; ICALL-PROM-NEXT: %call = call i32 %fptr(%struct.A* %obj)
+; NO-VTABLE-CMP: %fptr = load
+; NO-VTABLE-CMP: icmp eq i8* %{{[0-9]+}}, bitcast (i32 (%struct.A*)* @_ZN1B1fEv to i8*)
+  %call = call i32 %fptr(%struct.A* %obj), !prof !3
+  ret i32 %call
+}
+
+; A::f is found in the vtables of both A and C: keep comparing the function
+; pointer.
+; ICALL-PROM-LABEL: @call_a(
+define i32 @call_a(%struct.A* %obj) {
+entry:
+  %vtable.ptr = bitcast %struct.A* %obj to i32 (%struct.A*)***
+  %vtable = load i32 (%struct.A*)**, i32 (%struct.A*)*** %vtable.ptr, align 8
+  %vtable.i8 = bitcast i32 (%struct.A*)** %vtable to i8*
+  %is.a = call i1 @llvm.type.test(i8* %vtable.i8, metadata !"_ZTS1A")
+  call void @llvm.assume(i1 %is.a)
+; ICALL-PROM: %fptr = load i32 (%struct.A*)*, i32 (%struct.A*)** %vtable, align 8
+; ICALL-PROM: [[BITCAST:%[0-9]+]] = bitcast i32 (%struct.A*)* %fptr to i8*
+; ICALL-PROM: icmp eq i8* [[BITCAST]], bitcast (i32 (%struct.A*)* @_ZN1A1fEv to i8*)
+  %fptr = load i32 (%struct.A*)*, i32 (%struct.A*)** %vtable, align 8
+  %call = call i32 %fptr(%struct.A* %obj), !prof !4
+  ret i32 %call
+}
+
+declare i1 @llvm.type.test(i8*, metadata)
+declare void @llvm.assume(i1)
+
+!0 = !{i64 16, !"_ZTS1A"}
+!1 = !{i64 16, !"_ZTS1B"}
+!2 = !{i64 16, !"_ZTS1C"}
+!3 = !{!"VP", i32 0, i64 1600, i64 4591355986379362604, i64 1500}
+!4 = !{!"VP", i32 0, i64 1600, i64 10489283440387718362, i64 1500}
+; ICALL-PROM: [[BRANCH_WEIGHT]] = !{!"branch_weights", i32 1500, i32 100}
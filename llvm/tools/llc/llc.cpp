@@ -69,6 +69,11 @@ TimeCompilations("time-compilations", cl::Hidden, cl::init(1u),
                  cl::value_desc("N"),
                  cl::desc("Repeat compilation N times for timing"));
 
+static cl::opt<bool> PrintContextStats(
+    "print-context-stats",
+    cl::desc("Print the sizes of the uniquing tables of the LLVMContext when "
+             "done"));
+
 static cl::opt<bool>
 NoIntegratedAssembler("no-integrated-as", cl::Hidden,
                       cl::desc("Disable integrated assembler"));
@@ -264,6 +269,11 @@ int main(int argc, char **argv) {
   for (unsigned I = TimeCompilations; I; --I)
     if (int RetVal = compileModule(argv, Context))
       return RetVal;
+
+  // The module is gone by now; what is left is only referenced by the
+  // context.
+  if (PrintContextStats)
+    Context.printUniquingTableStats(errs());
   return 0;
 }
 
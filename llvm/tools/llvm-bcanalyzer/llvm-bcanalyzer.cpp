@@ -39,6 +39,7 @@
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cctype>
@@ -71,6 +72,12 @@ static cl::opt<bool>
   ShowBinaryBlobs("show-binary-blobs",
                   cl::desc("Print binary blobs using hex escapes"));
 
+static cl::opt<unsigned>
+  BenchmarkRuns("benchmark-runs",
+                cl::desc("Only decode all the records of the file, the given "
+                         "number of times, and print the decoding throughput"),
+                cl::init(0));
+
 namespace {
 
 /// CurStreamTypeType - A type for CurStreamType
@@ -913,6 +920,81 @@ static int AnalyzeBitcode() {
 }
 
 
+/// BenchmarkDecoding - Decode the records of the file specified by
+/// InputFilename as the bitcode reader does, BenchmarkRuns times, without
+/// analyzing them.
+static int BenchmarkDecoding() {
+  std::unique_ptr<MemoryBuffer> StreamBuffer;
+  BitstreamReader StreamFile;
+  BitstreamCursor Stream;
+  CurStreamTypeType CurStreamType;
+  if (openBitcodeFile(InputFilename, StreamBuffer, StreamFile, Stream,
+                      CurStreamType))
+    return true;
+
+  uint64_t StartBit = Stream.GetCurrentBitNo();
+  uint64_t NumRecords = 0;
+  SmallVector<uint64_t, 64> Record;
+  StringRef Blob;
+  TimeRecord StartTime = TimeRecord::getCurrentTime(true);
+  for (unsigned Run = 0; Run != BenchmarkRuns; ++Run) {
+    Stream.JumpToBit(StartBit);
+    while (!Stream.AtEndOfStream()) {
+      if (Stream.ReadCode() != bitc::ENTER_SUBBLOCK)
+        return Error("Invalid record at top-level");
+      unsigned BlockID = Stream.ReadSubBlockID();
+      if (BlockID == bitc::BLOCKINFO_BLOCK_ID) {
+        if (Stream.ReadBlockInfoBlock())
+          return Error("Malformed BlockInfoBlock");
+        continue;
+      }
+      if (Stream.EnterSubBlock(BlockID))
+        return Error("Malformed block record");
+
+      // Walk the block and its subblocks; the block info is only read once,
+      // by the first run.
+      unsigned Depth = 1;
+      while (Depth) {
+        BitstreamEntry Entry = Stream.advance();
+        switch (Entry.Kind) {
+        case BitstreamEntry::Error:
+          return Error("malformed bitcode file");
+        case BitstreamEntry::EndBlock:
+          --Depth;
+          break;
+        case BitstreamEntry::SubBlock:
+          if (Entry.ID == bitc::BLOCKINFO_BLOCK_ID) {
+            if (Stream.ReadBlockInfoBlock())
+              return Error("Malformed BlockInfoBlock");
+            break;
+          }
+          if (Stream.EnterSubBlock(Entry.ID))
+            return Error("Malformed block record");
+          ++Depth;
+          break;
+        case BitstreamEntry::Record:
+          Record.clear();
+          Stream.readRecord(Entry.ID, Record, &Blob);
+          ++NumRecords;
+          break;
+        }
+      }
+    }
+  }
+  TimeRecord Elapsed = TimeRecord::getCurrentTime(false);
+  Elapsed -= StartTime;
+
+  double MegaBytes = double(Stream.GetCurrentBitNo() - StartBit) / CHAR_BIT *
+                     BenchmarkRuns / (1024 * 1024);
+  outs() << "Decoded " << NumRecords << " records in " << BenchmarkRuns
+         << " runs\n";
+  outs() << format("  Wall time: %.3fs\n", Elapsed.getWallTime());
+  if (Elapsed.getWallTime() > 0)
+    outs() << format("  Throughput: %.1fMB/s\n",
+                     MegaBytes / Elapsed.getWallTime());
+  return 0;
+}
+
 int main(int argc, char **argv) {
   // Print a stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal(argv[0]);
@@ -920,5 +1002,7 @@ int main(int argc, char **argv) {
   llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
   cl::ParseCommandLineOptions(argc, argv, "llvm-bcanalyzer file analyzer\n");
 
+  if (BenchmarkRuns)
+    return BenchmarkDecoding();
   return AnalyzeBitcode();
 }
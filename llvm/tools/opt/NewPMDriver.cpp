@@ -14,6 +14,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "NewPMDriver.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/CGSCCPassManager.h"
@@ -23,8 +24,10 @@
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/PassInstrumentation.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Pass.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -47,6 +50,16 @@ static cl::opt<std::string>
                         "pipeline for handling managed aliasing queries"),
                cl::Hidden);
 
+static cl::opt<bool> PrintPassInstructionDeltas(
+    "print-pass-instruction-deltas", cl::Hidden,
+    cl::desc("Print how much each pass changes the instruction count of the "
+             "IR it runs on"));
+
+static cl::opt<bool>
+    PrintAnalysisCounts("print-analysis-counts", cl::Hidden,
+                        cl::desc("Print how often each analysis is computed "
+                                 "and invalidated"));
+
 bool llvm::runPassPipeline(StringRef Arg0, LLVMContext &Context, Module &M,
                            TargetMachine *TM, tool_output_file *Out,
                            StringRef PassPipeline, OutputKind OK,
@@ -63,6 +76,21 @@ bool llvm::runPassPipeline(StringRef Arg0, LLVMContext &Context, Module &M,
     return false;
   }
 
+  // The instrumentation is registered with the analysis managers, and thus
+  // has to outlive them.
+  PassInstrumentationCallbacks PIC;
+  PassTimingInfo TimingInfo;
+  PassInstructionCountTracker InstructionCounts;
+  AnalysisRunCounter AnalysisCounts;
+  if (TimePassesIsEnabled)
+    TimingInfo.registerCallbacks(PIC);
+  if (PrintPassInstructionDeltas)
+    InstructionCounts.registerCallbacks(PIC);
+  if (PrintAnalysisCounts)
+    AnalysisCounts.registerCallbacks(PIC);
+  bool UseInstrumentation =
+      TimePassesIsEnabled || PrintPassInstructionDeltas || PrintAnalysisCounts;
+
   LoopAnalysisManager LAM(DebugPM);
   FunctionAnalysisManager FAM(DebugPM);
   CGSCCAnalysisManager CGAM(DebugPM);
@@ -78,6 +106,13 @@ bool llvm::runPassPipeline(StringRef Arg0, LLVMContext &Context, Module &M,
   PB.registerLoopAnalyses(LAM);
   PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
 
+  if (UseInstrumentation) {
+    LAM.setPassInstrumentation(&PIC);
+    FAM.setPassInstrumentation(&PIC);
+    CGAM.setPassInstrumentation(&PIC);
+    MAM.setPassInstrumentation(&PIC);
+  }
+
   ModulePassManager MPM(DebugPM);
   if (VK > VK_NoVerifier)
     MPM.addPass(VerifierPass());
@@ -111,6 +146,16 @@ bool llvm::runPassPipeline(StringRef Arg0, LLVMContext &Context, Module &M,
   // Now that we have all of the passes ready, run them.
   MPM.run(M, MAM);
 
+  if (UseInstrumentation) {
+    std::unique_ptr<raw_fd_ostream> OS = CreateInfoOutputFile();
+    if (TimePassesIsEnabled)
+      TimingInfo.print(*OS);
+    if (PrintPassInstructionDeltas)
+      InstructionCounts.print(*OS);
+    if (PrintAnalysisCounts)
+      AnalysisCounts.print(*OS);
+  }
+
   // Declare success.
   if (OK != OK_NoOutput)
     Out->keep();
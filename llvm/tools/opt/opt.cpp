@@ -50,6 +50,7 @@
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/IPO/ParallelOptimize.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include <algorithm>
@@ -173,6 +174,17 @@ static cl::opt<bool> EmitSummaryIndex("module-summary",
 static cl::opt<bool> EmitModuleHash("module-hash", cl::desc("Emit module hash"),
                                     cl::init(false));
 
+static cl::opt<unsigned> FunctionPassThreads(
+    "function-pass-threads",
+    cl::desc("Number of threads to run the per-function passes of -O1, -O2, "
+             "-O3, -Os and -Oz on"),
+    cl::init(1));
+
+static cl::opt<bool> PrintContextStats(
+    "print-context-stats",
+    cl::desc("Print the sizes of the uniquing tables of the LLVMContext when "
+             "done"));
+
 static cl::opt<bool>
 DisableSimplifyLibCalls("disable-simplify-libcalls",
                         cl::desc("Disable simplify-libcalls"));
@@ -474,11 +486,13 @@ int main(int argc, char **argv) {
     // The user has asked to use the new pass manager and provided a pipeline
     // string. Hand off the rest of the functionality to the new code for that
     // layer.
-    return runPassPipeline(argv[0], Context, *M, TM.get(), Out.get(),
-                           PassPipeline, OK, VK, PreserveAssemblyUseListOrder,
-                           PreserveBitcodeUseListOrder)
-               ? 0
-               : 1;
+    bool Success = runPassPipeline(argv[0], Context, *M, TM.get(), Out.get(),
+                                   PassPipeline, OK, VK,
+                                   PreserveAssemblyUseListOrder,
+                                   PreserveBitcodeUseListOrder);
+    if (PrintContextStats)
+      Context.printUniquingTableStats(errs());
+    return Success ? 0 : 1;
   }
 
   // Create a PassManager to hold and optimize the collection of passes we are
@@ -511,6 +525,14 @@ int main(int argc, char **argv) {
         TM ? TM->getTargetIRAnalysis() : TargetIRAnalysis()));
   }
 
+  // The optimization levels added to FPasses, in order, to build the same
+  // function passes again for -function-pass-threads.
+  std::vector<std::pair<unsigned, unsigned>> FPassesLevels;
+  auto AddOptPasses = [&](unsigned OptLevel, unsigned SizeLevel) {
+    AddOptimizationPasses(Passes, *FPasses, TM.get(), OptLevel, SizeLevel);
+    FPassesLevels.push_back(std::make_pair(OptLevel, SizeLevel));
+  };
+
   if (PrintBreakpoints) {
     // Default to standard output.
     if (!Out) {
@@ -538,27 +560,27 @@ int main(int argc, char **argv) {
     }
 
     if (OptLevelO1 && OptLevelO1.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, TM.get(), 1, 0);
+      AddOptPasses(1, 0);
       OptLevelO1 = false;
     }
 
     if (OptLevelO2 && OptLevelO2.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, TM.get(), 2, 0);
+      AddOptPasses(2, 0);
       OptLevelO2 = false;
     }
 
     if (OptLevelOs && OptLevelOs.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, TM.get(), 2, 1);
+      AddOptPasses(2, 1);
       OptLevelOs = false;
     }
 
     if (OptLevelOz && OptLevelOz.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, TM.get(), 2, 2);
+      AddOptPasses(2, 2);
       OptLevelOz = false;
     }
 
     if (OptLevelO3 && OptLevelO3.getPosition() < PassList.getPosition(i)) {
-      AddOptimizationPasses(Passes, *FPasses, TM.get(), 3, 0);
+      AddOptPasses(3, 0);
       OptLevelO3 = false;
     }
 
@@ -610,21 +632,43 @@ int main(int argc, char **argv) {
   }
 
   if (OptLevelO1)
-    AddOptimizationPasses(Passes, *FPasses, TM.get(), 1, 0);
+    AddOptPasses(1, 0);
 
   if (OptLevelO2)
-    AddOptimizationPasses(Passes, *FPasses, TM.get(), 2, 0);
+    AddOptPasses(2, 0);
 
   if (OptLevelOs)
-    AddOptimizationPasses(Passes, *FPasses, TM.get(), 2, 1);
+    AddOptPasses(2, 1);
 
   if (OptLevelOz)
-    AddOptimizationPasses(Passes, *FPasses, TM.get(), 2, 2);
+    AddOptPasses(2, 2);
 
   if (OptLevelO3)
-    AddOptimizationPasses(Passes, *FPasses, TM.get(), 3, 0);
-
-  if (FPasses) {
+    AddOptPasses(3, 0);
+
+  // Each thread needs its own passes, and its own target machine for them.
+  auto RunFPassesOnPartition = [&](Module &MPart) {
+    std::unique_ptr<TargetMachine> PartTM;
+    if (ModuleTriple.getArch())
+      PartTM.reset(
+          GetTargetMachine(ModuleTriple, CPUStr, FeaturesStr, Options));
+    legacy::FunctionPassManager PartFPasses(&MPart);
+    PartFPasses.add(createTargetTransformInfoWrapperPass(
+        PartTM ? PartTM->getTargetIRAnalysis() : TargetIRAnalysis()));
+    legacy::PassManager UnusedPasses;
+    for (const auto &Levels : FPassesLevels)
+      AddOptimizationPasses(UnusedPasses, PartFPasses, PartTM.get(),
+                            Levels.first, Levels.second);
+    PartFPasses.doInitialization();
+    for (Function &F : MPart)
+      PartFPasses.run(F);
+    PartFPasses.doFinalization();
+  };
+
+  if (FPasses &&
+      !(FunctionPassThreads > 1 &&
+        optimizeFunctionsInParallel(*M, FunctionPassThreads,
+                                    RunFPassesOnPartition))) {
     FPasses->doInitialization();
     for (Function &F : *M)
       FPasses->run(F);
@@ -699,5 +743,8 @@ int main(int argc, char **argv) {
   if (!NoOutput || PrintBreakpoints)
     Out->keep();
 
+  if (PrintContextStats)
+    Context.printUniquingTableStats(errs());
+
   return 0;
 }
@@ -15,6 +15,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm-c/Core.h"
 #include "gtest/gtest.h"
 
@@ -476,5 +477,44 @@ TEST(ConstantsTest, BitcastToGEP) {
             Instruction::BitCast);
 }
 
+TEST(ConstantsTest, DropTriviallyDeadConstants) {
+  LLVMContext Context;
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  Type *Int8PtrTy = Type::getInt8PtrTy(Context);
+
+  // { i8* inttoptr (i32 42 to i8*), [2 x i32] [i32 1, i32 2] }, unused.
+  Constant *Ptr =
+      ConstantExpr::getIntToPtr(ConstantInt::get(Int32Ty, 42), Int8PtrTy);
+  uint32_t Elts[] = {1, 2};
+  Constant *Arr = ConstantDataArray::get(Context, Elts);
+  ConstantStruct::getAnon({Ptr, Arr});
+
+  // i8* inttoptr (i32 7 to i8*), used by a global.
+  Module M("MyModule", Context);
+  Constant *Used =
+      ConstantExpr::getIntToPtr(ConstantInt::get(Int32Ty, 7), Int8PtrTy);
+  new GlobalVariable(M, Int8PtrTy, true, GlobalValue::ExternalLinkage, Used,
+                     "used");
+
+  // i8* inttoptr (i32 9 to i8*), used only by metadata.
+  Constant *InMD =
+      ConstantExpr::getIntToPtr(ConstantInt::get(Int32Ty, 9), Int8PtrTy);
+  auto *MD = ConstantAsMetadata::get(InMD);
+
+  // The struct goes first, which leaves its operands dead as well.
+  EXPECT_EQ(3u, Context.dropTriviallyDeadConstants());
+  EXPECT_EQ(0u, Context.dropTriviallyDeadConstants());
+  EXPECT_EQ(Used,
+            ConstantExpr::getIntToPtr(ConstantInt::get(Int32Ty, 7), Int8PtrTy));
+  EXPECT_EQ(InMD, MD->getValue());
+  EXPECT_EQ(InMD,
+            ConstantExpr::getIntToPtr(ConstantInt::get(Int32Ty, 9), Int8PtrTy));
+
+  std::string Stats;
+  raw_string_ostream OS(Stats);
+  Context.printUniquingTableStats(OS);
+  EXPECT_NE(std::string::npos, OS.str().find("ConstantExpr"));
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
@@ -823,6 +823,30 @@ TEST_F(DILocationTest, cloneTemporary) {
   EXPECT_TRUE(L2->isTemporary());
 }
 
+TEST_F(DILocationTest, dropUnusedDebugLocations) {
+  DISubprogram *SP = getSubprogram();
+  Function *F = getFunction("foo");
+  BasicBlock *BB = BasicBlock::Create(Context, "entry", F);
+  ReturnInst *Ret = ReturnInst::Create(Context, BB);
+
+  // The location of the return, inlined at another one, and a location used
+  // by a loop identifier.
+  DILocation *InlinedAt = DILocation::get(Context, 1, 1, SP);
+  DILocation *Used = DILocation::get(Context, 2, 2, SP, InlinedAt);
+  Ret->setDebugLoc(Used);
+  DILocation *InLoop = DILocation::get(Context, 3, 3, SP);
+  MDTuple *Loop = MDTuple::getDistinct(Context, InLoop);
+
+  // Locations left behind, one inlined at another.
+  DILocation::get(Context, 4, 4, SP, DILocation::get(Context, 5, 5, SP));
+
+  EXPECT_EQ(2u, Context.dropUnusedDebugLocations());
+  EXPECT_EQ(0u, Context.dropUnusedDebugLocations());
+  EXPECT_EQ(Used, DILocation::get(Context, 2, 2, SP, InlinedAt));
+  EXPECT_EQ(InLoop, DILocation::get(Context, 3, 3, SP));
+  EXPECT_EQ(InLoop, Loop->getOperand(0));
+}
+
 typedef MetadataTest GenericDINodeTest;
 
 TEST_F(GenericDINodeTest, get) {
@@ -331,4 +331,84 @@ TEST_F(PassManagerTest, Basic) {
 
   EXPECT_EQ(1, ModuleAnalysisRuns);
 }
+
+TEST_F(PassManagerTest, Instrumentation) {
+  PassInstrumentationCallbacks PIC;
+
+  FunctionAnalysisManager FAM;
+  int FunctionAnalysisRuns = 0;
+  FAM.registerPass([&] { return TestFunctionAnalysis(FunctionAnalysisRuns); });
+  FAM.setPassInstrumentation(&PIC);
+
+  ModuleAnalysisManager MAM;
+  int ModuleAnalysisRuns = 0;
+  MAM.registerPass([&] { return TestModuleAnalysis(ModuleAnalysisRuns); });
+  MAM.registerPass([&] { return FunctionAnalysisManagerModuleProxy(FAM); });
+  FAM.registerPass([&] { return ModuleAnalysisManagerFunctionProxy(MAM); });
+  MAM.setPassInstrumentation(&PIC);
+
+  // Skip the counting pass on 'g', and record the size of 'f' as the pass
+  // sees it.
+  int BeforePassRuns = 0, AfterPassRuns = 0, SkippedPassRuns = 0;
+  unsigned InstructionsInF = 0;
+  PIC.registerBeforePassCallback(
+      [&](StringRef PassName, const PassInstrumentationIRUnit &IR) {
+        if (PassName != TestFunctionPass::name())
+          return true;
+        ++BeforePassRuns;
+        if (IR.getName() == "f")
+          InstructionsInF = IR.getInstructionCount();
+        return IR.getName() != "g";
+      });
+  PIC.registerAfterPassCallback(
+      [&](StringRef PassName, const PassInstrumentationIRUnit &) {
+        if (PassName == TestFunctionPass::name())
+          ++AfterPassRuns;
+      });
+  PIC.registerPassSkippedCallback(
+      [&](StringRef PassName, const PassInstrumentationIRUnit &IR) {
+        EXPECT_EQ(TestFunctionPass::name(), PassName);
+        EXPECT_EQ("g", IR.getName());
+        ++SkippedPassRuns;
+      });
+
+  int AnalysisRuns = 0, AnalysisInvalidations = 0;
+  PIC.registerAfterAnalysisCallback(
+      [&](StringRef AnalysisName, const PassInstrumentationIRUnit &) {
+        if (AnalysisName == TestFunctionAnalysis::name())
+          ++AnalysisRuns;
+      });
+  PIC.registerAnalysisInvalidatedCallback(
+      [&](StringRef AnalysisName, const PassInstrumentationIRUnit &IR) {
+        if (AnalysisName != TestFunctionAnalysis::name())
+          return;
+        EXPECT_EQ("f", IR.getName());
+        ++AnalysisInvalidations;
+      });
+
+  int FunctionPassRunCount = 0;
+  int AnalyzedInstrCount = 0;
+  int AnalyzedFunctionCount = 0;
+  ModulePassManager MPM;
+  {
+    FunctionPassManager FPM;
+    FPM.addPass(TestFunctionPass(FunctionPassRunCount, AnalyzedInstrCount,
+                                 AnalyzedFunctionCount));
+    FPM.addPass(TestInvalidationFunctionPass("f"));
+    MPM.addPass(createModuleToFunctionPassAdaptor(std::move(FPM)));
+  }
+  MPM.run(*M, MAM);
+
+  EXPECT_EQ(3, BeforePassRuns);
+  EXPECT_EQ(2, AfterPassRuns);
+  EXPECT_EQ(1, SkippedPassRuns);
+  EXPECT_EQ(3u, InstructionsInF);
+
+  EXPECT_EQ(2, FunctionPassRunCount);
+  EXPECT_EQ(4, AnalyzedInstrCount);
+
+  EXPECT_EQ(2, FunctionAnalysisRuns);
+  EXPECT_EQ(2, AnalysisRuns);
+  EXPECT_EQ(1, AnalysisInvalidations);
+}
 }